@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define HWM_ANALYZER_USE_SSE 1
+#endif
+
+#include "./TripleBuffer.hpp"
+
+namespace hwm {
+
+//! I[fBIXbhGUIXbh֓n͌
+struct MeterSnapshot
+{
+	enum {
+		MAX_CHANNELS = 8,
+		WAVEFORM_POINTS = 256,		//! g`\̓_
+		FFT_SIZE = 1024,
+		SPECTRUM_BINS = FFT_SIZE / 2
+	};
+
+	size_t	num_channels;
+	size_t	sampling_rate;
+	//! ̉͌ʂ܂łɏt[
+	unsigned long long	position;
+
+	//! s[NlRMSl(jA)Bs[N͈̑ŌARMS͖300ms̎萔ŕςB
+	float	peak[MAX_CHANNELS];
+	float	rms[MAX_CHANNELS];
+
+	//! Ԉg`B1_ƂɁAԈԂ̍ŏlƍőlBÂB
+	float	waveform_min[MAX_CHANNELS][WAVEFORM_POINTS];
+	float	waveform_max[MAX_CHANNELS][WAVEFORM_POINTS];
+
+	//! S`lZM̃p[XyNg(dB)B
+	//! spectrum_db[i]̎g i * sampling_rate / FFT_SIZE
+	float	spectrum_db[SPECTRUM_BINS];
+};
+
+//! [^[XyNgŕ\ŏ̃x(dB)
+static float const MIN_DB = -120.0f;
+
+namespace analyzer_detail {
+
+	//! Βl̍őlƓa
+	inline void PeakAndSumOfSquares(float const *data, size_t length, float &peak, float &sum_of_squares)
+	{
+		size_t i = 0;
+#if defined(HWM_ANALYZER_USE_SSE)
+		__m128 const sign_mask = _mm_set1_ps(-0.0f);
+		__m128 max0 = _mm_setzero_ps();
+		__m128 sum0 = _mm_setzero_ps();
+		__m128 sum1 = _mm_setzero_ps();
+		for( ; i + 8 <= length; i += 8) {
+			__m128 const x0 = _mm_loadu_ps(data + i);
+			__m128 const x1 = _mm_loadu_ps(data + i + 4);
+			max0 = _mm_max_ps(max0, _mm_max_ps(_mm_andnot_ps(sign_mask, x0), _mm_andnot_ps(sign_mask, x1)));
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(x0, x0));
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(x1, x1));
+		}
+		sum0 = _mm_add_ps(sum0, sum1);
+		sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+		sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+		max0 = _mm_max_ps(max0, _mm_movehl_ps(max0, max0));
+		max0 = _mm_max_ss(max0, _mm_shuffle_ps(max0, max0, 1));
+		float p = _mm_cvtss_f32(max0);
+		float s = _mm_cvtss_f32(sum0);
+#else
+		float p = 0.0f;
+		float s = 0.0f;
+#endif
+		for( ; i < length; ++i) {
+			p = std::max<float>(p, std::abs(data[i]));
+			s += data[i] * data[i];
+		}
+		peak = p;
+		sum_of_squares = s;
+	}
+
+	//! ŏlƍőlBlength1ȏB
+	inline void MinMax(float const *data, size_t length, float &min_value, float &max_value)
+	{
+		size_t i = 0;
+		float mn = data[0];
+		float mx = data[0];
+#if defined(HWM_ANALYZER_USE_SSE)
+		if(length >= 4) {
+			__m128 vmin = _mm_loadu_ps(data);
+			__m128 vmax = vmin;
+			for(i = 4; i + 4 <= length; i += 4) {
+				__m128 const x = _mm_loadu_ps(data + i);
+				vmin = _mm_min_ps(vmin, x);
+				vmax = _mm_max_ps(vmax, x);
+			}
+			vmin = _mm_min_ps(vmin, _mm_movehl_ps(vmin, vmin));
+			vmin = _mm_min_ss(vmin, _mm_shuffle_ps(vmin, vmin, 1));
+			vmax = _mm_max_ps(vmax, _mm_movehl_ps(vmax, vmax));
+			vmax = _mm_max_ss(vmax, _mm_shuffle_ps(vmax, vmax, 1));
+			mn = _mm_cvtss_f32(vmin);
+			mx = _mm_cvtss_f32(vmax);
+		}
+#endif
+		for( ; i < length; ++i) {
+			mn = std::min<float>(mn, data[i]);
+			mx = std::max<float>(mx, data[i]);
+		}
+		min_value = mn;
+		max_value = mx;
+	}
+
+}	//::analyzer_detail
+
+//! I[fBIXbhōĐf[^͂āATripleBufferoRGUIXbhɓnNX
+//!
+//! I[fBIXbhProcessĂԂŁA͌ʂ͖GetFeed()Back()ɏ܂ČJB
+//! GUIXbh͎̃^C~OGetFeed().Update()ĂсAFront()̒l`悷B
+//! Processł̓mۂbNsȂB
+struct AudioAnalyzer
+{
+	//! channels			: `l(MeterSnapshot::MAX_CHANNELS܂)
+	//! sampling_rate		: TvO[g
+	//! frames_per_point	: g`\1_̃t[
+	AudioAnalyzer(size_t channels, size_t sampling_rate, size_t frames_per_point = 8)
+		:	channels_(std::min<size_t>(channels, MeterSnapshot::MAX_CHANNELS))
+		,	sampling_rate_(sampling_rate)
+		,	frames_per_point_(std::max<size_t>(frames_per_point, 1))
+		,	position_(0)
+		,	waveform_write_pos_(0)
+		,	point_filled_(0)
+		,	fft_write_pos_(0)
+		,	frames_since_fft_(0)
+		,	fft_window_(MeterSnapshot::FFT_SIZE)
+		,	fft_twiddle_re_(MeterSnapshot::FFT_SIZE / 2)
+		,	fft_twiddle_im_(MeterSnapshot::FFT_SIZE / 2)
+		,	fft_bit_reverse_(MeterSnapshot::FFT_SIZE)
+		,	fft_input_(MeterSnapshot::FFT_SIZE)
+		,	fft_re_(MeterSnapshot::FFT_SIZE)
+		,	fft_im_(MeterSnapshot::FFT_SIZE)
+	{
+		size_t const n = MeterSnapshot::FFT_SIZE;
+		double const pi = 3.14159265358979323846;
+
+		//! nBXyNg̐UA̍vŐK悤ɂB
+		double window_sum = 0;
+		for(size_t i = 0; i < n; ++i) {
+			fft_window_[i] = static_cast<float>(0.5 - 0.5 * cos(2.0 * pi * i / n));
+			window_sum += fft_window_[i];
+		}
+		for(size_t i = 0; i < n; ++i) {
+			fft_window_[i] = static_cast<float>(fft_window_[i] * 2.0 / window_sum);
+		}
+
+		for(size_t i = 0; i < n / 2; ++i) {
+			fft_twiddle_re_[i] = static_cast<float>(cos(-2.0 * pi * i / n));
+			fft_twiddle_im_[i] = static_cast<float>(sin(-2.0 * pi * i / n));
+		}
+
+		size_t bits = 0;
+		while((static_cast<size_t>(1) << bits) < n) { ++bits; }
+		for(size_t i = 0; i < n; ++i) {
+			size_t r = 0;
+			for(size_t b = 0; b < bits; ++b) {
+				if(i & (static_cast<size_t>(1) << b)) { r |= static_cast<size_t>(1) << (bits - 1 - b); }
+			}
+			fft_bit_reverse_[i] = r;
+		}
+
+		std::memset(&state_, 0, sizeof(state_));
+		state_.num_channels = channels_;
+		state_.sampling_rate = sampling_rate_;
+		for(size_t i = 0; i < MeterSnapshot::SPECTRUM_BINS; ++i) {
+			state_.spectrum_db[i] = MIN_DB;
+		}
+		std::memset(rms_mean_square_, 0, sizeof(rms_mean_square_));
+		std::memset(partial_min_, 0, sizeof(partial_min_));
+		std::memset(partial_max_, 0, sizeof(partial_max_));
+
+		feed_.Reset(state_);
+
+		//! 1b̃s[Ň(20dB)ƁARMS̎萔(300ms)
+		peak_decay_per_sec_ = 0.1;
+		rms_time_constant_ = 0.3;
+	}
+
+	//! Đf[^͂āAʂJ
+	//! I[fBIXbhĂяoB
+	void Process(float const * const *data, size_t channels, size_t frames)
+	{
+		if(frames == 0) { return; }
+		size_t const num_channels = std::min<size_t>(channels, channels_);
+
+		double const seconds = frames / static_cast<double>(sampling_rate_);
+		float const peak_decay = static_cast<float>(pow(peak_decay_per_sec_, seconds));
+		float const rms_coeff = static_cast<float>(exp(-seconds / rms_time_constant_));
+
+		for(size_t ch = 0; ch < num_channels; ++ch) {
+			float peak, sum_of_squares;
+			analyzer_detail::PeakAndSumOfSquares(data[ch], frames, peak, sum_of_squares);
+
+			state_.peak[ch] = std::max<float>(peak, state_.peak[ch] * peak_decay);
+			float const mean_square = sum_of_squares / frames;
+			rms_mean_square_[ch] = rms_coeff * rms_mean_square_[ch] + (1.0f - rms_coeff) * mean_square;
+			state_.rms[ch] = sqrt(rms_mean_square_[ch]);
+		}
+
+		process_waveform(data, num_channels, frames);
+		process_spectrum(data, num_channels, frames);
+
+		position_ += frames;
+		publish();
+	}
+
+	//! ͌ʂ̎󂯓n
+	TripleBuffer<MeterSnapshot> &	GetFeed() { return feed_; }
+
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		feed_.VisitMemory(visit);
+		visit(static_cast<void *>(fft_input_.data()), fft_input_.size() * sizeof(float));
+		visit(static_cast<void *>(fft_re_.data()), fft_re_.size() * sizeof(float));
+		visit(static_cast<void *>(fft_im_.data()), fft_im_.size() * sizeof(float));
+	}
+
+	//! jA̒ldBɂBMIN_DBɂȂB
+	static
+	float ToDecibel(float value)
+	{
+		return value > 1e-6f ? std::max<float>(20.0f * log10(value), MIN_DB) : MIN_DB;
+	}
+
+private:
+	void process_waveform(float const * const *data, size_t num_channels, size_t frames)
+	{
+		size_t pos = 0;
+		while(pos < frames) {
+			size_t const chunk = std::min<size_t>(frames - pos, frames_per_point_ - point_filled_);
+
+			for(size_t ch = 0; ch < num_channels; ++ch) {
+				float mn, mx;
+				analyzer_detail::MinMax(data[ch] + pos, chunk, mn, mx);
+				if(point_filled_ == 0) {
+					partial_min_[ch] = mn;
+					partial_max_[ch] = mx;
+				} else {
+					partial_min_[ch] = std::min<float>(partial_min_[ch], mn);
+					partial_max_[ch] = std::max<float>(partial_max_[ch], mx);
+				}
+			}
+
+			point_filled_ += chunk;
+			pos += chunk;
+
+			if(point_filled_ == frames_per_point_) {
+				for(size_t ch = 0; ch < num_channels; ++ch) {
+					state_.waveform_min[ch][waveform_write_pos_] = partial_min_[ch];
+					state_.waveform_max[ch][waveform_write_pos_] = partial_max_[ch];
+				}
+				waveform_write_pos_ = (waveform_write_pos_ + 1) % MeterSnapshot::WAVEFORM_POINTS;
+				point_filled_ = 0;
+			}
+		}
+	}
+
+	void process_spectrum(float const * const *data, size_t num_channels, size_t frames)
+	{
+		size_t const n = MeterSnapshot::FFT_SIZE;
+
+		for(size_t fr = 0; fr < frames; ++fr) {
+			float sum = 0;
+			for(size_t ch = 0; ch < num_channels; ++ch) { sum += data[ch][fr]; }
+			fft_input_[fft_write_pos_] = sum;
+			fft_write_pos_ = (fft_write_pos_ + 1) % n;
+		}
+
+		//! FFT͔d˂āAFFT_SIZE/2t[ƂɈ񂾂s
+		frames_since_fft_ += frames;
+		if(frames_since_fft_ < n / 2) { return; }
+		frames_since_fft_ = 0;
+
+		for(size_t i = 0; i < n; ++i) {
+			size_t const r = fft_bit_reverse_[i];
+			fft_re_[r] = fft_input_[(fft_write_pos_ + i) % n] * fft_window_[i];
+			fft_im_[r] = 0;
+		}
+
+		for(size_t half = 1; half < n; half *= 2) {
+			size_t const step = n / (half * 2);
+			for(size_t start = 0; start < n; start += half * 2) {
+				for(size_t k = 0; k < half; ++k) {
+					float const wr = fft_twiddle_re_[k * step];
+					float const wi = fft_twiddle_im_[k * step];
+					size_t const a = start + k;
+					size_t const b = a + half;
+					float const tr = fft_re_[b] * wr - fft_im_[b] * wi;
+					float const ti = fft_re_[b] * wi + fft_im_[b] * wr;
+					fft_re_[b] = fft_re_[a] - tr;
+					fft_im_[b] = fft_im_[a] - ti;
+					fft_re_[a] += tr;
+					fft_im_[a] += ti;
+				}
+			}
+		}
+
+		for(size_t i = 0; i < MeterSnapshot::SPECTRUM_BINS; ++i) {
+			float const power = fft_re_[i] * fft_re_[i] + fft_im_[i] * fft_im_[i];
+			state_.spectrum_db[i] = power > 1e-12f ? std::max<float>(10.0f * log10(power), MIN_DB) : MIN_DB;
+		}
+	}
+
+	//! g`̃Oobt@ÂɕגāABack()ɏłJ
+	void publish()
+	{
+		MeterSnapshot &dest = feed_.Back();
+		dest.num_channels = state_.num_channels;
+		dest.sampling_rate = state_.sampling_rate;
+		dest.position = position_;
+		std::memcpy(dest.peak, state_.peak, sizeof(dest.peak));
+		std::memcpy(dest.rms, state_.rms, sizeof(dest.rms));
+
+		size_t const head = waveform_write_pos_;
+		size_t const tail = MeterSnapshot::WAVEFORM_POINTS - head;
+		for(size_t ch = 0; ch < channels_; ++ch) {
+			std::memcpy(dest.waveform_min[ch], state_.waveform_min[ch] + head, tail * sizeof(float));
+			std::memcpy(dest.waveform_min[ch] + tail, state_.waveform_min[ch], head * sizeof(float));
+			std::memcpy(dest.waveform_max[ch], state_.waveform_max[ch] + head, tail * sizeof(float));
+			std::memcpy(dest.waveform_max[ch] + tail, state_.waveform_max[ch], head * sizeof(float));
+		}
+		std::memcpy(dest.spectrum_db, state_.spectrum_db, sizeof(dest.spectrum_db));
+
+		feed_.Publish();
+	}
+
+private:
+	size_t				channels_;
+	size_t				sampling_rate_;
+	size_t				frames_per_point_;
+	unsigned long long	position_;
+	double				peak_decay_per_sec_;
+	double				rms_time_constant_;
+
+	//! ͒̏ԁBg`̓Oobt@ƂĎB
+	MeterSnapshot		state_;
+	float				rms_mean_square_[MeterSnapshot::MAX_CHANNELS];
+	size_t				waveform_write_pos_;
+	size_t				point_filled_;
+	float				partial_min_[MeterSnapshot::MAX_CHANNELS];
+	float				partial_max_[MeterSnapshot::MAX_CHANNELS];
+
+	size_t				fft_write_pos_;
+	size_t				frames_since_fft_;
+	std::vector<float>	fft_window_;
+	std::vector<float>	fft_twiddle_re_;
+	std::vector<float>	fft_twiddle_im_;
+	std::vector<size_t>	fft_bit_reverse_;
+	std::vector<float>	fft_input_;
+	std::vector<float>	fft_re_;
+	std::vector<float>	fft_im_;
+
+	TripleBuffer<MeterSnapshot>	feed_;
+
+	AudioAnalyzer(AudioAnalyzer const &);
+	AudioAnalyzer & operator=(AudioAnalyzer const &);
+};
+
+}	//::hwm
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include <windows.h>
+#include <avrt.h>
+
+#pragma comment(lib, "avrt.lib")
+
+#include "./Denormal.hpp"
+
+namespace hwm {
+
+//! I[fBIXbh̐ݒ
+//! Windowsł́ASCHED_FIFȎMMCSS(Multimedia Class Scheduler Service)
+//! "Pro Audio"^XNƂăXbho^Amlockall̑
+//! [LOZbggŕKvȃobt@VirtualLockB
+struct AudioThreadSettings
+{
+	AudioThreadSettings()
+		:	use_mmcss(true)
+		,	priority(THREAD_PRIORITY_TIME_CRITICAL)
+		,	affinity_mask(0)
+		,	flush_denormals(true)
+	{}
+
+	//! MMCSS"Pro Audio"^XNƂēo^邩ǂ
+	bool		use_mmcss;
+	//! SetThreadPriorityɓnDxBMMCSS̓o^Ɏsꍇ̗Dx͐ݒ肷B
+	int			priority;
+	//! XbhŒ肷CPŨ}XNB0ȂύXȂB
+	DWORD_PTR	affinity_mask;
+	//! MXCSRFTZDAZݒ肵āA񐳋Kɂ鏈̒xhǂ
+	bool		flush_denormals;
+};
+
+//! I[fBIXbh̐ݒs
+struct AudioThreadSetupResult
+{
+	enum Status { NOT_REQUESTED, SUCCEEDED, FAILED };
+
+	AudioThreadSetupResult()
+		:	mmcss(NOT_REQUESTED)
+		,	priority(NOT_REQUESTED)
+		,	affinity(NOT_REQUESTED)
+		,	denormals(NOT_REQUESTED)
+		,	mmcss_error(0)
+		,	priority_error(0)
+		,	affinity_error(0)
+	{}
+
+	Status	mmcss;
+	Status	priority;
+	Status	affinity;
+	Status	denormals;
+	DWORD	mmcss_error;
+	DWORD	priority_error;
+	DWORD	affinity_error;
+
+	std::string ToString() const
+	{
+		std::ostringstream ss;
+		ss << "mmcss: " << status_string(mmcss, mmcss_error)
+		   << ", priority: " << status_string(priority, priority_error)
+		   << ", affinity: " << status_string(affinity, affinity_error)
+		   << ", ftz/daz: " << status_string(denormals, 0);
+		return ss.str();
+	}
+
+	static
+	std::string status_string(Status status, DWORD error)
+	{
+		switch(status) {
+			case SUCCEEDED:	return "ok";
+			case FAILED:	{ std::ostringstream ss; ss << "failed(" << error << ")"; return ss.str(); }
+			default:		return "-";
+		}
+	}
+};
+
+//! ĂяoXbhI[fBIXbhƂĐݒ肷
+//! MMCSSւ̓o^MXCSR̐ݒ͌ĂяoXbhgɑ΂ĂsȂ̂ŁA
+//! ̊֐̓I[fBIXbh̐擪ŌĂяoB
+//! processReplacingĂяoXbhVɍꍇA擪ł̊֐ĂяoƁB
+inline
+AudioThreadSetupResult SetupAudioThread(AudioThreadSettings const &settings)
+{
+	AudioThreadSetupResult result;
+
+	if(settings.use_mmcss) {
+		DWORD task_index = 0;
+		HANDLE const task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index);
+		if(task) {
+			AvSetMmThreadPriority(task, AVRT_PRIORITY_CRITICAL);
+			result.mmcss = AudioThreadSetupResult::SUCCEEDED;
+		} else {
+			result.mmcss = AudioThreadSetupResult::FAILED;
+			result.mmcss_error = GetLastError();
+		}
+	}
+
+	if(SetThreadPriority(GetCurrentThread(), settings.priority)) {
+		result.priority = AudioThreadSetupResult::SUCCEEDED;
+	} else {
+		result.priority = AudioThreadSetupResult::FAILED;
+		result.priority_error = GetLastError();
+	}
+
+	if(settings.affinity_mask != 0) {
+		if(SetThreadAffinityMask(GetCurrentThread(), settings.affinity_mask) != 0) {
+			result.affinity = AudioThreadSetupResult::SUCCEEDED;
+		} else {
+			result.affinity = AudioThreadSetupResult::FAILED;
+			result.affinity_error = GetLastError();
+		}
+	}
+
+	if(settings.flush_denormals) {
+		Denormal::SetFlush(true);
+		result.denormals = Denormal::IsFlushing() ? AudioThreadSetupResult::SUCCEEDED : AudioThreadSetupResult::FAILED;
+	}
+
+	return result;
+}
+
+//! I[fBIŎg̈OɃy[WCāAɃbNNX
+//! Lock̈̓fXgN^ŃAbNB
+//! bNłʂ̓vZX̍ŏ[LOZbgɐ̂ŁA
+//! Ȃꍇ̓[LOZbggĂĎsB
+struct MemoryLocker
+{
+	MemoryLocker()
+		:	locked_bytes_(0)
+		,	num_failed_(0)
+		,	last_error_(0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		page_size_ = info.dwPageSize;
+	}
+
+	~MemoryLocker()
+	{
+		UnlockAll();
+	}
+
+	//! [data, data + bytes)vtHgăbNB
+	//! ̈̓e͕ύXȂB
+	bool Lock(void *data, size_t bytes)
+	{
+		if(!data || bytes == 0) { return true; }
+
+		boost::unique_lock<boost::mutex> lock(mutex_);
+
+		//! ey[WɈxŁAy[WtHgŔĂ
+		volatile char *p = static_cast<char *>(data);
+		for(size_t i = 0; i < bytes; i += page_size_) {
+			p[i] = p[i];
+		}
+		p[bytes - 1] = p[bytes - 1];
+
+		if(!VirtualLock(data, bytes)) {
+			if(GetLastError() != ERROR_WORKING_SET_QUOTA || !grow_working_set(bytes) || !VirtualLock(data, bytes)) {
+				last_error_ = GetLastError();
+				++num_failed_;
+				return false;
+			}
+		}
+
+		regions_.push_back(Region(data, bytes));
+		locked_bytes_ += bytes;
+		return true;
+	}
+
+	//! LockŃbN̈̂A[data, data + bytes)Ɠ͈͂œo^̂B
+	//! ĐɔjIuWFNg(ւvOCȂ)̗̈AjOɉ邽߂ɎgB
+	//! VirtualUnlock̓y[WPʂŉ̂ŁAcĂ鑼̗̈ƋLĂy[W̓bN܂܂ɂB
+	bool Unlock(void *data, size_t bytes)
+	{
+		if(!data || bytes == 0) { return true; }
+
+		boost::unique_lock<boost::mutex> lock(mutex_);
+		for(size_t i = 0; i < regions_.size(); ++i) {
+			if(regions_[i] == Region(data, bytes)) {
+				regions_.erase(regions_.begin() + i);
+				locked_bytes_ -= bytes;
+				unlock_unshared_pages(data, bytes);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void UnlockAll()
+	{
+		boost::unique_lock<boost::mutex> lock(mutex_);
+		for(size_t i = 0; i < regions_.size(); ++i) {
+			VirtualUnlock(regions_[i].first, regions_[i].second);
+		}
+		regions_.clear();
+		locked_bytes_ = 0;
+	}
+
+	size_t	GetLockedBytes() const { boost::unique_lock<boost::mutex> lock(mutex_); return locked_bytes_; }
+	size_t	GetNumFailed() const { boost::unique_lock<boost::mutex> lock(mutex_); return num_failed_; }
+
+	std::string ToString() const
+	{
+		boost::unique_lock<boost::mutex> lock(mutex_);
+		std::ostringstream ss;
+		ss << "locked: " << (locked_bytes_ / 1024) << "KB in " << regions_.size() << " regions";
+		if(num_failed_) {
+			ss << ", failed: " << num_failed_ << "(" << last_error_ << ")";
+		}
+		return ss.str();
+	}
+
+private:
+	size_t page_floor(void const *p) const
+	{
+		return reinterpret_cast<size_t>(p) / page_size_ * page_size_;
+	}
+
+	size_t page_ceil(void const *p, size_t bytes) const
+	{
+		return (reinterpret_cast<size_t>(p) + bytes + page_size_ - 1) / page_size_ * page_size_;
+	}
+
+	bool is_covered(size_t page) const
+	{
+		for(size_t i = 0; i < regions_.size(); ++i) {
+			if(page_floor(regions_[i].first) <= page && page < page_ceil(regions_[i].first, regions_[i].second)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//! [data, data + bytes)܂ރy[ŴAregions_̂ǂ̗̈ɂ܂܂Ȃy[WA
+	//! AĂ͈͂Ƃɂ܂Ƃ߂ăAbN
+	void unlock_unshared_pages(void *data, size_t bytes)
+	{
+		size_t const end = page_ceil(data, bytes);
+		size_t run_begin = 0;
+		size_t run_end = 0;
+		for(size_t page = page_floor(data); page < end; page += page_size_) {
+			if(is_covered(page)) { continue; }
+			if(run_end != page) {
+				if(run_begin != run_end) {
+					VirtualUnlock(reinterpret_cast<void *>(run_begin), run_end - run_begin);
+				}
+				run_begin = page;
+			}
+			run_end = page + page_size_;
+		}
+		if(run_begin != run_end) {
+			VirtualUnlock(reinterpret_cast<void *>(run_begin), run_end - run_begin);
+		}
+	}
+
+	bool grow_working_set(size_t bytes)
+	{
+		SIZE_T min_size = 0;
+		SIZE_T max_size = 0;
+		if(!GetProcessWorkingSetSize(GetCurrentProcess(), &min_size, &max_size)) { return false; }
+
+		//! bNʂɉāAy[WE̕ƊǗ̈̕]T
+		SIZE_T const extra = bytes + page_size_ * 16;
+		return SetProcessWorkingSetSize(GetCurrentProcess(), min_size + extra, std::max<SIZE_T>(max_size, min_size + extra * 2)) != 0;
+	}
+
+private:
+	typedef std::pair<void *, size_t> Region;
+
+	boost::mutex mutable	mutex_;
+	std::vector<Region>		regions_;
+	size_t					page_size_;
+	size_t					locked_bytes_;
+	size_t					num_failed_;
+	DWORD					last_error_;
+
+	MemoryLocker(MemoryLocker const &);
+	MemoryLocker & operator=(MemoryLocker const &);
+};
+
+}	//::hwm
@@ -0,0 +1,1125 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <boost/thread.hpp>
+
+#include "./AudioThread.hpp"
+#include "./BlockAdapter.hpp"
+#include "./Denormal.hpp"
+#include "./MidiRouter.hpp"
+#include "./ParameterCache.hpp"
+#include "./Resampler.hpp"
+#include "./RoutingGraph.hpp"
+#include "./Session.hpp"
+#include "./ThreadRole.hpp"
+#include "./VstPlugin.hpp"
+
+//! R}hC -bench <name> ŋNƂɎsx`}[NQ
+//! ʂ̓eLXgstreamɏoB
+namespace hwm { namespace bench {
+
+//! oߎԂ̌v
+struct Stopwatch
+{
+	Stopwatch() : start_(boost::chrono::steady_clock::now()) {}
+
+	void	Restart() { start_ = boost::chrono::steady_clock::now(); }
+
+	//! oߎ(b)
+	double	Elapsed() const
+	{
+		return boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start_).count();
+	}
+
+private:
+	boost::chrono::steady_clock::time_point start_;
+};
+
+//! -1.0 .. 1.0̃zCgmCYŖ߂
+inline
+void FillNoise(std::vector<std::vector<float>> &buffers, unsigned int seed = 1)
+{
+	boost::random::mt19937 engine(seed);
+	boost::random::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	for(auto &buffer: buffers) {
+		for(auto &x: buffer) { x = dist(engine); }
+	}
+}
+
+inline
+std::vector<float *> GetHeads(std::vector<std::vector<float>> &buffers)
+{
+	std::vector<float *> heads;
+	for(auto &buffer: buffers) { heads.push_back(buffer.data()); }
+	return heads;
+}
+
+//! tB^Ƃ̃TvO[gϊ̃X[vbg
+//! 44.1kHz -> 48kHz(L/M = 160/147)ƁA2{/4{I[o[TvỎɂāA
+//! XeI10b̂ɂԂA
+//! 1bɏł̓TvƁAԂɑ΂{߂B
+inline
+void RunResamplerBenchmark(std::ostream &os)
+{
+	size_t const channels = 2;
+	size_t const block_size = 512;
+	size_t const sampling_rate = 44100;
+	size_t const num_blocks = sampling_rate * 10 / block_size;
+	size_t const taps_list[] = { 8, 16, 32, 64, 128 };
+
+	std::vector<std::vector<float>> input(channels, std::vector<float>(block_size));
+	std::vector<std::vector<float>> output(channels, std::vector<float>(block_size * 4 + 1));
+	FillNoise(input);
+	std::vector<float *> input_heads = GetHeads(input);
+	std::vector<float *> output_heads = GetHeads(output);
+
+	os << "[resampler] " << channels << "ch, block " << block_size << ", " << num_blocks * block_size << " frames per run" << std::endl;
+#if defined(HWM_RESAMPLER_USE_SSE)
+	os << "simd: sse" << std::endl;
+#else
+	os << "simd: none" << std::endl;
+#endif
+	os << std::setw(14) << "mode" << std::setw(8) << "taps" << std::setw(16) << "Msamples/sec" << std::setw(12) << "x realtime" << std::endl;
+
+	for(size_t i = 0; i < sizeof(taps_list) / sizeof(taps_list[0]); ++i) {
+		size_t const taps = taps_list[i];
+
+		{
+			PolyphaseResampler resampler(channels, sampling_rate, 48000, block_size, taps);
+			Stopwatch sw;
+			for(size_t b = 0; b < num_blocks; ++b) {
+				resampler.Process(input_heads.data(), block_size, output_heads.data());
+			}
+			double const sec = sw.Elapsed();
+			os	<< std::setw(14) << "44.1k->48k" << std::setw(8) << resampler.GetNumTaps()
+				<< std::setw(16) << std::fixed << std::setprecision(2) << (num_blocks * block_size * channels / sec / 1e6)
+				<< std::setw(12) << std::setprecision(1) << (num_blocks * block_size / static_cast<double>(sampling_rate) / sec)
+				<< std::endl;
+		}
+
+		size_t const factors[] = { 2, 4 };
+		for(size_t f = 0; f < 2; ++f) {
+			Oversampler oversampler(channels, factors[f], block_size, taps);
+			Stopwatch sw;
+			for(size_t b = 0; b < num_blocks; ++b) {
+				oversampler.Run(input_heads.data(), output_heads.data(), block_size,
+					[] (float **buffers, size_t) -> float const * const * { return buffers; });
+			}
+			double const sec = sw.Elapsed();
+			os	<< std::setw(13) << "oversample x" << factors[f] << std::setw(8) << ((taps + 3) / 4 * 4)
+				<< std::setw(16) << std::fixed << std::setprecision(2) << (num_blocks * block_size * channels / sec / 1e6)
+				<< std::setw(12) << std::setprecision(1) << (num_blocks * block_size / static_cast<double>(sampling_rate) / sec)
+				<< std::endl;
+		}
+	}
+	os << std::endl;
+}
+
+//! [eBOOt̃obt@蓖Ă̔r
+//! T^IȐڑɂāARpCXPW[̃obt@gpʂ
+//! m[hƂɓo̓obt@ꍇƔׁA1ubN̏Ԃ𑪂B
+//! m[hVSTvOC̑ɁAQC邾̏gB
+inline
+void RunRoutingBenchmark(std::ostream &os)
+{
+	size_t const block_size = 512;
+	size_t const num_blocks = 20000;
+
+	auto source = [] (float **, float **outputs, size_t frames) {
+		for(size_t fr = 0; fr < frames; ++fr) { outputs[0][fr] = outputs[1][fr] = 0.25f; }
+	};
+	auto effect = [] (float **inputs, float **outputs, size_t frames) {
+		for(size_t ch = 0; ch < 2; ++ch) {
+			for(size_t fr = 0; fr < frames; ++fr) { outputs[ch][fr] = inputs[ch][fr] * 0.99f; }
+		}
+	};
+	auto connect_stereo = [] (RoutingGraph &graph, size_t src, size_t dest) {
+		graph.Connect(src, 0, dest, 0);
+		graph.Connect(src, 1, dest, 1);
+	};
+
+	os << "[routing] stereo, block " << block_size << std::endl;
+
+	auto run = [&] (char const *name, RoutingGraph const &graph) {
+		std::unique_ptr<RoutingSchedule> schedule = graph.Compile(block_size);
+		Stopwatch sw;
+		for(size_t b = 0; b < num_blocks; ++b) {
+			schedule->Process(block_size);
+		}
+		double const sec = sw.Elapsed();
+		os	<< std::setw(14) << name << " : " << schedule->ToString()
+			<< ", " << std::fixed << std::setprecision(2) << (sec / num_blocks * 1e6) << " usec/block" << std::endl;
+	};
+
+	{
+		//!  -> GtFNg8i
+		RoutingGraph graph(2);
+		size_t prev = graph.AddNode("synth", 0, 2, source);
+		for(size_t i = 0; i < 8; ++i) {
+			size_t const fx = graph.AddNode("fx", 2, 2, effect);
+			connect_stereo(graph, prev, fx);
+			prev = fx;
+		}
+		graph.ConnectToOutput(prev, 0, 0);
+		graph.ConnectToOutput(prev, 1, 1);
+		run("chain", graph);
+	}
+
+	{
+		//! 8AꂼɃGtFNg2i -> ~bNXoX -> }X^[GtFNg2i
+		RoutingGraph graph(2);
+		size_t const bus = graph.AddNode("bus", 2, 2, effect);
+		for(size_t i = 0; i < 8; ++i) {
+			size_t prev = graph.AddNode("synth", 0, 2, source);
+			for(size_t j = 0; j < 2; ++j) {
+				size_t const fx = graph.AddNode("fx", 2, 2, effect);
+				connect_stereo(graph, prev, fx);
+				prev = fx;
+			}
+			connect_stereo(graph, prev, bus);
+		}
+		size_t prev = bus;
+		for(size_t j = 0; j < 2; ++j) {
+			size_t const fx = graph.AddNode("master", 2, 2, effect);
+			connect_stereo(graph, prev, fx);
+			prev = fx;
+		}
+		graph.ConnectToOutput(prev, 0, 0);
+		graph.ConnectToOutput(prev, 1, 1);
+		run("mix bus", graph);
+	}
+
+	{
+		//! 4 -> ꂼCT[g1i -> o͂֒ + L̃ZhGtFNg
+		RoutingGraph graph(2);
+		size_t const send = graph.AddNode("send", 2, 2, effect);
+		for(size_t i = 0; i < 4; ++i) {
+			size_t const synth = graph.AddNode("synth", 0, 2, source);
+			size_t const fx = graph.AddNode("insert", 2, 2, effect);
+			connect_stereo(graph, synth, fx);
+			connect_stereo(graph, fx, send);
+			graph.ConnectToOutput(fx, 0, 0);
+			graph.ConnectToOutput(fx, 1, 1);
+		}
+		graph.ConnectToOutput(send, 0, 0);
+		graph.ConnectToOutput(send, 1, 1);
+		run("send/return", graph);
+	}
+
+	os << std::endl;
+}
+
+//! ubNTCYƂ̏RXg
+//! vOC̑ɁA16̃TCg炵AubNƂɊěWvZgāA
+//! BlockAdapteroRŃfoCX̗v(1024t[ŒƁA64 .. 1024t[̉)ɉRXg𑪂B
+//! ubNقǁAubNƂ̌Œ(CxgW̍XVȂ)̊傫ȂB
+inline
+void RunBlockSizeBenchmark(std::ostream &os)
+{
+	size_t const channels = 2;
+	size_t const sampling_rate = 44100;
+	size_t const device_frames = 1024;
+	size_t const total_frames = sampling_rate * 20;
+	size_t const block_sizes[] = { 16, 32, 64, 128, 256, 512, 1024, 2048 };
+	size_t const num_voices = 16;
+
+	os << "[blocksize] " << channels << "ch, " << num_voices << " voices, " << total_frames << " frames per run" << std::endl;
+	os	<< std::setw(8) << "block" << std::setw(14) << "latency(ms)"
+		<< std::setw(18) << "fixed usec/sec" << std::setw(12) << "x realtime"
+		<< std::setw(21) << "variable usec/sec" << std::setw(12) << "x realtime" << std::endl;
+
+	for(size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); ++i) {
+		size_t const block_size = block_sizes[i];
+
+		std::vector<std::vector<float>> rendered(channels, std::vector<float>(block_size));
+		std::vector<float *> rendered_heads = GetHeads(rendered);
+		std::vector<std::vector<float>> device(channels, std::vector<float>(device_frames));
+		std::vector<float *> device_heads = GetHeads(device);
+
+		//! e͕f̉]ŔU(1t[̌vZ͏ZƉẐ)
+		std::vector<float> osc_re(num_voices, 1.0f);
+		std::vector<float> osc_im(num_voices, 0.0f);
+		size_t block_count = 0;
+		auto render = [&] () -> float ** {
+			//! ubNƂ̌Œ : e̎gƉʂvZAÛ␳
+			float rot_re[num_voices];
+			float rot_im[num_voices];
+			float gains[num_voices];
+			for(size_t v = 0; v < num_voices; ++v) {
+				double const freq = 110.0 * pow(2.0, (v + (block_count % 12) / 12.0) / 4.0);
+				double const increment = 2.0 * 3.14159265358979323846 * freq / sampling_rate;
+				rot_re[v] = static_cast<float>(cos(increment));
+				rot_im[v] = static_cast<float>(sin(increment));
+				gains[v] = static_cast<float>(exp(-0.001 * (block_count % 1000)) / num_voices);
+				float const norm = 1.0f / sqrt(osc_re[v] * osc_re[v] + osc_im[v] * osc_im[v]);
+				osc_re[v] *= norm;
+				osc_im[v] *= norm;
+			}
+			for(size_t fr = 0; fr < block_size; ++fr) {
+				float sum = 0;
+				for(size_t v = 0; v < num_voices; ++v) {
+					float const re = osc_re[v] * rot_re[v] - osc_im[v] * rot_im[v];
+					float const im = osc_re[v] * rot_im[v] + osc_im[v] * rot_re[v];
+					osc_re[v] = re;
+					osc_im[v] = im;
+					sum += gains[v] * im;
+				}
+				rendered[0][fr] = rendered[1][fr] = sum;
+			}
+			++block_count;
+			return rendered_heads.data();
+		};
+
+		double results[2];
+		for(size_t mode = 0; mode < 2; ++mode) {
+			BlockAdapter adapter(channels, block_size, device_frames);
+			boost::random::mt19937 engine(1);
+			boost::random::uniform_int_distribution<size_t> dist(64, device_frames);
+
+			Stopwatch sw;
+			for(size_t done = 0; done < total_frames; ) {
+				size_t const frames = (mode == 0) ? device_frames : dist(engine);
+				adapter.Pull(device_heads.data(), frames, render);
+				done += frames;
+			}
+			results[mode] = sw.Elapsed() / (total_frames / static_cast<double>(sampling_rate));
+		}
+
+		os	<< std::setw(8) << block_size
+			<< std::setw(14) << std::fixed << std::setprecision(2) << (block_size * 1000.0 / sampling_rate)
+			<< std::setw(18) << std::setprecision(1) << (results[0] * 1e6)
+			<< std::setw(12) << (1.0 / results[0])
+			<< std::setw(21) << (results[1] * 1e6)
+			<< std::setw(12) << (1.0 / results[1])
+			<< std::endl;
+	}
+	os << std::endl;
+}
+
+#pragma warning(push)
+#pragma warning(disable: 4996)
+
+//! ̃p[^vOC̑
+//! l̕ێƁAsprintfɂ\p̏sB
+struct FakeParameterPlugin
+{
+	explicit FakeParameterPlugin(size_t num_params)
+		:	values_(num_params, 0.5f)
+	{
+		AEffect empty = {};
+		effect_ = empty;
+		effect_.magic = kEffectMagic;
+		effect_.numParams = num_params;
+		effect_.object = this;
+		effect_.dispatcher = &FakeParameterPlugin::dispatcher;
+		effect_.setParameter = &FakeParameterPlugin::set_parameter;
+		effect_.getParameter = &FakeParameterPlugin::get_parameter;
+	}
+
+	AEffect * GetEffect() { return &effect_; }
+
+private:
+	static
+	VstIntPtr VSTCALLBACK dispatcher(AEffect *effect, VstInt32 opcode, VstInt32 index, VstIntPtr /*value*/, void *ptr, float /*opt*/)
+	{
+		FakeParameterPlugin *self = static_cast<FakeParameterPlugin *>(effect->object);
+		switch(opcode) {
+		case effGetParamName:
+			sprintf(static_cast<char *>(ptr), "Param %d", index);
+			return 1;
+		case effGetParamDisplay:
+			sprintf(static_cast<char *>(ptr), "%.2f", self->values_[index] * 100.0f);
+			return 1;
+		case effGetParamLabel:
+			strcpy(static_cast<char *>(ptr), "%");
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	static
+	void VSTCALLBACK set_parameter(AEffect *effect, VstInt32 index, float value)
+	{
+		static_cast<FakeParameterPlugin *>(effect->object)->values_[index] = value;
+	}
+
+	static
+	float VSTCALLBACK get_parameter(AEffect *effect, VstInt32 index)
+	{
+		return static_cast<FakeParameterPlugin *>(effect->object)->values_[index];
+	}
+
+	AEffect				effect_;
+	std::vector<float>	values_;
+};
+
+#pragma warning(pop)
+
+//! p[^̓ǂݏ̃RXg
+//! p[^ƂɁAGUI1̍XVŃp[^ǂݏoRXg
+//! Sp[^vOC璼ڎ擾ꍇ(poll all)ƁAParameterCacheǂݏoꍇƂŔׂB
+//!  - cached read	: lׂăLbVǂݏo(ύXȂ)
+//!  - refresh 1%	: 1%̃p[^I[g[VŕύXꂽɁA\p擾
+//! ܂AI[fBIXbh̃ubN̐擪ApplyPendingWritesɂ鎞ԂA
+//! ݂Ȃꍇ(idle)A1%̃p[^ɏ񂾏ꍇASp[^ɏ񂾏ꍇɂđB
+inline
+void RunParameterBenchmark(std::ostream &os)
+{
+	size_t const params_list[] = { 256, 1024, 4096, 16384 };
+	size_t const num_updates = 50;
+	size_t const num_idle_blocks = 100000;
+
+	os << "[params] usec per GUI update / per audio block" << std::endl;
+	os	<< std::setw(8) << "params"
+		<< std::setw(12) << "poll all"
+		<< std::setw(14) << "cached read"
+		<< std::setw(13) << "refresh 1%"
+		<< std::setw(13) << "apply idle"
+		<< std::setw(11) << "apply 1%"
+		<< std::setw(12) << "apply all"
+		<< std::endl;
+
+	for(size_t i = 0; i < sizeof(params_list) / sizeof(params_list[0]); ++i) {
+		size_t const num_params = params_list[i];
+		size_t const num_changes = std::max<size_t>(num_params / 100, 1);
+
+		FakeParameterPlugin plugin(num_params);
+		AEffect *effect = plugin.GetEffect();
+		ParameterCache cache(effect);
+
+		std::vector<float> values(num_params);
+		char text[ParameterCache::TEXT_LENGTH];
+		boost::random::mt19937 engine(1);
+		boost::random::uniform_int_distribution<size_t> dist(0, num_params - 1);
+
+		Stopwatch sw;
+		for(size_t u = 0; u < num_updates; ++u) {
+			for(size_t p = 0; p < num_params; ++p) {
+				values[p] = effect->getParameter(effect, p);
+				effect->dispatcher(effect, effGetParamDisplay, p, 0, text, 0);
+				effect->dispatcher(effect, effGetParamLabel, p, 0, text, 0);
+			}
+		}
+		double const poll = sw.Elapsed() / num_updates;
+
+		sw.Restart();
+		for(size_t u = 0; u < num_updates; ++u) {
+			cache.GetValues(0, num_params, values.data());
+			cache.RefreshDisplays();
+		}
+		double const cached = sw.Elapsed() / num_updates;
+
+		double refresh = 0;
+		for(size_t u = 0; u < num_updates; ++u) {
+			for(size_t c = 0; c < num_changes; ++c) { cache.OnAutomate(dist(engine), 0.25f); }
+			sw.Restart();
+			cache.RefreshDisplays();
+			cache.ConsumeChanges([] (size_t, float) {});
+			refresh += sw.Elapsed();
+		}
+		refresh /= num_updates;
+
+		sw.Restart();
+		for(size_t b = 0; b < num_idle_blocks; ++b) {
+			cache.ApplyPendingWrites();
+		}
+		double const apply_idle = sw.Elapsed() / num_idle_blocks;
+
+		double apply_some = 0;
+		double apply_all = 0;
+		for(size_t u = 0; u < num_updates; ++u) {
+			for(size_t c = 0; c < num_changes; ++c) { cache.SetValue(dist(engine), 0.75f); }
+			sw.Restart();
+			cache.ApplyPendingWrites();
+			apply_some += sw.Elapsed();
+
+			cache.SetValues(0, num_params, values.data());
+			sw.Restart();
+			cache.ApplyPendingWrites();
+			apply_all += sw.Elapsed();
+		}
+		apply_some /= num_updates;
+		apply_all /= num_updates;
+
+		os	<< std::setw(8) << num_params
+			<< std::fixed << std::setprecision(2)
+			<< std::setw(12) << (poll * 1e6)
+			<< std::setw(14) << (cached * 1e6)
+			<< std::setw(13) << (refresh * 1e6)
+			<< std::setprecision(3)
+			<< std::setw(13) << (apply_idle * 1e6)
+			<< std::setprecision(2)
+			<< std::setw(11) << (apply_some * 1e6)
+			<< std::setw(12) << (apply_all * 1e6)
+			<< std::endl;
+	}
+	os << std::endl;
+}
+
+//! SysEx̎󂯓n̊mF
+//! 0SysExAMidiEventBatchAVstEventBufferAMidiRouter̂ǂłǉꂸɁA
+//! MidiRouterł͎肱ڂƂĐ邱Ƃm߂B(U蕪̃x`}[N̑OɎs)
+//! ʂosɏoASĊ҂ǂȂtrueԂB
+inline
+bool RunSysExCheck(std::ostream &os)
+{
+	char const sysex[] = { static_cast<char>(0xF0), 0x7E, 0x7F, 0x09, 0x01, static_cast<char>(0xF7) };
+	bool passed = true;
+	auto check = [&] (char const *name, bool result) {
+		os << "  " << name << " : " << (result ? "ok" : "FAILED") << std::endl;
+		passed = passed && result;
+	};
+
+	os << "[sysex check]" << std::endl;
+
+	MidiEventBatch batch;
+	check("batch rejects empty sysex", !batch.AddSysEx(sysex, 0) && batch.empty());
+	check("batch accepts sysex", batch.AddSysEx(sysex, sizeof(sysex)) && batch.size() == 1);
+
+	VstEventBuffer buffer;
+	buffer.Allocate(4, 64);
+	check("buffer rejects empty sysex", !buffer.PushSysEx(sysex, 0, 0) && buffer.empty());
+	check("buffer rejects null sysex", !buffer.PushSysEx(nullptr, 0, 0) && buffer.empty());
+	check(
+		"batch copies sysex",
+		batch.CopyTo(buffer) == 0 && buffer.size() == 1 &&
+		buffer[0].event.type == kVstSysExMidiType && buffer[0].sysex.dumpBytes == static_cast<VstInt32>(sizeof(sysex)) &&
+		std::memcmp(buffer[0].sysex.sysexDump, sysex, sizeof(sysex)) == 0
+		);
+
+	MidiRouter router(2, 4, 64);
+	router.AddZone(0, 0, 0, MidiRouter::NUM_KEYS - 1);
+	router.AddZone(1, 0, 0, MidiRouter::NUM_KEYS - 1);
+	router.RouteSysEx(sysex, 0);
+	size_t routed = 0;
+	router.Flush([&] (size_t, VstEventBuffer const &events) { routed += events.size(); });
+	check("router drops empty sysex", routed == 0 && router.GetNumDroppedEvents() == 2);
+
+	os << std::endl;
+	return passed;
+}
+
+//! MIDICxg̐U蕪̃RXg
+//! ̐ƂɁAL[{[h𑗂̐ŕXvbgƁAŜɏd˂1̃C[ݒ肵A
+//! _ȃm[gI/m[gItƃRg[`FWU蕪̂ɂA1Cxg̎ԂׂB
+//!  - scan		: CxgƂɑS̃][𒲂ׂĒǉꍇ
+//!  - router	: MidiRouter̕\Ēǉꍇ
+//! ǂ1ubNƂɑ̃obt@ɂ(vOCւ̎󂯓n͊܂߂Ȃ)B
+inline
+void RunMidiRouterBenchmark(std::ostream &os)
+{
+	RunSysExCheck(os);
+
+	size_t const targets_list[] = { 1, 4, 16, 32, 64 };
+	size_t const events_per_block = 64;
+	size_t const num_blocks = 20000;
+
+	struct Zone
+	{
+		size_t	channel;
+		size_t	lowest_key;
+		size_t	highest_key;
+	};
+
+	os << "[midirouter] nsec per event, " << events_per_block << " events per block" << std::endl;
+	os	<< std::setw(8) << "targets"
+		<< std::setw(12) << "fan-out"
+		<< std::setw(10) << "scan"
+		<< std::setw(10) << "router"
+		<< std::endl;
+
+	std::vector<VstMidiEvent> events;
+	boost::random::mt19937 engine(1);
+	boost::random::uniform_int_distribution<size_t> key_dist(0, MidiRouter::NUM_KEYS - 1);
+	boost::random::uniform_int_distribution<size_t> kind_dist(0, 9);
+	for(size_t i = 0; i < events_per_block * num_blocks; ++i) {
+		VstInt32 const delta = static_cast<VstInt32>(i % events_per_block);
+		size_t const kind = kind_dist(engine);
+		if(kind < 5)		{ events.push_back(MakeNoteOn(0, key_dist(engine), 100, delta)); }
+		else if(kind < 9)	{ events.push_back(MakeNoteOff(0, key_dist(engine), 0, delta)); }
+		else				{ events.push_back(MakeControlChange(0, 1, key_dist(engine), delta)); }
+	}
+
+	for(size_t i = 0; i < sizeof(targets_list) / sizeof(targets_list[0]); ++i) {
+		size_t const num_targets = targets_list[i];
+
+		//! Ō̑͑Ŝɏd˂郌C[BcŃL[{[h𓙕B
+		std::vector<Zone> zones(num_targets);
+		size_t const num_splits = std::max<size_t>(num_targets - 1, 1);
+		for(size_t t = 0; t < num_targets; ++t) {
+			Zone &zone = zones[t];
+			zone.channel = 0;
+			if(t == num_targets - 1 && num_targets > 1) {
+				zone.lowest_key = 0;
+				zone.highest_key = MidiRouter::NUM_KEYS - 1;
+			} else {
+				zone.lowest_key = MidiRouter::NUM_KEYS * t / num_splits;
+				zone.highest_key = MidiRouter::NUM_KEYS * (t + 1) / num_splits - 1;
+			}
+		}
+
+		std::vector<VstEventBuffer> buffers(num_targets);
+		for(auto &buffer: buffers) { buffer.Allocate(events_per_block, 0); }
+
+		size_t routed = 0;
+		Stopwatch sw;
+		for(size_t b = 0; b < num_blocks; ++b) {
+			for(size_t e = b * events_per_block; e < (b + 1) * events_per_block; ++e) {
+				VstMidiEvent const &event = events[e];
+				size_t const channel = event.midiData[0] & 0x0F;
+				size_t const key = event.midiData[1];
+				bool const is_note = (event.midiData[0] & 0xE0) == 0x80;
+				for(size_t t = 0; t < num_targets; ++t) {
+					Zone const &zone = zones[t];
+					if(zone.channel != channel) { continue; }
+					if(is_note && (key < zone.lowest_key || zone.highest_key < key)) { continue; }
+					buffers[t].Push(event);
+				}
+			}
+			for(auto &buffer: buffers) {
+				routed += buffer.size();
+				buffer.Clear();
+			}
+		}
+		double const scan = sw.Elapsed() / events.size();
+
+		MidiRouter router(num_targets, events_per_block, 0);
+		for(size_t t = 0; t < num_targets; ++t) {
+			router.AddZone(t, zones[t].channel, zones[t].lowest_key, zones[t].highest_key);
+		}
+
+		sw.Restart();
+		for(size_t b = 0; b < num_blocks; ++b) {
+			router.Route(events.begin() + b * events_per_block, events.begin() + (b + 1) * events_per_block);
+			router.Flush([] (size_t, VstEventBuffer const &) {});
+		}
+		double const routed_time = sw.Elapsed() / events.size();
+
+		os	<< std::setw(8) << num_targets
+			<< std::fixed << std::setprecision(2)
+			<< std::setw(12) << (static_cast<double>(routed) / events.size())
+			<< std::setprecision(1)
+			<< std::setw(10) << (scan * 1e9)
+			<< std::setw(10) << (routed_time * 1e9)
+			<< std::endl;
+	}
+	os << std::endl;
+}
+
+//! ZbV̓ǂݍݎ
+//! entries̃vOCA[J[Xbh̐ςēǂݍ݁ASč쐬ďԂ𕜌I܂ł̎ԂׂB
+//! [J[Xbh0̍śAGUIXbh1ǂݍ(܂ł̋N̓ǂݍݕɑ)B
+//! ŏ1DLLt@CLbVɍڂĂȂe󂯂̂ŁAvOɈxǂݍłB
+inline
+void RunSessionStartupBenchmark(std::ostream &os, std::vector<SessionEntry> const &entries, SessionLoader::create_function_t create)
+{
+	size_t const num_cores = std::max<size_t>(boost::thread::hardware_concurrency(), 1);
+	size_t const workers_list[] = { 0, 1, 2, 4, 8, num_cores };
+	size_t const num_runs = 3;
+
+	os << "[startup] " << entries.size() << " plugins, " << num_cores << " cores, best of " << num_runs << " runs" << std::endl;
+	os	<< std::setw(8) << "workers"
+		<< std::setw(12) << "sec"
+		<< std::setw(10) << "speedup"
+		<< std::setw(8) << "failed"
+		<< std::endl;
+
+	{
+		SessionLoader warmup(entries, create, 0);
+		warmup.Wait();
+	}
+
+	double sequential = 0;
+	for(size_t i = 0; i < sizeof(workers_list) / sizeof(workers_list[0]); ++i) {
+		size_t const num_workers = workers_list[i];
+		if(num_workers > num_cores * 2) { continue; }
+		if(i == sizeof(workers_list) / sizeof(workers_list[0]) - 1 &&
+		   std::find(workers_list, workers_list + i, num_workers) != workers_list + i)
+		{
+			continue;
+		}
+
+		double best = 0;
+		size_t failed = 0;
+		for(size_t r = 0; r < num_runs; ++r) {
+			Stopwatch sw;
+			SessionLoader loader(entries, create, num_workers);
+			loader.Wait();
+			double const elapsed = sw.Elapsed();
+			if(r == 0 || elapsed < best) { best = elapsed; }
+
+			failed = 0;
+			for(size_t e = 0; e < loader.GetNumEntries(); ++e) {
+				if(loader.GetStatus(e) == SessionLoader::FAILED) { ++failed; }
+			}
+			//! 쐬vOC̔j́AvɊ܂߂Ȃ
+		}
+		if(num_workers == 0) { sequential = best; }
+
+		os	<< std::setw(8) << num_workers
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(12) << best
+			<< std::setprecision(2)
+			<< std::setw(10) << (best > 0 ? sequential / best : 0)
+			<< std::setw(8) << failed
+			<< std::endl;
+	}
+	os << std::endl;
+}
+
+//! CX^X̕׎ŁASCX^XɑCxgp^[
+//! 120BPM16Ƃ4̘a炵AubNƂɃW[Vƃsb`xh𓮂B
+//! TvO[gƃubNTCYł΁A񓯂CxgɂȂB
+struct CapacityEventPattern
+{
+	explicit CapacityEventPattern(size_t sampling_rate)
+		:	step_frames_(std::max<size_t>(sampling_rate * 60 / 120 / 4, 1))
+		,	position_(0)
+		,	step_(0)
+	{}
+
+	//! block_sizet[̃CxgAdeltaFrames̏batchɍ
+	void Next(size_t block_size, MidiEventBatch &batch)
+	{
+		size_t const block_index = position_ / block_size;
+		batch.Clear();
+		batch.Add(MakeControlChange(0, 1, block_index % 128, 0));
+		batch.Add(MakePitchBend(0, static_cast<int>(block_index % 64) * 128 - 4096, 0));
+
+		size_t const end = position_ + block_size;
+		for(size_t start = step_ * step_frames_; start < end; start = step_ * step_frames_) {
+			VstInt32 const delta = static_cast<VstInt32>(start - position_);
+			if(step_ > 0) {
+				for(size_t i = 0; i < CHORD_SIZE; ++i) { batch.Add(MakeNoteOff(0, chord_note(step_ - 1, i), 0, delta)); }
+			}
+			for(size_t i = 0; i < CHORD_SIZE; ++i) { batch.Add(MakeNoteOn(0, chord_note(step_, i), 64 + (step_ * 13) % 64, delta)); }
+			++step_;
+		}
+		position_ = end;
+	}
+
+private:
+	enum { CHORD_SIZE = 4 };
+
+	static
+	size_t chord_note(size_t step, size_t index)
+	{
+		static size_t const intervals[CHORD_SIZE] = { 0, 4, 7, 11 };
+		return 48 + (step * 5) % 24 + intervals[index];
+	}
+
+	size_t	step_frames_;
+	size_t	position_;
+	size_t	step_;
+};
+
+//! ׎1񕪂̌
+struct CapacityTrialResult
+{
+	CapacityTrialResult()
+		:	num_blocks(0)
+		,	num_missed(0)
+		,	average_sec(0)
+		,	max_sec(0)
+	{}
+
+	size_t	num_blocks;
+	//! ubN̒(fbhC)ɊԂɍȂubN̐
+	size_t	num_missed;
+	double	average_sec;
+	double	max_sec;
+};
+
+//! pluginsnum_threads̃XbhŕSāAsecondsbԂ̃y[Xŏ
+//! ubNƂɁAubN̊Jn܂ő҂ĂSXbhɏJnA
+//! SCX^X̏I܂ł̎ԂubN̒ƔׂB
+//! Xbh̓I[fBIXbhƓݒɂāAubN̊Ԃ̓bNg킸ɑ҂B
+//! ԂɍȂubNmax_missed𒴂_őł؂B
+inline
+CapacityTrialResult RunCapacityTrial(
+	std::vector<VstPlugin *> const &plugins,
+	size_t block_size,
+	size_t sampling_rate,
+	size_t num_threads,
+	double seconds,
+	size_t max_missed,
+	AudioThreadSettings const &thread_settings )
+{
+	BOOST_ASSERT(0 < num_threads);
+
+	size_t const num_blocks = std::max<size_t>(static_cast<size_t>(seconds * sampling_rate / block_size), 1);
+	double const deadline = static_cast<double>(block_size) / sampling_rate;
+
+	CapacityEventPattern pattern(sampling_rate);
+	MidiEventBatch batch;
+	boost::atomic<size_t> generation(0);
+	boost::atomic<size_t> remaining(0);
+	boost::atomic<bool> quit(false);
+
+	//! XbhtSCX^X(t, t + num_threads, ...)
+	auto process_share = [&] (size_t t) {
+		for(size_t i = t; i < plugins.size(); i += num_threads) {
+			VstPlugin &plugin = *plugins[i];
+			plugin.AddEvents(batch);
+			plugin.ProcessEvents();
+			plugin.ProcessAudio(block_size);
+		}
+	};
+
+	boost::thread_group workers;
+	for(size_t t = 1; t < num_threads; ++t) {
+		workers.create_thread([&, t] {
+			SetupAudioThread(thread_settings);
+			ThreadRole::SetCurrent(ThreadRole::REALTIME);
+			size_t seen = 0;
+			for( ; ; ) {
+				size_t current;
+				while((current = generation.load(boost::memory_order_acquire)) == seen) {
+					boost::this_thread::yield();
+				}
+				seen = current;
+				if(quit.load(boost::memory_order_acquire)) { break; }
+				process_share(t);
+				remaining.fetch_sub(1, boost::memory_order_release);
+			}
+		});
+	}
+
+	CapacityTrialResult result;
+	boost::thread runner([&] {
+		SetupAudioThread(thread_settings);
+		ThreadRole::SetCurrent(ThreadRole::REALTIME);
+		double total = 0;
+		boost::chrono::steady_clock::time_point const start = boost::chrono::steady_clock::now();
+		for(size_t b = 0; b < num_blocks; ++b) {
+			//! Cxg̍쐬GUIXbhȂǂōs鏈Ȃ̂ŁAvɂ͊܂߂ȂB
+			pattern.Next(block_size, batch);
+			boost::this_thread::sleep_until(
+				start + boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(
+					boost::chrono::duration<double>(b * deadline))
+				);
+
+			Stopwatch sw;
+			remaining.store(num_threads - 1, boost::memory_order_relaxed);
+			generation.fetch_add(1, boost::memory_order_release);
+			process_share(0);
+			while(remaining.load(boost::memory_order_acquire) != 0) {}
+			double const elapsed = sw.Elapsed();
+
+			++result.num_blocks;
+			total += elapsed;
+			result.max_sec = std::max<double>(result.max_sec, elapsed);
+			if(elapsed > deadline) {
+				if(++result.num_missed > max_missed) { break; }
+			}
+		}
+		result.average_sec = total / result.num_blocks;
+
+		quit.store(true, boost::memory_order_release);
+		generation.fetch_add(1, boost::memory_order_release);
+	});
+	runner.join();
+	workers.join_all();
+
+	return result;
+}
+
+//! CPU̖O(WXgProcessorNameString)B擾łȂ΋󕶎
+inline
+std::string GetProcessorName()
+{
+	char name[256] = {};
+	DWORD size = sizeof(name);
+	LSTATUS const status = RegGetValueA(
+		HKEY_LOCAL_MACHINE, "HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\0", "ProcessorNameString",
+		RRF_RT_REG_SZ, nullptr, name, &size);
+	return (status == ERROR_SUCCESS) ? std::string(name) : std::string();
+}
+
+//! 1̃}VœvOC̃CX^X
+//! ubNTCYƃXbh̑gݍ킹ƂɁACX^X1ȂA
+//! SCX^XɓCxgp^[(CapacityEventPattern)𑗂ĎԂ̃y[XŏA
+//! fbhCɊԂɍȂubN0.1%𒴂钼ÕCX^X߂B
+//! n߂CX^X́AXbhňÕubNTCYɂċ߂CX^XɂB
+//! CX^Xcreate(ő̃ubNTCY)ō쐬AׂĂ̑gݍ킹Ŏg񂷁B
+//! ʂ̓}VzXg̃o[WԂŔׂ悤ɁACPUƃrh̏ƈꏏɏoB
+//!  - capacity	: fbhCɊԂɍő̃CX^X(MAX_INSTANCES܂ŊԂɍꍇ+t)
+//!  - avg, max	: ̃CX^Xł́AubN̏(usec)̕ςƍő
+//!  - load		: ς̏Ԃ̃fbhCɑ΂銄
+inline
+void RunCapacityBenchmark(
+	std::ostream &os,
+	std::string const &plugin_name,
+	std::function<std::unique_ptr<VstPlugin>(size_t block_size)> create,
+	size_t sampling_rate,
+	double trial_seconds )
+{
+	enum { MAX_INSTANCES = 256, WARMUP_BLOCKS = 8 };
+	size_t const block_sizes[] = { 64, 128, 256, 512 };
+	size_t const max_block_size = block_sizes[sizeof(block_sizes) / sizeof(block_sizes[0]) - 1];
+	size_t const num_cores = std::max<size_t>(boost::thread::hardware_concurrency(), 1);
+	size_t const threads_list[] = { 1, 2, 4, num_cores };
+
+	AudioThreadSettings thread_settings;
+
+	os << "[capacity] " << plugin_name << std::endl;
+	os << "  cpu: " << GetProcessorName() << " (" << num_cores << " logical cores)" << std::endl;
+	os << "  host build: " << __DATE__ << " " << __TIME__ << std::endl;
+	os	<< "  " << sampling_rate << " Hz, " << trial_seconds << " sec per step, "
+		<< "miss tolerance 0.1% (rounded up, shown as missed/allowed), max " << MAX_INSTANCES << " instances" << std::endl;
+	os	<< std::setw(8) << "block"
+		<< std::setw(9) << "threads"
+		<< std::setw(12) << "deadline"
+		<< std::setw(10) << "capacity"
+		<< std::setw(10) << "avg"
+		<< std::setw(10) << "max"
+		<< std::setw(8) << "load"
+		<< std::setw(10) << "missed"
+		<< std::endl;
+
+	std::vector<std::unique_ptr<VstPlugin>> instances;
+	std::vector<VstPlugin *> active;
+	std::string create_error;
+
+	//! CX^X1ǉB쐬̐ubN̓mۂȂǂŒxƂ̂ŁAv̑OɏĂB
+	auto add_instance = [&] () -> bool {
+		if(!create_error.empty()) { return false; }
+		try {
+			std::unique_ptr<VstPlugin> plugin = create(max_block_size);
+			for(size_t b = 0; b < WARMUP_BLOCKS; ++b) {
+				plugin->ProcessEvents();
+				plugin->ProcessAudio(max_block_size);
+			}
+			instances.push_back(std::move(plugin));
+			return true;
+		} catch(std::exception &e) {
+			create_error = e.what();
+			return false;
+		}
+	};
+
+	//! XbhƂ́AÕubNTCYł̃CX^X
+	//! ̃ubNTCYł́ÃCX^X玎n߂B
+	size_t hints[sizeof(threads_list) / sizeof(threads_list[0])];
+	std::fill(hints, hints + sizeof(hints) / sizeof(hints[0]), 1);
+
+	for(size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); ++i) {
+		size_t const block_size = block_sizes[i];
+		double const deadline = static_cast<double>(block_size) / sampling_rate;
+		size_t const num_blocks = std::max<size_t>(static_cast<size_t>(trial_seconds * sampling_rate / block_size), 1);
+		//! e񐔂0.1%؂グB(1XebvZƁA؂̂Ăł1̒xeȂȂ)
+		size_t const max_missed = (num_blocks + 999) / 1000;
+
+		for(size_t j = 0; j < sizeof(threads_list) / sizeof(threads_list[0]); ++j) {
+			size_t const num_threads = threads_list[j];
+			if(num_threads > num_cores) { continue; }
+			if(std::find(threads_list, threads_list + j, num_threads) != threads_list + j) { continue; }
+
+			//! ŏ̃CX^XŊԂɍ1₵AԂɍȂΊԂɍ܂1炷B
+			size_t capacity = 0;
+			bool limit_reached = false;
+			bool descending = false;
+			CapacityTrialResult at_capacity;
+			for(size_t n = std::max<size_t>(hints[j], 1); ; ) {
+				if(n > MAX_INSTANCES) {
+					limit_reached = true;
+					break;
+				}
+				while(instances.size() < n && add_instance()) {}
+				if(instances.size() < n) { break; }
+
+				active.clear();
+				for(size_t k = 0; k < n; ++k) { active.push_back(instances[k].get()); }
+
+				CapacityTrialResult const result =
+					RunCapacityTrial(active, block_size, sampling_rate, num_threads, trial_seconds, max_missed, thread_settings);
+				if(result.num_missed <= max_missed) {
+					capacity = n;
+					at_capacity = result;
+					if(descending) { break; }
+					++n;
+				} else {
+					if(capacity > 0 || n == 1) { break; }
+					descending = true;
+					--n;
+				}
+			}
+			hints[j] = capacity;
+
+			std::ostringstream missed;
+			missed << at_capacity.num_missed << "/" << max_missed;
+			os	<< std::setw(8) << block_size
+				<< std::setw(9) << num_threads
+				<< std::fixed << std::setprecision(0)
+				<< std::setw(12) << (deadline * 1e6)
+				<< std::setw(9) << capacity << (limit_reached ? "+" : " ")
+				<< std::setw(10) << (at_capacity.average_sec * 1e6)
+				<< std::setw(10) << (at_capacity.max_sec * 1e6)
+				<< std::setprecision(1)
+				<< std::setw(7) << (at_capacity.average_sec / deadline * 100) << "%"
+				<< std::setw(10) << missed.str()
+				<< std::endl;
+		}
+	}
+	if(!create_error.empty()) {
+		os << "  instance creation stopped at " << instances.size() << " : " << create_error << std::endl;
+	}
+	os << std::endl;
+}
+
+//! 񐳋K̐ff1񕪂̌
+struct DenormalTrialResult
+{
+	DenormalTrialResult()
+		:	num_blocks(0)
+		,	num_denormal_blocks(0)
+		,	num_denormal_samples(0)
+		,	average_sec(0)
+		,	tail_average_sec(0)
+		,	max_sec(0)
+	{}
+
+	size_t			num_blocks;
+	//! o͂ɔ񐳋K܂łubN̐
+	size_t			num_denormal_blocks;
+	boost::uint64_t	num_denormal_samples;
+	double			average_sec;
+	//! ͂m[g~߂́A]C̕̕
+	double			tail_average_sec;
+	double			max_sec;
+};
+
+//! pluginɍŏexcite_secondsbAc͗]CĂ܂ŁAsecondsb
+//! VZɂ̓m[g𑗂AGtFNgɂ̓mCY͂B
+//! flushfalseȂFTZDAZԂŏAtrueȂݒ肵ԂŏB
+//! ubNƂ̏ԂƁAo͂Ɋ܂܂񐳋K̐L^B(̂͌v̊Oōs)
+inline
+DenormalTrialResult RunDenormalTrial(
+	VstPlugin &plugin,
+	size_t block_size,
+	size_t sampling_rate,
+	double excite_seconds,
+	double seconds,
+	bool flush )
+{
+	DenormalScope const scope(flush);
+
+	size_t const num_blocks = std::max<size_t>(static_cast<size_t>(seconds * sampling_rate / block_size), 1);
+	size_t const excite_blocks = std::min<size_t>(static_cast<size_t>(excite_seconds * sampling_rate / block_size), num_blocks);
+
+	size_t const notes[] = { 48, 55, 60, 64 };
+	std::vector<VstMidiEvent> note_ons;
+	std::vector<VstMidiEvent> note_offs;
+	for(size_t i = 0; i < sizeof(notes) / sizeof(notes[0]); ++i) {
+		note_ons.push_back(MakeNoteOn(0, notes[i], 100));
+		note_offs.push_back(MakeNoteOff(0, notes[i], 0));
+	}
+
+	boost::random::mt19937 engine(1);
+	boost::random::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+
+	DenormalTrialResult result;
+	double total = 0;
+	double tail_total = 0;
+	for(size_t b = 0; b < num_blocks; ++b) {
+		if(b == 0) { plugin.AddEvents(note_ons.begin(), note_ons.end()); }
+		if(b == excite_blocks) { plugin.AddEvents(note_offs.begin(), note_offs.end()); }
+		for(size_t ch = 0; ch < plugin.GetNumInputs(); ++ch) {
+			float *input = plugin.GetInputBuffers()[ch];
+			for(size_t i = 0; i < block_size; ++i) {
+				input[i] = (b < excite_blocks) ? dist(engine) : 0.0f;
+			}
+		}
+
+		Stopwatch sw;
+		plugin.ProcessEvents();
+		float **output = plugin.ProcessAudio(block_size);
+		double const elapsed = sw.Elapsed();
+
+		total += elapsed;
+		if(b >= excite_blocks) { tail_total += elapsed; }
+		result.max_sec = std::max<double>(result.max_sec, elapsed);
+
+		size_t denormals = 0;
+		for(size_t ch = 0; ch < plugin.GetNumOutputs(); ++ch) {
+			denormals += Denormal::Count(output[ch], block_size);
+		}
+		if(denormals > 0) { ++result.num_denormal_blocks; }
+		result.num_denormal_samples += denormals;
+		++result.num_blocks;
+	}
+
+	result.average_sec = total / num_blocks;
+	result.tail_average_sec = (num_blocks > excite_blocks) ? tail_total / (num_blocks - excite_blocks) : 0;
+	return result;
+}
+
+//! vOC̏o͂ɔ񐳋KpxƁAɂ鏈Ԃ̑
+//! Ԃn߂邽߁AFTZDAZꍇƐݒ肵ꍇƂŁAꂼVCX^Xcreate()ō쐬ďB
+//!  - denormal blocks	: o͂ɔ񐳋K܂łubN̊
+//!  - avg, tail, max	: ubN̏(usec)̕ρA]C̕̕ρAő
+//! ]C̏̕Ԃ̔䂪AFTZDAZݒ肵Ȃꍇ̒x̖ڈɂȂB
+inline
+void RunDenormalBenchmark(
+	std::ostream &os,
+	std::string const &plugin_name,
+	std::function<std::unique_ptr<VstPlugin>()> create,
+	size_t block_size,
+	size_t sampling_rate )
+{
+	double const excite_seconds = 1.0;
+	double const seconds = 10.0;
+
+	os << "[denormal] " << plugin_name << std::endl;
+	os	<< "  " << sampling_rate << " Hz, " << block_size << " frames, "
+		<< excite_seconds << " sec excitation + " << (seconds - excite_seconds) << " sec tail" << std::endl;
+	os	<< std::setw(10) << ""
+		<< std::setw(18) << "denormal blocks"
+		<< std::setw(18) << "denormal samples"
+		<< std::setw(10) << "avg"
+		<< std::setw(10) << "tail"
+		<< std::setw(10) << "max"
+		<< std::endl;
+
+	DenormalTrialResult results[2];
+	for(size_t i = 0; i < 2; ++i) {
+		bool const flush = (i == 1);
+		std::unique_ptr<VstPlugin> plugin = create();
+		results[i] = RunDenormalTrial(*plugin, block_size, sampling_rate, excite_seconds, seconds, flush);
+
+		DenormalTrialResult const &r = results[i];
+		os	<< std::setw(10) << (flush ? "ftz/daz" : "off")
+			<< std::fixed << std::setprecision(1)
+			<< std::setw(17) << (100.0 * r.num_denormal_blocks / r.num_blocks) << "%"
+			<< std::setw(18) << r.num_denormal_samples
+			<< std::setprecision(0)
+			<< std::setw(10) << (r.average_sec * 1e6)
+			<< std::setw(10) << (r.tail_average_sec * 1e6)
+			<< std::setw(10) << (r.max_sec * 1e6)
+			<< std::endl;
+	}
+
+	if(results[1].tail_average_sec > 0) {
+		os	<< std::setprecision(2)
+			<< "  tail slowdown without ftz/daz: x" << (results[0].tail_average_sec / results[1].tail_average_sec) << std::endl;
+	}
+	os << std::endl;
+}
+
+}}	//::hwm::bench
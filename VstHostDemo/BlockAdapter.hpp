@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+namespace hwm {
+
+//! vOC̏P(ubNTCY)ƁAfoCXvt[̈ႢzNX
+//!
+//! vOC͏internal_block_sizet[ǍʂOobt@ɗ߂ĂB
+//! foCX̗vɂ́AOobt@ɗ܂Ă镪牞AȂΒǉōB
+//! ubN΃Cxg̔fȂAvOC̍Ɨ̈LbVɎ܂₷ȂB
+//! tɁAubNfoCX̃obt@傫邱ƂłB
+//!
+//! foCX̗vt[͖ςĂ悢BPullł̓mۂsȂB
+struct BlockAdapter
+{
+	//! channels			: `l
+	//! internal_block_size	: vOCxɍt[
+	//! max_device_frames	: xPullŗvt[̖ڈB𒴂v͕ďB
+	BlockAdapter(size_t channels, size_t internal_block_size, size_t max_device_frames)
+		:	internal_block_size_(internal_block_size)
+		,	capacity_(internal_block_size + max_device_frames)
+		,	read_pos_(0)
+		,	num_frames_(0)
+		,	num_rendered_blocks_(0)
+	{
+		BOOST_ASSERT(internal_block_size > 0);
+		BOOST_ASSERT(max_device_frames > 0);
+
+		ring_.resize(channels);
+		for(size_t ch = 0; ch < channels; ++ch) {
+			ring_[ch].assign(capacity_, 0.0f);
+		}
+	}
+
+	//! dest[ch][0 .. frames)𖄂߂B
+	//! render()́Ainternal_block_sizet[̃f[^`l̔zƂĕԂ֐B
+	//! (VstPlugin::ProcessAudio̖߂lƓ`)
+	template<class Render>
+	void Pull(float * const *dest, size_t frames, Render render)
+	{
+		size_t const channels = ring_.size();
+		size_t const max_chunk = capacity_ - internal_block_size_;
+
+		size_t done = 0;
+		while(done < frames) {
+			size_t const chunk = std::min<size_t>(frames - done, max_chunk);
+
+			while(num_frames_ < chunk) {
+				float const * const *source = render();
+				write(source);
+				++num_rendered_blocks_;
+			}
+
+			for(size_t ch = 0; ch < channels; ++ch) {
+				read(ring_[ch].data(), dest[ch] + done, chunk);
+			}
+			read_pos_ = (read_pos_ + chunk) % capacity_;
+			num_frames_ -= chunk;
+			done += chunk;
+		}
+	}
+
+	//! ܂Ăf[^̂Ă
+	void Reset()
+	{
+		read_pos_ = 0;
+		num_frames_ = 0;
+	}
+
+	size_t	GetInternalBlockSize() const { return internal_block_size_; }
+
+	//! Oobt@ɗ܂Ăt[
+	size_t	GetNumBufferedFrames() const { return num_frames_; }
+
+	//! ܂łrenderĂяo
+	size_t	GetNumRenderedBlocks() const { return num_rendered_blocks_; }
+
+	//! ĂfoCXɓn܂łɁAOobt@Őő̒x(t[)
+	size_t	GetMaxLatency() const { return internal_block_size_ - 1; }
+
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		for(auto &buffer: ring_) {
+			visit(static_cast<void *>(buffer.data()), buffer.size() * sizeof(float));
+		}
+	}
+
+private:
+	//! ubNOobt@̖ɒǉ
+	void write(float const * const *source)
+	{
+		BOOST_ASSERT(num_frames_ + internal_block_size_ <= capacity_);
+
+		size_t const write_pos = (read_pos_ + num_frames_) % capacity_;
+		size_t const first = std::min<size_t>(internal_block_size_, capacity_ - write_pos);
+		for(size_t ch = 0; ch < ring_.size(); ++ch) {
+			float *ring = ring_[ch].data();
+			std::memcpy(ring + write_pos, source[ch], first * sizeof(float));
+			std::memcpy(ring, source[ch] + first, (internal_block_size_ - first) * sizeof(float));
+		}
+		num_frames_ += internal_block_size_;
+	}
+
+	void read(float const *ring, float *dest, size_t frames) const
+	{
+		size_t const first = std::min<size_t>(frames, capacity_ - read_pos_);
+		std::memcpy(dest, ring + read_pos_, first * sizeof(float));
+		std::memcpy(dest + first, ring, (frames - first) * sizeof(float));
+	}
+
+private:
+	size_t							internal_block_size_;
+	size_t							capacity_;
+	size_t							read_pos_;
+	size_t							num_frames_;
+	size_t							num_rendered_blocks_;
+	std::vector<std::vector<float>>	ring_;
+};
+
+}	//::hwm
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+namespace hwm {
+
+//! WaveI[fBIfoCX̃obt@̐ݒ
+//! o͂̃CeV́AfoCXɓnĂobt@̍v(block_size * multiplicity)t[ɂȂB
+struct BufferConfig
+{
+	enum { VERSION = 1 };
+
+	BufferConfig()
+		:	block_size(0)
+		,	multiplicity(0)
+		,	sampling_rate(0)
+	{}
+
+	BufferConfig(size_t frames, size_t buffers)
+		:	block_size(frames)
+		,	multiplicity(buffers)
+		,	sampling_rate(0)
+	{}
+
+	//! obt@̃t[
+	size_t		block_size;
+	//! obt@dx
+	size_t		multiplicity;
+	//! Ƃ̃foCX̃TvO[g
+	size_t		sampling_rate;
+	//! ɎgvOC̃pX(CP932Bǂݍݎɂ͎QlƂĎg)
+	std::string	plugin;
+
+	size_t	GetLatencyFrames() const { return block_size * multiplicity; }
+
+	//! "obt@TCY x dx"
+	std::string	ToString() const
+	{
+		std::ostringstream ss;
+		ss << block_size << " x " << multiplicity;
+		return ss.str();
+	}
+
+	//! ݒǂݍ
+	//! `sȏꍇ́Astd::runtime_error𓊂B
+	static
+	BufferConfig Load(std::istream &is)
+	{
+		namespace pt = boost::property_tree;
+
+		BufferConfig config;
+		try {
+			pt::ptree tree;
+			pt::read_xml(is, tree, pt::xml_parser::trim_whitespace);
+
+			pt::ptree const &root = tree.get_child("buffer_config");
+			if(root.get<int>("<xmlattr>.version") != VERSION) {
+				throw std::runtime_error("unsupported buffer config version");
+			}
+			config.block_size = root.get<size_t>("block_size");
+			config.multiplicity = root.get<size_t>("multiplicity");
+			config.sampling_rate = root.get<size_t>("sampling_rate", 0);
+			config.plugin = root.get<std::string>("plugin", "");
+		} catch(pt::ptree_error &e) {
+			throw std::runtime_error(std::string("invalid buffer config file : ") + e.what());
+		}
+		if(config.block_size == 0 || config.multiplicity < 2) {
+			throw std::runtime_error("invalid buffer config file : out of range");
+		}
+		return config;
+	}
+
+	//! ݒo
+	void Save(std::ostream &os) const
+	{
+		namespace pt = boost::property_tree;
+
+		pt::ptree root;
+		root.put("<xmlattr>.version", static_cast<int>(VERSION));
+		root.put("block_size", block_size);
+		root.put("multiplicity", multiplicity);
+		root.put("sampling_rate", sampling_rate);
+		root.put("plugin", plugin);
+
+		pt::ptree tree;
+		tree.add_child("buffer_config", root);
+		pt::write_xml(os, tree);
+		if(!os) { throw std::runtime_error("failed to write buffer config file"); }
+	}
+};
+
+//! ̃obt@̐ݒōĐ
+struct BufferTrialResult
+{
+	BufferTrialResult()
+		:	opened(false)
+		,	seconds(0)
+		,	num_callbacks(0)
+		,	num_underruns(0)
+		,	average_callback_sec(0)
+		,	max_callback_sec(0)
+	{}
+
+	//! foCXJǂ
+	bool	opened;
+	//! ۂɍĐ(r؂ꂽ񐔂el𒴂_őł؂)
+	double	seconds;
+	size_t	num_callbacks;
+	size_t	num_underruns;
+	double	average_callback_sec;
+	double	max_callback_sec;
+
+	double	GetUnderrunsPerMinute() const { return seconds > 0 ? num_underruns * 60.0 / seconds : 0; }
+};
+
+//! obt@̐ݒ̎̏
+struct BufferCalibrationSettings
+{
+	BufferCalibrationSettings()
+		:	trial_seconds(10)
+		,	max_underruns_per_minute(0)
+		,	margin_buffers(1)
+	{
+		size_t const sizes[] = { 128, 256, 512, 1024, 2048 };
+		size_t const multiplicities[] = { 2, 3, 4, 6, 8 };
+		block_sizes.assign(sizes, sizes + sizeof(sizes) / sizeof(sizes[0]));
+		this->multiplicities.assign(multiplicities, multiplicities + sizeof(multiplicities) / sizeof(multiplicities[0]));
+	}
+
+	std::vector<size_t>	block_sizes;
+	std::vector<size_t>	multiplicities;
+	//! ̐ݒōĐ(b)
+	double				trial_seconds;
+	//! eA1̍Đr؂ꂽ
+	double				max_underruns_per_minute;
+	//! ̗pݒ̑dxɉ]T̃obt@
+	//! ̍Đ͒ʏ̍Đ̌oHꕔȗĂ(vOC̍ւGUIXbhƂ̃bN̋Ȃ)̂ŁA
+	//! œr؂Ȃݒ菭]TĕۑB
+	size_t				margin_buffers;
+};
+
+//! obt@̐ݒŎۂɍĐ֐
+//! (ݒ, b, er؂̉)󂯎Ar؂ꂽ񐔂el𒴂_ōĐł؂Ă悢B
+typedef std::function<BufferTrialResult(BufferConfig const &config, double seconds, size_t max_underruns)> buffer_trial_function_t;
+
+//! Đr؂Ȃ͈͂ŁAłCeV̏obt@̐ݒT
+//! ̑gݍ킹CeV̏ɕ(CeVȂ瑽dx̑傫ɂ)A
+//! trial(ݒ, b, er؂̉)ŎۂɍĐāAr؂ꂽ񐔂elȓɎ܂ŏ̐ݒA
+//! xōĐĊm߂ĂAdxsettings.margin_buffersč̗pB
+//! ݒ育Ƃ̌ʂosɏoB𖞂ݒ肪Ȃboost::noneԂB
+inline
+boost::optional<BufferConfig> RunBufferCalibration(
+	std::ostream &os,
+	BufferCalibrationSettings const &settings,
+	size_t sampling_rate,
+	buffer_trial_function_t trial )
+{
+	std::vector<BufferConfig> candidates;
+	for(auto block_size: settings.block_sizes) {
+		for(auto multiplicity: settings.multiplicities) {
+			BufferConfig config(block_size, multiplicity);
+			config.sampling_rate = sampling_rate;
+			candidates.push_back(config);
+		}
+	}
+	std::stable_sort(candidates.begin(), candidates.end(), [] (BufferConfig const &lhs, BufferConfig const &rhs) {
+		if(lhs.GetLatencyFrames() != rhs.GetLatencyFrames()) { return lhs.GetLatencyFrames() < rhs.GetLatencyFrames(); }
+		return lhs.multiplicity > rhs.multiplicity;
+	});
+
+	size_t const max_underruns = static_cast<size_t>(settings.max_underruns_per_minute * settings.trial_seconds / 60.0);
+
+	os	<< "  " << sampling_rate << " Hz, " << settings.trial_seconds << " sec per step, "
+		<< "max " << settings.max_underruns_per_minute << " underruns per minute" << std::endl;
+	os	<< std::setw(8) << "block"
+		<< std::setw(8) << "bufs"
+		<< std::setw(12) << "latency"
+		<< std::setw(12) << "underruns"
+		<< std::setw(12) << "per min"
+		<< std::setw(10) << "avg"
+		<< std::setw(10) << "max"
+		<< std::setw(8) << "load"
+		<< std::endl;
+
+	auto run = [&] (BufferConfig const &config) -> bool {
+		BufferTrialResult const result = trial(config, settings.trial_seconds, max_underruns);
+		double const block_sec = static_cast<double>(config.block_size) / sampling_rate;
+
+		os	<< std::setw(8) << config.block_size
+			<< std::setw(8) << config.multiplicity
+			<< std::fixed << std::setprecision(1)
+			<< std::setw(9) << (config.GetLatencyFrames() * 1000.0 / sampling_rate) << " ms";
+		if(!result.opened) {
+			os << "  failed to open the device" << std::endl;
+			return false;
+		}
+		os	<< std::setw(12) << result.num_underruns
+			<< std::setw(12) << result.GetUnderrunsPerMinute()
+			<< std::setprecision(0)
+			<< std::setw(10) << (result.average_callback_sec * 1e6)
+			<< std::setw(10) << (result.max_callback_sec * 1e6)
+			<< std::setprecision(1)
+			<< std::setw(7) << (result.average_callback_sec / block_sec * 100) << "%"
+			<< std::endl;
+		return result.num_underruns <= max_underruns;
+	};
+
+	for(auto const &config: candidates) {
+		if(run(config) && run(config)) {
+			BufferConfig selected = config;
+			selected.multiplicity += settings.margin_buffers;
+			if(settings.margin_buffers > 0) {
+				os << "  passed with " << config.ToString() << ", added " << settings.margin_buffers << " buffers as a margin" << std::endl;
+			}
+			return selected;
+		}
+	}
+	return boost::none;
+}
+
+}	//::hwm
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include "./ControlProtocol.hpp"
+
+namespace hwm {
+
+//! Rg[\Pbg̃NCAg
+//! ÕvȎM߂̂̂ŁA׎(RunControlLoadGenerator)ŎgB
+struct ControlClient
+{
+	ControlClient()
+		:	socket_(INVALID_SOCKET)
+	{
+		buffer_.reserve(ControlProtocol::HEADER_SIZE + ControlProtocol::MAX_COMMANDS_PER_FRAME * ControlProtocol::COMMAND_SIZE);
+	}
+
+	~ControlClient()
+	{
+		Close();
+	}
+
+	//! path̃\PbgɐڑBsꍇfalseԂB
+	bool	Connect(std::string const &path)
+	{
+		Close();
+		if(!winsock_.IsSucceeded()) { return false; }
+
+		UnixSocketAddress address;
+		if(!address.SetPath(path)) { return false; }
+
+		socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(socket_ == INVALID_SOCKET) { return false; }
+
+		if(connect(socket_, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) == SOCKET_ERROR) {
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void	Close()
+	{
+		if(socket_ == INVALID_SOCKET) { return; }
+		closesocket(socket_);
+		socket_ = INVALID_SOCKET;
+	}
+
+	bool	IsConnected() const { return socket_ != INVALID_SOCKET; }
+
+	//! commands𑗐M
+	//! MAX_COMMANDS_PER_FRAMEƂɈ̃t[ɂ܂Ƃ߁AŜxsendőB
+	//! MłȂꍇ͐ڑfalseԂB
+	bool	Send(ControlCommand const *commands, size_t num_commands)
+	{
+		if(!IsConnected()) { return false; }
+
+		buffer_.clear();
+		while(num_commands > 0) {
+			size_t const n = std::min<size_t>(num_commands, ControlProtocol::MAX_COMMANDS_PER_FRAME);
+			ControlProtocol::Encode(commands, n, buffer_);
+			commands += n;
+			num_commands -= n;
+		}
+
+		char const *p = buffer_.data();
+		size_t remaining = buffer_.size();
+		while(remaining > 0) {
+			int const sent = send(socket_, p, static_cast<int>(remaining), 0);
+			if(sent == SOCKET_ERROR || sent == 0) {
+				Close();
+				return false;
+			}
+			p += sent;
+			remaining -= sent;
+		}
+		return true;
+	}
+
+private:
+	WinsockInitializer	winsock_;
+	SOCKET				socket_;
+	std::vector<char>	buffer_;
+
+	ControlClient(ControlClient const &);
+	ControlClient & operator=(ControlClient const &);
+};
+
+//! Rg[\Pbg̕׎
+//! path̃T[o[ɐڑA1bevents_per_sec̃R}hsecondsbԑ葱B
+//! 1msƂɁA̎_܂łɑׂ̃R}hAcommands_per_frame̃t[ɂ܂Ƃ߂đB
+//! R}h̓m[gIƃm[gIt̑g(m[gɗ̂ŁAςȂɂȂȂ)ɁA
+//! 162̊ŃW[V(CC#1)ƃsb`xh́BŌALL_NOTES_OFF𑗂B
+//! MvOCɓ͂܂ł̒x́AzXg̃Xe[^X\(ControlServer::ToString)ŊmFB
+//! ڑłȂꍇArŐؒfꂽꍇfalseԂB
+inline
+bool RunControlLoadGenerator(
+	std::ostream &os,
+	std::string const &path,
+	double events_per_sec,
+	double seconds,
+	size_t commands_per_frame )
+{
+	namespace chrono = boost::chrono;
+	typedef chrono::steady_clock clock;
+
+	commands_per_frame = std::max<size_t>(commands_per_frame, 1);
+
+	os << "[control-load] " << path << std::endl;
+	os	<< "  target " << events_per_sec << " events/sec, " << seconds << " sec, "
+		<< commands_per_frame << " commands per frame" << std::endl;
+
+	ControlClient client;
+	if(!client.Connect(path)) {
+		os << "  failed to connect." << std::endl;
+		return false;
+	}
+
+	std::vector<ControlCommand> commands;
+	commands.reserve(commands_per_frame);
+
+	boost::uint64_t num_sent = 0;
+	boost::uint64_t num_frames = 0;
+	double max_send_sec = 0;
+	bool succeeded = true;
+
+	//! iԖڂ̃R}h
+	//! 16ƂāAm[gIƃm[gIt̑g7ɃW[Vƃsb`xh𑗂B
+	auto make_command = [] (boost::uint64_t i) -> ControlCommand {
+		size_t const k = static_cast<size_t>(i % 16);
+		boost::uint64_t const cycle = i / 16;
+		if(k == 14) {
+			return ControlCommand::Make(ControlCommand::CONTROL_CHANGE, 0, 1, static_cast<boost::uint32_t>(cycle % 128));
+		} else if(k == 15) {
+			return ControlCommand::Make(ControlCommand::PITCH_BEND, 0, 0, static_cast<boost::uint32_t>(8192 + (cycle % 64) * 16));
+		}
+
+		size_t const note = 36 + static_cast<size_t>((cycle * 7 + k / 2) % 48);
+		if(k % 2 == 0) {
+			return ControlCommand::Make(ControlCommand::NOTE_ON, 0, note, 64 + static_cast<boost::uint32_t>(cycle % 64));
+		} else {
+			return ControlCommand::Make(ControlCommand::NOTE_OFF, 0, note, 0);
+		}
+	};
+
+	boost::uint64_t const total = static_cast<boost::uint64_t>(events_per_sec * seconds);
+	clock::time_point const start = clock::now();
+	for(size_t tick = 1; succeeded && num_sent < total; ++tick) {
+		boost::this_thread::sleep_until(start + chrono::milliseconds(tick));
+
+		double const elapsed = chrono::duration<double>(clock::now() - start).count();
+		boost::uint64_t const due = std::min<boost::uint64_t>(static_cast<boost::uint64_t>(elapsed * events_per_sec), total);
+		while(num_sent < due) {
+			size_t const n = static_cast<size_t>(std::min<boost::uint64_t>(due - num_sent, commands_per_frame));
+			commands.clear();
+			for(size_t i = 0; i < n; ++i) { commands.push_back(make_command(num_sent + i)); }
+
+			clock::time_point const send_start = clock::now();
+			if(!client.Send(commands.data(), commands.size())) {
+				succeeded = false;
+				break;
+			}
+			max_send_sec = std::max<double>(max_send_sec, chrono::duration<double>(clock::now() - send_start).count());
+			num_sent += n;
+			++num_frames;
+		}
+	}
+
+	ControlCommand const all_notes_off = ControlCommand::Make(ControlCommand::ALL_NOTES_OFF, 0, 0, 0);
+	client.Send(&all_notes_off, 1);
+
+	double const elapsed = chrono::duration<double>(clock::now() - start).count();
+	os	<< std::fixed << std::setprecision(1)
+		<< "  sent " << num_sent << " commands in " << num_frames << " frames, "
+		<< elapsed << " sec, " << (num_sent / elapsed) << " events/sec" << std::endl;
+	os	<< "  max send time " << (max_send_sec * 1e6) << " usec" << std::endl;
+	if(!succeeded) {
+		os << "  disconnected by the server." << std::endl;
+	}
+	return succeeded;
+}
+
+}	//::hwm
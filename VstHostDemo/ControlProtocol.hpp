@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+
+//! winsock2.h́Awindows.hɃCN[hĂKv
+//! (windows.hÂwinsock.h荞ނ)
+#include <winsock2.h>
+#include <windows.h>
+
+#pragma comment(lib, "ws2_32.lib")
+
+namespace hwm {
+
+//! Rg[\PbgŎ󂯎R}h
+//!
+//! ʐMHł́A̍\̂̂܂8oCg̃gGfBAŕׂB
+//!  - NOTE_ON, NOTE_OFF	: index = m[gԍ, value = xVeB
+//!  - CONTROL_CHANGE		: index = Rg[ԍ, value = l(0 .. 127)
+//!  - PROGRAM_CHANGE		: index = vOԍ
+//!  - PITCH_BEND			: value = 0 .. 16383 (8192Z^[)
+//!  - PARAMETER			: index = p[^ԍ, value = 0.0 .. 1.0float̃rbg
+//!  - TRANSPORT			: index = TransportCommand, value = LOCATEł̓TvʒuATEMPOłBPMfloat̃rbg
+//!  - ALL_NOTES_OFF		: S`lɃI[m[gIt(CC#123)𑗂
+struct ControlCommand
+{
+	enum Type {
+		NOTE_ON = 1,
+		NOTE_OFF,
+		CONTROL_CHANGE,
+		PROGRAM_CHANGE,
+		PITCH_BEND,
+		PARAMETER,
+		TRANSPORT,
+		ALL_NOTES_OFF
+	};
+
+	enum TransportCommand {
+		TRANSPORT_STOP,
+		TRANSPORT_PLAY,
+		TRANSPORT_LOCATE,
+		TRANSPORT_TEMPO
+	};
+
+	boost::uint8_t	type;
+	boost::uint8_t	channel;
+	boost::uint16_t	index;
+	boost::uint32_t	value;
+
+	static
+	ControlCommand Make(Type type, size_t channel, size_t index, boost::uint32_t value)
+	{
+		ControlCommand command;
+		command.type = static_cast<boost::uint8_t>(type);
+		command.channel = static_cast<boost::uint8_t>(channel);
+		command.index = static_cast<boost::uint16_t>(index);
+		command.value = value;
+		return command;
+	}
+
+	static
+	ControlCommand MakeFloat(Type type, size_t channel, size_t index, float value)
+	{
+		boost::uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return Make(type, channel, index, bits);
+	}
+
+	float	GetFloatValue() const
+	{
+		float f;
+		std::memcpy(&f, &value, sizeof(f));
+		return f;
+	}
+};
+
+BOOST_STATIC_ASSERT(sizeof(ControlCommand) == 8);
+
+//! Rg[\Pbg̒ʐM̌`
+//!
+//! NCAǵA4oCg̃wb_ɑControlCommandׂt[𑗂B
+//! wb_́At[Ɋ܂܂R}h̐(uint16)AVERSION(uint8)A\(uint8, 0)̏B
+//! R}h͎Mɏ邪A̃t[ɂ܂Ƃ߂R}hI[fBIubNŏƂ͌ȂB
+//! ControlServer::Dispatch1ubNɃCxgobt@Ɏ܂镪܂łoA
+//! ܂MXbht[̃R}hL[ɓĂrłôŁAt[̃ubNɕ邱ƂB
+struct ControlProtocol
+{
+	enum {
+		VERSION = 1,
+		HEADER_SIZE = 4,
+		COMMAND_SIZE = 8,
+		//! ̃t[ɓR}h̍ő吔
+		MAX_COMMANDS_PER_FRAME = 4096
+	};
+
+	//! commands̃t[ɂdestɒǉ
+	static
+	void	Encode(ControlCommand const *commands, size_t num_commands, std::vector<char> &dest)
+	{
+		BOOST_ASSERT(num_commands <= MAX_COMMANDS_PER_FRAME);
+
+		size_t const offset = dest.size();
+		dest.resize(offset + HEADER_SIZE + num_commands * COMMAND_SIZE);
+		char *p = dest.data() + offset;
+		p[0] = static_cast<char>(num_commands & 0xFF);
+		p[1] = static_cast<char>((num_commands >> 8) & 0xFF);
+		p[2] = VERSION;
+		p[3] = 0;
+		p += HEADER_SIZE;
+		for(size_t i = 0; i < num_commands; ++i, p += COMMAND_SIZE) {
+			std::memcpy(p, &commands[i], COMMAND_SIZE);
+		}
+	}
+};
+
+//! MoCg񂩂t[oAR}hɕNX
+//! Xg[\Pbgł͈x̎MŃt[ē͂Ƃ̂ŁA
+//! r܂ł̃t[͎̎M܂ŕێĂB
+struct ControlDecoder
+{
+	ControlDecoder()
+	{
+		pending_.reserve(ControlProtocol::HEADER_SIZE + ControlProtocol::MAX_COMMANDS_PER_FRAME * ControlProtocol::COMMAND_SIZE);
+	}
+
+	//! Mf[^nAt[̃R}hƂcallback(ControlCommand const &)Ăяo
+	//! wb_s(o[WႤAR}h)ȏꍇfalseԂB̐ڑ͐ؒf邱ƁB
+	template<class Callback>
+	bool	Feed(char const *data, size_t length, Callback callback)
+	{
+		while(length > 0) {
+			size_t const needed = (pending_.size() < ControlProtocol::HEADER_SIZE) ? static_cast<size_t>(ControlProtocol::HEADER_SIZE) : frame_size();
+			size_t const n = std::min<size_t>(needed - pending_.size(), length);
+			pending_.insert(pending_.end(), data, data + n);
+			data += n;
+			length -= n;
+
+			if(pending_.size() == ControlProtocol::HEADER_SIZE) {
+				if(static_cast<unsigned char>(pending_[2]) != ControlProtocol::VERSION) { return false; }
+				if(get_num_commands() > ControlProtocol::MAX_COMMANDS_PER_FRAME) { return false; }
+			}
+
+			if(pending_.size() >= ControlProtocol::HEADER_SIZE && pending_.size() == frame_size()) {
+				char const *p = pending_.data() + ControlProtocol::HEADER_SIZE;
+				for(size_t i = 0; i < get_num_commands(); ++i, p += ControlProtocol::COMMAND_SIZE) {
+					ControlCommand command;
+					std::memcpy(&command, p, ControlProtocol::COMMAND_SIZE);
+					callback(command);
+				}
+				pending_.clear();
+			}
+		}
+		return true;
+	}
+
+private:
+	size_t	get_num_commands() const
+	{
+		return static_cast<unsigned char>(pending_[0]) | (static_cast<size_t>(static_cast<unsigned char>(pending_[1])) << 8);
+	}
+
+	size_t	frame_size() const
+	{
+		return ControlProtocol::HEADER_SIZE + get_num_commands() * ControlProtocol::COMMAND_SIZE;
+	}
+
+	std::vector<char>	pending_;
+};
+
+//! UnixhC\Pbg̃AhX
+//! Windows 10(1803)ȍ~WinsockAF_UNIX̃Xg[\PbgɑΉĂB
+//! afunix.h͂OSDKɂ͊܂܂Ȃ̂ŁACAEg̍\̂Œ`B
+struct UnixSocketAddress
+{
+	enum { MAX_PATH_LENGTH = 108 };
+
+	u_short	sun_family;
+	char	sun_path[MAX_PATH_LENGTH];
+
+	//! pXꍇfalseԂ
+	bool	SetPath(std::string const &path)
+	{
+		std::memset(this, 0, sizeof(*this));
+		sun_family = AF_UNIX;
+		if(path.size() >= MAX_PATH_LENGTH) { return false; }
+		std::memcpy(sun_path, path.c_str(), path.size());
+		return true;
+	}
+};
+
+//! Winsock̏ƏI
+//! gpXbhIuWFNg̐Ԃ̊ԁÃIuWFNgێĂB
+struct WinsockInitializer
+{
+	WinsockInitializer()
+	{
+		WSADATA data;
+		succeeded_ = (WSAStartup(MAKEWORD(2, 2), &data) == 0);
+	}
+
+	~WinsockInitializer()
+	{
+		if(succeeded_) { WSACleanup(); }
+	}
+
+	bool	IsSucceeded() const { return succeeded_; }
+
+private:
+	bool	succeeded_;
+
+	WinsockInitializer(WinsockInitializer const &);
+	WinsockInitializer & operator=(WinsockInitializer const &);
+};
+
+//! Rg[\Pbg̊̃pX(ꎞt@C̃fBNgVstHostDemo.sock)
+inline
+std::string GetDefaultControlSocketPath()
+{
+	char dir[MAX_PATH] = {};
+	DWORD const length = GetTempPathA(MAX_PATH, dir);
+	if(length == 0 || length >= MAX_PATH) { return "VstHostDemo.sock"; }
+	return std::string(dir) + "VstHostDemo.sock";
+}
+
+}	//::hwm
@@ -0,0 +1,424 @@
+#pragma once
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+
+#include "./ControlProtocol.hpp"
+#include "./HostApplication.hpp"
+#include "./MidiEvent.hpp"
+#include "./SpscQueue.hpp"
+#include "./ThreadRole.hpp"
+#include "./Trace.hpp"
+#include "./VstPlugin.hpp"
+
+namespace hwm {
+
+//! [JUnixhC\PbgŁAÕvOm[gp[^󂯎T[o[
+//!
+//! Mƃt[̓̕T[o[̃XbhōsAR}hSpscQueueŃI[fBIXbhɓnB
+//! I[fBIXbh̓ubNƂDispatchĂяoāA܂ĂR}h܂Ƃ߂ăvOCƃzXgɓKpB
+//! L[̗eʂ𒴂ė܂R}ĥ͎Ă̂ŁAMvOCɓ͂܂ł̒x
+//! L[̗eʕ̃ubNŗ}B(̂ĂGetNumDroppedŎ擾ł)
+struct ControlServer
+{
+	enum {
+		//! ɐڑłNCAg̐
+		MAX_CLIENTS = 8,
+		RECEIVE_BUFFER_SIZE = 64 * 1024,
+		//! IvmFԊu
+		POLL_INTERVAL_MSEC = 100,
+		//! ̃R}hCxg̍ő吔(ALL_NOTES_OFF16`l)
+		MAX_EVENTS_PER_COMMAND = 16
+	};
+
+	//! queue_capacity܂ł̃R}hAI[fBIXbhɓn܂ŗ߂Ă
+	explicit ControlServer(size_t queue_capacity)
+		:	queue_(queue_capacity)
+		,	listen_socket_(INVALID_SOCKET)
+		,	last_error_(0)
+		,	terminated_(false)
+		,	num_clients_(0)
+		,	num_received_(0)
+		,	num_dropped_(0)
+		,	num_protocol_errors_(0)
+		,	num_dispatches_(0)
+		,	total_latency_ticks_(0)
+		,	max_latency_ticks_(0)
+	{
+		events_.Allocate(VstPlugin::EVENT_CAPACITY, 0);
+
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		ticks_per_usec_ = frequency.QuadPart / 1000000.0;
+	}
+
+	~ControlServer()
+	{
+		Stop();
+	}
+
+	//! pathɃ\Pbg쐬āAT[o[̃XbhJn
+	//! ÖُIŎc\Pbgt@C͍폜Ă蒼B
+	//! sꍇfalseԂAGetErrorCodeWinsock̃G[R[h擾łB
+	bool	Start(std::string const &path)
+	{
+		BOOST_ASSERT(!thread_.joinable());
+
+		if(!winsock_.IsSucceeded()) {
+			last_error_ = WSASYSNOTREADY;
+			return false;
+		}
+
+		UnixSocketAddress address;
+		if(!address.SetPath(path)) {
+			last_error_ = WSAENAMETOOLONG;
+			return false;
+		}
+
+		listen_socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(listen_socket_ == INVALID_SOCKET) {
+			last_error_ = WSAGetLastError();
+			return false;
+		}
+
+		DeleteFileA(path.c_str());
+		if(	bind(listen_socket_, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) == SOCKET_ERROR ||
+			listen(listen_socket_, MAX_CLIENTS) == SOCKET_ERROR )
+		{
+			last_error_ = WSAGetLastError();
+			closesocket(listen_socket_);
+			listen_socket_ = INVALID_SOCKET;
+			return false;
+		}
+
+		path_ = path;
+		terminated_.store(false);
+		thread_ = boost::thread([this] { server_thread(); });
+		return true;
+	}
+
+	//! T[o[̃XbhIāA\Pbgt@C폜
+	void	Stop()
+	{
+		if(!thread_.joinable()) { return; }
+
+		terminated_.store(true);
+		thread_.join();
+
+		closesocket(listen_socket_);
+		listen_socket_ = INVALID_SOCKET;
+		DeleteFileA(path_.c_str());
+	}
+
+	bool	IsRunning() const { return thread_.joinable(); }
+	std::string const &	GetPath() const { return path_; }
+	int		GetErrorCode() const { return last_error_; }
+
+	//! I[fBIXbh : ܂ĂR}hoēKp
+	//! MIDĨR}h̓CxgɕϊāA܂Ƃ߂ĈxAddEventspluginɒǉB
+	//! p[^pluginParameterCacheɁAgX|[ghostɐݒ肷B
+	//! xɎô̓Cxgobt@Ɏ܂镪܂łŁAc͎̃ubNŏB
+	//! bNmۂsȂ̂ŁApluginProcessEventsOɁAXbhĂяoB
+	void	Dispatch(VstPlugin &plugin, HostApplication &host)
+	{
+		if(queue_.empty()) { return; }
+
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+
+		QueuedCommand queued;
+		size_t count = 0;
+		while(events_.size() + MAX_EVENTS_PER_COMMAND <= events_.capacity() && queue_.Pop(queued)) {
+			//! L[̐擪ԌÂ̂ŁÃR}h̒x̃ubN̒xƂ
+			if(count == 0) { record_latency(now.QuadPart - queued.received_tick); }
+			apply(queued.command, plugin, host);
+			++count;
+		}
+
+		if(!events_.empty()) {
+			plugin.AddEvents(events_);
+			events_.Clear();
+		}
+	}
+
+	//! ڑ̃NCAg̐
+	size_t	GetNumClients() const { return num_clients_.load(boost::memory_order_relaxed); }
+	//! MăL[ɓꂽR}h̐
+	boost::uint64_t	GetNumReceived() const { return num_received_.load(boost::memory_order_relaxed); }
+	//! L[tŎ̂ĂR}h̐
+	boost::uint64_t	GetNumDropped() const { return num_dropped_.load(boost::memory_order_relaxed); }
+	//! sȃt[R}h󂯎
+	boost::uint64_t	GetNumProtocolErrors() const { return num_protocol_errors_.load(boost::memory_order_relaxed); }
+
+	//! MĂDispatchœKp܂ł̎(usec)̕ςƍő
+	double	GetAverageLatencyUsec() const
+	{
+		boost::uint64_t const n = num_dispatches_.load(boost::memory_order_relaxed);
+		if(n == 0) { return 0; }
+		return total_latency_ticks_.load(boost::memory_order_relaxed) / ticks_per_usec_ / n;
+	}
+
+	double	GetMaxLatencyUsec() const
+	{
+		return max_latency_ticks_.load(boost::memory_order_relaxed) / ticks_per_usec_;
+	}
+
+	std::string	ToString() const
+	{
+		std::stringstream ss;
+		if(!IsRunning()) {
+			ss << "control: not running";
+			if(last_error_ != 0) { ss << " (error " << last_error_ << ")"; }
+			return ss.str();
+		}
+
+		ss.setf(std::ios::fixed);
+		ss.precision(1);
+		ss	<< "control: " << GetNumClients() << " clients, "
+			<< GetNumReceived() << " received, "
+			<< GetNumDropped() << " dropped, "
+			<< GetNumProtocolErrors() << " errors, latency "
+			<< GetAverageLatencyUsec() / 1000.0 << "/" << GetMaxLatencyUsec() / 1000.0 << " ms";
+		return ss.str();
+	}
+
+	//! I[fBIXbhG̈visit(void *data, size_t bytes)ŗ񋓂
+	template<class Visitor>
+	void	VisitMemory(Visitor visit)
+	{
+		queue_.VisitMemory(visit);
+		events_.VisitMemory(visit);
+	}
+
+private:
+	struct QueuedCommand
+	{
+		ControlCommand	command;
+		//! M(QueryPerformanceCounter̒l)
+		LONGLONG		received_tick;
+	};
+
+	struct Client
+	{
+		Client(SOCKET s) : socket(s) {}
+
+		SOCKET			socket;
+		ControlDecoder	decoder;
+	};
+
+	static
+	bool	is_valid(ControlCommand const &command)
+	{
+		switch(command.type) {
+			case ControlCommand::NOTE_ON:
+			case ControlCommand::NOTE_OFF:
+			case ControlCommand::CONTROL_CHANGE:
+				return command.channel < 16 && command.index < 128 && command.value < 128;
+			case ControlCommand::PROGRAM_CHANGE:
+				return command.channel < 16 && command.index < 128;
+			case ControlCommand::PITCH_BEND:
+				return command.channel < 16 && command.value < 16384;
+			case ControlCommand::PARAMETER:
+			case ControlCommand::ALL_NOTES_OFF:
+				return true;
+			case ControlCommand::TRANSPORT:
+				return command.index <= ControlCommand::TRANSPORT_TEMPO;
+			default:
+				return false;
+		}
+	}
+
+	void	apply(ControlCommand const &command, VstPlugin &plugin, HostApplication &host)
+	{
+		switch(command.type) {
+			case ControlCommand::NOTE_ON:
+				events_.Push(MakeNoteOn(command.channel, command.index, command.value));
+				break;
+			case ControlCommand::NOTE_OFF:
+				events_.Push(MakeNoteOff(command.channel, command.index, command.value));
+				break;
+			case ControlCommand::CONTROL_CHANGE:
+				events_.Push(MakeControlChange(command.channel, command.index, command.value));
+				break;
+			case ControlCommand::PROGRAM_CHANGE:
+				events_.Push(MakeProgramChange(command.channel, command.index));
+				break;
+			case ControlCommand::PITCH_BEND:
+				events_.Push(MakePitchBend(command.channel, static_cast<int>(command.value) - 8192));
+				break;
+			case ControlCommand::PARAMETER:
+				if(command.index < plugin.GetParameters().GetNumParameters()) {
+					//! NaN0ƂĈ
+					float const value = command.GetFloatValue();
+					plugin.GetParameters().SetValue(command.index, (value >= 0.0f) ? std::min<float>(value, 1.0f) : 0.0f);
+				}
+				break;
+			case ControlCommand::TRANSPORT:
+				apply_transport(command, host);
+				break;
+			case ControlCommand::ALL_NOTES_OFF:
+				for(size_t ch = 0; ch < 16; ++ch) {
+					events_.Push(MakeControlChange(ch, 123, 0));
+				}
+				break;
+		}
+	}
+
+	static
+	void	apply_transport(ControlCommand const &command, HostApplication &host)
+	{
+		switch(command.index) {
+			case ControlCommand::TRANSPORT_STOP:
+				host.SetPlaying(false);
+				break;
+			case ControlCommand::TRANSPORT_PLAY:
+				host.SetPlaying(true);
+				break;
+			case ControlCommand::TRANSPORT_LOCATE:
+				host.SetSamplePosition(command.value);
+				break;
+			case ControlCommand::TRANSPORT_TEMPO: {
+				float const tempo = command.GetFloatValue();
+				if(tempo > 0) { host.SetTempo(tempo); }
+				break;
+			}
+		}
+	}
+
+	//! ނ̂̓I[fBIXbhȂ̂ŁAől̍XVcompare_exchange͗vȂ
+	void	record_latency(LONGLONG ticks)
+	{
+		boost::uint64_t const t = static_cast<boost::uint64_t>(std::max<LONGLONG>(ticks, 0));
+		num_dispatches_.store(num_dispatches_.load(boost::memory_order_relaxed) + 1, boost::memory_order_relaxed);
+		total_latency_ticks_.store(total_latency_ticks_.load(boost::memory_order_relaxed) + t, boost::memory_order_relaxed);
+		if(t > max_latency_ticks_.load(boost::memory_order_relaxed)) {
+			max_latency_ticks_.store(t, boost::memory_order_relaxed);
+		}
+	}
+
+	//! T[o[̃Xbh : MR}hL[ɓ
+	void	enqueue(ControlCommand const &command, LONGLONG received_tick)
+	{
+		if(!is_valid(command)) {
+			num_protocol_errors_.fetch_add(1, boost::memory_order_relaxed);
+			return;
+		}
+
+		QueuedCommand queued;
+		queued.command = command;
+		queued.received_tick = received_tick;
+		if(queue_.Push(queued)) {
+			num_received_.fetch_add(1, boost::memory_order_relaxed);
+		} else {
+			num_dropped_.fetch_add(1, boost::memory_order_relaxed);
+		}
+	}
+
+	//! ڑ̎󂯕tƎMAselectň̃Xbhōs
+	//! IvmF邽߁AselectPOLL_INTERVAL_MSECŃ^CAEgB
+	void	server_thread()
+	{
+		ThreadRole::SetCurrent(ThreadRole::WORKER);
+		HWM_TRACE_THREAD("ControlServer");
+
+		std::vector<std::unique_ptr<Client>> clients;
+		std::vector<char> buffer(RECEIVE_BUFFER_SIZE);
+
+		while(!terminated_.load()) {
+			fd_set read_set;
+			FD_ZERO(&read_set);
+			FD_SET(listen_socket_, &read_set);
+			SOCKET max_socket = listen_socket_;
+			for(auto &client: clients) {
+				FD_SET(client->socket, &read_set);
+				max_socket = std::max<SOCKET>(max_socket, client->socket);
+			}
+
+			timeval timeout;
+			timeout.tv_sec = 0;
+			timeout.tv_usec = POLL_INTERVAL_MSEC * 1000;
+			//! Windowsł͖͑
+			int const ready = select(static_cast<int>(max_socket + 1), &read_set, nullptr, nullptr, &timeout);
+			if(ready == SOCKET_ERROR) {
+				last_error_ = WSAGetLastError();
+				break;
+			}
+			if(ready == 0) { continue; }
+
+			if(FD_ISSET(listen_socket_, &read_set)) {
+				SOCKET const s = accept(listen_socket_, nullptr, nullptr);
+				if(s != INVALID_SOCKET) {
+					if(clients.size() < MAX_CLIENTS) {
+						clients.push_back(std::unique_ptr<Client>(new Client(s)));
+					} else {
+						closesocket(s);
+					}
+				}
+			}
+
+			for(auto it = clients.begin(); it != clients.end(); ) {
+				Client &client = **it;
+				if(!FD_ISSET(client.socket, &read_set)) {
+					++it;
+					continue;
+				}
+
+				HWM_TRACE_SCOPE("ControlServer::Receive");
+				int const received = recv(client.socket, buffer.data(), static_cast<int>(buffer.size()), 0);
+
+				LARGE_INTEGER now;
+				QueryPerformanceCounter(&now);
+				bool const ok =
+					received > 0 &&
+					client.decoder.Feed(buffer.data(), received, [&] (ControlCommand const &command) {
+						enqueue(command, now.QuadPart);
+					});
+
+				if(ok) {
+					++it;
+					continue;
+				}
+
+				//! ؒfꂽꍇƕsȃt[󂯎ꍇ́Aڑ
+				if(received > 0) { num_protocol_errors_.fetch_add(1, boost::memory_order_relaxed); }
+				closesocket(client.socket);
+				it = clients.erase(it);
+			}
+			num_clients_.store(clients.size(), boost::memory_order_relaxed);
+		}
+
+		for(auto &client: clients) {
+			closesocket(client->socket);
+		}
+		num_clients_.store(0, boost::memory_order_relaxed);
+	}
+
+private:
+	WinsockInitializer		winsock_;
+	SpscQueue<QueuedCommand>	queue_;
+	VstEventBuffer			events_;
+	SOCKET					listen_socket_;
+	std::string				path_;
+	int						last_error_;
+	double					ticks_per_usec_;
+	boost::thread			thread_;
+	boost::atomic<bool>		terminated_;
+	boost::atomic<size_t>	num_clients_;
+	boost::atomic<boost::uint64_t>	num_received_;
+	boost::atomic<boost::uint64_t>	num_dropped_;
+	boost::atomic<boost::uint64_t>	num_protocol_errors_;
+	boost::atomic<boost::uint64_t>	num_dispatches_;
+	boost::atomic<boost::uint64_t>	total_latency_ticks_;
+	boost::atomic<boost::uint64_t>	max_latency_ticks_;
+
+	ControlServer(ControlServer const &);
+	ControlServer & operator=(ControlServer const &);
+};
+
+}	//::hwm
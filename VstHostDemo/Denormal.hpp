@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+
+#include <xmmintrin.h>
+
+namespace hwm {
+
+//! 񐳋K(denormal)̈
+//!
+//! o[utB^̗]CĔɏȒlɂȂƁA_Z񐳋K߂
+//! ʏ̐\{S{ȏxȂ邱ƂAɋ߂ŃvOC̏Ԃ}ɐLтB
+//! MXCSRFTZ(Zʂ̔񐳋K0ɂ)DAZ(͂̔񐳋K0ƂĈ)ݒ肷ƁA
+//! SSẺZł͔񐳋KȂȂB
+//! MXCSR̓XbhƂ̐ݒȂ̂ŁAprocessReplacingĂяoׂẴXbhŐݒ肷B
+//! (I[fBIXbhłSetupAudioThreadŐݒ肷)
+struct Denormal
+{
+	enum {
+		MXCSR_DAZ = 0x0040,
+		MXCSR_FTZ = 0x8000,
+		MXCSR_FLUSH = MXCSR_DAZ | MXCSR_FTZ
+	};
+
+	//! ݂̃XbhFTZDAZݒ肷(flushfalseȂ)
+	//! ݒOMXCSR̒lԂB
+	static
+	unsigned int	SetFlush(bool flush)
+	{
+		unsigned int const previous = _mm_getcsr();
+		_mm_setcsr(flush ? (previous | MXCSR_FLUSH) : (previous & ~static_cast<unsigned int>(MXCSR_FLUSH)));
+		return previous;
+	}
+
+	//! ݂̃XbhFTZDAZݒ肳Ă邩ǂ
+	static
+	bool	IsFlushing()
+	{
+		return (_mm_getcsr() & MXCSR_FLUSH) == MXCSR_FLUSH;
+	}
+
+	static
+	bool	IsDenormal(float value)
+	{
+		boost::uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return (bits & 0x7F800000u) == 0 && (bits & 0x007FFFFFu) != 0;
+	}
+
+	//! [data, data + length)Ɋ܂܂񐳋K̐
+	static
+	size_t	Count(float const *data, size_t length)
+	{
+		size_t count = 0;
+		for(size_t i = 0; i < length; ++i) {
+			if(IsDenormal(data[i])) { ++count; }
+		}
+		return count;
+	}
+};
+
+//! ̃IuWFNgĂԁÃ݂XbhFTZDAZύX
+//! GUIXbhňꎞIɍsꍇAx`}[NŐݒ؂ւĔrꍇɎgB
+struct DenormalScope
+{
+	explicit DenormalScope(bool flush = true)
+		:	previous_(Denormal::SetFlush(flush))
+	{}
+
+	~DenormalScope() { _mm_setcsr(previous_); }
+
+private:
+	unsigned int	previous_;
+
+	DenormalScope(DenormalScope const &);
+	DenormalScope & operator=(DenormalScope const &);
+};
+
+}	//::hwm
@@ -0,0 +1,470 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/optional.hpp>
+
+#include "./HostApplication.hpp"
+#include "./MidiEvent.hpp"
+#include "./SampleConversion.hpp"
+#include "./ThreadRole.hpp"
+#include "./VstPlugin.hpp"
+#include "./WaveFile.hpp"
+
+namespace hwm {
+
+//! CxgXNvg1Cxg
+struct ScriptEvent
+{
+	enum Type { MIDI, PARAMETER };
+
+	ScriptEvent()
+		:	frame(0)
+		,	type(MIDI)
+		,	index(0)
+		,	value(0)
+	{
+		std::memset(&midi, 0, sizeof(midi));
+	}
+
+	//! Cxg𑗂t[ʒu(JñTv)
+	boost::uint64_t	frame;
+	Type			type;
+	VstMidiEvent	midi;
+	//! PARAMETEȐꍇ́Ap[^ԍƒl
+	size_t			index;
+	float			value;
+};
+
+//! S[f_[ōĐCxg
+//!
+//! eLXg`ŁA1s1CxgB#ȍ~̓RgB
+//!   <frame> on <ch> <note> <velocity>
+//!   <frame> off <ch> <note> [<velocity>]
+//!   <frame> cc <ch> <number> <value>
+//!   <frame> pc <ch> <program>
+//!   <frame> bend <ch> <value(-8192 .. 8191)>
+//!   <frame> param <index> <value(0.0 .. 1.0)>
+//!   <frame> end
+//! ch0n܂Bendō钷w肷(ȗ͍Ō̃Cxg̈ʒu܂)B
+//! MIDICxgdeltaFramesŃTvPʂ̈ʒuɑ邪A
+//! p[^̕ύXParameterCacheoR̂ŁÃt[܂ރubN̐擪œKpB
+struct EventScript
+{
+	EventScript()
+		:	length(0)
+	{}
+
+	//! t[ʒuɕ񂾃Cxg
+	std::vector<ScriptEvent>	events;
+	//! t[
+	boost::uint64_t				length;
+
+	//! XNvgǂݍ
+	//! sȏꍇ́Asԍ܂߂std::runtime_error𓊂B
+	static
+	EventScript Parse(std::istream &is)
+	{
+		EventScript script;
+		boost::optional<boost::uint64_t> end;
+
+		std::string line;
+		for(size_t line_number = 1; std::getline(is, line); ++line_number) {
+			std::string::size_type const comment = line.find('#');
+			if(comment != std::string::npos) { line.erase(comment); }
+
+			std::istringstream ls(line);
+			boost::uint64_t frame;
+			std::string command;
+			if(!(ls >> frame)) {
+				if(line.find_first_not_of(" \t\r") == std::string::npos) { continue; }
+				throw_parse_error(line_number, "frame expected");
+			}
+			if(!(ls >> command)) { throw_parse_error(line_number, "command expected"); }
+
+			ScriptEvent ev;
+			ev.frame = frame;
+			size_t ch = 0, a = 0, b = 0;
+			if(command == "on") {
+				if(!(ls >> ch >> a >> b)) { throw_parse_error(line_number, "on <ch> <note> <velocity>"); }
+				ev.midi = MakeNoteOn(ch, a, b);
+			} else if(command == "off") {
+				if(!(ls >> ch >> a)) { throw_parse_error(line_number, "off <ch> <note> [<velocity>]"); }
+				if(!(ls >> b)) { b = 0x40; }
+				ev.midi = MakeNoteOff(ch, a, b);
+			} else if(command == "cc") {
+				if(!(ls >> ch >> a >> b)) { throw_parse_error(line_number, "cc <ch> <number> <value>"); }
+				ev.midi = MakeControlChange(ch, a, b);
+			} else if(command == "pc") {
+				if(!(ls >> ch >> a)) { throw_parse_error(line_number, "pc <ch> <program>"); }
+				ev.midi = MakeProgramChange(ch, a);
+			} else if(command == "bend") {
+				int value = 0;
+				if(!(ls >> ch >> value)) { throw_parse_error(line_number, "bend <ch> <value>"); }
+				ev.midi = MakePitchBend(ch, value);
+			} else if(command == "param") {
+				if(!(ls >> ev.index >> ev.value)) { throw_parse_error(line_number, "param <index> <value>"); }
+				ev.type = ScriptEvent::PARAMETER;
+			} else if(command == "end") {
+				end = frame;
+				continue;
+			} else {
+				throw_parse_error(line_number, "unknown command : " + command);
+			}
+			if(ch >= 16) { throw_parse_error(line_number, "channel out of range"); }
+
+			script.events.push_back(ev);
+		}
+
+		std::stable_sort(script.events.begin(), script.events.end(),
+			[] (ScriptEvent const &lhs, ScriptEvent const &rhs) { return lhs.frame < rhs.frame; });
+
+		if(end) {
+			script.length = *end;
+		} else if(!script.events.empty()) {
+			script.length = script.events.back().frame + 1;
+		}
+		return script;
+	}
+
+private:
+	static
+	void throw_parse_error(size_t line_number, std::string const &message)
+	{
+		std::ostringstream ss;
+		ss << "event script line " << line_number << " : " << message;
+		throw std::runtime_error(ss.str());
+	}
+};
+
+//! 1ubNA1`l̃nbV
+//! raw		: vOCo͂float̃f[^
+//! device	: WaveOutProcessorɏôƓϊ16bitɂf[^
+struct BlockHash
+{
+	BlockHash()
+		:	raw(0)
+		,	device(0)
+	{}
+
+	boost::uint64_t	raw;
+	boost::uint64_t	device;
+
+	bool operator==(BlockHash const &rhs) const { return raw == rhs.raw && device == rhs.device; }
+	bool operator!=(BlockHash const &rhs) const { return !(*this == rhs); }
+};
+
+//! S[ft@CƔr
+struct GoldenResult
+{
+	GoldenResult()
+		:	matched(true)
+		,	block(0)
+		,	channel(0)
+		,	frame(0)
+		,	is_device_path(false)
+		,	max_raw_diff(0)
+		,	max_device_diff(0)
+		,	num_blocks(0)
+	{}
+
+	//! SubNv(e덷)
+	bool		matched;
+	//! ŏɈvȂubNA`lAubÑt[(e덷Ŕrꍇ̂)
+	size_t		block;
+	size_t		channel;
+	size_t		frame;
+	//! vȂ̂16bitɕϊf[^̕Ȃtrue
+	bool		is_device_path;
+	//! e덷Ŕrꍇ́AŜł̍ő̌덷
+	double		max_raw_diff;
+	int			max_device_diff;
+	size_t		num_blocks;
+	std::string	message;
+
+	std::string ToString() const
+	{
+		std::ostringstream ss;
+		if(matched) {
+			ss << "golden render matched : " << num_blocks << " blocks";
+		} else {
+			ss	<< "golden render mismatch at block " << block << ", channel " << channel;
+			if(!message.empty()) { ss << " (" << message << ")"; }
+			ss << " in " << (is_device_path ? "device (16bit)" : "raw (float)") << " output";
+		}
+		if(max_raw_diff > 0 || max_device_diff > 0) {
+			ss << ", max diff : raw " << max_raw_diff << ", device " << max_device_diff;
+		}
+		return ss.str();
+	}
+};
+
+//! ܂CxgōʂAȑǑ(S[ft@C)Ɣr邽߂̃NX
+//!
+//! zXgItC[hɂāATvʒuvZŒ̎ŃvOC𓮂A
+//! block_sizeƂɍo͂̃nbVA`lƂɋL^B
+//! nbV́AvOCfloat̏o͂ƁAWaveOutProcessor̃R[obNƓϊ
+//! (InterleaveToShort)16bitɂ̗̂ɂĎB
+//! float̏o͂WAVt@CɎcĂA_̌vZς悤ȍœǨɂ
+//! nbVł͂ȂAe덷w肵Ẵt@CƔrB
+//!
+//! ʂ̓vOC̓ԂɈˑ̂ŁA쐬̃vOCnB
+struct GoldenRender
+{
+	//! WaveOutProcessorŊJfoCX̃`l
+	enum { DEVICE_CHANNELS = 2 };
+
+	typedef
+		std::function<void(size_t block, float const * const *raw, size_t channels, short const *device, size_t frames)>
+	block_function_t;
+
+	//! script̓epluginAubNƂvisitĂяo
+	//! devicéADEVICE_CHANNELS`lɃC^[[uꂽf[^B
+	static
+	void Render(VstPlugin &plugin, HostApplication &host, EventScript const &script, size_t block_size, block_function_t visit)
+	{
+		ThreadRoleScope const offline_role(ThreadRole::OFFLINE);
+		bool const was_offline = host.IsOffline();
+		host.SetOffline(true);
+
+		std::vector<short> device(block_size * DEVICE_CHANNELS);
+		size_t const dropped_before = plugin.GetNumDroppedEvents();
+		auto it = script.events.begin();
+
+		size_t block = 0;
+		for(boost::uint64_t pos = 0; pos < script.length; pos += block_size, ++block) {
+			size_t const frames = static_cast<size_t>(std::min<boost::uint64_t>(block_size, script.length - pos));
+
+			for( ; it != script.events.end() && it->frame < pos + frames; ++it) {
+				if(it->type == ScriptEvent::PARAMETER) {
+					if(it->index < plugin.GetParameters().GetNumParameters()) {
+						plugin.GetParameters().SetValue(it->index, it->value);
+					}
+				} else {
+					VstMidiEvent ev = it->midi;
+					ev.deltaFrames = static_cast<VstInt32>(it->frame - pos);
+					plugin.AddEvent(ev);
+				}
+			}
+
+			host.SetSamplePosition(static_cast<double>(pos));
+			plugin.ProcessEvents();
+			float **raw = plugin.ProcessAudio(frames);
+
+			//! foCXo̓`lȂvOCłʂ܂悤ɁA񖳉Ŗ߂Ăϊ
+			std::fill(device.begin(), device.end(), 0);
+			InterleaveToShort(raw, plugin.GetNumOutputs(), device.data(), DEVICE_CHANNELS, frames);
+
+			visit(block, raw, plugin.GetNumOutputs(), device.data(), frames);
+		}
+
+		host.SetOffline(was_offline);
+
+		if(plugin.GetNumDroppedEvents() != dropped_before) {
+			throw std::runtime_error("events dropped during golden render. split the script or enlarge the event queue");
+		}
+	}
+
+	//! ăS[ft@C
+	//! hashesɂ̓ubNƂ̃nbVAwav_pathɂfloat̏o͂WAVt@CƂďoB
+	static
+	size_t Record(VstPlugin &plugin, HostApplication &host, EventScript const &script, size_t block_size,
+				  size_t sampling_rate, std::ostream &hashes, wchar_t const *wav_path)
+	{
+		size_t const channels = plugin.GetNumOutputs();
+		WaveFormat const format(channels, sampling_rate, WaveFormat::FLOAT32);
+		WaveFileWriter wav(wav_path, format);
+		std::vector<unsigned char> interleaved(block_size * format.GetBlockAlign());
+
+		hashes << file_magic() << "\n" << sampling_rate << " " << block_size << " " << channels << "\n";
+		size_t num_blocks = 0;
+		Render(plugin, host, script, block_size,
+			[&] (size_t block, float const * const *raw, size_t num_channels, short const *device, size_t frames) {
+				for(size_t ch = 0; ch < num_channels; ++ch) {
+					BlockHash const h = hash_block(raw, device, ch, frames);
+					hashes << block << " " << ch << " " << std::hex << h.raw << " " << h.device << std::dec << "\n";
+				}
+				WaveFileWriter::Interleave(raw, num_channels, frames, format, interleaved.data());
+				wav.WriteRaw(interleaved.data(), frames * format.GetBlockAlign());
+				num_blocks = block + 1;
+			});
+		wav.Close();
+
+		if(!hashes) { throw std::runtime_error("failed to write golden hashes"); }
+		return num_blocks;
+	}
+
+	//! ʂARecordōnbVƃrbgPʂŔr
+	//! ubNƂɔr̂ŁAL^ƂƓblock_sizeōB
+	static
+	GoldenResult VerifyHashes(VstPlugin &plugin, HostApplication &host, EventScript const &script, size_t block_size, std::istream &hashes)
+	{
+		std::string magic;
+		size_t golden_sampling_rate = 0, golden_block_size = 0, channels = 0;
+		std::getline(hashes, magic);
+		if(magic != file_magic() || !(hashes >> golden_sampling_rate >> golden_block_size >> channels)) {
+			throw std::runtime_error("invalid golden hash file");
+		}
+		if(golden_block_size != block_size) {
+			throw std::runtime_error("block size differs from the golden file");
+		}
+		check_layout(plugin, channels);
+
+		std::vector<BlockHash> golden;
+		size_t block, ch;
+		BlockHash h;
+		while(hashes >> std::dec >> block >> ch >> std::hex >> h.raw >> h.device) {
+			if(ch >= channels) { throw std::runtime_error("invalid golden hash file"); }
+			if(golden.size() < (block + 1) * channels) { golden.resize((block + 1) * channels); }
+			golden[block * channels + ch] = h;
+		}
+
+		GoldenResult result;
+		Render(plugin, host, script, block_size,
+			[&] (size_t block, float const * const *raw, size_t num_channels, short const *device, size_t frames) {
+				result.num_blocks = block + 1;
+				if(!result.matched) { return; }
+				for(size_t ch = 0; ch < num_channels; ++ch) {
+					if(block * channels + ch >= golden.size()) {
+						set_mismatch(result, block, ch, 0, false, "golden file is shorter");
+						return;
+					}
+					BlockHash const actual = hash_block(raw, device, ch, frames);
+					BlockHash const &expected = golden[block * channels + ch];
+					if(actual != expected) {
+						set_mismatch(result, block, ch, 0, actual.raw == expected.raw, std::string());
+						return;
+					}
+				}
+			});
+
+		if(result.matched && result.num_blocks * channels != golden.size()) {
+			set_mismatch(result, result.num_blocks, 0, 0, false, "golden file is longer");
+		}
+		return result;
+	}
+
+	//! ʂARecordŏoWAVt@CƋe덷w肵Ĕr
+	//! float̏o͂toleranceA16bitɕϊf[^tolerance * 32768 + 1(ۂ߂̋E̕)܂ōB
+	static
+	GoldenResult VerifyWithTolerance(VstPlugin &plugin, HostApplication &host, EventScript const &script,
+									 size_t block_size, wchar_t const *wav_path, double tolerance)
+	{
+		MappedWaveFileReader wav(wav_path);
+		size_t const channels = wav.GetNumChannels();
+		check_layout(plugin, channels);
+
+		std::vector<std::vector<float>> golden(channels, std::vector<float>(block_size));
+		std::vector<float *> golden_heads(channels);
+		for(size_t ch = 0; ch < channels; ++ch) { golden_heads[ch] = golden[ch].data(); }
+
+		int const device_tolerance = static_cast<int>(tolerance * 32768.0) + 1;
+
+		GoldenResult result;
+		Render(plugin, host, script, block_size,
+			[&] (size_t block, float const * const *raw, size_t num_channels, short const *device, size_t frames) {
+				result.num_blocks = block + 1;
+				size_t const read = wav.Read(golden_heads.data(), channels, frames);
+				if(read != frames) {
+					if(result.matched) { set_mismatch(result, block, 0, read, false, "golden file is shorter"); }
+					return;
+				}
+				for(size_t ch = 0; ch < num_channels; ++ch) {
+					for(size_t fr = 0; fr < frames; ++fr) {
+						double const raw_diff = std::fabs(static_cast<double>(raw[ch][fr]) - golden[ch][fr]);
+						int const device_diff =
+							(ch < DEVICE_CHANNELS)
+							?	std::abs(device[fr * DEVICE_CHANNELS + ch] - FloatToShort(golden[ch][fr]))
+							:	0;
+						result.max_raw_diff = std::max<double>(result.max_raw_diff, raw_diff);
+						result.max_device_diff = std::max<int>(result.max_device_diff, device_diff);
+
+						if(result.matched) {
+							if(!(raw_diff <= tolerance)) {
+								set_mismatch(result, block, ch, fr, false, frame_message(fr));
+							} else if(device_diff > device_tolerance) {
+								set_mismatch(result, block, ch, fr, true, frame_message(fr));
+							}
+						}
+					}
+				}
+			});
+
+		if(result.matched && wav.GetPosition() != wav.GetNumFrames()) {
+			set_mismatch(result, result.num_blocks, 0, 0, false, "golden file is longer");
+		}
+		return result;
+	}
+
+private:
+	static
+	char const * file_magic() { return "VstHostDemo golden render 1"; }
+
+	//! FNV-1a
+	static
+	boost::uint64_t hash_bytes(boost::uint64_t h, void const *data, size_t bytes)
+	{
+		unsigned char const *p = static_cast<unsigned char const *>(data);
+		for(size_t i = 0; i < bytes; ++i) {
+			h ^= p[i];
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
+	static
+	BlockHash hash_block(float const * const *raw, short const *device, size_t ch, size_t frames)
+	{
+		boost::uint64_t const basis = 14695981039346656037ULL;
+
+		BlockHash h;
+		h.raw = hash_bytes(basis, raw[ch], frames * sizeof(float));
+		h.device = basis;
+		if(ch < DEVICE_CHANNELS) {
+			for(size_t fr = 0; fr < frames; ++fr) {
+				h.device = hash_bytes(h.device, &device[fr * DEVICE_CHANNELS + ch], sizeof(short));
+			}
+		}
+		return h;
+	}
+
+	static
+	void check_layout(VstPlugin &plugin, size_t golden_channels)
+	{
+		if(plugin.GetNumOutputs() != golden_channels) {
+			throw std::runtime_error("number of output channels differs from the golden file");
+		}
+	}
+
+	static
+	void set_mismatch(GoldenResult &result, size_t block, size_t channel, size_t frame, bool is_device_path, std::string const &message)
+	{
+		result.matched = false;
+		result.block = block;
+		result.channel = channel;
+		result.frame = frame;
+		result.is_device_path = is_device_path;
+		result.message = message;
+	}
+
+	static
+	std::string frame_message(size_t frame)
+	{
+		std::ostringstream ss;
+		ss << "frame " << frame;
+		return ss.str();
+	}
+};
+
+}	//::hwm
@@ -5,17 +5,41 @@
 #include <boost/range/size.hpp>
 #include <boost/static_assert.hpp>
 #include <boost/chrono.hpp>
+#include <boost/cstdint.hpp>
 
 #include <tchar.h>
 
 #include "./HostApplication.hpp"
+#include "./ThreadRole.hpp"
 #include "./VstPlugin.hpp"
 
 namespace hwm {
 
+//! ǂݍݒ̃VFvOC̃TuvOCID
+static __declspec(thread) VstInt32 loading_shell_plugin_id = 0;
+
+void SetLoadingShellPluginId(VstInt32 id)
+{
+	loading_shell_plugin_id = id;
+}
+
+VstInt32 GetLoadingShellPluginId()
+{
+	return loading_shell_plugin_id;
+}
+
+//! audioMasterGetTimeŕԂ
+//! vOC͌ĂяoXbhŕԂꂽ|C^ǂނ̂ŁAXbhƂɎB
+//! (ĐXbhAs̃XbhAǂݍݗp̃XbhȂǂ瓯ɖ₢킹ĂA݂ɏȂ)
+static __declspec(thread) VstTimeInfo thread_timeinfo;
+
 HostApplication::HostApplication(size_t sampling_rate, size_t block_size)
 	:	sampling_rate_(sampling_rate)
 	,	block_size_(block_size)
+	,	offline_(false)
+	,	playing_(false)
+	,	sample_pos_(0)
+	,	tempo_(120.0)
 {}
 
 VstIntPtr VSTCALLBACK VstHostCallback(AEffect* effect, VstInt32 opcode, VstInt32 index, VstIntPtr value, void *ptr, float opt)
@@ -25,6 +49,9 @@ VstIntPtr VSTCALLBACK VstHostCallback(AEffect* effect, VstInt32 opcode, VstInt32
 		switch(opcode) {
 			case audioMasterVersion:
 				return kVstVersion;
+			case audioMasterCurrentId:
+				//! VFvOĆAGg|Cg̒ł₢킹āA쐬TuvOC߂
+				return GetLoadingShellPluginId();
 			default:
 				return 0;
 		}
@@ -38,7 +65,6 @@ VstIntPtr VSTCALLBACK VstHostCallback(AEffect* effect, VstInt32 opcode, VstInt32
 VstIntPtr HostApplication::Callback(VstPlugin* vst, VstInt32 opcode, VstInt32 index, VstIntPtr value, void *ptr, float opt)
 {
 	int result = false;
-	opt; //gp̕ϐ̌x}
 
 	switch( opcode )
 	{
@@ -46,6 +72,8 @@ VstIntPtr HostApplication::Callback(VstPlugin* vst, VstInt32 opcode, VstInt32 in
 		//! Plugin̑̒ʒm
 		//! I[g[V̋L^ɑΉVSTzXg
 		//! œnĂf[^I[g[VGx[vɋL^
+		//! ̃AvP[Vł́Ap[^̃LbVɔf邾ɂƂǂ߂B
+		vst->OnParameterAutomated(index, opt);
 		break;
 
 	case audioMasterVersion:
@@ -54,6 +82,10 @@ VstIntPtr HostApplication::Callback(VstPlugin* vst, VstInt32 opcode, VstInt32 in
 
 	case audioMasterCurrentId:
 		//! kPlugCategShell^CṽvOCɑ΂āASẴTuvOCWJƂɂ̂݌Ă΂
+		//! VF쐬TuvOCɂ́A쐬Ɏw肵IDԂ
+		if(vst->GetShellPluginId() != 0) {
+			return vst->GetShellPluginId();
+		}
 		return vst->GetEffect()->uniqueID;
 
 	case audioMasterIdle:
@@ -75,22 +107,36 @@ VstIntPtr HostApplication::Callback(VstPlugin* vst, VstInt32 opcode, VstInt32 in
 
 	case audioMasterGetTime:
 		//! VSTzXǧ݂̎Ԃ
-		timeinfo_.samplePos = 0;
-		timeinfo_.sampleRate = sampling_rate_;
-		timeinfo_.nanoSeconds = GetTickCount() * 1000.0 * 1000.0;
-		timeinfo_.ppqPos = 0;
-		timeinfo_.tempo = 120.0;
-		timeinfo_.barStartPos = 0;
-		timeinfo_.cycleStartPos = 0;
-		timeinfo_.cycleEndPos = 0;
-		timeinfo_.timeSigNumerator = 4;
-		timeinfo_.timeSigDenominator = 4;
-		timeinfo_.smpteOffset = 0;
-		timeinfo_.smpteFrameRate = kVstSmpte24fps ;
-		timeinfo_.samplesToNextClock = 0;
-		timeinfo_.flags = (kVstNanosValid | kVstPpqPosValid | kVstTempoValid | kVstTimeSigValid);
-
-		return reinterpret_cast<VstIntPtr>(&timeinfo_);
+		{
+			VstTimeInfo &timeinfo = thread_timeinfo;
+			timeinfo.samplePos = 0;
+			timeinfo.sampleRate = sampling_rate_;
+			timeinfo.nanoSeconds = GetTickCount() * 1000.0 * 1000.0;
+			timeinfo.ppqPos = 0;
+			timeinfo.tempo = GetTempo();
+			timeinfo.barStartPos = 0;
+			timeinfo.cycleStartPos = 0;
+			timeinfo.cycleEndPos = 0;
+			timeinfo.timeSigNumerator = 4;
+			timeinfo.timeSigDenominator = 4;
+			timeinfo.smpteOffset = 0;
+			timeinfo.smpteFrameRate = kVstSmpte24fps ;
+			timeinfo.samplesToNextClock = 0;
+			timeinfo.flags = (kVstNanosValid | kVstPpqPosValid | kVstTempoValid | kVstTimeSigValid);
+
+			if(IsOffline() || IsPlaying()) {
+				//! ItC[hƍĐ́AԂg킸ɃTvʒuvZ
+				double const sample_pos = GetSamplePosition();
+				double const seconds = sample_pos / sampling_rate_;
+				timeinfo.samplePos = sample_pos;
+				timeinfo.nanoSeconds = seconds * 1000.0 * 1000.0 * 1000.0;
+				timeinfo.ppqPos = seconds * timeinfo.tempo / 60.0;
+				timeinfo.barStartPos = static_cast<double>(static_cast<boost::int64_t>(timeinfo.ppqPos / 4.0)) * 4.0;
+				timeinfo.flags |= (kVstTransportPlaying | kVstBarsValid);
+			}
+
+			return reinterpret_cast<VstIntPtr>(&timeinfo);
+		}
 
 	case audioMasterProcessEvents:
 		//! vOC瑗ĂCxg
@@ -153,7 +199,8 @@ VstIntPtr HostApplication::Callback(VstPlugin* vst, VstInt32 opcode, VstInt32 in
 		//break;
 
 	case audioMasterGetCurrentProcessLevel:
-		return kVstProcessLevelUnknown;
+		//! ĂяõXbh̖猈߂
+		return ThreadRole::ToProcessLevel(ThreadRole::GetCurrent());
 
 	case audioMasterGetAutomationState:
 		return kVstAutomationOff;
@@ -218,7 +265,8 @@ VstIntPtr HostApplication::Callback(VstPlugin* vst, VstInt32 opcode, VstInt32 in
 				{ "sendVstMidiEvents" },
 				{ "sizeWindow" },
 				{ "startStopProcess" },
-				{ "sendVstMidiEventFlagIsRealtime" } };
+				{ "sendVstMidiEventFlagIsRealtime" },
+				{ "shellCategory" } };
 
 			for(auto elem: do_list) {
 				if(strcmp(elem, static_cast<char const *>(ptr)) == 0) { 
@@ -5,10 +5,15 @@
 #include "./vstsdk2.4/pluginterfaces/vst2.x/aeffectx.h"
 #pragma warning(pop)
 
+#include <boost/atomic.hpp>
+
 namespace hwm {
 
 struct VstPlugin;
 
+//! gX|[g̏(ItC[hAĐǂATvʒuAe|)́A
+//! XbhGUIXbhAaudioMasterGetTimeĂяoCӂ̃Xbhǂނ̂ŁA
+//! ꂼAg~bNɓǂݏB
 struct HostApplication
 {
 	HostApplication(
@@ -17,14 +22,59 @@ struct HostApplication
 
 	VstIntPtr Callback(VstPlugin* vst, VstInt32 opcode, VstInt32 index, VstIntPtr value, void *ptr, float opt);
 
+	//! vOCɖ₢킹ꂽɕԂTvO[gύX
+	void SetSamplingRate(size_t sampling_rate) { sampling_rate_ = sampling_rate; }
+
+	//! ItC[hɂ
+	//! ItC[hł́AaudioMasterGetTimeŕԂԂł͂Ȃ
+	//! SetSamplePositionŐݒ肵ʒuvZAĐƂĕԂB
+	//! (audioMasterGetCurrentProcessLevel̒ĺAXbh̖(ThreadRole::OFFLINE)Ō܂)
+	//! Cxg񂩂͖񓯂񂪓n̂ŁAʂrꍇɎgB
+	void SetOffline(bool offline) { offline_.store(offline, boost::memory_order_relaxed); }
+	bool IsOffline() const { return offline_.load(boost::memory_order_relaxed); }
+
+	//! ItC[h܂͍ĐɕԂAɍubN̐擪̃Tvʒu
+	//! XbhAProcessAudiȏOɐݒ肷B
+	void SetSamplePosition(double sample_pos) { sample_pos_.store(sample_pos, boost::memory_order_relaxed); }
+	double GetSamplePosition() const { return sample_pos_.load(boost::memory_order_relaxed); }
+
+	//! gX|[gĐɂ
+	//! Đ́AaudioMasterGetTimeŃItC[hƓ悤ɃTvʒuvZԂB
+	//! TvʒúAXbhubNƂAdvanceTransportŐi߂B
+	void SetPlaying(bool playing) { playing_.store(playing, boost::memory_order_relaxed); }
+	bool IsPlaying() const { return playing_.load(boost::memory_order_relaxed); }
+
+	//! audioMasterGetTimeŕԂe|(BPM)
+	void SetTempo(double tempo) { tempo_.store(tempo, boost::memory_order_relaxed); }
+	double GetTempo() const { return tempo_.load(boost::memory_order_relaxed); }
+
+	//! Đł΁ATvʒuframesi߂
+	//! Tvʒû͍XbhȂ̂ŁAǂݏoƏ݂𕪂Ă悢B
+	void AdvanceTransport(size_t frames)
+	{
+		if(IsPlaying()) { SetSamplePosition(GetSamplePosition() + frames); }
+	}
+
 private:
 	size_t sampling_rate_;
 	size_t block_size_;
-	VstTimeInfo	timeinfo_;
+	boost::atomic<bool>		offline_;
+	boost::atomic<bool>		playing_;
+	boost::atomic<double>	sample_pos_;
+	boost::atomic<double>	tempo_;
+
+	HostApplication(HostApplication const &);
+	HostApplication & operator=(HostApplication const &);
 };
 
 //! vOC̗vȂǂ󂯂ČĂяo
 //! Host̃R[obN֐
 VstIntPtr VSTCALLBACK VstHostCallback(AEffect* effect, VstInt32 opcode, VstInt32 index, VstIntPtr value, void *ptr, float opt);
 
+//! VFvOC(kPlugCategShell)̃TuvOC쐬ۂɁA
+//! Gg|CǧĂяoaudioMasterCurrentIdŕԂIDݒ肷B0Ȃݒ肵ȂB
+//! l̓XbhƂɕێ̂ŁÃXbhœɃvOCǂݍł悢B
+void SetLoadingShellPluginId(VstInt32 id);
+VstInt32 GetLoadingShellPluginId();
+
 }	//::hwm
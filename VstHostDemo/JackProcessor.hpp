@@ -0,0 +1,253 @@
+#pragma once
+
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/atomic.hpp>
+
+#include <windows.h>
+
+#include <jack/jack.h>
+
+#if defined(_WIN64)
+#pragma comment(lib, "libjack64.lib")
+#else
+#pragma comment(lib, "libjack.lib")
+#endif
+
+#include "./AudioThread.hpp"
+#include "./Denormal.hpp"
+#include "./ThreadRole.hpp"
+#include "./Trace.hpp"
+
+namespace hwm {
+
+//! JACK̃NCAgƂāAI[fBȈosNX
+//!
+//! WaveOutProcessorƈႢAĐp̃Xbhobt@̑d͎ȂB
+//! JACK̃vZXR[obN̒ŒڃR[obN֐ĂяoA
+//! ʂJACK̃|[g̃obt@֏܂̂ŁAǉ郌CeVJACK1ɂȂB
+//! TvO[gƎ̒JACKT[o[̐ݒŌ܂B
+//!
+//! wbhX̊łA"jackd -d dummy"ŋNT[o[ɐڑēmFłB
+struct JackProcessor
+{
+	enum { THREAD_SETUP_TIMEOUT_MSEC = 1000 };
+
+	JackProcessor()
+		:	client_(nullptr)
+		,	channel_(0)
+		,	is_thread_setup_(false)
+		,	process_thread_id_(0)
+		,	num_xruns_(0)
+		,	is_shutdown_(false)
+	{}
+
+	~JackProcessor()
+	{
+		BOOST_ASSERT(!client_);
+	}
+
+	typedef
+		std::function<void(float **data, size_t channel, size_t frames)>
+	callback_function_t;
+
+	//! JACK̃vZXXbh̐ݒ
+	//! vZXXbhJACK쐬ăXPW[OǗ̂ŁA
+	//! DxAMMCSSACPŮ蓖Ă͕ύXAflush_denormals(FTZDAZ)
+	//! JACK̃XbhJñR[obNœKpB
+	//! OpenDevicȇOɌĂяoB
+	void SetThreadSettings(AudioThreadSettings const &settings) { thread_settings_ = settings; }
+
+	//! vZXXbh̐ݒ茋
+	//! OpenDevicéAXbhJñR[obNĂ΂̂(THREAD_SETUP_TIMEOUT_MSEC܂)҂Ă߂̂ŁA
+	//! OpenDevicěŌĂяoBR[obN܂Ă΂ĂȂ΁Aݒ肵ĂȂԂԂB
+	AudioThreadSetupResult GetThreadSetupResult() const
+	{
+		if(!is_thread_setup_.load(boost::memory_order_acquire)) { return AudioThreadSetupResult(); }
+		return thread_setup_result_;
+	}
+
+	//! ĐɃANZX郁̈vtHgăbNB(WaveOutProcessorƓ)
+	bool LockMemory(void *data, size_t bytes) { return memory_locker_.Lock(data, bytes); }
+	bool UnlockMemory(void *data, size_t bytes) { return memory_locker_.Unlock(data, bytes); }
+	MemoryLocker const & GetMemoryLocker() const { return memory_locker_; }
+
+	//! JACKT[o[ɐڑāAchannel̏o̓|[gAo͂ɐڑ
+	//! T[o[̃TvO[gsampling_rateƈقȂꍇ́AڑfalseԂB
+	//! callback̓vZXR[obN̒ĂяoA`lƂ̃|[g̃obt@frames̃f[^ށB
+	bool OpenDevice(char const *client_name, size_t sampling_rate, size_t channel, callback_function_t callback)
+	{
+		BOOST_ASSERT(0 < channel);
+		BOOST_ASSERT(callback);
+		BOOST_ASSERT(!client_);
+
+		jack_status_t status;
+		client_ = jack_client_open(client_name, JackNoStartServer, &status);
+		if(!client_) { return false; }
+
+		if(jack_get_sample_rate(client_) != sampling_rate) {
+			close_client();
+			return false;
+		}
+
+		channel_ = channel;
+		callback_ = callback;
+		num_xruns_ = 0;
+		is_shutdown_ = false;
+		is_thread_setup_ = false;
+
+		for(size_t ch = 0; ch < channel; ++ch) {
+			std::ostringstream name;
+			name << "out_" << (ch + 1);
+			jack_port_t *port = jack_port_register(client_, name.str().c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+			if(!port) {
+				close_client();
+				return false;
+			}
+			ports_.push_back(port);
+		}
+		port_heads_.assign(channel, nullptr);
+		LockMemory(port_heads_.data(), port_heads_.size() * sizeof(float *));
+
+		jack_set_thread_init_callback(client_, &JackProcessor::thread_init_callback, this);
+		jack_set_process_callback(client_, &JackProcessor::process_callback, this);
+		jack_set_xrun_callback(client_, &JackProcessor::xrun_callback, this);
+		jack_on_shutdown(client_, &JackProcessor::shutdown_callback, this);
+
+		if(jack_activate(client_) != 0) {
+			close_client();
+			return false;
+		}
+
+		//! ĂяoGetThreadSetupResultǂ߂悤ɁAvZXXbh̐ݒ҂
+		for(size_t i = 0; i < THREAD_SETUP_TIMEOUT_MSEC && !is_thread_setup_.load(boost::memory_order_acquire); ++i) {
+			Sleep(1);
+		}
+
+		//! o(dummyhCȍꍇsystem:playback_*)֏ɐڑB
+		//! ڑłȂĂĐ͑(qjackctlȂǂŌォڑł)̂ŁAs͖B
+		char const **playback_ports = jack_get_ports(client_, nullptr, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput);
+		if(playback_ports) {
+			for(size_t ch = 0; ch < channel && playback_ports[ch]; ++ch) {
+				jack_connect(client_, jack_port_name(ports_[ch]), playback_ports[ch]);
+			}
+			jack_free(playback_ports);
+		}
+
+		return true;
+	}
+
+	//! JACKT[o[ؒf
+	void CloseDevice()
+	{
+		if(!client_) { return; }
+		jack_deactivate(client_);
+		if(is_thread_setup_.load(boost::memory_order_acquire)) {
+			HWM_TRACE_RELEASE_THREAD(process_thread_id_);
+		}
+		close_client();
+		memory_locker_.UnlockAll();
+	}
+
+	//! JACK1̃t[BĐɃT[o[ŕύX邱ƂB
+	size_t GetBlockSize() const { return client_ ? jack_get_buffer_size(client_) : 0; }
+
+	//! JACK񍐂xrun(ɏIȂ)̉
+	size_t GetNumXruns() const { return num_xruns_.load(boost::memory_order_relaxed); }
+
+	//! JACKT[o[~ANCAgؒfꍇtrue
+	bool IsShutdown() const { return is_shutdown_.load(boost::memory_order_relaxed); }
+
+	std::string ToString() const
+	{
+		std::ostringstream ss;
+		ss << "jack block: " << GetBlockSize() << ", xruns: " << GetNumXruns();
+		if(IsShutdown()) { ss << ", shutdown"; }
+		return ss.str();
+	}
+
+private:
+	void close_client()
+	{
+		jack_client_close(client_);
+		client_ = nullptr;
+		ports_.clear();
+	}
+
+	//! JACKvZXXbhJnɁÃXbhŌĂяo
+	//! Xbh̖Ag[X̃XbhAFTZ/DAZݒ肷B
+	//! DxMMCSSJACKݒ肷̂ŕύXȂB
+	//! mۂVXeR[𔺂ݒ́AvZXR[obNł͂ȂōsB
+	//! thread_setup_result_process_thread_id_̂͂̃XbhŁAis_thread_setup_releaseŌJB
+	static
+	void thread_init_callback(void *arg)
+	{
+		JackProcessor *self = static_cast<JackProcessor *>(arg);
+
+		ThreadRole::SetCurrent(ThreadRole::REALTIME);
+		HWM_TRACE_REGISTER_THREAD("JackProcessThread");
+		self->process_thread_id_ = GetCurrentThreadId();
+
+		AudioThreadSetupResult result;
+		if(self->thread_settings_.flush_denormals) {
+			Denormal::SetFlush(true);
+			result.denormals = Denormal::IsFlushing() ? AudioThreadSetupResult::SUCCEEDED : AudioThreadSetupResult::FAILED;
+		}
+		self->thread_setup_result_ = result;
+		self->is_thread_setup_.store(true, boost::memory_order_release);
+	}
+
+	//! JACK1ƂɌĂяo
+	//! mۂ⃍bN𔺂ĂяoȂB
+	static
+	int process_callback(jack_nframes_t nframes, void *arg)
+	{
+		JackProcessor *self = static_cast<JackProcessor *>(arg);
+		HWM_TRACE_SCOPE("device callback");
+		for(size_t ch = 0; ch < self->channel_; ++ch) {
+			self->port_heads_[ch] = static_cast<float *>(jack_port_get_buffer(self->ports_[ch], nframes));
+		}
+		self->callback_(self->port_heads_.data(), self->channel_, nframes);
+		return 0;
+	}
+
+	static
+	int xrun_callback(void *arg)
+	{
+		JackProcessor *self = static_cast<JackProcessor *>(arg);
+		self->num_xruns_.fetch_add(1, boost::memory_order_relaxed);
+		HWM_TRACE_INSTANT("jack xrun");
+		return 0;
+	}
+
+	static
+	void shutdown_callback(void *arg)
+	{
+		static_cast<JackProcessor *>(arg)->is_shutdown_.store(true, boost::memory_order_relaxed);
+	}
+
+private:
+	jack_client_t *				client_;
+	std::vector<jack_port_t *>	ports_;
+	std::vector<float *>		port_heads_;
+	size_t						channel_;
+	callback_function_t			callback_;
+
+	AudioThreadSettings			thread_settings_;
+	AudioThreadSetupResult		thread_setup_result_;
+	boost::atomic<bool>			is_thread_setup_;
+	DWORD						process_thread_id_;
+	MemoryLocker				memory_locker_;
+
+	boost::atomic<size_t>		num_xruns_;
+	boost::atomic<bool>			is_shutdown_;
+
+	JackProcessor(JackProcessor const &);
+	JackProcessor & operator=(JackProcessor const &);
+};
+
+}	//::hwm
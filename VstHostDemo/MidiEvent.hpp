@@ -0,0 +1,287 @@
+#pragma once
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+#pragma warning(push)
+#pragma warning(disable: 4996)
+#include "./vstsdk2.4/pluginterfaces/vst2.x/aeffectx.h"
+#pragma warning(pop)
+
+namespace hwm {
+
+//! MIDIbZ[W̃Xe[^XoCg(4bit)
+enum MidiStatus {
+	MIDI_NOTE_OFF			= 0x80,
+	MIDI_NOTE_ON			= 0x90,
+	MIDI_POLY_AFTERTOUCH	= 0xA0,
+	MIDI_CONTROL_CHANGE		= 0xB0,
+	MIDI_PROGRAM_CHANGE		= 0xC0,
+	MIDI_CHANNEL_AFTERTOUCH	= 0xD0,
+	MIDI_PITCH_BEND			= 0xE0,
+	MIDI_SYSEX				= 0xF0
+};
+
+//! VstMidiEvent쐬
+//! channel0n܂(0 .. 15)Ŏw肷B
+//! 2oCggȂbZ[Wł́Adata2͖B
+inline
+VstMidiEvent MakeMidiEvent(size_t status, size_t channel, size_t data1, size_t data2, VstInt32 delta_frames = 0)
+{
+	BOOST_ASSERT(channel < 16);
+
+	VstMidiEvent event;
+	event.type = kVstMidiType;
+	event.byteSize = sizeof(VstMidiEvent);
+	event.flags = kVstMidiEventIsRealtime;
+	event.midiData[0] = static_cast<char>((status & 0xF0) | (channel & 0x0F));
+	event.midiData[1] = static_cast<char>(data1 & 0x7F);
+	event.midiData[2] = static_cast<char>(data2 & 0x7F);
+	event.midiData[3] = 0;				// unused
+	event.noteLength = 0;
+	event.noteOffset = 0;
+	event.detune = 0;
+	event.deltaFrames = delta_frames;
+	event.noteOffVelocity = 0;
+	event.reserved1 = 0;
+	event.reserved2 = 0;
+	return event;
+}
+
+inline
+VstMidiEvent MakeNoteOn(size_t channel, size_t note_number, size_t velocity, VstInt32 delta_frames = 0)
+{
+	return MakeMidiEvent(MIDI_NOTE_ON, channel, note_number, velocity, delta_frames);
+}
+
+inline
+VstMidiEvent MakeNoteOff(size_t channel, size_t note_number, size_t velocity, VstInt32 delta_frames = 0)
+{
+	VstMidiEvent event = MakeMidiEvent(MIDI_NOTE_OFF, channel, note_number, velocity, delta_frames);
+	event.noteOffVelocity = static_cast<char>(velocity & 0x7F);
+	return event;
+}
+
+inline
+VstMidiEvent MakeControlChange(size_t channel, size_t control_number, size_t value, VstInt32 delta_frames = 0)
+{
+	return MakeMidiEvent(MIDI_CONTROL_CHANGE, channel, control_number, value, delta_frames);
+}
+
+inline
+VstMidiEvent MakeProgramChange(size_t channel, size_t program, VstInt32 delta_frames = 0)
+{
+	return MakeMidiEvent(MIDI_PROGRAM_CHANGE, channel, program, 0, delta_frames);
+}
+
+inline
+VstMidiEvent MakePolyAftertouch(size_t channel, size_t note_number, size_t pressure, VstInt32 delta_frames = 0)
+{
+	return MakeMidiEvent(MIDI_POLY_AFTERTOUCH, channel, note_number, pressure, delta_frames);
+}
+
+inline
+VstMidiEvent MakeChannelAftertouch(size_t channel, size_t pressure, VstInt32 delta_frames = 0)
+{
+	return MakeMidiEvent(MIDI_CHANNEL_AFTERTOUCH, channel, pressure, 0, delta_frames);
+}
+
+//! sb`xh
+//! value-8192 .. 8191ŁA0Z^[B
+inline
+VstMidiEvent MakePitchBend(size_t channel, int value, VstInt32 delta_frames = 0)
+{
+	BOOST_ASSERT(-8192 <= value && value <= 8191);
+	size_t const raw = static_cast<size_t>(value + 8192);
+	return MakeMidiEvent(MIDI_PITCH_BEND, channel, raw & 0x7F, (raw >> 7) & 0x7F, delta_frames);
+}
+
+//! VstEventsɋl߂Cxg̗̈
+//! VstMidiEventVstMidiSysexEvent𓯂zɕׂĕێ邽߂ɎgB
+union VstEventSlot
+{
+	VstEvent			event;
+	VstMidiEvent		midi;
+	VstMidiSysexEvent	sysex;
+};
+
+//! Œeʂ̃Cxgobt@
+//! mۂAllocatěĂяô݂ŁAȍ~Push/ClearŃmۂȂB
+//! SysEx̃f[^͂炩ߊmۂv[ɃRs[A
+//! VstMidiSysexEvent::sysexDump͂̃v[wB
+//! std::swapŒgĂvector̗̈掩͈̂ړȂ̂ŁA
+//! sysexDump̃|C^͗LȂ܂܁B
+struct VstEventBuffer
+{
+	VstEventBuffer()
+		:	num_events_(0)
+		,	sysex_used_(0)
+	{}
+
+	void Allocate(size_t event_capacity, size_t sysex_capacity)
+	{
+		slots_.resize(event_capacity);
+		sysex_pool_.resize(sysex_capacity);
+		Clear();
+	}
+
+	bool Push(VstMidiEvent const &event)
+	{
+		if(num_events_ == slots_.size()) { return false; }
+
+		slots_[num_events_++].midi = event;
+		return true;
+	}
+
+	//! 0SysEx́AvOCɓnĂǂ߂Ȃ(sysexDumpLȗ̈wȂ)̂ŒǉȂB
+	bool PushSysEx(char const *data, size_t length, VstInt32 delta_frames)
+	{
+		if(!data || length == 0) { return false; }
+		if(num_events_ == slots_.size()) { return false; }
+		if(sysex_pool_.size() - sysex_used_ < length) { return false; }
+
+		char *dump = sysex_pool_.data() + sysex_used_;
+		std::memcpy(dump, data, length);
+		sysex_used_ += length;
+
+		VstMidiSysexEvent &event = slots_[num_events_++].sysex;
+		event.type = kVstSysExMidiType;
+		event.byteSize = sizeof(VstMidiSysexEvent);
+		event.deltaFrames = delta_frames;
+		event.flags = 0;
+		event.dumpBytes = static_cast<VstInt32>(length);
+		event.resvd1 = 0;
+		event.sysexDump = dump;
+		event.resvd2 = 0;
+		return true;
+	}
+
+	void Clear()
+	{
+		num_events_ = 0;
+		sysex_used_ = 0;
+	}
+
+	//! src̃Cxgɒǉ
+	//! SysEx̃f[^͂̃obt@̃v[ɃRs[B
+	//! ǉłȂCxg̐ԂB
+	size_t Append(VstEventBuffer const &src)
+	{
+		size_t dropped = 0;
+		for(size_t i = 0; i < src.size(); ++i) {
+			VstEventSlot const &slot = src[i];
+			bool const pushed =
+				(slot.event.type == kVstSysExMidiType)
+				?	PushSysEx(slot.sysex.sysexDump, slot.sysex.dumpBytes, slot.sysex.deltaFrames)
+				:	Push(slot.midi);
+
+			if(!pushed) { ++dropped; }
+		}
+		return dropped;
+	}
+
+	bool empty() const { return num_events_ == 0; }
+	size_t size() const { return num_events_; }
+	size_t capacity() const { return slots_.size(); }
+	VstEventSlot & operator[](size_t index) { return slots_[index]; }
+	VstEventSlot const & operator[](size_t index) const { return slots_[index]; }
+
+	//! mۍς݂̗̈visit(void *data, size_t bytes)ŗ񋓂
+	//! (̃bNȂǂɎg)
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		visit(static_cast<void *>(slots_.data()), slots_.size() * sizeof(VstEventSlot));
+		visit(static_cast<void *>(sysex_pool_.data()), sysex_pool_.size());
+	}
+
+	void swap(VstEventBuffer &rhs)
+	{
+		slots_.swap(rhs.slots_);
+		sysex_pool_.swap(rhs.sysex_pool_);
+		std::swap(num_events_, rhs.num_events_);
+		std::swap(sysex_used_, rhs.sysex_used_);
+	}
+
+private:
+	std::vector<VstEventSlot>	slots_;
+	std::vector<char>			sysex_pool_;
+	size_t						num_events_;
+	size_t						sysex_used_;
+};
+
+inline
+void swap(VstEventBuffer &lhs, VstEventBuffer &rhs) { lhs.swap(rhs); }
+
+//! ܂Ƃ߂đMCxg
+//! GUIXbhMIDI̓Xbhō쐬A
+//! VstPlugin::AddEventsňx̃bNł܂Ƃ߂ăL[ɒǉB
+//! ClearĂmۍς݂̗͉̈Ȃ̂ŁAg񂹂΃mۂ͍ŏōςށB
+struct MidiEventBatch
+{
+	void Add(VstMidiEvent const &event)
+	{
+		Entry entry;
+		entry.midi = event;
+		entry.sysex_offset = 0;
+		entry.sysex_length = 0;
+		entries_.push_back(entry);
+	}
+
+	//! SysExǉ
+	//! 0SysEx͒ǉfalseԂB
+	bool AddSysEx(char const *data, size_t length, VstInt32 delta_frames = 0)
+	{
+		if(!data || length == 0) { return false; }
+
+		Entry entry = {};
+		entry.midi.deltaFrames = delta_frames;
+		entry.sysex_offset = sysex_data_.size();
+		entry.sysex_length = length;
+		entries_.push_back(entry);
+		sysex_data_.insert(sysex_data_.end(), data, data + length);
+		return true;
+	}
+
+	void Clear()
+	{
+		entries_.clear();
+		sysex_data_.clear();
+	}
+
+	bool empty() const { return entries_.empty(); }
+	size_t size() const { return entries_.size(); }
+
+	//! ob`̓ebufferɒǉB
+	//! ǉłȂCxg̐ԂB
+	size_t CopyTo(VstEventBuffer &buffer) const
+	{
+		size_t dropped = 0;
+		for(size_t i = 0; i < entries_.size(); ++i) {
+			Entry const &entry = entries_[i];
+			bool const pushed =
+				entry.sysex_length
+				?	buffer.PushSysEx(sysex_data_.data() + entry.sysex_offset, entry.sysex_length, entry.midi.deltaFrames)
+				:	buffer.Push(entry.midi);
+
+			if(!pushed) { ++dropped; }
+		}
+		return dropped;
+	}
+
+private:
+	struct Entry
+	{
+		VstMidiEvent	midi;
+		size_t			sysex_offset;
+		size_t			sysex_length;
+	};
+
+	std::vector<Entry>	entries_;
+	std::vector<char>	sysex_data_;
+};
+
+}	//::hwm
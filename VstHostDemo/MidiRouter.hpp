@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/cstdint.hpp>
+
+#include "./MidiEvent.hpp"
+#include "./VstPlugin.hpp"
+
+namespace hwm {
+
+//! ̃CxgAMIDI`lƃL[͈̔͂ɂĕ̑ɐU蕪NX
+//!
+//! C[(L[ɕ̉d˂)Xvbg(L[͈̔͂Ƃɉ𕪂)̂悤ɁA
+//! ̃vOC̌Ղ炷\ɎgB
+//! 0 .. MAX_TARGETS-1̔ԍňAۂɂǂ̃vOCɑ邩FlusȟĂяo߂B
+//!
+//! U蕪̐ݒ́A[`l][L[]Ƃɑ̏Wrbg}XNŎ\ɂĂ̂ŁA
+//! ̃Cxg̐U蕪͑̐ɂ炸\xōςށB
+//! 悲Ƃ̃CxǵA炩ߊmۂVstEventBufferɓɒǉ̂ŁA
+//! RoutěĂяoł̓mۂ͔A͂ɕłΑ悲Ƃ̕בւvȂB
+//!
+//! ݒ̕ύX(AddZoneȂ)Route/Flush͓XbhĂяoƁB
+struct MidiRouter
+{
+	typedef boost::uint64_t target_mask_t;
+
+	enum {
+		//! ̍ő吔(target_mask_t̃rbg)
+		MAX_TARGETS = 64,
+		//! AddZonechannelɎw肷ƁAׂẴ`lΏۂɂ
+		OMNI = 16,
+		NUM_CHANNELS = 16,
+		NUM_KEYS = 128
+	};
+
+	//! num_targets̑̂߂ɁAꂼevent_capacity̃CxgƁA
+	//! sysex_capacityoCgSysExf[^̗̈mۂB
+	MidiRouter(
+		size_t num_targets,
+		size_t event_capacity = VstPlugin::EVENT_CAPACITY,
+		size_t sysex_capacity = 4 * 1024 )
+		:	buffers_(num_targets)
+		,	num_dropped_events_(0)
+	{
+		if(num_targets == 0 || num_targets > MAX_TARGETS) {
+			throw std::runtime_error("invalid number of midi router targets");
+		}
+		for(auto &buffer: buffers_) {
+			buffer.Allocate(event_capacity, sysex_capacity);
+		}
+		ClearZones();
+		ResetNotes();
+	}
+
+	size_t	GetNumTargets() const { return buffers_.size(); }
+
+	//! targetɁAchannellowest_key .. highest_key͈̔͂̃m[g𑗂悤ɐݒ肷
+	//! L[ɕ̑ݒ肷΃C[ɂȂB
+	//! ́Ã`l̃m[gȊÕbZ[W(Rg[`FWAsb`xhȂ)󂯎B
+	void	AddZone(size_t target, size_t channel, size_t lowest_key = 0, size_t highest_key = NUM_KEYS - 1)
+	{
+		BOOST_ASSERT(target < buffers_.size());
+		BOOST_ASSERT(channel <= OMNI);
+		BOOST_ASSERT(lowest_key <= highest_key && highest_key < NUM_KEYS);
+
+		target_mask_t const bit = target_mask_t(1) << target;
+		size_t const first_ch = (channel == OMNI) ? 0 : channel;
+		size_t const last_ch = (channel == OMNI) ? NUM_CHANNELS - 1 : channel;
+		for(size_t ch = first_ch; ch <= last_ch; ++ch) {
+			for(size_t key = lowest_key; key <= highest_key; ++key) {
+				key_targets_[ch][key] |= bit;
+			}
+			channel_targets_[ch] |= bit;
+		}
+		all_targets_ |= bit;
+	}
+
+	//! U蕪̐ݒׂď
+	//! Ăm[g̋L^͎ĉŁAݒύXOɖ炵m[g̃m[gIt́A
+	//! m[gI𑗂ɓ͂B
+	void	ClearZones()
+	{
+		std::memset(key_targets_, 0, sizeof(key_targets_));
+		std::memset(channel_targets_, 0, sizeof(channel_targets_));
+		all_targets_ = 0;
+	}
+
+	//! channel, keỹm[gI鑗̃rbg}XN
+	target_mask_t	GetTargets(size_t channel, size_t key) const
+	{
+		BOOST_ASSERT(channel < NUM_CHANNELS && key < NUM_KEYS);
+		return key_targets_[channel][key];
+	}
+
+	//! CxgU蕪
+	//!  - m[gI			: [`l][L[]̕\̑Bm[gIt̂߂ɑL^ĂB
+	//!  - m[gItA|tHjbNAt^[^b` : L^ĂÃm[g炵Ă鑗
+	//!  - ̑̃`lbZ[W	: ̃`lɃ][
+	//!  - VXebZ[W		: ][ׂĂ̑
+	void	Route(VstMidiEvent const &event)
+	{
+		unsigned char const status = static_cast<unsigned char>(event.midiData[0]);
+		size_t const kind = status & 0xF0;
+		size_t const channel = status & 0x0F;
+		size_t const key = static_cast<unsigned char>(event.midiData[1]) & 0x7F;
+		bool const is_note_on = (kind == MIDI_NOTE_ON && event.midiData[2] != 0);
+		bool const is_note_off = (kind == MIDI_NOTE_OFF) || (kind == MIDI_NOTE_ON && event.midiData[2] == 0);
+
+		target_mask_t targets;
+		if(is_note_on) {
+			targets = key_targets_[channel][key];
+			sounding_[channel][key] |= targets;
+		} else if(is_note_off) {
+			targets = sounding_[channel][key];
+			sounding_[channel][key] = 0;
+		} else if(kind == MIDI_POLY_AFTERTOUCH) {
+			targets = sounding_[channel][key];
+		} else if(kind == MIDI_SYSEX) {
+			targets = all_targets_;
+		} else {
+			targets = channel_targets_[channel];
+		}
+
+		for( ; targets; targets &= targets - 1) {
+			if(!buffers_[lowest_bit(targets)].Push(event)) { ++num_dropped_events_; }
+		}
+	}
+
+	template<class Iterator>
+	void	Route(Iterator first, Iterator last)
+	{
+		for( ; first != last; ++first) { Route(*first); }
+	}
+
+	//! SysEx́A][ׂĂ̑ɑ
+	//! 0SysEx͑炸A悲ƂɎ肱ڂƂĐB
+	void	RouteSysEx(char const *data, size_t length, VstInt32 delta_frames = 0)
+	{
+		for(target_mask_t targets = all_targets_; targets; targets &= targets - 1) {
+			if(!buffers_[lowest_bit(targets)].PushSysEx(data, length, delta_frames)) { ++num_dropped_events_; }
+		}
+	}
+
+	//! U蕪CxgACxĝ鑗ɂdeliver(size_t target, VstEventBuffer const &events)œnA
+	//! 悲Ƃ̃obt@ɂB
+	//! 悪VstPluginł΁Adeliver̒VstPlugin::AddEvents(events)ĂяoB
+	template<class Deliver>
+	void	Flush(Deliver deliver)
+	{
+		for(size_t t = 0; t < buffers_.size(); ++t) {
+			if(buffers_[t].empty()) { continue; }
+			deliver(t, static_cast<VstEventBuffer const &>(buffers_[t]));
+			buffers_[t].Clear();
+		}
+	}
+
+	//! Ăm[g̋L^
+	//! ̃vOCւƂAI[m[gIt𑗂ƂɌĂяoB
+	void	ResetNotes()
+	{
+		std::memset(sounding_, 0, sizeof(sounding_));
+	}
+
+	VstEventBuffer const &	GetEvents(size_t target) const { return buffers_[target]; }
+
+	//! ̃obt@tŒǉłȂCxg(ƒ0SysEx)̐
+	size_t	GetNumDroppedEvents() const { return num_dropped_events_; }
+
+	//! mۍς݂̗̈visit(void *data, size_t bytes)ŗ񋓂
+	template<class Visitor>
+	void	VisitMemory(Visitor visit)
+	{
+		for(auto &buffer: buffers_) { buffer.VisitMemory(visit); }
+	}
+
+private:
+	//! ŉʂ1̃rbg̈ʒu
+	//! de BruijngāAȂŋ߂B
+	static
+	size_t	lowest_bit(target_mask_t mask)
+	{
+		BOOST_ASSERT(mask != 0);
+		static unsigned char const table[64] = {
+			 0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+			62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+			63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+			46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+		};
+		target_mask_t const isolated = mask & (~mask + 1);
+		return table[(isolated * 0x03F79D71B4CB0A89ULL) >> 58];
+	}
+
+private:
+	std::vector<VstEventBuffer>	buffers_;
+	target_mask_t				key_targets_[NUM_CHANNELS][NUM_KEYS];
+	target_mask_t				channel_targets_[NUM_CHANNELS];
+	target_mask_t				all_targets_;
+	//! Ăm[gƂɁAm[gI𑗂
+	target_mask_t				sounding_[NUM_CHANNELS][NUM_KEYS];
+	size_t						num_dropped_events_;
+
+	MidiRouter(MidiRouter const &);
+	MidiRouter & operator=(MidiRouter const &);
+};
+
+}	//::hwm
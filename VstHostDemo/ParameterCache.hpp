@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+#pragma warning(push)
+#pragma warning(disable: 4996)
+#include "./vstsdk2.4/pluginterfaces/vst2.x/aeffectx.h"
+#pragma warning(pop)
+
+#include "./Trace.hpp"
+
+namespace hwm {
+
+//! vOC̃p[^̃LbV
+//!
+//! GUII[g[VAԂ̕ۑȂǂŃp[^QƂ邽т
+//! getParametereffGetParamDisplayŃvOCĂяoɁA
+//! vOC̃[hɓǂݍ񂾒lƁAaudioMasterAutomateŒʒmꂽlێĂA
+//! ǂݏoׂ͂ẴLbVsB
+//!
+//! ݂SetValueŃLbVɋL^ĂŁA
+//! I[fBIXbhubN̐擪ApplyPendingWritesĂяoƂɁA
+//! ܂Ă镪܂Ƃ߂setParameterŃvOCɓKpB
+//!
+//! p[^Ƃ̕ύX̗L32bit̃[hPʂ̃rbgŊǗ̂ŁA
+//! ̃p[^vOCłAύX̂Ȃ[h͓ǂݔ΂B
+//!  - pending_bits_	: ܂vOCɓKpĂȂ
+//!  - changed_bits_	: ConsumeChangesł܂󂯎ĂȂύX
+//!  - display_bits_	: \p擾Kvp[^
+struct ParameterCache
+{
+	enum {
+		WORD_BITS = 32,
+		//! \p̃obt@
+		//! dlkVstMaxParamStrLen(8)܂łA𒴂ďރvOĈŗ]TB
+		TEXT_LENGTH = 256
+	};
+
+	//! vOC̃p[^ǂݍŃLbV쐬
+	//! vOC̃[hɁAGUIXbhĂяoB
+	explicit ParameterCache(AEffect *effect)
+		:	effect_(effect)
+		,	num_params_(std::max<VstInt32>(effect->numParams, 0))
+		,	num_words_((num_params_ + WORD_BITS - 1) / WORD_BITS)
+		,	values_(new boost::atomic<float>[num_params_])
+		,	pending_values_(new boost::atomic<float>[num_params_])
+		,	pending_bits_(new boost::atomic<boost::uint32_t>[num_words_])
+		,	changed_bits_(new boost::atomic<boost::uint32_t>[num_words_])
+		,	display_bits_(new boost::atomic<boost::uint32_t>[num_words_])
+		,	has_pending_(false)
+		,	num_applied_(0)
+		,	num_automated_(0)
+	{
+		for(size_t w = 0; w < num_words_; ++w) {
+			pending_bits_[w].store(0, boost::memory_order_relaxed);
+			changed_bits_[w].store(0, boost::memory_order_relaxed);
+			display_bits_[w].store(0, boost::memory_order_relaxed);
+		}
+
+		names_.resize(num_params_);
+		displays_.resize(num_params_);
+		for(size_t i = 0; i < num_params_; ++i) {
+			float const value = effect_->getParameter(effect_, i);
+			values_[i].store(value, boost::memory_order_relaxed);
+			pending_values_[i].store(value, boost::memory_order_relaxed);
+			names_[i] = get_text(effGetParamName, i);
+			displays_[i] = get_display(i);
+		}
+		boost::atomic_thread_fence(boost::memory_order_release);
+	}
+
+	//! ׂẴp[^̒lƕ\pvOCǂݍݒ
+	//! vO̕ύX`N̕ȂǁAaudioMasterAutomate𔺂킸
+	//! p[^܂Ƃ߂ĕςŁAGUIXbhĂяoB
+	//! ǂݍ񂾃p[^ׂ͂ĕύXꂽ̂ƂĈB
+	void	Reload()
+	{
+		for(size_t i = 0; i < num_params_; ++i) {
+			values_[i].store(effect_->getParameter(effect_, i), boost::memory_order_relaxed);
+			std::string display = get_display(i);
+			boost::unique_lock<boost::mutex> lock(display_mutex_);
+			displays_[i].swap(display);
+		}
+		for(size_t w = 0; w < num_words_; ++w) {
+			size_t const rest = num_params_ - w * WORD_BITS;
+			boost::uint32_t const bits = (rest >= WORD_BITS) ? ~boost::uint32_t(0) : ((1u << rest) - 1);
+			changed_bits_[w].fetch_or(bits, boost::memory_order_release);
+		}
+	}
+
+	size_t	GetNumParameters() const { return num_params_; }
+
+	//! LbVĂl
+	//! ǂ̃XbhĂяoĂ悢BvOC͌ĂяoȂB
+	float	GetValue(size_t index) const
+	{
+		BOOST_ASSERT(index < num_params_);
+		return values_[index].load(boost::memory_order_relaxed);
+	}
+
+	//! [first, first + count)͈̔͂̒l܂Ƃ߂destɓǂݏo
+	void	GetValues(size_t first, size_t count, float *dest) const
+	{
+		BOOST_ASSERT(first + count <= num_params_);
+		for(size_t i = 0; i < count; ++i) {
+			dest[i] = values_[first + i].load(boost::memory_order_relaxed);
+		}
+	}
+
+	//! p[^
+	//! [hɎ擾̂ԂB
+	std::string	GetName(size_t index) const
+	{
+		BOOST_ASSERT(index < num_params_);
+		return names_[index];
+	}
+
+	//! \p(lƒP)
+	//! ŌRefreshDisplaysĂяo_̂̂ԂB
+	std::string	GetDisplay(size_t index) const
+	{
+		BOOST_ASSERT(index < num_params_);
+		boost::unique_lock<boost::mutex> lock(display_mutex_);
+		return displays_[index];
+	}
+
+	//! l
+	//! LbV̒l͂ɍXVAvOCւ͎ApplyPendingWritesœKpB
+	//! KpOɓp[^֍ēx񂾏ꍇ́AŌɏ񂾒lKpB
+	//! ǂ̃XbhĂяoĂ悢B
+	void	SetValue(size_t index, float value)
+	{
+		if(index >= num_params_) { return; }
+		store_pending(index, value);
+		has_pending_.store(true, boost::memory_order_release);
+	}
+
+	//! [first, first + count)͈̔͂̒l܂Ƃ߂ď
+	//! Ԃ̕ȂǁÃp[^xɕύXꍇɎgB
+	void	SetValues(size_t first, size_t count, float const *src)
+	{
+		BOOST_ASSERT(first + count <= num_params_);
+		for(size_t i = 0; i < count; ++i) {
+			store_pending(first + i, src[i]);
+		}
+		has_pending_.store(true, boost::memory_order_release);
+	}
+
+	//! ܂Ă鏑݂vOCɓKp
+	//! I[fBIXbhŁAubN̏̐擪(processReplacingĂяoO)ɌĂяoB
+	//! mۂ⃍bN͍sȂB݂Ȃ΃rbg̑s킸ɕԂB
+	//! ߂l͓Kpp[^̐B
+	size_t	ApplyPendingWrites()
+	{
+		if(!has_pending_.load(boost::memory_order_relaxed)) { return 0; }
+		if(!has_pending_.exchange(false, boost::memory_order_acquire)) { return 0; }
+
+		HWM_TRACE_SCOPE("apply parameters");
+		size_t applied = 0;
+		for(size_t w = 0; w < num_words_; ++w) {
+			if(pending_bits_[w].load(boost::memory_order_relaxed) == 0) { continue; }
+			boost::uint32_t bits = pending_bits_[w].exchange(0, boost::memory_order_acquire);
+			boost::uint32_t const written = bits;
+			while(bits) {
+				size_t const index = w * WORD_BITS + lowest_bit(bits);
+				bits &= bits - 1;
+				effect_->setParameter(effect_, index, pending_values_[index].load(boost::memory_order_relaxed));
+				++applied;
+			}
+			changed_bits_[w].fetch_or(written, boost::memory_order_release);
+			display_bits_[w].fetch_or(written, boost::memory_order_release);
+		}
+		num_applied_.fetch_add(applied, boost::memory_order_relaxed);
+		HWM_TRACE_COUNTER("applied parameters", applied);
+		return applied;
+	}
+
+	//! audioMasterAutomateŒʒmꂽlLbVɔf
+	//! vOC̃GfB^ȂǂŁAvOCgp[^ύXƂɌĂ΂B
+	//! ʒm̓I[fBIXbh痈邱Ƃ̂ŁAł̓bNȂB
+	void	OnAutomate(size_t index, float value)
+	{
+		if(index >= num_params_) { return; }
+		values_[index].store(value, boost::memory_order_relaxed);
+		boost::uint32_t const bit = 1u << (index % WORD_BITS);
+		changed_bits_[index / WORD_BITS].fetch_or(bit, boost::memory_order_release);
+		display_bits_[index / WORD_BITS].fetch_or(bit, boost::memory_order_release);
+		num_automated_.fetch_add(1, boost::memory_order_relaxed);
+	}
+
+	//! ǑĂяoȍ~ɕύXꂽp[^f(size_t index, float value)ŗ񋓂
+	//! GUI̍XVȀԕۑɎgBĂяô͈̃XbhɌB
+	//! ߂l͗񋓂p[^̐B
+	template<class F>
+	size_t	ConsumeChanges(F f)
+	{
+		size_t count = 0;
+		for(size_t w = 0; w < num_words_; ++w) {
+			if(changed_bits_[w].load(boost::memory_order_relaxed) == 0) { continue; }
+			boost::uint32_t bits = changed_bits_[w].exchange(0, boost::memory_order_acquire);
+			while(bits) {
+				size_t const index = w * WORD_BITS + lowest_bit(bits);
+				bits &= bits - 1;
+				f(index, GetValue(index));
+				++count;
+			}
+		}
+		return count;
+	}
+
+	//! lύXꂽp[^̕\p񂾂vOC擾
+	//! effGetParamDisplayĂяôŁAGUIXbhĂяoB
+	//! ߂l͎擾p[^̐B
+	size_t	RefreshDisplays()
+	{
+		size_t count = 0;
+		for(size_t w = 0; w < num_words_; ++w) {
+			if(display_bits_[w].load(boost::memory_order_relaxed) == 0) { continue; }
+			boost::uint32_t bits = display_bits_[w].exchange(0, boost::memory_order_acquire);
+			while(bits) {
+				size_t const index = w * WORD_BITS + lowest_bit(bits);
+				bits &= bits - 1;
+				std::string display = get_display(index);
+				boost::unique_lock<boost::mutex> lock(display_mutex_);
+				displays_[index].swap(display);
+				++count;
+			}
+		}
+		return count;
+	}
+
+	//! ApplyPendingWritesŃvOCɓKp݂̐
+	size_t	GetNumApplied() const { return num_applied_.load(boost::memory_order_relaxed); }
+
+	//! audioMasterAutomateŒʒmꂽύX̐
+	size_t	GetNumAutomated() const { return num_automated_.load(boost::memory_order_relaxed); }
+
+	std::string ToString() const
+	{
+		std::ostringstream ss;
+		ss	<< num_params_ << " params"
+			<< ", applied " << GetNumApplied()
+			<< ", automated " << GetNumAutomated();
+		return ss.str();
+	}
+
+	//! I[fBIXbhANZẌvisit(void *data, size_t bytes)ŗ񋓂
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		visit(static_cast<void *>(values_.get()), num_params_ * sizeof(values_[0]));
+		visit(static_cast<void *>(pending_values_.get()), num_params_ * sizeof(pending_values_[0]));
+		visit(static_cast<void *>(pending_bits_.get()), num_words_ * sizeof(pending_bits_[0]));
+		visit(static_cast<void *>(changed_bits_.get()), num_words_ * sizeof(changed_bits_[0]));
+		visit(static_cast<void *>(display_bits_.get()), num_words_ * sizeof(display_bits_[0]));
+	}
+
+private:
+	void	store_pending(size_t index, float value)
+	{
+		pending_values_[index].store(value, boost::memory_order_relaxed);
+		values_[index].store(value, boost::memory_order_relaxed);
+		pending_bits_[index / WORD_BITS].fetch_or(1u << (index % WORD_BITS), boost::memory_order_release);
+	}
+
+	static
+	size_t	lowest_bit(boost::uint32_t bits)
+	{
+		BOOST_ASSERT(bits != 0);
+		size_t n = 0;
+		while((bits & 1) == 0) { bits >>= 1; ++n; }
+		return n;
+	}
+
+	std::string get_text(VstInt32 opcode, size_t index) const
+	{
+		char buf[TEXT_LENGTH] = {};
+		effect_->dispatcher(effect_, opcode, index, 0, buf, 0);
+		buf[TEXT_LENGTH-1] = '\0';
+		return buf;
+	}
+
+	//! lƒPʂȂ\p
+	std::string get_display(size_t index) const
+	{
+		std::string const display = get_text(effGetParamDisplay, index);
+		std::string const label = get_text(effGetParamLabel, index);
+		return label.empty() ? display : display + " " + label;
+	}
+
+private:
+	AEffect *										effect_;
+	size_t											num_params_;
+	size_t											num_words_;
+	std::unique_ptr<boost::atomic<float>[]>			values_;
+	std::unique_ptr<boost::atomic<float>[]>			pending_values_;
+	std::unique_ptr<boost::atomic<boost::uint32_t>[]>	pending_bits_;
+	std::unique_ptr<boost::atomic<boost::uint32_t>[]>	changed_bits_;
+	std::unique_ptr<boost::atomic<boost::uint32_t>[]>	display_bits_;
+	boost::atomic<bool>								has_pending_;
+	boost::atomic<size_t>							num_applied_;
+	boost::atomic<size_t>							num_automated_;
+
+	std::vector<std::string>						names_;
+	std::vector<std::string>						displays_;
+	boost::mutex mutable							display_mutex_;
+
+	ParameterCache(ParameterCache const &);
+	ParameterCache & operator=(ParameterCache const &);
+};
+
+}	//::hwm
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/atomic.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread.hpp>
+
+#include "./RealtimeChecker.hpp"
+#include "./ThreadRole.hpp"
+#include "./Trace.hpp"
+#include "./VstPlugin.hpp"
+
+namespace hwm {
+
+//! ւ̃CX^XɈpvOC̏
+//! vOCǂݍݒꍇAvOςCX^XɍւꍇɎgB
+struct PluginState
+{
+	PluginState()
+		:	program(-1)
+	{}
+
+	//! ɐݒ肷vOBȂݒ肵ȂB
+	int					program;
+	//! effGetChunkŎ擾f[^(vOC`NɑΉĂꍇ)
+	std::vector<char>	chunk;
+	//! `NɑΉĂȂꍇ́ASp[^̒l
+	std::vector<float>	parameters;
+
+	//! plugiň݂̏Ԃ擾
+	//! GUIXbhĂяoB`NɑΉĂȂvOC̒lParameterCacheǂݏoB
+	static
+	PluginState Capture(VstPlugin &plugin)
+	{
+		PluginState state;
+		if(plugin.GetEffect()->flags & effFlagsProgramChunks) {
+			void *data = nullptr;
+			VstIntPtr const size = plugin.dispatcher(effGetChunk, 0, 0, &data, 0);
+			if(data && size > 0) {
+				state.chunk.assign(static_cast<char const *>(data), static_cast<char const *>(data) + size);
+			}
+		} else {
+			ParameterCache const &parameters = plugin.GetParameters();
+			state.parameters.resize(parameters.GetNumParameters());
+			if(!state.parameters.empty()) {
+				parameters.GetValues(0, state.parameters.size(), state.parameters.data());
+			}
+		}
+		return state;
+	}
+
+	//! pluginɏԂ𕜌
+	//! I[fBȈɎgÕCX^Xɑ΂āAǂݍݗp̃XbhĂяoB
+	//! ʂ̃vOC̏Ԃ͕łȂ̂ŁAuniqueIDvȂꍇ͌ĂяoŕȂ悤ɂB
+	void Restore(VstPlugin &plugin) const
+	{
+		if(!chunk.empty()) {
+			plugin.dispatcher(effSetChunk, 0, chunk.size(), const_cast<char *>(chunk.data()), 0);
+		}
+		if(!parameters.empty() && parameters.size() == static_cast<size_t>(plugin.GetEffect()->numParams)) {
+			AEffect *effect = plugin.GetEffect();
+			for(size_t i = 0; i < parameters.size(); ++i) {
+				effect->setParameter(effect, i, parameters[i]);
+			}
+		}
+		if(program >= 0 && static_cast<size_t>(program) < plugin.GetNumPrograms()) {
+			plugin.SetProgram(program);
+		}
+		plugin.GetParameters().Reload();
+	}
+};
+
+//! Đ~߂ɃvOC̃CX^XւNX
+//!
+//! RequestSwapœn֐ŁAVCX^X̍쐬ƏԂ̕ǂݍݗp̃XbhōsA
+//! oオCX^XAg~bNȃ|C^ŃI[fBIXbhɓnB
+//! I[fBIXbh́AProcess̐擪ł󂯎A
+//! fade_frameŝṼCX^XōāATvPʂŃNXtF[hB
+//! NXtF[hIÂCX^XGUIXbhUpdateŉAjp̃XbhŔjB
+//! I[fBIXbhł́AmہAbNAvOC̔jsȂB
+//!
+//! o͂̓`l̈ႤvOCɍւĂςȂ悤ɁA
+//! ɂ̃NX̃obt@(channels)ɏoBȂ`l͖ɂȂB
+struct PluginSwapper
+{
+	typedef std::function<std::unique_ptr<VstPlugin>()> loader_function_t;
+
+	//! initial			: ŏɎgCX^X
+	//! channels		: o͂̃`l
+	//! max_block_size	: xProcessŏő̃t[
+	//! fade_frames		: NXtF[h̒
+	PluginSwapper(std::unique_ptr<VstPlugin> initial, size_t channels, size_t max_block_size, size_t fade_frames)
+		:	current_(initial.release())
+		,	fading_out_(nullptr)
+		,	channels_(channels)
+		,	max_block_size_(max_block_size)
+		,	fade_frames_(std::max<size_t>(fade_frames, 1))
+		,	fade_pos_(0)
+		,	is_busy_(false)
+		,	active_(current_)
+		,	pending_(nullptr)
+		,	retired_(nullptr)
+		,	failed_(false)
+		,	num_swaps_(0)
+	{
+		outputs_.resize(channels);
+		output_heads_.resize(channels);
+		for(size_t ch = 0; ch < channels; ++ch) {
+			outputs_[ch].assign(max_block_size, 0.0f);
+			output_heads_[ch] = outputs_[ch].data();
+		}
+	}
+
+	~PluginSwapper()
+	{
+		if(load_thread_.joinable()) { load_thread_.join(); }
+		if(retire_thread_.joinable()) { retire_thread_.join(); }
+		delete pending_.exchange(nullptr);
+		delete retired_.exchange(nullptr);
+		delete fading_out_;
+		delete current_;
+	}
+
+	//! Cxg𑗂ׂCX^X
+	//! GUIXbhĂяoBNXtF[h͐VCX^XԂB
+	//! ԂCX^X́AUpdateĂяo܂ŔjȂB
+	VstPlugin & GetActive() { return *active_.load(boost::memory_order_acquire); }
+
+	//! ւ̓r(ǂݍݒANXtF[hAÂCX^X̉҂)Ȃtrue
+	bool	IsBusy() const { return is_busy_; }
+
+	//! ւJn
+	//! GUIXbhĂяoBload͓ǂݍݗp̃XbhŌĂяoA
+	//! VCX^X̍쐬AԂ̕Aobt@̃bNȂǂsĕԂB
+	//! ւ̓rłΉfalseԂB
+	bool	RequestSwap(loader_function_t load)
+	{
+		if(is_busy_) { return false; }
+		if(load_thread_.joinable()) { load_thread_.join(); }
+
+		is_busy_ = true;
+		failed_ = false;
+		load_thread_ = boost::thread([this, load] {
+			ThreadRole::SetCurrent(ThreadRole::WORKER);
+			HWM_TRACE_THREAD("PluginLoader");
+			try {
+				std::unique_ptr<VstPlugin> plugin = load();
+				if(!plugin) { throw std::runtime_error("plugin not loaded"); }
+#if defined(HWM_REALTIME_CHECK)
+				//! ւœǂݍ܂ꂽvOCDLLWin32 APIĂяoĎ
+				RealtimeChecker::GetInstance().HookModuleContaining(reinterpret_cast<void const *>(plugin->GetEffect()->dispatcher));
+#endif
+				pending_.store(plugin.release(), boost::memory_order_release);
+			} catch(std::exception &e) {
+				boost::unique_lock<boost::mutex> lock(error_mutex_);
+				error_ = std::string(e.what());
+				failed_.store(true, boost::memory_order_release);
+			}
+		});
+		return true;
+	}
+
+	//! ւ̐is
+	//! GUIXbhIɌĂяoB
+	//! NXtF[hIÂCX^X΁Aon_retire(retired)Ăяo
+	//! (GfB^AbNobt@Ȃ)Ajp̃XbhɓntrueԂB
+	//! ǂݍ݂ɎsĂꍇ́Astd::runtime_error𓊂B
+	bool	Update(std::function<void(VstPlugin &retired)> on_retire)
+	{
+		if(!is_busy_) { return false; }
+
+		if(failed_.load(boost::memory_order_acquire)) {
+			load_thread_.join();
+			is_busy_ = false;
+			failed_ = false;
+			boost::unique_lock<boost::mutex> lock(error_mutex_);
+			std::string const message = error_ ? *error_ : std::string("unknown error");
+			error_ = boost::none;
+			throw std::runtime_error(message);
+		}
+
+		VstPlugin *retired = retired_.exchange(nullptr, boost::memory_order_acquire);
+		if(!retired) { return false; }
+
+		on_retire(*retired);
+		if(retired->IsEditorOpened()) {
+			retired->CloseEditor();
+		}
+
+		load_thread_.join();
+		if(retire_thread_.joinable()) { retire_thread_.join(); }
+		retire_thread_ = boost::thread([retired] {
+			ThreadRole::SetCurrent(ThreadRole::WORKER);
+			HWM_TRACE_THREAD("PluginRetire");
+			delete retired;
+		});
+
+		is_busy_ = false;
+		return true;
+	}
+
+	//! frames̍
+	//! I[fBIXbhĂяoB
+	//! ւCX^X͂Ă΁ÃubN̐擪NXtF[hn߂B
+	float ** Process(size_t frames)
+	{
+		BOOST_ASSERT(frames <= max_block_size_);
+
+		if(!fading_out_ && pending_.load(boost::memory_order_relaxed)) {
+			fading_out_ = current_;
+			current_ = pending_.exchange(nullptr, boost::memory_order_acquire);
+			active_.store(current_, boost::memory_order_release);
+			fade_pos_ = 0;
+			num_swaps_.fetch_add(1, boost::memory_order_relaxed);
+			HWM_TRACE_INSTANT("plugin swap");
+		}
+
+		float **rendered = render(*current_, frames);
+		copy_outputs(rendered, current_->GetNumOutputs(), frames);
+
+		if(fading_out_) {
+			float **old = render(*fading_out_, frames);
+			size_t const old_channels = fading_out_->GetNumOutputs();
+			for(size_t fr = 0; fr < frames; ++fr) {
+				float const gain = std::min<float>(static_cast<float>(fade_pos_ + fr) / fade_frames_, 1.0f);
+				for(size_t ch = 0; ch < channels_; ++ch) {
+					float const x = (ch < old_channels) ? old[ch][fr] : 0.0f;
+					output_heads_[ch][fr] = output_heads_[ch][fr] * gain + x * (1.0f - gain);
+				}
+			}
+
+			fade_pos_ += frames;
+			if(fade_pos_ >= fade_frames_) {
+				BOOST_ASSERT(!retired_.load(boost::memory_order_relaxed));
+				retired_.store(fading_out_, boost::memory_order_release);
+				fading_out_ = nullptr;
+			}
+		}
+
+		return output_heads_.data();
+	}
+
+	//! Processʂރobt@
+	float ** GetOutputBuffers() { return output_heads_.data(); }
+
+	size_t	GetNumChannels() const { return channels_; }
+
+	//! ւ
+	size_t	GetNumSwaps() const { return num_swaps_.load(boost::memory_order_relaxed); }
+
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		for(auto &buffer: outputs_) {
+			visit(static_cast<void *>(buffer.data()), buffer.size() * sizeof(float));
+		}
+	}
+
+private:
+	static
+	float ** render(VstPlugin &plugin, size_t frames)
+	{
+		plugin.ProcessEvents();
+		return plugin.ProcessAudio(frames);
+	}
+
+	void	copy_outputs(float **src, size_t num_src_channels, size_t frames)
+	{
+		for(size_t ch = 0; ch < channels_; ++ch) {
+			if(ch < num_src_channels) {
+				std::copy(src[ch], src[ch] + frames, output_heads_[ch]);
+			} else {
+				std::fill(output_heads_[ch], output_heads_[ch] + frames, 0.0f);
+			}
+		}
+	}
+
+private:
+	//! I[fBIXbhG
+	VstPlugin *							current_;
+	VstPlugin *							fading_out_;
+	size_t								channels_;
+	size_t								max_block_size_;
+	size_t								fade_frames_;
+	size_t								fade_pos_;
+	std::vector<std::vector<float>>		outputs_;
+	std::vector<float *>				output_heads_;
+
+	//! GUIXbhG
+	bool								is_busy_;
+	boost::thread						load_thread_;
+	boost::thread						retire_thread_;
+
+	//! XbhԂ̎󂯓n
+	boost::atomic<VstPlugin *>			active_;
+	boost::atomic<VstPlugin *>			pending_;
+	boost::atomic<VstPlugin *>			retired_;
+	boost::atomic<bool>					failed_;
+	boost::atomic<size_t>				num_swaps_;
+	boost::mutex						error_mutex_;
+	boost::optional<std::string>		error_;
+
+	PluginSwapper(PluginSwapper const &);
+	PluginSwapper & operator=(PluginSwapper const &);
+};
+
+}	//::hwm
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+
+#include <windows.h>
+
+#include "./Trace.hpp"
+
+namespace hwm {
+
+//! PluginWatchdog̐ݒ
+struct WatchdogSettings
+{
+	enum Mode {
+		BYPASS,		//! ͂̂܂܏o͂
+		MUTE		//! o͂
+	};
+
+	WatchdogSettings()
+		:	budget_share(0.8)
+		,	miss_limit(3)
+		,	window_blocks(16)
+		,	initial_backoff_msec(500)
+		,	max_backoff_msec(30000)
+		,	ramp_msec(200)
+		,	stable_msec(5000)
+		,	mode(BYPASS)
+	{}
+
+	//! ubN̒ߐ؂(ubN̒̎)̂ÃvOCɊ蓖Ă銄
+	double	budget_share;
+	//! window_blocksubN̂Amiss_limitȏ㊄蓖Ă𒴂oCpX
+	size_t	miss_limit;
+	size_t	window_blocks;
+	//! oCpXĂĂя܂ł̎
+	//! ĊJɍĂуoCpX邽тɔ{ɂȂAmax_backoff_msecœłɂȂB
+	size_t	initial_backoff_msec;
+	size_t	max_backoff_msec;
+	//! ĊJɁAoCpX̏o͂vOC̏o͂֐؂ւNXtF[h̒
+	size_t	ramp_msec;
+	//! ĊJA̎ԃoCpXȂ΁AobNItlɖ߂
+	size_t	stable_msec;
+	Mode	mode;
+};
+
+//! PluginWatchdogs̋L^
+struct WatchdogAction
+{
+	enum Type {
+		BYPASSED,	//! 蓖Ă𒴂̂ŃoCpX
+		PROBING,	//! obNIt̂ŁANXtF[hȂ珈ĊJ
+		RESTORED,	//! NXtF[hIAʏ̏ɖ߂
+		REBYPASSED	//! ĊJɊ蓖Ă𒴂̂ŁAobNIt΂čĂуoCpX
+	};
+
+	Type			type;
+	boost::uint64_t	block;			//! ubNڂŋN
+	size_t			misses;			//! ߂̃EBhEŊ蓖Ă𒴂
+	double			elapsed_msec;	//! ̃ubN̏
+	double			budget_msec;	//! 蓖
+	size_t			backoff_msec;	//! ɍĊJ܂ł̎
+
+	std::string ToString() const
+	{
+		static char const * const names[] = { "bypassed", "probing", "restored", "re-bypassed" };
+
+		std::ostringstream ss;
+		ss	<< "block " << block << ": " << names[type];
+		if(type != PROBING) {
+			ss << " (misses " << misses << ", last " << elapsed_msec << "ms / budget " << budget_msec << "ms)";
+		}
+		if(type == BYPASSED || type == REBYPASSED) {
+			ss << ", retry in " << backoff_msec << "ms";
+		}
+		return ss.str();
+	}
+};
+
+//! vOC̏ԂĎAߐ؂ȂvOCIɃoCpXNX
+//!
+//! vOCɂpӂÃvOC̏RunŎsB
+//! ԂubN̒ߐ؂ɑ΂銄蓖(budget_share)JԂꍇA
+//! ̃vOC̏߂ăoCpX(܂̓~[g)B
+//! ̃vOĈ߂ɏo͑Ŝr؂́ÃvOC̉IԁB
+//!
+//! oCpXĂobNIt̎ԂoƁAĊJA
+//! oCpX̏o͂vOC̏o͂֏XɃNXtF[hB
+//! ĊJɍĂъ蓖Ă𒴂ꍇ́AobNIt{ɂčĂуoCpXB
+//!
+//! sׂ͂WatchdogActionƂċL^APopActionŎoB
+//! Run̓mۂbNsȂ̂ŁAfoCX̃R[obNĂяoB
+//! Runɓnt[͖ςĂ悢BobNIt̎Ԃ́Aۂɓnꂽt[ŐB
+struct PluginWatchdog
+{
+	enum State { ACTIVE, BYPASSING, RAMPING };
+	enum { ACTION_CAPACITY = 64 };
+
+	//! name				: L^ɎgvOC̖O
+	//! sampling_rate		: ubN̒ԂɊZ邽߂̃TvO[g
+	//! channels			: vOC̏o̓`l
+	//! max_block_size		: Runɓnő̃t[
+	PluginWatchdog(std::string const &name, size_t sampling_rate, size_t channels, size_t max_block_size, WatchdogSettings const &settings)
+		:	name_(name)
+		,	sampling_rate_(sampling_rate)
+		,	max_block_size_(max_block_size)
+		,	settings_(settings)
+		,	state_(ACTIVE)
+		,	history_(0)
+		,	num_blocks_(0)
+		,	frames_until_probe_(0)
+		,	backoff_msec_(settings.initial_backoff_msec)
+		,	ramp_pos_(0)
+		,	stable_frames_(0)
+		,	recently_restored_(false)
+		,	action_write_(0)
+		,	action_read_(0)
+		,	num_dropped_actions_(0)
+		,	num_misses_(0)
+		,	num_bypassed_blocks_(0)
+		,	max_elapsed_usec_(0)
+		,	shared_state_(ACTIVE)
+	{
+		BOOST_ASSERT(settings.window_blocks > 0 && settings.window_blocks <= 64);
+		BOOST_ASSERT(settings.miss_limit > 0);
+
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		ticks_per_second_ = static_cast<double>(frequency.QuadPart);
+
+		scratch_.assign(channels * max_block_size, 0.0f);
+		for(size_t ch = 0; ch < channels; ++ch) {
+			scratch_heads_.push_back(scratch_.data() + ch * max_block_size);
+		}
+		actions_.resize(ACTION_CAPACITY);
+	}
+
+	//! vOC̏ubNs
+	//! process()	: vOC̏sAoutputs[ch][0 .. frames)Ɍʂފ֐
+	//! bypass(dest, frames)	: oCpX̏o͂destɏފ֐B(GtFNgȂ͂̃Rs[)
+	//!				  process()outputsƓ͂LĂĂ悢悤ɁAbypassprocessɌĂяoB
+	//! ̃ubNprocess()ĂяoǂԂB
+	//! ĂяoȂꍇAvOCɓn͂Cxg̈͌ĂяoŌ߂B
+	template<class Process, class Bypass>
+	bool Run(float * const *outputs, size_t frames, Process process, Bypass bypass)
+	{
+		BOOST_ASSERT(frames <= max_block_size_);
+
+		size_t const channels = scratch_heads_.size();
+		if(settings_.mode == WatchdogSettings::MUTE) {
+			for(size_t ch = 0; ch < channels; ++ch) {
+				std::fill(scratch_heads_[ch], scratch_heads_[ch] + frames, 0.0f);
+			}
+		} else {
+			bypass(scratch_heads_.data(), frames);
+		}
+
+		++num_blocks_;
+
+		if(state_ == BYPASSING) {
+			for(size_t ch = 0; ch < channels; ++ch) {
+				std::memcpy(outputs[ch], scratch_heads_[ch], frames * sizeof(float));
+			}
+			num_bypassed_blocks_.fetch_add(1, boost::memory_order_relaxed);
+
+			if(frames_until_probe_ <= frames) {
+				set_state(RAMPING);
+				ramp_pos_ = 0;
+				report(WatchdogAction::PROBING, 0, 0);
+			} else {
+				frames_until_probe_ -= frames;
+			}
+			return false;
+		}
+
+		LARGE_INTEGER begin, end;
+		QueryPerformanceCounter(&begin);
+		process();
+		QueryPerformanceCounter(&end);
+
+		double const elapsed = (end.QuadPart - begin.QuadPart) / ticks_per_second_;
+		double const budget = settings_.budget_share * frames / sampling_rate_;
+		bool const missed = elapsed > budget;
+
+		size_t const elapsed_usec = static_cast<size_t>(elapsed * 1000000.0);
+		if(elapsed_usec > max_elapsed_usec_.load(boost::memory_order_relaxed)) {
+			max_elapsed_usec_.store(elapsed_usec, boost::memory_order_relaxed);
+		}
+
+		boost::uint64_t const window_mask = (settings_.window_blocks == 64) ? ~boost::uint64_t(0) : ((boost::uint64_t(1) << settings_.window_blocks) - 1);
+		history_ = ((history_ << 1) | (missed ? 1 : 0)) & window_mask;
+		if(missed) {
+			num_misses_.fetch_add(1, boost::memory_order_relaxed);
+			HWM_TRACE_INSTANT("watchdog miss");
+		}
+
+		size_t const ramp_frames = std::max<size_t>(settings_.ramp_msec * sampling_rate_ / 1000, 1);
+
+		if(state_ == ACTIVE) {
+			if(count_misses() >= settings_.miss_limit) {
+				//! ̃ubN̒ŁAvOC̏o͂oCpX̏o͂֐؂ւ
+				crossfade(outputs, frames, 1.0f, 0.0f);
+				if(recently_restored_) {
+					backoff_msec_ = std::min<size_t>(backoff_msec_ * 2, settings_.max_backoff_msec);
+				}
+				enter_bypass(WatchdogAction::BYPASSED, elapsed, budget);
+				return true;
+			}
+			if(recently_restored_) {
+				stable_frames_ += frames;
+				if(stable_frames_ >= settings_.stable_msec * sampling_rate_ / 1000) {
+					backoff_msec_ = settings_.initial_backoff_msec;
+					recently_restored_ = false;
+				}
+			}
+			return true;
+		}
+
+		//! RAMPING
+		float const gain_begin = static_cast<float>(ramp_pos_) / ramp_frames;
+		if(missed) {
+			crossfade(outputs, frames, gain_begin, 0.0f);
+			backoff_msec_ = std::min<size_t>(backoff_msec_ * 2, settings_.max_backoff_msec);
+			enter_bypass(WatchdogAction::REBYPASSED, elapsed, budget);
+			return true;
+		}
+
+		ramp_pos_ = std::min<size_t>(ramp_pos_ + frames, ramp_frames);
+		float const gain_end = static_cast<float>(ramp_pos_) / ramp_frames;
+		crossfade(outputs, frames, gain_begin, gain_end);
+		if(ramp_pos_ == ramp_frames) {
+			set_state(ACTIVE);
+			history_ = 0;
+			stable_frames_ = 0;
+			recently_restored_ = true;
+			report(WatchdogAction::RESTORED, elapsed, budget);
+		}
+		return true;
+	}
+
+	//! L^ꂽoBȂfalseԂB
+	//! GUIXbhȂǁA̃XbhĂяoB
+	bool PopAction(WatchdogAction &action)
+	{
+		size_t const read = action_read_.load(boost::memory_order_relaxed);
+		if(read == action_write_.load(boost::memory_order_acquire)) { return false; }
+
+		action = actions_[read % ACTION_CAPACITY];
+		action_read_.store(read + 1, boost::memory_order_release);
+		return true;
+	}
+
+	std::string const &	GetName() const { return name_; }
+	State	GetState() const { return static_cast<State>(shared_state_.load(boost::memory_order_relaxed)); }
+
+	//! 蓖Ă𒴂
+	size_t	GetNumMisses() const { return num_misses_.load(boost::memory_order_relaxed); }
+	//! oCpXubN
+	size_t	GetNumBypassedBlocks() const { return num_bypassed_blocks_.load(boost::memory_order_relaxed); }
+	//! L^ꂸɎ̂Ă̐
+	size_t	GetNumDroppedActions() const { return num_dropped_actions_.load(boost::memory_order_relaxed); }
+
+	std::string ToString() const
+	{
+		static char const * const states[] = { "active", "bypassed", "ramping" };
+
+		std::ostringstream ss;
+		ss	<< name_ << ": " << states[GetState()]
+			<< ", misses " << GetNumMisses()
+			<< ", bypassed blocks " << GetNumBypassedBlocks()
+			<< ", max " << max_elapsed_usec_.load(boost::memory_order_relaxed) / 1000.0 << "ms";
+		return ss.str();
+	}
+
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		visit(static_cast<void *>(scratch_.data()), scratch_.size() * sizeof(float));
+		visit(static_cast<void *>(actions_.data()), actions_.size() * sizeof(WatchdogAction));
+	}
+
+private:
+	size_t count_misses() const
+	{
+		size_t n = 0;
+		for(boost::uint64_t h = history_; h != 0; h &= h - 1) { ++n; }
+		return n;
+	}
+
+	//! outputs = outputs * gain + bypass * (1 - gain)
+	//! gain̓ubN̐擪gain_begin疖gain_end܂ŒIɕωB
+	void crossfade(float * const *outputs, size_t frames, float gain_begin, float gain_end)
+	{
+		float const step = (gain_end - gain_begin) / frames;
+		for(size_t ch = 0; ch < scratch_heads_.size(); ++ch) {
+			float *out = outputs[ch];
+			float const *by = scratch_heads_[ch];
+			for(size_t i = 0; i < frames; ++i) {
+				float const gain = gain_begin + step * (i + 1);
+				out[i] = out[i] * gain + by[i] * (1.0f - gain);
+			}
+		}
+	}
+
+	void enter_bypass(WatchdogAction::Type type, double elapsed, double budget)
+	{
+		set_state(BYPASSING);
+		frames_until_probe_ = std::max<boost::uint64_t>(static_cast<boost::uint64_t>(backoff_msec_) * sampling_rate_ / 1000, 1);
+		stable_frames_ = 0;
+		report(type, elapsed, budget);
+		HWM_TRACE_INSTANT("watchdog bypass");
+	}
+
+	void set_state(State state)
+	{
+		state_ = state;
+		shared_state_.store(state, boost::memory_order_relaxed);
+	}
+
+	void report(WatchdogAction::Type type, double elapsed, double budget)
+	{
+		size_t const write = action_write_.load(boost::memory_order_relaxed);
+		if(write - action_read_.load(boost::memory_order_acquire) >= ACTION_CAPACITY) {
+			num_dropped_actions_.fetch_add(1, boost::memory_order_relaxed);
+			return;
+		}
+
+		WatchdogAction &action = actions_[write % ACTION_CAPACITY];
+		action.type = type;
+		action.block = num_blocks_;
+		action.misses = count_misses();
+		action.elapsed_msec = elapsed * 1000.0;
+		action.budget_msec = budget * 1000.0;
+		action.backoff_msec = backoff_msec_;
+		action_write_.store(write + 1, boost::memory_order_release);
+	}
+
+private:
+	std::string					name_;
+	size_t						sampling_rate_;
+	size_t						max_block_size_;
+	WatchdogSettings			settings_;
+	double						ticks_per_second_;
+	std::vector<float>			scratch_;
+	std::vector<float *>		scratch_heads_;
+
+	//! RunĂяoXbhg
+	State						state_;
+	boost::uint64_t				history_;
+	boost::uint64_t				num_blocks_;
+	boost::uint64_t				frames_until_probe_;
+	size_t						backoff_msec_;
+	size_t						ramp_pos_;
+	size_t						stable_frames_;
+	bool						recently_restored_;
+
+	//! ̋L^(PꐶYҁAP)
+	std::vector<WatchdogAction>	actions_;
+	boost::atomic<size_t>		action_write_;
+	boost::atomic<size_t>		action_read_;
+	boost::atomic<size_t>		num_dropped_actions_;
+
+	//! v
+	boost::atomic<size_t>		num_misses_;
+	boost::atomic<size_t>		num_bypassed_blocks_;
+	boost::atomic<size_t>		max_elapsed_usec_;
+	boost::atomic<int>			shared_state_;
+
+	PluginWatchdog(PluginWatchdog const &);
+	PluginWatchdog & operator=(PluginWatchdog const &);
+};
+
+}	//::hwm
@@ -0,0 +1,509 @@
+#pragma once
+
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+#include <dbghelp.h>
+
+#if defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+#pragma comment(lib, "dbghelp.lib")
+
+#include "./Denormal.hpp"
+#include "./ThreadRole.hpp"
+
+//! I[fBIXbh̃A^C𑹂Ȃo邽߂̃fobO@\
+//!
+//! foCX̃R[obN̒RealtimeScopeň͂łƁA
+//! ̊ԂɍsꂽmہAbN̎擾AubN\̂VXeR[A
+//! ĂяõX^bNg[XƉ񐔂ƂƂɋL^B
+//!
+//! o@͈ȉ̒ʂB
+//!  - zXggnew/malloc : fobOCRT̃AP[VtbN(_CrtSetAllocHook)
+//!  - zXggmutex : bN擾ӏɒuHWM_REALTIME_CHECK_LOCK
+//!  - vOC(ƃzXg)Win32 APIĂяo : W[̃C|[ge[u(IAT)āA
+//!    HeapAlloc, EnterCriticalSection, WaitForSingleObject, Sleep, CreateFile, ReadFileȂǂtbN
+//!
+//! ܂AFTZDAZݒ肵ĂȂXbhprocessReplacinǧĂяoARealtimeScope̊OłL^B
+//!
+//! ᔽ́AoXbh̖(ThreadRole)ƂɕċL^B
+//!
+//! HWM_REALTIME_CHECK`Ăꍇ̂ݗLɂȂB(Debug\Œ`Ă)
+
+namespace hwm {
+
+struct RealtimeChecker
+{
+	enum ViolationKind { ALLOCATION, LOCK, BLOCKING_CALL, DENORMALS };
+
+	enum {
+		CAPACITY = 256,		//! L^łᔽӏ(X^bNg[X)̐
+		MAX_FRAMES = 24		//! L^X^bNg[X̐[
+	};
+
+	static
+	RealtimeChecker & GetInstance()
+	{
+		static RealtimeChecker instance;
+		return instance;
+	}
+
+	//! ݂̃XbhRealtimeScope̒ɂ邩ǂ
+	static
+	bool IsInRealtimeScope() { return realtime_depth() > 0; }
+
+	void	SetEnabled(bool enabled) { enabled_ = enabled ? 1 : 0; }
+	bool	IsEnabled() const { return enabled_ != 0; }
+
+	//! L^ꂽᔽ̑
+	size_t	GetTotalCount() const { return static_cast<size_t>(total_); }
+
+	//! RealtimeScope̒ŌĂ΂ꂽꍇɈᔽƂċL^B
+	//! nameɂ͕񃊃eȂǁA؂ȂnB
+	void Check(ViolationKind kind, char const *name)
+	{
+		if(!enabled_ || !IsInRealtimeScope()) { return; }
+
+		//! L^̒tbNĂ΂Ă
+		int &guard = reentrancy_guard();
+		if(guard) { return; }
+		guard = 1;
+
+		Record(kind, name);
+
+		guard = 0;
+	}
+
+	//! ݂̃XbhFTZDAZݒ肳ĂȂ΁AᔽƂċL^
+	//! SetupAudioThreadDenormalScopeʂ炸ɃvOCĂяoXbh邽߁A
+	//! RealtimeScope̒ǂɊւ炸L^B
+	void CheckDenormals(char const *name)
+	{
+		if(!enabled_ || Denormal::IsFlushing()) { return; }
+
+		int &guard = reentrancy_guard();
+		if(guard) { return; }
+		guard = 1;
+
+		Record(DENORMALS, name);
+
+		guard = 0;
+	}
+
+	//! AP[VtbNݒ肵AzXgg̃W[IATtbNB
+	//! NAXbh쐬OɈxĂяoB
+	void Install()
+	{
+		init_originals();
+#if defined(_DEBUG)
+		_CrtSetAllocHook(&RealtimeChecker::crt_alloc_hook);
+#endif
+		HookModule(GetModuleHandleW(NULL));
+	}
+
+	//! w肵AhX܂ރW[(vOCDLLȂ)IATtbNB
+	bool HookModuleContaining(void const *address)
+	{
+		HMODULE module = NULL;
+		if(!GetModuleHandleExW(
+				GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+				static_cast<LPCWSTR>(address),
+				&module))
+		{
+			return false;
+		}
+		return HookModule(module);
+	}
+
+	//! W[̃C|[ge[ûAĎΏۂ̊֐̃GgtbN֐ɏA
+	//! tbNW[ƂċL^B
+	//! xꂽDLLAhXɓǂݍݒꂽꍇɂΉł悤A
+	//! L^ς݂̃W[łIAT͖񏑂B(͙p)
+	//! PluginSwapper̃[hXbhƃCXbh瓯ɌĂ΂邱ƂB
+	bool HookModule(HMODULE module)
+	{
+		init_originals();
+
+		ModuleLock lock(modules_cs_);
+
+		BYTE *base = reinterpret_cast<BYTE *>(module);
+		IMAGE_DOS_HEADER const *dos = reinterpret_cast<IMAGE_DOS_HEADER const *>(base);
+		if(dos->e_magic != IMAGE_DOS_SIGNATURE) { return false; }
+		IMAGE_NT_HEADERS const *nt = reinterpret_cast<IMAGE_NT_HEADERS const *>(base + dos->e_lfanew);
+		if(nt->Signature != IMAGE_NT_SIGNATURE) { return false; }
+
+		IMAGE_DATA_DIRECTORY const &dir = nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+		if(dir.VirtualAddress == 0) { return true; }
+
+		IMAGE_IMPORT_DESCRIPTOR const *desc = reinterpret_cast<IMAGE_IMPORT_DESCRIPTOR const *>(base + dir.VirtualAddress);
+		for( ; desc->Name; ++desc) {
+			if(!desc->OriginalFirstThunk) { continue; }
+
+			IMAGE_THUNK_DATA const *names = reinterpret_cast<IMAGE_THUNK_DATA const *>(base + desc->OriginalFirstThunk);
+			IMAGE_THUNK_DATA *addresses = reinterpret_cast<IMAGE_THUNK_DATA *>(base + desc->FirstThunk);
+
+			for( ; names->u1.AddressOfData; ++names, ++addresses) {
+				if(IMAGE_SNAP_BY_ORDINAL(names->u1.Ordinal)) { continue; }
+
+				IMAGE_IMPORT_BY_NAME const *import =
+					reinterpret_cast<IMAGE_IMPORT_BY_NAME const *>(base + names->u1.AddressOfData);
+				void *hook = find_hook(reinterpret_cast<char const *>(import->Name));
+				if(!hook) { continue; }
+
+				DWORD old_protect = 0;
+				if(VirtualProtect(&addresses->u1.Function, sizeof(addresses->u1.Function), PAGE_READWRITE, &old_protect)) {
+					addresses->u1.Function = reinterpret_cast<decltype(addresses->u1.Function)>(hook);
+					VirtualProtect(&addresses->u1.Function, sizeof(addresses->u1.Function), old_protect, &old_protect);
+				}
+			}
+		}
+
+		add_hooked_module(module);
+		return true;
+	}
+
+	//! ܂łɃtbNW[̐
+	size_t GetNumHookedModules()
+	{
+		ModuleLock lock(modules_cs_);
+		return hooked_modules_.size();
+	}
+
+	//! L^ᔽA񐔂ƃV{X^bNg[XƂƂɏoB
+	//! I[fBIXbhȊOĂяoƁB
+	void WriteReport(std::ostream &os)
+	{
+		int &guard = reentrancy_guard();
+		guard = 1;
+
+		HANDLE const process = GetCurrentProcess();
+		SymSetOptions(SymGetOptions() | SYMOPT_LOAD_LINES | SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+		SymInitialize(process, NULL, TRUE);
+
+		{
+			ModuleLock lock(modules_cs_);
+			os << "hooked modules: " << hooked_modules_.size() << std::endl;
+			for(size_t i = 0; i < hooked_modules_.size(); ++i) {
+				os << "    " << hooked_modules_[i] << std::endl;
+			}
+		}
+
+		os << "realtime violations: " << total_ << " (" << num_overflowed_ << " not recorded)" << std::endl;
+		for(size_t i = 0; i < CAPACITY; ++i) {
+			Violation const &v = violations_[i];
+			if(v.state != FILLED) { continue; }
+
+			os	<< std::endl
+				<< "[" << kind_name(v.kind) << "] " << v.name << " x " << v.count
+				<< " (" << ThreadRole::GetName(v.role) << " thread)" << std::endl;
+
+			for(size_t f = 0; f < v.num_frames; ++f) {
+				DWORD64 const address = reinterpret_cast<DWORD64>(v.frames[f]);
+				os << "    " << std::hex << v.frames[f] << std::dec << " ";
+
+				char buffer[sizeof(SYMBOL_INFO) + 256] = {};
+				SYMBOL_INFO *symbol = reinterpret_cast<SYMBOL_INFO *>(buffer);
+				symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+				symbol->MaxNameLen = 255;
+				DWORD64 displacement = 0;
+				if(SymFromAddr(process, address, &displacement, symbol)) {
+					os << symbol->Name << "+0x" << std::hex << displacement << std::dec;
+				} else {
+					char module_name[MAX_PATH] = {};
+					HMODULE module = NULL;
+					if(	GetModuleHandleExA(
+							GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+							static_cast<LPCSTR>(v.frames[f]), &module) &&
+						GetModuleFileNameA(module, module_name, MAX_PATH))
+					{
+						os << module_name << "+0x" << std::hex << (reinterpret_cast<BYTE *>(v.frames[f]) - reinterpret_cast<BYTE *>(module)) << std::dec;
+					} else {
+						os << "?";
+					}
+				}
+
+				IMAGEHLP_LINE64 line = {};
+				line.SizeOfStruct = sizeof(line);
+				DWORD line_displacement = 0;
+				if(SymGetLineFromAddr64(process, address, &line_displacement, &line)) {
+					os << " (" << line.FileName << ":" << line.LineNumber << ")";
+				}
+				os << std::endl;
+			}
+		}
+
+		SymCleanup(process);
+		guard = 0;
+	}
+
+	//! RealtimeScopeŎgp
+	static
+	int & realtime_depth()
+	{
+		static __declspec(thread) int depth = 0;
+		return depth;
+	}
+
+private:
+	enum { EMPTY = 0, FILLING = 1, FILLED = 2 };
+
+	struct Violation
+	{
+		LONG volatile	state;
+		LONG volatile	count;
+		ULONG			hash;
+		ViolationKind	kind;
+		char const *	name;
+		ThreadRole::Role	role;
+		USHORT			num_frames;
+		void *			frames[MAX_FRAMES];
+	};
+
+	RealtimeChecker()
+		:	enabled_(1)
+		,	total_(0)
+		,	num_overflowed_(0)
+		,	originals_initialized_(false)
+	{
+		std::memset(violations_, 0, sizeof(violations_));
+		std::memset(&originals_, 0, sizeof(originals_));
+		InitializeCriticalSection(&modules_cs_);
+	}
+
+	struct ModuleLock
+	{
+		explicit ModuleLock(CRITICAL_SECTION &cs) : cs_(cs) { EnterCriticalSection(&cs_); }
+		~ModuleLock() { LeaveCriticalSection(&cs_); }
+
+	private:
+		CRITICAL_SECTION &cs_;
+		ModuleLock(ModuleLock const &);
+		ModuleLock & operator=(ModuleLock const &);
+	};
+
+	//! modules_cs_擾ԂŌĂяo
+	void add_hooked_module(HMODULE module)
+	{
+		char module_name[MAX_PATH] = {};
+		if(!GetModuleFileNameA(module, module_name, MAX_PATH)) { return; }
+
+		std::string const name = module_name;
+		for(size_t i = 0; i < hooked_modules_.size(); ++i) {
+			if(hooked_modules_[i] == name) { return; }
+		}
+		hooked_modules_.push_back(name);
+	}
+
+	//! X^bNg[X̃nbVL[ɂI[vAhX@̃e[uɋL^B
+	//! I[fBIXbhĂ΂̂ŁAmۂbNsȂB
+	void Record(ViolationKind kind, char const *name)
+	{
+		InterlockedIncrement(&total_);
+
+		void *frames[MAX_FRAMES];
+		ULONG hash = 0;
+		//! Record, Check, tbN֐̕ǂݔ΂
+		USHORT const num_frames = CaptureStackBackTrace(3, MAX_FRAMES, frames, &hash);
+		hash ^= static_cast<ULONG>(reinterpret_cast<ULONG_PTR>(name) * 2654435761u);
+		ThreadRole::Role const role = ThreadRole::GetCurrent();
+		hash ^= static_cast<ULONG>(role) * 0x9E3779B9u;
+
+		for(size_t probe = 0; probe < CAPACITY; ++probe) {
+			Violation &v = violations_[(hash + probe) % CAPACITY];
+
+			if(v.state == FILLED && v.hash == hash && v.name == name && v.role == role) {
+				InterlockedIncrement(&v.count);
+				return;
+			}
+
+			if(v.state == EMPTY && InterlockedCompareExchange(&v.state, FILLING, EMPTY) == EMPTY) {
+				v.hash = hash;
+				v.kind = kind;
+				v.name = name;
+				v.role = role;
+				v.num_frames = num_frames;
+				std::memcpy(v.frames, frames, num_frames * sizeof(void *));
+				v.count = 1;
+				MemoryBarrier();
+				v.state = FILLED;
+				return;
+			}
+		}
+
+		InterlockedIncrement(&num_overflowed_);
+	}
+
+	static
+	int & reentrancy_guard()
+	{
+		static __declspec(thread) int guard = 0;
+		return guard;
+	}
+
+	static
+	char const * kind_name(ViolationKind kind)
+	{
+		switch(kind) {
+			case ALLOCATION:	return "allocation";
+			case LOCK:			return "lock";
+			case DENORMALS:		return "denormals";
+			default:			return "blocking call";
+		}
+	}
+
+#if defined(_DEBUG)
+	static
+	int __cdecl crt_alloc_hook(int alloc_type, void *, size_t, int, long, unsigned char const *, int)
+	{
+		if(alloc_type == _HOOK_ALLOC || alloc_type == _HOOK_REALLOC) {
+			GetInstance().Check(ALLOCATION, "malloc/new");
+		} else if(alloc_type == _HOOK_FREE) {
+			GetInstance().Check(ALLOCATION, "free/delete");
+		}
+		return TRUE;
+	}
+#endif
+
+	//! tbN֐̌̃AhX
+	struct Originals
+	{
+		LPVOID	(WINAPI *HeapAlloc)(HANDLE, DWORD, SIZE_T);
+		LPVOID	(WINAPI *HeapReAlloc)(HANDLE, DWORD, LPVOID, SIZE_T);
+		BOOL	(WINAPI *HeapFree)(HANDLE, DWORD, LPVOID);
+		LPVOID	(WINAPI *VirtualAlloc)(LPVOID, SIZE_T, DWORD, DWORD);
+		BOOL	(WINAPI *VirtualFree)(LPVOID, SIZE_T, DWORD);
+		void	(WINAPI *EnterCriticalSection)(LPCRITICAL_SECTION);
+		void	(WINAPI *AcquireSRWLockExclusive)(PSRWLOCK);
+		void	(WINAPI *AcquireSRWLockShared)(PSRWLOCK);
+		DWORD	(WINAPI *WaitForSingleObject)(HANDLE, DWORD);
+		DWORD	(WINAPI *WaitForSingleObjectEx)(HANDLE, DWORD, BOOL);
+		DWORD	(WINAPI *WaitForMultipleObjects)(DWORD, HANDLE const *, BOOL, DWORD);
+		void	(WINAPI *Sleep)(DWORD);
+		DWORD	(WINAPI *SleepEx)(DWORD, BOOL);
+		HANDLE	(WINAPI *CreateFileA)(LPCSTR, DWORD, DWORD, LPSECURITY_ATTRIBUTES, DWORD, DWORD, HANDLE);
+		HANDLE	(WINAPI *CreateFileW)(LPCWSTR, DWORD, DWORD, LPSECURITY_ATTRIBUTES, DWORD, DWORD, HANDLE);
+		BOOL	(WINAPI *ReadFile)(HANDLE, LPVOID, DWORD, LPDWORD, LPOVERLAPPED);
+		BOOL	(WINAPI *WriteFile)(HANDLE, LPCVOID, DWORD, LPDWORD, LPOVERLAPPED);
+	};
+
+	static Originals const & original() { return GetInstance().originals_; }
+
+	static LPVOID WINAPI hook_HeapAlloc(HANDLE h, DWORD f, SIZE_T n)				{ GetInstance().Check(ALLOCATION, "HeapAlloc"); return original().HeapAlloc(h, f, n); }
+	static LPVOID WINAPI hook_HeapReAlloc(HANDLE h, DWORD f, LPVOID p, SIZE_T n)	{ GetInstance().Check(ALLOCATION, "HeapReAlloc"); return original().HeapReAlloc(h, f, p, n); }
+	static BOOL WINAPI hook_HeapFree(HANDLE h, DWORD f, LPVOID p)					{ GetInstance().Check(ALLOCATION, "HeapFree"); return original().HeapFree(h, f, p); }
+	static LPVOID WINAPI hook_VirtualAlloc(LPVOID p, SIZE_T n, DWORD t, DWORD r)	{ GetInstance().Check(ALLOCATION, "VirtualAlloc"); return original().VirtualAlloc(p, n, t, r); }
+	static BOOL WINAPI hook_VirtualFree(LPVOID p, SIZE_T n, DWORD t)				{ GetInstance().Check(ALLOCATION, "VirtualFree"); return original().VirtualFree(p, n, t); }
+	static void WINAPI hook_EnterCriticalSection(LPCRITICAL_SECTION cs)			{ GetInstance().Check(LOCK, "EnterCriticalSection"); original().EnterCriticalSection(cs); }
+	static void WINAPI hook_AcquireSRWLockExclusive(PSRWLOCK l)					{ GetInstance().Check(LOCK, "AcquireSRWLockExclusive"); original().AcquireSRWLockExclusive(l); }
+	static void WINAPI hook_AcquireSRWLockShared(PSRWLOCK l)						{ GetInstance().Check(LOCK, "AcquireSRWLockShared"); original().AcquireSRWLockShared(l); }
+	static DWORD WINAPI hook_WaitForSingleObject(HANDLE h, DWORD t)				{ GetInstance().Check(LOCK, "WaitForSingleObject"); return original().WaitForSingleObject(h, t); }
+	static DWORD WINAPI hook_WaitForSingleObjectEx(HANDLE h, DWORD t, BOOL a)		{ GetInstance().Check(LOCK, "WaitForSingleObjectEx"); return original().WaitForSingleObjectEx(h, t, a); }
+	static DWORD WINAPI hook_WaitForMultipleObjects(DWORD n, HANDLE const *h, BOOL w, DWORD t) { GetInstance().Check(LOCK, "WaitForMultipleObjects"); return original().WaitForMultipleObjects(n, h, w, t); }
+	static void WINAPI hook_Sleep(DWORD t)											{ GetInstance().Check(BLOCKING_CALL, "Sleep"); original().Sleep(t); }
+	static DWORD WINAPI hook_SleepEx(DWORD t, BOOL a)								{ GetInstance().Check(BLOCKING_CALL, "SleepEx"); return original().SleepEx(t, a); }
+	static HANDLE WINAPI hook_CreateFileA(LPCSTR n, DWORD a, DWORD s, LPSECURITY_ATTRIBUTES sa, DWORD c, DWORD f, HANDLE t) { GetInstance().Check(BLOCKING_CALL, "CreateFileA"); return original().CreateFileA(n, a, s, sa, c, f, t); }
+	static HANDLE WINAPI hook_CreateFileW(LPCWSTR n, DWORD a, DWORD s, LPSECURITY_ATTRIBUTES sa, DWORD c, DWORD f, HANDLE t) { GetInstance().Check(BLOCKING_CALL, "CreateFileW"); return original().CreateFileW(n, a, s, sa, c, f, t); }
+	static BOOL WINAPI hook_ReadFile(HANDLE h, LPVOID b, DWORD n, LPDWORD r, LPOVERLAPPED o)		{ GetInstance().Check(BLOCKING_CALL, "ReadFile"); return original().ReadFile(h, b, n, r, o); }
+	static BOOL WINAPI hook_WriteFile(HANDLE h, LPCVOID b, DWORD n, LPDWORD w, LPOVERLAPPED o)	{ GetInstance().Check(BLOCKING_CALL, "WriteFile"); return original().WriteFile(h, b, n, w, o); }
+
+	void init_originals()
+	{
+		if(originals_initialized_) { return; }
+
+		HMODULE const kernel32 = GetModuleHandleW(L"kernel32.dll");
+#define HWM_REALTIME_CHECKER_RESOLVE(name) \
+		originals_.name = reinterpret_cast<decltype(originals_.name)>(GetProcAddress(kernel32, #name))
+
+		HWM_REALTIME_CHECKER_RESOLVE(HeapAlloc);
+		HWM_REALTIME_CHECKER_RESOLVE(HeapReAlloc);
+		HWM_REALTIME_CHECKER_RESOLVE(HeapFree);
+		HWM_REALTIME_CHECKER_RESOLVE(VirtualAlloc);
+		HWM_REALTIME_CHECKER_RESOLVE(VirtualFree);
+		HWM_REALTIME_CHECKER_RESOLVE(EnterCriticalSection);
+		HWM_REALTIME_CHECKER_RESOLVE(AcquireSRWLockExclusive);
+		HWM_REALTIME_CHECKER_RESOLVE(AcquireSRWLockShared);
+		HWM_REALTIME_CHECKER_RESOLVE(WaitForSingleObject);
+		HWM_REALTIME_CHECKER_RESOLVE(WaitForSingleObjectEx);
+		HWM_REALTIME_CHECKER_RESOLVE(WaitForMultipleObjects);
+		HWM_REALTIME_CHECKER_RESOLVE(Sleep);
+		HWM_REALTIME_CHECKER_RESOLVE(SleepEx);
+		HWM_REALTIME_CHECKER_RESOLVE(CreateFileA);
+		HWM_REALTIME_CHECKER_RESOLVE(CreateFileW);
+		HWM_REALTIME_CHECKER_RESOLVE(ReadFile);
+		HWM_REALTIME_CHECKER_RESOLVE(WriteFile);
+
+#undef HWM_REALTIME_CHECKER_RESOLVE
+		originals_initialized_ = true;
+	}
+
+	//! C|[gɑΉtbN֐ԂBĎΏۂłȂnullptrB
+	void * find_hook(char const *name) const
+	{
+		struct Entry { char const *name; void *hook; };
+		Entry const table[] = {
+			{ "HeapAlloc",					reinterpret_cast<void *>(&hook_HeapAlloc) },
+			{ "HeapReAlloc",				reinterpret_cast<void *>(&hook_HeapReAlloc) },
+			{ "HeapFree",					reinterpret_cast<void *>(&hook_HeapFree) },
+			{ "VirtualAlloc",				reinterpret_cast<void *>(&hook_VirtualAlloc) },
+			{ "VirtualFree",				reinterpret_cast<void *>(&hook_VirtualFree) },
+			{ "EnterCriticalSection",		reinterpret_cast<void *>(&hook_EnterCriticalSection) },
+			{ "AcquireSRWLockExclusive",	reinterpret_cast<void *>(&hook_AcquireSRWLockExclusive) },
+			{ "AcquireSRWLockShared",		reinterpret_cast<void *>(&hook_AcquireSRWLockShared) },
+			{ "WaitForSingleObject",		reinterpret_cast<void *>(&hook_WaitForSingleObject) },
+			{ "WaitForSingleObjectEx",		reinterpret_cast<void *>(&hook_WaitForSingleObjectEx) },
+			{ "WaitForMultipleObjects",		reinterpret_cast<void *>(&hook_WaitForMultipleObjects) },
+			{ "Sleep",						reinterpret_cast<void *>(&hook_Sleep) },
+			{ "SleepEx",					reinterpret_cast<void *>(&hook_SleepEx) },
+			{ "CreateFileA",				reinterpret_cast<void *>(&hook_CreateFileA) },
+			{ "CreateFileW",				reinterpret_cast<void *>(&hook_CreateFileW) },
+			{ "ReadFile",					reinterpret_cast<void *>(&hook_ReadFile) },
+			{ "WriteFile",					reinterpret_cast<void *>(&hook_WriteFile) },
+		};
+
+		for(size_t i = 0; i < sizeof(table) / sizeof(table[0]); ++i) {
+			if(std::strcmp(table[i].name, name) == 0) { return table[i].hook; }
+		}
+		return nullptr;
+	}
+
+private:
+	LONG volatile	enabled_;
+	LONG volatile	total_;
+	LONG volatile	num_overflowed_;
+	bool			originals_initialized_;
+	Originals		originals_;
+	CRITICAL_SECTION	modules_cs_;
+	std::vector<std::string>	hooked_modules_;	//! tbNW[̃pX
+	Violation		violations_[CAPACITY];
+};
+
+//! ̃IuWFNgĂԁÃ݂XbhA^CƂĈ
+struct RealtimeScope
+{
+	RealtimeScope()		{ ++RealtimeChecker::realtime_depth(); }
+	~RealtimeScope()	{ --RealtimeChecker::realtime_depth(); }
+
+private:
+	RealtimeScope(RealtimeScope const &);
+	RealtimeScope & operator=(RealtimeScope const &);
+};
+
+}	//::hwm
+
+#if defined(HWM_REALTIME_CHECK)
+	//! foCX̃R[obNȂǁAA^CKvȏ͈̔͂
+	#define HWM_REALTIME_SCOPE() ::hwm::RealtimeScope hwm_realtime_scope_
+	//! zXggmutexȂǂ̃bN擾ӏɒu
+	#define HWM_REALTIME_CHECK_LOCK(name) ::hwm::RealtimeChecker::GetInstance().Check(::hwm::RealtimeChecker::LOCK, name)
+	//! vOC̍Ăяoӏɒu
+	#define HWM_REALTIME_CHECK_DENORMALS(name) ::hwm::RealtimeChecker::GetInstance().CheckDenormals(name)
+#else
+	#define HWM_REALTIME_SCOPE() ((void)0)
+	#define HWM_REALTIME_CHECK_LOCK(name) ((void)0)
+	#define HWM_REALTIME_CHECK_DENORMALS(name) ((void)0)
+#endif
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread.hpp>
+
+#include "./ThreadRole.hpp"
+#include "./Trace.hpp"
+#include "./WaveFile.hpp"
+
+namespace hwm {
+
+//! Đ̃I[fBIf[^t@Cɘ^NX
+//!
+//! foCX̃R[obNł́APushōς݂̃f[^炩ߊmۂOobt@ɃRs[邾ŁA
+//! t@Cւ݂̏͏݃XbhsB
+//! ݃Xbh́AOobt@ɗ܂f[^܂Ƃ߂ăC^[[uA
+//! WRITE_CHUNK_FRAMESPʂ̑傫ȘA݂Ƃăt@CɏoB
+//!
+//! ݂Ԃɍ킸Oobt@ɋ󂫂ȂꍇAPushꂽubN͎̂ĂA
+//! ̉(I[o[)ƃt[L^B
+struct Recorder
+{
+	enum { WRITE_CHUNK_FRAMES = 32 * 1024 };
+
+	//! channels		: ^`l
+	//! sampling_rate	: t@CɋL^TvO[g
+	//! ring_frames		: Oobt@̑傫(t[)B݃Xbh̒x̕złB
+	Recorder(size_t channels, size_t sampling_rate, size_t ring_frames)
+		:	channels_(channels)
+		,	sampling_rate_(sampling_rate)
+		,	capacity_(ring_frames)
+		,	write_index_(0)
+		,	read_index_(0)
+		,	recording_(false)
+		,	terminated_(false)
+		,	num_overruns_(0)
+		,	num_dropped_frames_(0)
+		,	max_fill_(0)
+		,	num_recorded_frames_(0)
+	{
+		BOOST_ASSERT(channels > 0);
+		BOOST_ASSERT(ring_frames >= WRITE_CHUNK_FRAMES);
+
+		ring_.resize(channels);
+		for(size_t ch = 0; ch < channels; ++ch) {
+			ring_[ch].assign(capacity_, 0.0f);
+		}
+	}
+
+	~Recorder()
+	{
+		try {
+			Stop();
+		} catch(...) {}
+	}
+
+	//! ^Jn
+	//! GUIXbhĂяoBt@C͂ō쐬B
+	//! with_headerfalseȂwb_Ȃrawt@CƂďoB
+	void Start(wchar_t const *path, WaveFormat::SampleType sample_type, bool with_header)
+	{
+		BOOST_ASSERT(!write_thread_.joinable());
+
+		WaveFormat const format(channels_, sampling_rate_, sample_type);
+		writer_.reset(new WaveFileWriter(path, format, with_header));
+		chunk_.resize(WRITE_CHUNK_FRAMES * format.GetBlockAlign());
+
+		//! O̘^~߂Pushꂽ͎̂Ă
+		read_index_.store(write_index_.load(boost::memory_order_acquire), boost::memory_order_release);
+		num_overruns_ = 0;
+		num_dropped_frames_ = 0;
+		max_fill_ = 0;
+		error_ = boost::none;
+
+		terminated_ = false;
+		write_thread_ = boost::thread([this] { WriteThread(); });
+		recording_.store(true, boost::memory_order_release);
+	}
+
+	//! ^~AOobt@ɎcĂ镪oĂt@C
+	//! ݒɃG[Ăꍇ́Astd::runtime_error𓊂B
+	void Stop()
+	{
+		if(!write_thread_.joinable()) { return; }
+
+		recording_.store(false, boost::memory_order_release);
+		terminated_ = true;
+		write_thread_.join();
+
+		writer_->Close();
+		writer_.reset();
+
+		boost::unique_lock<boost::mutex> lock(error_mutex_);
+		if(error_) { throw std::runtime_error(*error_); }
+	}
+
+	bool IsRecording() const { return write_thread_.joinable(); }
+
+	//! f[^^
+	//! foCX̃R[obNĂяoBmہAbNAt@CANZXsȂB
+	//! src̃`l^`l菭ȂꍇAȂ`l͖ɂȂB
+	void Push(float const * const *src, size_t num_src_channels, size_t frames)
+	{
+		if(!recording_.load(boost::memory_order_acquire)) { return; }
+
+		size_t const write = write_index_.load(boost::memory_order_relaxed);
+		size_t const fill = write - read_index_.load(boost::memory_order_acquire);
+		if(frames > capacity_ - fill) {
+			num_overruns_.fetch_add(1, boost::memory_order_relaxed);
+			num_dropped_frames_.fetch_add(frames, boost::memory_order_relaxed);
+			return;
+		}
+
+		size_t const pos = write % capacity_;
+		size_t const first = std::min<size_t>(frames, capacity_ - pos);
+		for(size_t ch = 0; ch < channels_; ++ch) {
+			float *ring = ring_[ch].data();
+			if(ch < num_src_channels) {
+				std::memcpy(ring + pos, src[ch], first * sizeof(float));
+				std::memcpy(ring, src[ch] + first, (frames - first) * sizeof(float));
+			} else {
+				std::fill(ring + pos, ring + pos + first, 0.0f);
+				std::fill(ring, ring + (frames - first), 0.0f);
+			}
+		}
+		write_index_.store(write + frames, boost::memory_order_release);
+
+		if(fill + frames > max_fill_.load(boost::memory_order_relaxed)) {
+			max_fill_.store(fill + frames, boost::memory_order_relaxed);
+		}
+	}
+
+	//! t@Cɏot[
+	boost::uint64_t	GetNumRecordedFrames() const { return num_recorded_frames_.load(boost::memory_order_relaxed); }
+
+	//! Oobt@ɋ󂫂ȂAubN̂Ă
+	size_t	GetNumOverruns() const { return num_overruns_.load(boost::memory_order_relaxed); }
+
+	//! ̂Ăt[
+	size_t	GetNumDroppedFrames() const { return num_dropped_frames_.load(boost::memory_order_relaxed); }
+
+	std::string ToString() const
+	{
+		std::ostringstream ss;
+		ss	<< (IsRecording() ? "REC " : "")
+			<< static_cast<double>(GetNumRecordedFrames()) / sampling_rate_ << "sec"
+			<< ", overruns " << GetNumOverruns()
+			<< ", ring max " << (max_fill_.load(boost::memory_order_relaxed) * 100 / capacity_) << "%";
+		return ss.str();
+	}
+
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		for(auto &buffer: ring_) {
+			visit(static_cast<void *>(buffer.data()), buffer.size() * sizeof(float));
+		}
+	}
+
+private:
+	//! ܂f[^WRITE_CHUNK_FRAMESoB
+	//! ~́A܂Ă镪ׂďoĂIB
+	void WriteThread()
+	{
+		ThreadRole::SetCurrent(ThreadRole::WORKER);
+		HWM_TRACE_THREAD("Recorder");
+		num_recorded_frames_ = 0;
+
+		try {
+			for( ; ; ) {
+				bool const stopping = terminated_;
+
+				size_t const available = write_index_.load(boost::memory_order_acquire) - read_index_.load(boost::memory_order_relaxed);
+				if(available >= WRITE_CHUNK_FRAMES || (stopping && available > 0)) {
+					write_chunk(std::min<size_t>(available, WRITE_CHUNK_FRAMES));
+					continue;
+				}
+				if(stopping) { break; }
+
+				boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+			}
+		} catch(std::exception &e) {
+			recording_.store(false, boost::memory_order_release);
+			boost::unique_lock<boost::mutex> lock(error_mutex_);
+			error_ = std::string(e.what());
+		}
+	}
+
+	void write_chunk(size_t frames)
+	{
+		HWM_TRACE_SCOPE("record chunk");
+		size_t const read = read_index_.load(boost::memory_order_relaxed);
+		size_t const pos = read % capacity_;
+		size_t const first = std::min<size_t>(frames, capacity_ - pos);
+		WaveFormat const &format = writer_->GetFormat();
+
+		float const *heads[64];
+		BOOST_ASSERT(channels_ <= 64);
+
+		for(size_t ch = 0; ch < channels_; ++ch) { heads[ch] = ring_[ch].data() + pos; }
+		WaveFileWriter::Interleave(heads, channels_, first, format, chunk_.data());
+
+		for(size_t ch = 0; ch < channels_; ++ch) { heads[ch] = ring_[ch].data(); }
+		WaveFileWriter::Interleave(heads, channels_, frames - first, format, chunk_.data() + first * format.GetBlockAlign());
+
+		read_index_.store(read + frames, boost::memory_order_release);
+
+		writer_->WriteRaw(chunk_.data(), frames * format.GetBlockAlign());
+		num_recorded_frames_.fetch_add(frames, boost::memory_order_relaxed);
+	}
+
+private:
+	size_t								channels_;
+	size_t								sampling_rate_;
+	size_t								capacity_;
+	std::vector<std::vector<float>>		ring_;
+	std::vector<unsigned char>			chunk_;
+	std::unique_ptr<WaveFileWriter>		writer_;
+	boost::thread						write_thread_;
+
+	boost::atomic<size_t>				write_index_;
+	boost::atomic<size_t>				read_index_;
+	boost::atomic<bool>					recording_;
+	boost::atomic<bool>					terminated_;
+
+	boost::atomic<size_t>				num_overruns_;
+	boost::atomic<size_t>				num_dropped_frames_;
+	boost::atomic<size_t>				max_fill_;
+	boost::atomic<boost::uint64_t>		num_recorded_frames_;
+
+	boost::mutex						error_mutex_;
+	boost::optional<std::string>		error_;
+
+	Recorder(Recorder const &);
+	Recorder & operator=(Recorder const &);
+};
+
+}	//::hwm
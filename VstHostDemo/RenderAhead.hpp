@@ -0,0 +1,417 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include <windows.h>
+#include <mmsystem.h>
+
+#pragma comment(lib, "winmm.lib")
+
+#include "./AudioThread.hpp"
+#include "./ThreadRole.hpp"
+#include "./Trace.hpp"
+
+namespace hwm {
+
+//! s̐ݒ
+struct RenderAheadSettings
+{
+	RenderAheadSettings()
+		:	ahead_blocks(8)
+		,	live_blocks(1)
+		,	live_hold_msec(1000)
+		,	fade_frames(64)
+	{}
+
+	//! ʏ펞ɐsčĂubN(live_blocks傫lɂ)
+	//! foCẌ̗vŎoubN(RenderAheadmax_pull_frames)́AƂ͕ʂɊmۂB
+	size_t	ahead_blocks;
+	//! tɐsčĂubN
+	//! CuCxg󂯎ƁA𒴂ĐsĂ̂ĂčB
+	size_t	live_blocks;
+	//! Ō̃CuCxgA̎Ԃo܂ł͉tƂĈ
+	size_t	live_hold_msec;
+	//! ̂ĂƍȂNXtF[h̒
+	size_t	fade_frames;
+};
+
+//! s̓v
+struct RenderAheadStats
+{
+	size_t	num_rendered_blocks;	//! ubN
+	size_t	num_drains;				//! foCX̗vɃOobt@ɂȂĂ
+	size_t	num_flushes;			//! CuCxgŐŝĂ
+	size_t	num_discarded_blocks;	//! ̂ĂubN
+	size_t	min_fill_blocks;		//! foCX̗vɗ܂ĂubN̍ŏl
+	double	max_render_msec;		//! [J[Xbhł1ubN̍Ԃ̍ől
+
+	std::string ToString() const
+	{
+		std::ostringstream ss;
+		ss	<< "render ahead: drains " << num_drains
+			<< ", min fill " << min_fill_blocks
+			<< ", re-render " << num_flushes << "(" << num_discarded_blocks << " blocks)"
+			<< ", max " << max_render_msec << "ms";
+		return ss.str();
+	}
+};
+
+//! [J[XbhŐubN܂ōĂAfoCX̃R[obNł͂oɂNX
+//!
+//! ʂ̓bNt[̃Oobt@(PꐶYҁAP)Ŏ󂯓n̂ŁA
+//! ̍xꂽAprocess_mutexێꂽ肵ĂA
+//! scĂfoCXւ͓̋r؂ȂB
+//!
+//! sƁAՂĂ特o܂ł̒x傫ȂB
+//! ŁACuCxg󂯎(NotifyLiveEvent)A
+//! ŝlive_blocks𒴂镔̂āACxg𔽉fčubNɐ؂ւB
+//! ubN܂łĂȂ΁Aꂪł܂ł͎̂Ă\̃ubNĐ̂ŁA
+//! ؂ւ̂߂ɉr؂邱Ƃ͂ȂB
+//! ؂ւɂ́ÂĂubN̐擪ƐVubN̐擪NXtF[hB
+//! ܂t́Asčʂlive_blocksɗ}B
+//!
+//! foCX̃R[obN̓[J[XbhNȂ(SetEventȂǂ̃J[lĂяo)B
+//! [J[Xbh͒ZԊu(POLL_MSEC)ŃOobt@̋󂫂𒲂ׂB
+//! ̂߁A[J[XbhĂԂ́A^C}[̕\1msɂĂB
+struct RenderAhead
+{
+	typedef std::function<float const * const * ()> render_function_t;
+
+	//! [J[XbhOobt@̋󂫂𒲂ׂԊu
+	enum { POLL_MSEC = 1 };
+
+	//! channels		: `l
+	//! block_size		: render_functionxɕԂt[
+	//! max_pull_frames	: xPullŗvt[̍ől(foCX̃obt@)
+	RenderAhead(size_t channels, size_t block_size, size_t max_pull_frames, RenderAheadSettings const &settings)
+		:	channels_(channels)
+		,	block_size_(block_size)
+		,	settings_(settings)
+		,	pull_blocks_((std::max<size_t>(max_pull_frames, 1) + block_size - 1) / block_size)
+		,	num_slots_(settings.ahead_blocks + pull_blocks_ + 1)
+		,	write_index_(0)
+		,	read_index_(0)
+		,	flush_generation_(0)
+		,	last_live_event_tick_(0)
+		,	terminated_(false)
+		,	read_(0)
+		,	offset_(0)
+		,	has_current_(false)
+		,	seen_generation_(0)
+		,	flush_pending_(false)
+		,	keep_remaining_(0)
+		,	fade_pending_(false)
+		,	num_rendered_blocks_(0)
+		,	num_drains_(0)
+		,	num_flushes_(0)
+		,	num_discarded_blocks_(0)
+		,	min_fill_blocks_(settings.ahead_blocks + pull_blocks_)
+		,	max_render_usec_(0)
+	{
+		BOOST_ASSERT(block_size > 0);
+		BOOST_ASSERT(settings.ahead_blocks > settings.live_blocks);
+
+		settings_.fade_frames = std::min<size_t>(settings_.fade_frames, block_size);
+		slots_.assign(num_slots_ * channels * block_size, 0.0f);
+		tags_.assign(num_slots_, 0);
+		fade_buffer_.assign(channels * std::max<size_t>(settings_.fade_frames, 1), 0.0f);
+
+		wake_event_ = CreateEventW(NULL, FALSE, FALSE, NULL);
+		if(!wake_event_) { throw std::runtime_error("failed to create an event"); }
+	}
+
+	~RenderAhead()
+	{
+		Stop();
+		CloseHandle(wake_event_);
+	}
+
+	//! [J[XbhJnAs܂܂(ő1b)҂
+	//! render()́Ablock_sizet[̃f[^`l̔zƂĕԂ֐B
+	//! process_mutexȂǂ̃bŃAfoCX̃R[obNł͂Ȃrender()̒ŎB
+	void Start(render_function_t render, AudioThreadSettings const &thread_settings)
+	{
+		BOOST_ASSERT(!worker_.joinable());
+
+		render_ = render;
+		terminated_ = false;
+		worker_ = boost::thread([this, thread_settings] {
+			SetupAudioThread(thread_settings);
+			ThreadRole::SetCurrent(ThreadRole::PREFETCH);
+			HWM_TRACE_THREAD("RenderAhead");
+			timeBeginPeriod(1);
+			WorkerThread();
+			timeEndPeriod(1);
+		});
+
+		for(size_t i = 0; i < 1000 && GetFill() < settings_.ahead_blocks + pull_blocks_; ++i) {
+			Sleep(1);
+		}
+	}
+
+	void Stop()
+	{
+		if(!worker_.joinable()) { return; }
+		terminated_ = true;
+		SetEvent(wake_event_);
+		worker_.join();
+	}
+
+	//! CuCxg(Ղ̑Ȃ)VstPluginɒǉŌĂяo
+	//! GUIXbhĂяoB
+	void NotifyLiveEvent()
+	{
+		last_live_event_tick_.store(GetTickCount(), boost::memory_order_relaxed);
+		flush_generation_.fetch_add(1, boost::memory_order_acq_rel);
+		SetEvent(wake_event_);
+	}
+
+	//! dest[ch][0 .. frames)s疄߂
+	//! foCX̃R[obNĂяoBmۂbNAJ[ľĂяosȂB
+	void Pull(float * const *dest, size_t frames)
+	{
+		unsigned int const generation = flush_generation_.load(boost::memory_order_acquire);
+		if(generation != seen_generation_) {
+			seen_generation_ = generation;
+			flush_pending_ = true;
+			keep_remaining_ = settings_.live_blocks;
+		}
+
+		size_t const fill = write_index_.load(boost::memory_order_acquire) - read_;
+		if(fill < min_fill_blocks_.load(boost::memory_order_relaxed)) {
+			min_fill_blocks_.store(fill, boost::memory_order_relaxed);
+		}
+
+		size_t done = 0;
+		while(done < frames) {
+			if(!has_current_ && !select_next_block()) {
+				//! sg؂
+				for(size_t ch = 0; ch < channels_; ++ch) {
+					std::fill(dest[ch] + done, dest[ch] + frames, 0.0f);
+				}
+				num_drains_.fetch_add(1, boost::memory_order_relaxed);
+				HWM_TRACE_INSTANT("render ahead drain");
+				fade_pending_ = false;
+				break;
+			}
+
+			size_t const chunk = std::min<size_t>(frames - done, block_size_ - offset_);
+			for(size_t ch = 0; ch < channels_; ++ch) {
+				float const *src = block_data(read_, ch) + offset_;
+				std::memcpy(dest[ch] + done, src, chunk * sizeof(float));
+			}
+
+			if(fade_pending_) {
+				apply_crossfade(dest, done, chunk);
+			}
+
+			offset_ += chunk;
+			done += chunk;
+
+			if(offset_ == block_size_) {
+				release_current_block();
+			}
+		}
+	}
+
+	//! ܂ĂubN
+	size_t GetFill() const
+	{
+		return write_index_.load(boost::memory_order_acquire) - read_index_.load(boost::memory_order_acquire);
+	}
+
+	RenderAheadStats GetStats() const
+	{
+		RenderAheadStats stats;
+		stats.num_rendered_blocks = num_rendered_blocks_.load(boost::memory_order_relaxed);
+		stats.num_drains = num_drains_.load(boost::memory_order_relaxed);
+		stats.num_flushes = num_flushes_.load(boost::memory_order_relaxed);
+		stats.num_discarded_blocks = num_discarded_blocks_.load(boost::memory_order_relaxed);
+		stats.min_fill_blocks = min_fill_blocks_.load(boost::memory_order_relaxed);
+		stats.max_render_msec = max_render_usec_.load(boost::memory_order_relaxed) / 1000.0;
+		return stats;
+	}
+
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		visit(static_cast<void *>(slots_.data()), slots_.size() * sizeof(float));
+		visit(static_cast<void *>(fade_buffer_.data()), fade_buffer_.size() * sizeof(float));
+	}
+
+private:
+	float *	block_data(size_t index, size_t ch)
+	{
+		return slots_.data() + ((index % num_slots_) * channels_ + ch) * block_size_;
+	}
+
+	//! tags_[index]̃ubNAŌɎ󂯎CuCxgOɍn߂̂ǂ
+	bool	is_stale(size_t index) const
+	{
+		return static_cast<int>(tags_[index % num_slots_] - seen_generation_) < 0;
+	}
+
+	//! ɍĐubNI
+	//! CuCxgȑOɍꂽubN̂Alive_blocks𒴂镪́A
+	//! ̌ɃCxg𔽉fčubNAxPull̕(pull_blocks_)łĂ΂Ŏ̂ĂB
+	//! ܂łĂȂ΁ÂĂɂ̂܂܍ĐÃubN̋EłxׂB
+	bool select_next_block()
+	{
+		size_t const write = write_index_.load(boost::memory_order_acquire);
+		if(read_ == write) { return false; }
+
+		if(flush_pending_) {
+			if(!is_stale(read_)) {
+				flush_pending_ = false;
+			} else if(keep_remaining_ > 0) {
+				--keep_remaining_;
+			} else {
+				size_t fresh = read_;
+				while(fresh != write && is_stale(fresh)) { ++fresh; }
+
+				if(write - fresh >= pull_blocks_) {
+					//! ŏɎ̂ĂubN̐擪́A܂ōĐĂ̑Ȃ̂ŁA
+					//! VubNƂ̃NXtF[ĥ߂ɎĂB
+					for(size_t ch = 0; ch < channels_; ++ch) {
+						std::memcpy(&fade_buffer_[ch * settings_.fade_frames], block_data(read_, ch), settings_.fade_frames * sizeof(float));
+					}
+					fade_pending_ = (settings_.fade_frames > 0);
+					num_flushes_.fetch_add(1, boost::memory_order_relaxed);
+					num_discarded_blocks_.fetch_add(fresh - read_, boost::memory_order_relaxed);
+					HWM_TRACE_INSTANT("render ahead flush");
+
+					read_ = fresh;
+					read_index_.store(read_, boost::memory_order_release);
+					flush_pending_ = false;
+				}
+			}
+		}
+
+		has_current_ = true;
+		offset_ = 0;
+		return true;
+	}
+
+	void release_current_block()
+	{
+		has_current_ = false;
+		offset_ = 0;
+		++read_;
+		read_index_.store(read_, boost::memory_order_release);
+	}
+
+	//! VubN̐擪fade_framesÂĂubN̐擪NXtF[h
+	void apply_crossfade(float * const *dest, size_t dest_offset, size_t chunk)
+	{
+		size_t const fade = settings_.fade_frames;
+		size_t const end = std::min<size_t>(offset_ + chunk, fade);
+		for(size_t i = offset_; i < end; ++i) {
+			float const w = (i + 0.5f) / fade;
+			for(size_t ch = 0; ch < channels_; ++ch) {
+				float &x = dest[ch][dest_offset + (i - offset_)];
+				x = x * w + fade_buffer_[ch * fade + i] * (1.0f - w);
+			}
+		}
+		if(offset_ + chunk >= fade) { fade_pending_ = false; }
+	}
+
+	//! ڕW̃ubN܂ŐsčA܂foCXubNg܂ő҂
+	//! CuCxǧ́A܂ĂubNڕWɒBĂĂA
+	//! Cxg𔽉fubNt̖ڕWɑȂ΁A󂫂肻B
+	void WorkerThread()
+	{
+		while(!terminated_) {
+			DWORD const since_live = GetTickCount() - last_live_event_tick_.load(boost::memory_order_relaxed);
+			bool const live = (last_live_event_tick_.load(boost::memory_order_relaxed) != 0 && since_live < settings_.live_hold_msec);
+			size_t const live_target = settings_.live_blocks + pull_blocks_;
+			size_t const target = live ? live_target : settings_.ahead_blocks + pull_blocks_;
+
+			size_t const write = write_index_.load(boost::memory_order_relaxed);
+			size_t const read = read_index_.load(boost::memory_order_acquire);
+			size_t const fill = write - read;
+			//! n߂O̐L^ĂB
+			//! ɃCuCxgꍇÃubNɂ͂̃CxgfĂȂB
+			unsigned int const generation = flush_generation_.load(boost::memory_order_acquire);
+
+			//! ܂ĂubN̂AŌ̃CuCxgɍn߂
+			size_t fresh = 0;
+			while(fresh < fill && static_cast<int>(tags_[(write - 1 - fresh) % num_slots_] - generation) >= 0) { ++fresh; }
+
+			HWM_TRACE_COUNTER("render ahead fill", fill);
+			bool const needs_fresh = fresh < fill && fresh < live_target;
+			if(fill >= num_slots_ || (fill >= target && !needs_fresh)) {
+				WaitForSingleObject(wake_event_, POLL_MSEC);
+				continue;
+			}
+
+			HWM_TRACE_SCOPE("render ahead block");
+			boost::chrono::steady_clock::time_point const start = boost::chrono::steady_clock::now();
+			float const * const *rendered = render_();
+			size_t const usec = static_cast<size_t>(
+				boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::steady_clock::now() - start).count());
+			if(usec > max_render_usec_.load(boost::memory_order_relaxed)) {
+				max_render_usec_.store(usec, boost::memory_order_relaxed);
+			}
+
+			for(size_t ch = 0; ch < channels_; ++ch) {
+				std::memcpy(block_data(write, ch), rendered[ch], block_size_ * sizeof(float));
+			}
+			tags_[write % num_slots_] = generation;
+			write_index_.store(write + 1, boost::memory_order_release);
+			num_rendered_blocks_.fetch_add(1, boost::memory_order_relaxed);
+		}
+	}
+
+private:
+	size_t					channels_;
+	size_t					block_size_;
+	RenderAheadSettings		settings_;
+	size_t					pull_blocks_;
+	size_t					num_slots_;
+	std::vector<float>		slots_;
+	std::vector<unsigned int>	tags_;
+	render_function_t		render_;
+	HANDLE					wake_event_;
+	boost::thread			worker_;
+
+	//! XbhԂŋL
+	boost::atomic<size_t>		write_index_;
+	boost::atomic<size_t>		read_index_;
+	boost::atomic<unsigned int>	flush_generation_;
+	boost::atomic<DWORD>		last_live_event_tick_;
+	boost::atomic<bool>			terminated_;
+
+	//! foCX̃R[obNŎg
+	size_t					read_;
+	size_t					offset_;
+	bool					has_current_;
+	unsigned int			seen_generation_;
+	bool					flush_pending_;
+	size_t					keep_remaining_;
+	bool					fade_pending_;
+	std::vector<float>		fade_buffer_;
+
+	//! v
+	boost::atomic<size_t>	num_rendered_blocks_;
+	boost::atomic<size_t>	num_drains_;
+	boost::atomic<size_t>	num_flushes_;
+	boost::atomic<size_t>	num_discarded_blocks_;
+	boost::atomic<size_t>	min_fill_blocks_;
+	boost::atomic<size_t>	max_render_usec_;
+
+	RenderAhead(RenderAhead const &);
+	RenderAhead & operator=(RenderAhead const &);
+};
+
+}	//::hwm
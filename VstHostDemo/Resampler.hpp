@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/math/common_factor_rt.hpp>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define HWM_RESAMPLER_USE_SSE 1
+#endif
+
+namespace hwm {
+
+//! 16oCgEɑfloatz
+//! SSẼACꂽ[hŌWe[uǂނ߂ɎgB
+struct AlignedFloatArray
+{
+	AlignedFloatArray()
+		:	data_(nullptr)
+		,	size_(0)
+	{}
+
+	explicit
+	AlignedFloatArray(size_t size)
+	{
+		resize(size);
+	}
+
+	void resize(size_t size)
+	{
+		storage_.assign(size + 4, 0.0f);
+		size_t const misalign = (reinterpret_cast<size_t>(storage_.data()) / sizeof(float)) % 4;
+		data_ = storage_.data() + (misalign ? 4 - misalign : 0);
+		size_ = size;
+	}
+
+	float *			data()			{ return data_; }
+	float const *	data() const	{ return data_; }
+	size_t			size() const	{ return size_; }
+	float &			operator[](size_t i)		{ return data_[i]; }
+	float const &	operator[](size_t i) const	{ return data_[i]; }
+
+private:
+	std::vector<float>	storage_;
+	float *				data_;
+	size_t				size_;
+
+	AlignedFloatArray(AlignedFloatArray const &);
+	AlignedFloatArray & operator=(AlignedFloatArray const &);
+};
+
+namespace resampler_detail {
+
+	//! 0̑ό`xbZ֐(JCU[̌vZp)
+	inline double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for(int k = 1; k < 50; ++k) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if(term < sum * 1e-12) { break; }
+		}
+		return sum;
+	}
+
+	//! WƓ͂̓
+	//! length4̔{Acoeff16oCgEɑĂ邱ƁB
+	inline float DotProduct(float const *coeff, float const *input, size_t length)
+	{
+#if defined(HWM_RESAMPLER_USE_SSE)
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		size_t i = 0;
+		for( ; i + 8 <= length; i += 8) {
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(coeff + i),		_mm_loadu_ps(input + i)));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(coeff + i + 4),	_mm_loadu_ps(input + i + 4)));
+		}
+		if(i < length) {
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(coeff + i), _mm_loadu_ps(input + i)));
+		}
+		acc0 = _mm_add_ps(acc0, acc1);
+		acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+		acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+		return _mm_cvtss_f32(acc0);
+#else
+		float acc[4] = {};
+		for(size_t i = 0; i < length; i += 4) {
+			acc[0] += coeff[i + 0] * input[i + 0];
+			acc[1] += coeff[i + 1] * input[i + 1];
+			acc[2] += coeff[i + 2] * input[i + 2];
+			acc[3] += coeff[i + 3] * input[i + 3];
+		}
+		return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+	}
+
+}	//::resampler_detail
+
+//! |tF[YFIRtB^ɂTvO[gϊNX
+//! ͂Əo͂̃TvO[g̔L/M(񕪐)ŕ\A
+//! L{̃AbvTvOA[pXtB^A1/M̃_ETvOxɍsB
+//! tB^W͍\zL̃tF[YƂ̃e[uƂČvZĂ̂ŁA
+//! ɂ͏o1TvƂɁAtaps̓ςvZ邾ōςށB
+//! Processł̓mۂsȂB
+struct PolyphaseResampler
+{
+	//! channels			: `l
+	//! input_rate			: ̓TvO[g
+	//! output_rate			: o̓TvO[g
+	//! max_input_frames	: xProcessɓn̓t[̍ől
+	//! taps				: 1tF[ỸtB^BقǑj~̌傫Ȃ邪dȂB(4̔{ɐ؂グ)
+	PolyphaseResampler(size_t channels, size_t input_rate, size_t output_rate, size_t max_input_frames, size_t taps = 32)
+		:	channels_(channels)
+		,	max_input_frames_(max_input_frames)
+	{
+		BOOST_ASSERT(channels > 0);
+		BOOST_ASSERT(input_rate > 0 && output_rate > 0);
+		BOOST_ASSERT(taps > 0);
+
+		size_t const g = boost::math::gcd(input_rate, output_rate);
+		up_ = output_rate / g;
+		down_ = input_rate / g;
+		taps_ = (taps + 3) / 4 * 4;
+
+		build_coefficients();
+
+		history_.resize(channels_);
+		for(size_t ch = 0; ch < channels_; ++ch) {
+			history_[ch].assign(taps_ - 1 + max_input_frames_, 0.0f);
+		}
+		Reset();
+	}
+
+	//! ԂāAĂԂɖ߂
+	void Reset()
+	{
+		for(size_t ch = 0; ch < channels_; ++ch) {
+			std::fill(history_[ch].begin(), history_[ch].end(), 0.0f);
+		}
+		position_ = (taps_ - 1) * up_;
+	}
+
+	size_t	GetUpFactor() const { return up_; }
+	size_t	GetDownFactor() const { return down_; }
+	size_t	GetNumTaps() const { return taps_; }
+	size_t	GetNumChannels() const { return channels_; }
+
+	//! input_frames̓͂瓾o̓t[̍ől
+	size_t	GetMaxOutputFrames(size_t input_frames) const
+	{
+		return (input_frames * up_ + down_ - 1) / down_ + 1;
+	}
+
+	//! tB^ɂx(o̓Tv)
+	double	GetLatency() const
+	{
+		return (taps_ - 1) / 2.0 * up_ / down_;
+	}
+
+	//! input[ch][0 .. input_frames)ϊoutput[ch]ɏ݁Ao͂t[ԂB
+	//! output[ch]ɂGetMaxOutputFrames(input_frames)ȏ̗̈悪KvB
+	size_t Process(float const * const *input, size_t input_frames, float * const *output)
+	{
+		BOOST_ASSERT(input_frames <= max_input_frames_);
+
+		size_t const history_length = taps_ - 1;
+
+		for(size_t ch = 0; ch < channels_; ++ch) {
+			std::memcpy(history_[ch].data() + history_length, input[ch], input_frames * sizeof(float));
+		}
+
+		//! position_̓AbvTvO̎Ԏł̈ʒuŁA
+		//! position_ / LA̍Ō̃Tvhistory_̃CfbNXA
+		//! position_ % LAgptF[YɂȂB
+		size_t const end = (history_length + input_frames) * up_;
+		size_t produced = 0;
+		size_t position = position_;
+		for( ; position < end; position += down_) {
+			size_t const newest = position / up_;
+			float const *coeff = coefficients_.data() + (position % up_) * taps_;
+			size_t const oldest = newest + 1 - taps_;
+
+			for(size_t ch = 0; ch < channels_; ++ch) {
+				output[ch][produced] = resampler_detail::DotProduct(coeff, history_[ch].data() + oldest, taps_);
+			}
+			++produced;
+		}
+		position_ = position - input_frames * up_;
+
+		//! ̂߂ɁAtaps - 1Tv擪ɈڂĂ
+		for(size_t ch = 0; ch < channels_; ++ch) {
+			float *h = history_[ch].data();
+			std::memmove(h, h + input_frames, history_length * sizeof(float));
+		}
+
+		return produced;
+	}
+
+private:
+	//! JCU[sinc֐Ń[pXtB^݌vA
+	//! tF[YƂɁA͂̌Âɕׂe[uɓWJB
+	void build_coefficients()
+	{
+		double const pi = 3.14159265358979323846;
+		size_t const length = taps_ * up_;
+
+		//! ̓TvPʂ̃JbgItg
+		//! _ETvȌꍇ͏o͑̃iCLXggɍ킹B
+		double const cutoff = 0.5 * std::min<double>(1.0, static_cast<double>(up_) / down_) * 0.95;
+		double const beta = 8.0;
+		double const i0_beta = resampler_detail::BesselI0(beta);
+		double const center = (length - 1) / 2.0;
+
+		std::vector<double> prototype(length);
+		for(size_t k = 0; k < length; ++k) {
+			double const t = (k - center) / up_;
+			double const x = 2.0 * cutoff * t;
+			double const sinc = (std::abs(x) < 1e-12) ? 1.0 : std::sin(pi * x) / (pi * x);
+			double const r = (k - center) / center;
+			double const window = resampler_detail::BesselI0(beta * std::sqrt(std::max<double>(0.0, 1.0 - r * r))) / i0_beta;
+			prototype[k] = 2.0 * cutoff * sinc * window;
+		}
+
+		//! etF[Y̒QC1ɂȂ悤ɐK
+		coefficients_.resize(up_ * taps_);
+		for(size_t phase = 0; phase < up_; ++phase) {
+			double sum = 0;
+			for(size_t j = 0; j < taps_; ++j) {
+				sum += prototype[phase + j * up_];
+			}
+			float *row = coefficients_.data() + phase * taps_;
+			for(size_t j = 0; j < taps_; ++j) {
+				row[taps_ - 1 - j] = static_cast<float>(prototype[phase + j * up_] / sum);
+			}
+		}
+	}
+
+private:
+	size_t							channels_;
+	size_t							max_input_frames_;
+	size_t							up_;
+	size_t							down_;
+	size_t							taps_;
+	size_t							position_;
+	AlignedFloatArray				coefficients_;
+	std::vector<std::vector<float>>	history_;
+};
+
+//! vOC̏o͂foCX̃TvO[gɕϊēn߂̃NX
+//! vOC͏ɌŒ̃ubNTCYŏsAϊ̃f[^FIFOɗ߂ĂB
+//! foCXvꂽt[ɑȂԂAvOC̏ĂяoB
+struct ResamplingStage
+{
+	ResamplingStage(size_t channels, size_t source_rate, size_t target_rate, size_t source_block_size, size_t max_target_frames, size_t taps = 32)
+		:	resampler_(channels, source_rate, target_rate, source_block_size, taps)
+		,	source_block_size_(source_block_size)
+		,	max_target_frames_(max_target_frames)
+		,	fifo_frames_(0)
+	{
+		BOOST_ASSERT(max_target_frames > 0);
+
+		size_t const capacity = max_target_frames + resampler_.GetMaxOutputFrames(source_block_size);
+		fifo_.resize(channels);
+		fifo_heads_.resize(channels);
+		for(size_t ch = 0; ch < channels; ++ch) {
+			fifo_[ch].assign(capacity, 0.0f);
+		}
+	}
+
+	//! dest[ch][0 .. frames)𖄂߂B
+	//! render()́Asource_block_sizet[̃f[^`l̔zƂĕԂ֐B
+	//! (VstPlugin::ProcessAudio̖߂lƓ`)
+	//! FIFOmax_target_framesɊmۂĂ̂ŁA𒴂v͕ďB
+	template<class Render>
+	void Pull(float * const *dest, size_t frames, Render render)
+	{
+		size_t const channels = resampler_.GetNumChannels();
+
+		size_t done = 0;
+		while(done < frames) {
+			size_t const chunk = std::min<size_t>(frames - done, max_target_frames_);
+
+			while(fifo_frames_ < chunk) {
+				float const * const *source = render();
+				for(size_t ch = 0; ch < channels; ++ch) {
+					fifo_heads_[ch] = fifo_[ch].data() + fifo_frames_;
+				}
+				fifo_frames_ += resampler_.Process(source, source_block_size_, fifo_heads_.data());
+			}
+
+			for(size_t ch = 0; ch < channels; ++ch) {
+				float *f = fifo_[ch].data();
+				std::memcpy(dest[ch] + done, f, chunk * sizeof(float));
+				std::memmove(f, f + chunk, (fifo_frames_ - chunk) * sizeof(float));
+			}
+			fifo_frames_ -= chunk;
+			done += chunk;
+		}
+	}
+
+	PolyphaseResampler const & GetResampler() const { return resampler_; }
+
+private:
+	PolyphaseResampler				resampler_;
+	size_t							source_block_size_;
+	size_t							max_target_frames_;
+	size_t							fifo_frames_;
+	std::vector<std::vector<float>>	fifo_;
+	std::vector<float *>			fifo_heads_;
+};
+
+//! 2{A4{Ȃǂ̃I[o[TvOsNX
+//! ͂factor{ɃAbvTvOprocessɓnA
+//! ̌ʂ̃TvO[gɖ߂ďo͂B
+//! vOCI[o[TvOœꍇ́A
+//! vOC̃TvO[gƃubNTCYfactor{ɂĂB
+struct Oversampler
+{
+	Oversampler(size_t channels, size_t factor, size_t max_block_size, size_t taps = 32)
+		:	factor_(factor)
+		,	up_(channels, 1, factor, max_block_size, taps)
+		,	down_(channels, factor, 1, max_block_size * factor, taps)
+	{
+		BOOST_ASSERT(factor >= 1);
+
+		oversampled_.resize(channels);
+		oversampled_heads_.resize(channels);
+		for(size_t ch = 0; ch < channels; ++ch) {
+			oversampled_[ch].assign(max_block_size * factor + 1, 0.0f);
+			oversampled_heads_[ch] = oversampled_[ch].data();
+		}
+	}
+
+	size_t	GetFactor() const { return factor_; }
+
+	//! Abv/_Ẽ̗tB^ɂx(̃TvO[gł̃Tv)
+	double	GetLatency() const { return up_.GetLatency() / factor_ + down_.GetLatency(); }
+
+	//! process(float **buffers, size_t frames)́A
+	//! buffers̓ȅŏ邩Aʂ̔zԂ֐B
+	template<class Process>
+	void Run(float const * const *input, float * const *output, size_t frames, Process process)
+	{
+		size_t const n = up_.Process(input, frames, oversampled_heads_.data());
+		BOOST_ASSERT(n == frames * factor_);
+
+		float const * const *processed = process(oversampled_heads_.data(), n);
+		size_t const m = down_.Process(processed, n, output);
+		BOOST_ASSERT(m == frames);
+		(void)m;
+	}
+
+private:
+	size_t							factor_;
+	PolyphaseResampler				up_;
+	PolyphaseResampler				down_;
+	std::vector<std::vector<float>>	oversampled_;
+	std::vector<float *>			oversampled_heads_;
+};
+
+}	//::hwm
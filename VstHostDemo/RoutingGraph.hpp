@@ -0,0 +1,610 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+#include "./PluginWatchdog.hpp"
+#include "./Resampler.hpp"
+#include "./VstPlugin.hpp"
+
+namespace hwm {
+
+//! RoutingGraph::Compileō쐬AtbgȎsXPW[
+//!
+//! m[h̓g|WJɕׂAm[hԂ̃I[fBIobt@
+//! ̘Ä悩犄蓖ĂĂB
+//! Processł̓mۂbNsȂB
+struct RoutingSchedule
+{
+	typedef std::function<void(float **inputs, float **outputs, size_t frames)> ProcessFunction;
+
+	//! ̐ڑ̓͂ɏW܂ꍇ̉Z
+	//! ڑ̃m[h̏̒ɁÃm[h̏o͂ZɑށB
+	struct MixOp
+	{
+		float *						dest;
+		std::vector<float const *>	sources;
+		//! trueȂdest̓esources𑫂ށBfalseȂsources̍vdest㏑B
+		bool						accumulate;
+	};
+
+	struct Step
+	{
+		std::string				name;
+		ProcessFunction			process;
+		//! ̌ɍsZ
+		std::vector<MixOp>		mixes;
+		std::vector<float *>	inputs;
+		std::vector<float *>	outputs;
+	};
+
+	//! XPW[̏ɑSm[h
+	//! framesCompileɓnblock_sizeȉł邱ƁB
+	void Process(size_t frames)
+	{
+		BOOST_ASSERT(frames <= block_size_);
+
+		for(size_t s = 0; s < steps_.size(); ++s) {
+			Step &step = steps_[s];
+			step.process(step.inputs.data(), step.outputs.data(), frames);
+			for(size_t m = 0; m < step.mixes.size(); ++m) {
+				mix(step.mixes[m], frames);
+			}
+		}
+	}
+
+	//! Ot̏o
+	float **	GetOutputs()		{ return outputs_.data(); }
+	size_t		GetNumOutputs() const	{ return outputs_.size(); }
+	size_t		GetBlockSize() const	{ return block_size_; }
+
+	size_t		GetNumSteps() const		{ return steps_.size(); }
+	Step const & GetStep(size_t index) const { return steps_[index]; }
+
+	//! 蓖Ăobt@̐(p̃obt@܂)
+	size_t		GetNumBuffers() const	{ return num_buffers_; }
+	//! ͂Əo͂œobt@L`l̐
+	size_t		GetNumInPlace() const	{ return num_in_place_; }
+	//! ZƂĐڑ̃obt@𗬗p͂̐
+	size_t		GetNumAliasedMixes() const	{ return num_aliased_mixes_; }
+
+	//! 蓖Ăobt@̍vTCY
+	size_t		GetPeakBytes() const	{ return num_buffers_ * stride_ * sizeof(float); }
+	//! m[hƂɓ͂Əo͂̃obt@ꍇ̃TCY
+	size_t		GetNaiveBytes() const	{ return naive_channels_ * block_size_ * sizeof(float); }
+
+	std::string ToString() const
+	{
+		std::ostringstream ss;
+		ss	<< steps_.size() << " steps, "
+			<< num_buffers_ << " buffers ("
+			<< num_in_place_ << " in-place, "
+			<< num_aliased_mixes_ << " aliased mixes), "
+			<< "peak " << GetPeakBytes() / 1024.0 << "KB / naive " << GetNaiveBytes() / 1024.0 << "KB";
+		return ss.str();
+	}
+
+	//! obt@̈visit(void *data, size_t bytes)ŗ񋓂
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		visit(static_cast<void *>(pool_.data()), pool_.size() * sizeof(float));
+	}
+
+private:
+	friend struct RoutingGraph;
+
+	RoutingSchedule()
+		:	block_size_(0)
+		,	stride_(0)
+		,	num_buffers_(0)
+		,	num_in_place_(0)
+		,	num_aliased_mixes_(0)
+		,	naive_channels_(0)
+	{}
+
+	static
+	void mix(MixOp const &op, size_t frames)
+	{
+		size_t first = 0;
+		if(!op.accumulate) {
+			std::copy(op.sources[0], op.sources[0] + frames, op.dest);
+			first = 1;
+		}
+		for(size_t i = first; i < op.sources.size(); ++i) {
+			float const *src = op.sources[i];
+			float *dest = op.dest;
+			for(size_t fr = 0; fr < frames; ++fr) { dest[fr] += src[fr]; }
+		}
+	}
+
+private:
+	std::vector<Step>	steps_;
+	std::vector<float *>	outputs_;
+	AlignedFloatArray	pool_;
+	size_t				block_size_;
+	size_t				stride_;
+	size_t				num_buffers_;
+	size_t				num_in_place_;
+	size_t				num_aliased_mixes_;
+	size_t				naive_channels_;
+
+	RoutingSchedule(RoutingSchedule const &);
+	RoutingSchedule & operator=(RoutingSchedule const &);
+};
+
+//! ̃vOC̐ڑ\Ot
+//!
+//! m[hƃ`lPʂ̐ڑo^ĂCompileƁA
+//! g|WJ\[gsƁAobt@̊蓖Ă߂RoutingSchedule쐬B
+//!
+//! obt@̊蓖Ă͐ԂɊÂčsAŌ̓ǂݎ̏Iobt@
+//! ̃m[h̏o͂ɍėpBɁA̓`l̃obt@̃m[hōŌɓǂ܂ꍇ́A
+//! ԍ̏o̓`lɂ̃obt@̂܂܎g(in-place)B
+//! ̓͂ɕ̐ڑꍇ́Aڑ̃m[h̏I邽тɉZ֑ނ̂ŁA
+//! ڑ̏o̓obt@́A͑̃m[h̏҂ɉłB
+//! ŏɑޏo͂ǂ܂Ȃꍇ́Ãobt@̂܂܉ZɂB
+//! ڑ̂Ȃ͂ɂ́ASm[hŋL閳̃obt@nB
+struct RoutingGraph
+{
+	typedef RoutingSchedule::ProcessFunction ProcessFunction;
+
+	explicit
+	RoutingGraph(size_t num_outputs)
+		:	output_sources_(num_outputs)
+	{}
+
+	//! Cӂ̏m[hƂĒǉAm[hԍԂ
+	//! can_process_in_placetrueȂAԍ̓̓`lƏo̓`l
+	//! obt@nƂB
+	size_t AddNode(std::string const &name, size_t num_inputs, size_t num_outputs, ProcessFunction process, bool can_process_in_place = true)
+	{
+		Node node;
+		node.name = name;
+		node.num_outputs = num_outputs;
+		node.process = process;
+		node.can_process_in_place = can_process_in_place;
+		node.input_sources.resize(num_inputs);
+		nodes_.push_back(node);
+		return nodes_.size() - 1;
+	}
+
+	//! VSTvOCm[hƂĒǉ
+	//! VST 2.4łprocessReplacing̓͂Əo͂ɓobt@nƂĂ邪A
+	//! ɑΉĂȂvOC̏ꍇcan_process_in_placefalsew肷B
+	size_t AddPlugin(VstPlugin &plugin, bool can_process_in_place = true)
+	{
+		VstPlugin *p = &plugin;
+		return AddNode(
+			plugin.GetEffectName(), plugin.GetNumInputs(), plugin.GetNumOutputs(),
+			[p] (float **inputs, float **outputs, size_t frames) {
+				p->ProcessEvents();
+				p->ProcessAudio(inputs, outputs, frames);
+			},
+			can_process_in_place);
+	}
+
+	//! VstPluginm[hƂĒǉȀwatchdogŊĎ
+	//! watchdogoCpXĂԂ́A̓`l𓯂ԍ̏o̓`lɂ̂܂܏o͂A
+	//! vOCɓn͂Cxĝ͎ĂB(VstPlugin::DiscardEvents)
+	//! watchdog̏o̓`lmax_block_sizéAvOC̏o͐CompileɓnubNTCYɍ킹ĂB
+	size_t AddPlugin(VstPlugin &plugin, PluginWatchdog &watchdog, bool can_process_in_place = true)
+	{
+		VstPlugin *p = &plugin;
+		PluginWatchdog *w = &watchdog;
+		return AddNode(
+			plugin.GetEffectName(), plugin.GetNumInputs(), plugin.GetNumOutputs(),
+			[p, w] (float **inputs, float **outputs, size_t frames) {
+				bool const processed = w->Run(
+					outputs, frames,
+					[&] {
+						p->ProcessEvents();
+						p->ProcessAudio(inputs, outputs, frames);
+					},
+					[&] (float * const *dest, size_t n) {
+						for(size_t ch = 0; ch < p->GetNumOutputs(); ++ch) {
+							if(ch < p->GetNumInputs()) {
+								std::memcpy(dest[ch], inputs[ch], n * sizeof(float));
+							} else {
+								std::fill(dest[ch], dest[ch] + n, 0.0f);
+							}
+						}
+					});
+				if(!processed) {
+					p->DiscardEvents();
+				}
+			},
+			can_process_in_place);
+	}
+
+	//! srcm[h̏o̓`lAdestm[h̓̓`lɐڑ
+	void Connect(size_t src_node, size_t src_channel, size_t dest_node, size_t dest_channel)
+	{
+		check_output(src_node, src_channel);
+		if(dest_node >= nodes_.size() || dest_channel >= nodes_[dest_node].input_sources.size()) {
+			throw std::runtime_error("invalid routing destination");
+		}
+		nodes_[dest_node].input_sources[dest_channel].push_back(Port(src_node, src_channel));
+	}
+
+	//! srcm[h̏o̓`lAOt̏o̓`lɐڑ
+	void ConnectToOutput(size_t src_node, size_t src_channel, size_t output_channel)
+	{
+		check_output(src_node, src_channel);
+		if(output_channel >= output_sources_.size()) {
+			throw std::runtime_error("invalid routing output");
+		}
+		output_sources_[output_channel].push_back(Port(src_node, src_channel));
+	}
+
+	size_t GetNumNodes() const { return nodes_.size(); }
+
+	//! sXPW[쐬
+	//! Otɏzꍇstd::runtime_error𓊂B
+	std::unique_ptr<RoutingSchedule> Compile(size_t block_size) const
+	{
+		size_t const num_nodes = nodes_.size();
+
+		std::vector<size_t> const order = topological_order();
+		std::vector<size_t> step_of(num_nodes);
+		for(size_t s = 0; s < order.size(); ++s) { step_of[order[s]] = s; }
+		//! Ot̏o͂́AŌɎs鉼zIȃm[hƂĈ
+		size_t const sink_step = order.size();
+
+		auto inputs_of = [&] (size_t step) -> PortList const & {
+			return step == sink_step ? output_sources_ : nodes_[order[step]].input_sources;
+		};
+
+		//! ̐ڑ͂́AZ̃obt@(Accumulator)pӂāA
+		//! ڑ̃m[h̏I邽тɂށB
+		//! Ɛڑ̏o̓obt@́Ãm[h̒ɉłB
+		std::vector<Accumulator> accumulators;
+		std::vector<std::vector<size_t>> accumulators_at(sink_step);	//! ڑ̃XebvƂɁAސ
+		std::vector<std::vector<size_t>> accumulator_of(sink_step + 1);	//! ̓`lƂ̉Z
+
+		//! eo̓`lŌɓǂ܂XebvƁAǂ܂
+		//! Nɂǂ܂Ȃo͂́Ãm[hg̃XebvŉB
+		std::vector<std::vector<size_t>> last_use(num_nodes);
+		std::vector<std::vector<size_t>> num_uses(num_nodes);
+		for(size_t n = 0; n < num_nodes; ++n) {
+			last_use[n].assign(nodes_[n].num_outputs, step_of[n]);
+			num_uses[n].assign(nodes_[n].num_outputs, 0);
+		}
+
+		for(size_t s = 0; s <= sink_step; ++s) {
+			PortList const &inputs = inputs_of(s);
+			accumulator_of[s].assign(inputs.size(), size_t(INVALID));
+
+			for(size_t ch = 0; ch < inputs.size(); ++ch) {
+				if(inputs[ch].size() == 1) {
+					Port const &p = inputs[ch][0];
+					last_use[p.node][p.channel] = std::max<size_t>(last_use[p.node][p.channel], s);
+					++num_uses[p.node][p.channel];
+				} else if(inputs[ch].size() > 1) {
+					Accumulator acc;
+					acc.sources = inputs[ch];
+					std::stable_sort(acc.sources.begin(), acc.sources.end(),
+						[&] (Port const &a, Port const &b) { return step_of[a.node] < step_of[b.node]; });
+					accumulator_of[s][ch] = accumulators.size();
+
+					for(size_t i = 0; i < acc.sources.size(); ++i) {
+						Port const &p = acc.sources[i];
+						size_t const src_step = step_of[p.node];
+						std::vector<size_t> &list = accumulators_at[src_step];
+						if(std::find(list.begin(), list.end(), accumulators.size()) == list.end()) {
+							list.push_back(accumulators.size());
+						}
+						++num_uses[p.node][p.channel];
+					}
+					accumulators.push_back(acc);
+				}
+			}
+		}
+
+		//! Ōɓǂ܂XebvƂ̏o̓`l
+		std::vector<std::vector<Port>> expiring(sink_step + 1);
+		for(size_t n = 0; n < num_nodes; ++n) {
+			for(size_t ch = 0; ch < nodes_[n].num_outputs; ++ch) {
+				expiring[last_use[n][ch]].push_back(Port(n, ch));
+			}
+		}
+
+		std::unique_ptr<RoutingSchedule> schedule(new RoutingSchedule());
+		BufferAllocator allocator;
+
+		//! Ō߂̂̓obt@ԍŁAAhX͍ŌɊ蓖Ă
+		std::vector<std::vector<size_t>> value_buffer(num_nodes);
+		//! in-placȅo͂ZɈp̂ŁAĂ͂Ȃobt@
+		std::vector<std::vector<bool>> transferred(num_nodes);
+		std::vector<StepPlan> plans(sink_step + 1);
+
+		for(size_t s = 0; s <= sink_step; ++s) {
+			PortList const &inputs = inputs_of(s);
+			StepPlan &plan = plans[s];
+
+			//! ͂̉
+			//! ͂̃obt@̃Xebv̂̃`lōŌɓǂ܂ȂA
+			//! ԍ̏o̓`lɈpB
+			plan.inputs.resize(inputs.size());
+			std::vector<bool> input_dies(inputs.size(), false);
+			std::vector<size_t> dying_accumulators;
+			for(size_t ch = 0; ch < inputs.size(); ++ch) {
+				if(inputs[ch].empty()) {
+					plan.inputs[ch] = SILENCE;
+				} else if(inputs[ch].size() == 1) {
+					Port const &p = inputs[ch][0];
+					plan.inputs[ch] = value_buffer[p.node][p.channel];
+					input_dies[ch] = (s != sink_step && last_use[p.node][p.channel] == s && num_uses[p.node][p.channel] == 1);
+				} else {
+					Accumulator const &acc = accumulators[accumulator_of[s][ch]];
+					plan.inputs[ch] = acc.buffer;
+					if(s != sink_step) {
+						input_dies[ch] = true;
+						dying_accumulators.push_back(acc.buffer);
+					}
+				}
+			}
+
+			if(s == sink_step) { break; }
+
+			size_t const n = order[s];
+			Node const &node = nodes_[n];
+
+			//! o͂̊蓖
+			value_buffer[n].resize(node.num_outputs);
+			transferred[n].assign(node.num_outputs, false);
+			for(size_t ch = 0; ch < node.num_outputs; ++ch) {
+				if(node.can_process_in_place && ch < inputs.size() && input_dies[ch]) {
+					size_t const buffer = plan.inputs[ch];
+					value_buffer[n][ch] = buffer;
+					if(inputs[ch].size() == 1) {
+						transferred[inputs[ch][0].node][inputs[ch][0].channel] = true;
+					} else {
+						dying_accumulators.erase(std::remove(dying_accumulators.begin(), dying_accumulators.end(), buffer), dying_accumulators.end());
+					}
+					++schedule->num_in_place_;
+				} else {
+					value_buffer[n][ch] = allocator.Allocate();
+				}
+			}
+
+			//! IΓǂ܂ȂȂ͂
+			for(size_t i = 0; i < expiring[s].size(); ++i) {
+				Port const &p = expiring[s][i];
+				if(p.node != n && !transferred[p.node][p.channel]) {
+					allocator.Release(value_buffer[p.node][p.channel]);
+				}
+			}
+			for(size_t i = 0; i < dying_accumulators.size(); ++i) {
+				allocator.Release(dying_accumulators[i]);
+			}
+
+			//! ̃m[h̏o͂Zɑ
+			//! ŏɑޏo͂ǂ܂ȂȂÃobt@̂܂܉ZɂB
+			for(size_t i = 0; i < accumulators_at[s].size(); ++i) {
+				Accumulator &acc = accumulators[accumulators_at[s][i]];
+				PlannedMix mix;
+				mix.accumulate = (acc.buffer != INVALID);
+
+				for(size_t j = 0; j < acc.sources.size(); ++j) {
+					Port const &p = acc.sources[j];
+					if(p.node != n) { continue; }
+
+					if(acc.buffer == INVALID) {
+						if(num_uses[p.node][p.channel] == 1) {
+							acc.buffer = value_buffer[p.node][p.channel];
+							transferred[p.node][p.channel] = true;
+							mix.accumulate = true;
+							++schedule->num_aliased_mixes_;
+							continue;
+						}
+						acc.buffer = allocator.Allocate();
+					}
+					mix.sources.push_back(value_buffer[p.node][p.channel]);
+				}
+
+				if(!mix.sources.empty()) {
+					mix.dest = acc.buffer;
+					plan.mixes.push_back(mix);
+				}
+			}
+
+			//! Zɂǂ܂o͂ƁANɂǂ܂Ȃo͂
+			for(size_t i = 0; i < expiring[s].size(); ++i) {
+				Port const &p = expiring[s][i];
+				if(p.node == n && !transferred[p.node][p.channel]) {
+					allocator.Release(value_buffer[p.node][p.channel]);
+				}
+			}
+
+			schedule->naive_channels_ += node.input_sources.size() + node.num_outputs;
+		}
+
+		//! obt@̈̊mۂƃAhX̉
+		//! ̃obt@͍ŌɒuB
+		size_t const silence = allocator.GetNumBuffers();
+		schedule->block_size_ = block_size;
+		schedule->stride_ = (block_size + 3) / 4 * 4;
+		schedule->num_buffers_ = silence + 1;
+		schedule->pool_.resize(schedule->num_buffers_ * schedule->stride_);
+
+		auto address = [&] (size_t buffer) -> float * {
+			return schedule->pool_.data() + (buffer == SILENCE ? silence : buffer) * schedule->stride_;
+		};
+
+		for(size_t s = 0; s < sink_step; ++s) {
+			size_t const n = order[s];
+			StepPlan const &plan = plans[s];
+
+			RoutingSchedule::Step step;
+			step.name = nodes_[n].name;
+			step.process = nodes_[n].process;
+			for(size_t ch = 0; ch < plan.inputs.size(); ++ch) {
+				step.inputs.push_back(address(plan.inputs[ch]));
+			}
+			for(size_t ch = 0; ch < value_buffer[n].size(); ++ch) {
+				step.outputs.push_back(address(value_buffer[n][ch]));
+			}
+			for(size_t m = 0; m < plan.mixes.size(); ++m) {
+				RoutingSchedule::MixOp op;
+				op.dest = address(plan.mixes[m].dest);
+				op.accumulate = plan.mixes[m].accumulate;
+				for(size_t i = 0; i < plan.mixes[m].sources.size(); ++i) {
+					op.sources.push_back(address(plan.mixes[m].sources[i]));
+				}
+				step.mixes.push_back(op);
+			}
+			schedule->steps_.push_back(step);
+		}
+
+		for(size_t ch = 0; ch < plans[sink_step].inputs.size(); ++ch) {
+			schedule->outputs_.push_back(address(plans[sink_step].inputs[ch]));
+		}
+
+		return schedule;
+	}
+
+private:
+	static size_t const INVALID = static_cast<size_t>(-1);
+	static size_t const SILENCE = static_cast<size_t>(-2);
+
+	struct Port
+	{
+		Port(size_t node, size_t channel) : node(node), channel(channel) {}
+		size_t node;
+		size_t channel;
+		bool operator==(Port const &rhs) const { return node == rhs.node && channel == rhs.channel; }
+	};
+
+	typedef std::vector<std::vector<Port>> PortList;
+
+	struct Node
+	{
+		std::string		name;
+		size_t			num_outputs;
+		ProcessFunction	process;
+		bool			can_process_in_place;
+		//! ̓`lƂ̐ڑ
+		PortList		input_sources;
+	};
+
+	//! ̐ڑ͂̉Z
+	struct Accumulator
+	{
+		Accumulator() : buffer(INVALID) {}
+		//! ڑBsɕׂĂB
+		std::vector<Port>	sources;
+		size_t				buffer;
+	};
+
+	struct PlannedMix
+	{
+		size_t				dest;
+		std::vector<size_t>	sources;
+		bool				accumulate;
+	};
+
+	struct StepPlan
+	{
+		std::vector<size_t>		inputs;
+		//! ̌ɍsZ
+		std::vector<PlannedMix>	mixes;
+	};
+
+	//! ꂽobt@ԍėpAP[^
+	//! Oɉꂽobt@قǃLbVɎcĂ̂ŁAoōėpB
+	struct BufferAllocator
+	{
+		BufferAllocator() : num_buffers_(0) {}
+
+		size_t Allocate()
+		{
+			if(free_.empty()) { return num_buffers_++; }
+			size_t const buffer = free_.back();
+			free_.pop_back();
+			return buffer;
+		}
+
+		void Release(size_t buffer)
+		{
+			if(buffer == SILENCE) { return; }
+			BOOST_ASSERT(std::find(free_.begin(), free_.end(), buffer) == free_.end());
+			free_.push_back(buffer);
+		}
+
+		size_t GetNumBuffers() const { return num_buffers_; }
+
+	private:
+		std::vector<size_t>	free_;
+		size_t				num_buffers_;
+	};
+
+	static
+	void add_unique(std::vector<size_t> &list, size_t value)
+	{
+		if(std::find(list.begin(), list.end(), value) == list.end()) { list.push_back(value); }
+	}
+
+	void check_output(size_t node, size_t channel) const
+	{
+		if(node >= nodes_.size() || channel >= nodes_[node].num_outputs) {
+			throw std::runtime_error("invalid routing source");
+		}
+	}
+
+	//! KahñASYɂg|WJ\[g
+	//! ʂ̃m[h͒ǉɕׂB
+	std::vector<size_t> topological_order() const
+	{
+		size_t const num_nodes = nodes_.size();
+		std::vector<size_t> num_dependencies(num_nodes, 0);
+		std::vector<std::vector<size_t>> dependents(num_nodes);
+
+		for(size_t n = 0; n < num_nodes; ++n) {
+			std::vector<size_t> sources;
+			for(size_t ch = 0; ch < nodes_[n].input_sources.size(); ++ch) {
+				for(size_t i = 0; i < nodes_[n].input_sources[ch].size(); ++i) {
+					add_unique(sources, nodes_[n].input_sources[ch][i].node);
+				}
+			}
+			num_dependencies[n] = sources.size();
+			for(size_t i = 0; i < sources.size(); ++i) {
+				dependents[sources[i]].push_back(n);
+			}
+		}
+
+		std::vector<size_t> order;
+		std::vector<size_t> ready;
+		for(size_t n = num_nodes; n > 0; --n) {
+			if(num_dependencies[n - 1] == 0) { ready.push_back(n - 1); }
+		}
+		while(!ready.empty()) {
+			size_t const n = ready.back();
+			ready.pop_back();
+			order.push_back(n);
+			for(size_t i = dependents[n].size(); i > 0; --i) {
+				size_t const d = dependents[n][i - 1];
+				if(--num_dependencies[d] == 0) { ready.push_back(d); }
+			}
+		}
+
+		if(order.size() != num_nodes) {
+			throw std::runtime_error("routing graph has a cycle");
+		}
+		return order;
+	}
+
+private:
+	std::vector<Node>	nodes_;
+	PortList			output_sources_;
+};
+
+}	//::hwm
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+
+namespace hwm {
+
+//! -1.0 .. 1.0float̃TvA-32768 .. 3276716bitɕϊ
+//! ͈͊O̒l͖OaA0ɐ؂̂ĂB
+inline
+short FloatToShort(float sample)
+{
+	double const s = sample * 32768.0;
+	return static_cast<short>(std::max<double>(-32768.0, std::min<double>(s, 32767.0)));
+}
+
+//! `lƂɕꂽfloat̃f[^A16bitɕϊȂC^[[u
+//! WaveOutProcessor̃R[obNŁAfoCX̃obt@ւ̏oɎgϊB
+//! min(num_src_channels, dest_channels)`l݁Adest̎c̃`lɂ͐GȂB
+inline
+void InterleaveToShort(float const * const *src, size_t num_src_channels, short *dest, size_t dest_channels, size_t frames)
+{
+	size_t const channels = std::min<size_t>(num_src_channels, dest_channels);
+	for(size_t ch = 0; ch < channels; ++ch) {
+		float const *s = src[ch];
+		for(size_t fr = 0; fr < frames; ++fr) {
+			dest[fr * dest_channels + ch] = FloatToShort(s[fr]);
+		}
+	}
+}
+
+}	//::hwm
@@ -0,0 +1,391 @@
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/thread.hpp>
+
+#include "./PluginSwapper.hpp"
+#include "./ThreadRole.hpp"
+#include "./Trace.hpp"
+#include "./VstPlugin.hpp"
+
+namespace hwm {
+
+//! ZbVɊ܂܂vOC1̏
+struct SessionEntry
+{
+	SessionEntry()
+		:	shell_plugin_id(0)
+		,	needs_main_thread(false)
+		,	swap_on_program_change(false)
+	{}
+
+	//! W[̃pX(CP932)
+	std::string	path;
+	//! \p̖O
+	std::string	name;
+	//! VFvOC̃TuvOC̏ꍇ͂ID
+	VstInt32	shell_plugin_id;
+	//! 쐬GUIXbhōsKvvOCȂtrue
+	//! (̒ŃEBhEȂǁA[J[Xbh쐬Ɩ肪N)
+	bool		needs_main_thread;
+	//! vO̕ύXAvOςVCX^Xւ̍ւōsȂtrue
+	//! (effSetProgram̏dAĐɌĂԂƉr؂)
+	bool		swap_on_program_change;
+	//! 쐬ɕ
+	PluginState	state;
+
+	//! plugiň݂̏ԂGg
+	//! GUIXbhĂяoB
+	static
+	SessionEntry Capture(VstPlugin &plugin, bool needs_main_thread = false)
+	{
+		SessionEntry entry;
+		entry.path = balor::locale::Charset(932, true).encode(plugin.GetModulePath());
+		entry.name = plugin.GetEffectName();
+		entry.shell_plugin_id = plugin.GetShellPluginId();
+		entry.needs_main_thread = needs_main_thread;
+		entry.state = PluginState::Capture(plugin);
+		if(plugin.GetNumPrograms() > 0) {
+			entry.state.program = static_cast<int>(plugin.GetProgram());
+		}
+		return entry;
+	}
+
+	//! needs_main_threadȂǂ̐ݒ͂̂܂܂ŁAplugiň݂̏ԂɍXV
+	//! GUIXbhĂяoB
+	void Update(VstPlugin &plugin)
+	{
+		SessionEntry entry = Capture(plugin, needs_main_thread);
+		entry.swap_on_program_change = swap_on_program_change;
+		*this = entry;
+	}
+};
+
+//! ZbV
+//! ǂݍރvOCƁA̐ݒԂ̈ꗗB
+//!
+//! boost::property_treeXML`(UTF-8)ŕۑB
+//!   <session version="1">
+//!     <sampling_rate>44100</sampling_rate>
+//!     <block_size>256</block_size>
+//!     <plugin>
+//!       <path>...</path> <name>...</name> <shell_plugin_id>0</shell_plugin_id> <main_thread>false</main_thread>
+//!       <swap_on_program_change>false</swap_on_program_change>
+//!       <program>0</program> <chunk>(16i)</chunk> <parameters>(󔒋؂̒l)</parameters>
+//!     </plugin>
+//!     ...
+//!   </session>
+struct Session
+{
+	enum { VERSION = 1 };
+
+	Session()
+		:	sampling_rate(0)
+		,	block_size(0)
+	{}
+
+	//! ۑƂ̐ݒ(ǂݍݎɂ͎QlƂĎg)
+	size_t						sampling_rate;
+	size_t						block_size;
+	std::vector<SessionEntry>	entries;
+
+	//! ZbVǂݍ
+	//! `sȏꍇ́Astd::runtime_error𓊂B
+	static
+	Session Load(std::istream &is)
+	{
+		namespace pt = boost::property_tree;
+
+		Session session;
+		try {
+			pt::ptree tree;
+			pt::read_xml(is, tree, pt::xml_parser::trim_whitespace);
+
+			pt::ptree const &root = tree.get_child("session");
+			if(root.get<int>("<xmlattr>.version") != VERSION) {
+				throw std::runtime_error("unsupported session version");
+			}
+			session.sampling_rate = root.get<size_t>("sampling_rate", 0);
+			session.block_size = root.get<size_t>("block_size", 0);
+
+			for(auto const &child: root) {
+				if(child.first != "plugin") { continue; }
+				pt::ptree const &node = child.second;
+
+				SessionEntry entry;
+				entry.path = from_utf8(node.get<std::string>("path"));
+				entry.name = from_utf8(node.get<std::string>("name", ""));
+				entry.shell_plugin_id = node.get<VstInt32>("shell_plugin_id", 0);
+				entry.needs_main_thread = node.get<bool>("main_thread", false);
+				entry.swap_on_program_change = node.get<bool>("swap_on_program_change", false);
+				entry.state.program = node.get<int>("program", -1);
+				entry.state.chunk = decode_hex(node.get<std::string>("chunk", ""));
+
+				std::istringstream params(node.get<std::string>("parameters", ""));
+				float value;
+				while(params >> value) {
+					entry.state.parameters.push_back(value);
+				}
+				session.entries.push_back(entry);
+			}
+		} catch(pt::ptree_error &e) {
+			throw std::runtime_error(std::string("invalid session file : ") + e.what());
+		}
+		return session;
+	}
+
+	//! ZbVo
+	void Save(std::ostream &os) const
+	{
+		namespace pt = boost::property_tree;
+
+		pt::ptree root;
+		root.put("<xmlattr>.version", static_cast<int>(VERSION));
+		root.put("sampling_rate", sampling_rate);
+		root.put("block_size", block_size);
+
+		for(auto const &entry: entries) {
+			pt::ptree node;
+			node.put("path", to_utf8(entry.path));
+			node.put("name", to_utf8(entry.name));
+			node.put("shell_plugin_id", entry.shell_plugin_id);
+			node.put("main_thread", entry.needs_main_thread);
+			node.put("swap_on_program_change", entry.swap_on_program_change);
+			node.put("program", entry.state.program);
+			if(!entry.state.chunk.empty()) {
+				node.put("chunk", encode_hex(entry.state.chunk));
+			}
+			if(!entry.state.parameters.empty()) {
+				std::ostringstream params;
+				params << std::setprecision(9);
+				for(size_t i = 0; i < entry.state.parameters.size(); ++i) {
+					params << (i ? " " : "") << entry.state.parameters[i];
+				}
+				node.put("parameters", params.str());
+			}
+			root.add_child("plugin", node);
+		}
+
+		pt::ptree tree;
+		tree.add_child("session", root);
+		pt::write_xml(os, tree);
+		if(!os) { throw std::runtime_error("failed to write session file"); }
+	}
+
+private:
+	//! ̃AvP[V̕(CP932)ƁAt@C̕(UTF-8)̕ϊ
+	static
+	std::string to_utf8(std::string const &text)
+	{
+		return balor::locale::Charset(CP_UTF8, true).encode(balor::locale::Charset(932, true).decode(text));
+	}
+
+	static
+	std::string from_utf8(std::string const &text)
+	{
+		return balor::locale::Charset(932, true).encode(balor::locale::Charset(CP_UTF8, true).decode(text));
+	}
+
+	static
+	std::string encode_hex(std::vector<char> const &data)
+	{
+		static char const digits[] = "0123456789abcdef";
+		std::string text(data.size() * 2, '0');
+		for(size_t i = 0; i < data.size(); ++i) {
+			unsigned char const c = static_cast<unsigned char>(data[i]);
+			text[i * 2] = digits[c >> 4];
+			text[i * 2 + 1] = digits[c & 0x0F];
+		}
+		return text;
+	}
+
+	static
+	std::vector<char> decode_hex(std::string const &text)
+	{
+		if(text.size() % 2 != 0) { throw std::runtime_error("invalid session file : broken chunk"); }
+		std::vector<char> data(text.size() / 2);
+		for(size_t i = 0; i < data.size(); ++i) {
+			data[i] = static_cast<char>((hex_value(text[i * 2]) << 4) | hex_value(text[i * 2 + 1]));
+		}
+		return data;
+	}
+
+	static
+	int hex_value(char c)
+	{
+		if('0' <= c && c <= '9') { return c - '0'; }
+		if('a' <= c && c <= 'f') { return c - 'a' + 10; }
+		if('A' <= c && c <= 'F') { return c - 'A' + 10; }
+		throw std::runtime_error("invalid session file : broken chunk");
+	}
+};
+
+//! ZbṼvOCɓǂݍރNX
+//!
+//! [J[XbhGg擪1AW[̓ǂݍ݂ƃCX^X̍쐬A
+//! Ԃ̕܂łꂼɍsB
+//! needs_main_thread̃Gg̓[J[Xbhł͈킸A
+//! GUIXbhRunMainThreadTaskĂяoƂ1쐬AB
+//! ǂݍ݂̐i݋̓GgƂ̏ԂŊmFł̂ŁAGUIɓro߂\łB
+struct SessionLoader
+{
+	//! Gg̃vOC쐬֐
+	//! [J[XbhGUIXbhɌĂяoBԂ̕SessionLoadersB
+	typedef std::function<std::unique_ptr<VstPlugin>(SessionEntry const &entry)> create_function_t;
+
+	enum Status { WAITING, LOADING, LOADED, FAILED };
+
+	//! num_workers	: [J[Xbh̐B0Ȃ烏[J[Xbhg킸ASRunMainThreadTaskœǂݍށB
+	SessionLoader(std::vector<SessionEntry> const &entries, create_function_t create, size_t num_workers)
+		:	entries_(entries)
+		,	create_(create)
+		,	status_(new boost::atomic<int>[entries.size()])
+		,	plugins_(entries.size())
+		,	errors_(entries.size())
+		,	next_worker_entry_(0)
+		,	next_main_entry_(0)
+		,	num_finished_(0)
+		,	is_cancelled_(false)
+	{
+		for(size_t i = 0; i < entries_.size(); ++i) {
+			status_[i] = WAITING;
+		}
+		for(size_t i = 0; i < num_workers; ++i) {
+			workers_.create_thread([this] { worker(); });
+		}
+	}
+
+	~SessionLoader()
+	{
+		Cancel();
+		workers_.join_all();
+	}
+
+	size_t	GetNumEntries() const { return entries_.size(); }
+	SessionEntry const & GetEntry(size_t index) const { return entries_[index]; }
+
+	//! ǂݍ݂I(AsALZ܂)Gg̐
+	size_t	GetNumFinished() const { return num_finished_.load(boost::memory_order_acquire); }
+	bool	IsFinished() const { return GetNumFinished() == entries_.size(); }
+
+	Status	GetStatus(size_t index) const { return static_cast<Status>(status_[index].load(boost::memory_order_acquire)); }
+
+	//! ǂݍ݂ɎsGg̗R
+	//! GetStatusFAILEDԂŌĂяoB
+	std::string const & GetError(size_t index) const
+	{
+		BOOST_ASSERT(GetStatus(index) == FAILED);
+		return errors_[index];
+	}
+
+	//! GUIXbhō쐬Gg1ǂݍ
+	//! GUIXbhA^C}[ȂǂŌJԂĂяoBǂݍނ̂ȂfalseԂB
+	bool	RunMainThreadTask()
+	{
+		bool const use_workers = workers_.size() > 0;
+		for( ; next_main_entry_ < entries_.size(); ++next_main_entry_) {
+			if(!use_workers || entries_[next_main_entry_].needs_main_thread) {
+				load(next_main_entry_++);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//! ܂n߂ĂȂGg̓ǂݍ݂߂
+	//! ǂݍݒ̃Gg͍Ō܂œǂݍ܂B
+	void	Cancel()
+	{
+		is_cancelled_.store(true, boost::memory_order_relaxed);
+		while(RunMainThreadTask()) {}
+	}
+
+	//! SẴGg̓ǂݍ݂I܂ő҂
+	//! GUIXbhō쐬GǵA̒œǂݍށB
+	void	Wait()
+	{
+		while(RunMainThreadTask()) {}
+		workers_.join_all();
+	}
+
+	//! ǂݍ񂾃vOC󂯎
+	//! GetStatusLOADEDԂŁAGUIXbhĂяoBx󂯎GgnullptrԂB
+	std::unique_ptr<VstPlugin> TakePlugin(size_t index)
+	{
+		if(GetStatus(index) != LOADED) { return std::unique_ptr<VstPlugin>(); }
+		return std::move(plugins_[index]);
+	}
+
+private:
+	void	worker()
+	{
+		ThreadRole::SetCurrent(ThreadRole::WORKER);
+		HWM_TRACE_THREAD("SessionLoader");
+		for( ; ; ) {
+			size_t const index = next_worker_entry_.fetch_add(1, boost::memory_order_relaxed);
+			if(index >= entries_.size()) { break; }
+			if(entries_[index].needs_main_thread) { continue; }
+			load(index);
+		}
+	}
+
+	//! Gg1ǂݍ
+	//! ʂ͂̃Gg̗̈ɂ݁AԂreleaseŌJB
+	void	load(size_t index)
+	{
+		if(is_cancelled_.load(boost::memory_order_relaxed)) {
+			errors_[index] = "cancelled";
+			finish(index, FAILED);
+			return;
+		}
+
+		HWM_TRACE_SCOPE("load session entry");
+		status_[index].store(LOADING, boost::memory_order_release);
+		try {
+			SessionEntry const &entry = entries_[index];
+			std::unique_ptr<VstPlugin> plugin = create_(entry);
+			if(!plugin) { throw std::runtime_error("plugin not loaded"); }
+			entry.state.Restore(*plugin);
+			plugins_[index] = std::move(plugin);
+			finish(index, LOADED);
+		} catch(std::exception &e) {
+			errors_[index] = e.what();
+			finish(index, FAILED);
+		}
+	}
+
+	void	finish(size_t index, Status status)
+	{
+		status_[index].store(status, boost::memory_order_release);
+		num_finished_.fetch_add(1, boost::memory_order_release);
+	}
+
+private:
+	std::vector<SessionEntry>					entries_;
+	create_function_t							create_;
+	std::unique_ptr<boost::atomic<int>[]>		status_;
+	std::vector<std::unique_ptr<VstPlugin>>		plugins_;
+	std::vector<std::string>					errors_;
+	boost::thread_group							workers_;
+	boost::atomic<size_t>						next_worker_entry_;
+	size_t										next_main_entry_;
+	boost::atomic<size_t>						num_finished_;
+	boost::atomic<bool>							is_cancelled_;
+
+	SessionLoader(SessionLoader const &);
+	SessionLoader & operator=(SessionLoader const &);
+};
+
+}	//::hwm
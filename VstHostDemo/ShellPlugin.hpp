@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <windows.h>
+
+#include "./VstPlugin.hpp"
+
+namespace hwm {
+
+//! VFvOC(kPlugCategShell)Ɋ܂܂TuvOC
+struct ShellPluginEntry
+{
+	ShellPluginEntry()
+		:	id(0)
+	{}
+
+	ShellPluginEntry(VstInt32 id, std::string const &name)
+		:	id(id)
+		,	name(name)
+	{}
+
+	//! VstPluginshell_plugin_idɎw肷ID
+	VstInt32	id;
+	std::string	name;
+};
+
+//! VFvOC̃TuvOC̈ꗗ擾ALbVNX
+//!
+//! ꗗeffShellGetNextPlugin0Ԃ܂ŌJԂĂяoĎ擾B
+//! 擾ꗗ̓W[ƓfBNgɁuW[̃t@C.shell.txtvƂĕۑĂA
+//! 񂩂̓VFvOC쐬ė񋓂ɁAIDw肵ăTuvOC𒼐ڍ쐬ł悤ɂB
+//! LbVɂ̓W[̃t@CTCYƍXVL^AW[XVĂ΃LbV͎gȂB
+struct ShellPluginCache
+{
+	//! effShellGetNextPluginĂё񐔂̏
+	//! 0ԂȂvOCĂ[vɂȂȂ悤ɂB
+	enum { MAX_ENTRIES = 4096 };
+
+	//! LbVǂݍ
+	//! LbVȂ(VFvOCłȂA܂񋓂ĂȂ)ꍇA
+	//! W[LbV̍쐬ɍXVĂꍇfalseԂB
+	static
+	bool	Load(balor::String const &module_path, std::vector<ShellPluginEntry> &entries)
+	{
+		std::string text;
+		if(!read_file(get_cache_path(module_path).c_str(), text)) { return false; }
+
+		std::istringstream is(text);
+		std::string magic, stamp;
+		if(!std::getline(is, magic) || magic != cache_magic()) { return false; }
+		if(!std::getline(is, stamp) || stamp.empty() || stamp != get_module_stamp(module_path)) { return false; }
+
+		std::vector<ShellPluginEntry> loaded;
+		std::string line;
+		while(std::getline(is, line)) {
+			std::string::size_type const tab = line.find('\t');
+			if(tab == std::string::npos) { continue; }
+			VstInt32 const id = static_cast<VstInt32>(std::strtol(line.substr(0, tab).c_str(), nullptr, 10));
+			if(id == 0) { continue; }
+			loaded.push_back(ShellPluginEntry(id, line.substr(tab + 1)));
+		}
+		entries.swap(loaded);
+		return true;
+	}
+
+	//! VFvOC̃TuvOC񋓂āALbVɏo
+	//! shelĺAIDw肹ɍ쐬VFvOC̃CX^XB
+	//! LbV߂Ȃ(W[̃fBNgɏ݌ȂȂ)ꍇA񋓂ꗗ͕ԂB
+	static
+	std::vector<ShellPluginEntry> Enumerate(VstPlugin &shell)
+	{
+		std::vector<ShellPluginEntry> entries;
+		for(size_t i = 0; i < MAX_ENTRIES; ++i) {
+			char name[256] = {};
+			VstInt32 const id = static_cast<VstInt32>(shell.dispatcher(effShellGetNextPlugin, 0, 0, name, 0));
+			if(id == 0) { break; }
+			name[sizeof(name)-1] = '\0';
+			entries.push_back(ShellPluginEntry(id, name));
+		}
+		Save(shell.GetModulePath(), entries);
+		return entries;
+	}
+
+	//! LbVo
+	static
+	bool	Save(balor::String const &module_path, std::vector<ShellPluginEntry> const &entries)
+	{
+		std::string const stamp = get_module_stamp(module_path);
+		if(stamp.empty()) { return false; }
+
+		std::ostringstream os;
+		os << cache_magic() << "\n" << stamp << "\n";
+		for(auto const &entry: entries) {
+			os << entry.id << "\t" << entry.name << "\n";
+		}
+		return write_file(get_cache_path(module_path).c_str(), os.str());
+	}
+
+private:
+	static
+	char const * cache_magic() { return "VstHostDemo shell plugin cache 1"; }
+
+	static
+	std::wstring get_cache_path(balor::String const &module_path)
+	{
+		return std::wstring(module_path.c_str()) + L".shell.txt";
+	}
+
+	//! W[̃t@CTCYƍXVׂB擾łȂ΋󕶎
+	static
+	std::string get_module_stamp(balor::String const &module_path)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		if(!GetFileAttributesExW(module_path.c_str(), GetFileExInfoStandard, &data)) { return std::string(); }
+
+		boost::uint64_t const size = (static_cast<boost::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+		boost::uint64_t const time =
+			(static_cast<boost::uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+
+		std::ostringstream ss;
+		ss << size << " " << time;
+		return ss.str();
+	}
+
+	static
+	bool	read_file(wchar_t const *path, std::string &text)
+	{
+		HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(file == INVALID_HANDLE_VALUE) { return false; }
+
+		LARGE_INTEGER size;
+		bool ok = GetFileSizeEx(file, &size) && size.QuadPart < 16 * 1024 * 1024;
+		if(ok) {
+			text.resize(static_cast<size_t>(size.QuadPart));
+			DWORD read = 0;
+			ok = text.empty() || (ReadFile(file, &text[0], static_cast<DWORD>(text.size()), &read, NULL) && read == text.size());
+		}
+		CloseHandle(file);
+		return ok;
+	}
+
+	static
+	bool	write_file(wchar_t const *path, std::string const &text)
+	{
+		HANDLE file = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(file == INVALID_HANDLE_VALUE) { return false; }
+
+		DWORD written = 0;
+		bool const ok = WriteFile(file, text.data(), static_cast<DWORD>(text.size()), &written, NULL) && written == text.size();
+		CloseHandle(file);
+		return ok;
+	}
+};
+
+}	//::hwm
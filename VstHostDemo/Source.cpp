@@ -1,11 +1,16 @@
 #include <array>
+#include <cmath>
+#include <fstream>
 #include <memory>
+#include <sstream>
 
+#include <winsock2.h>
 #include <windows.h>
 #include <tchar.h>
 #include <mmsystem.h>
 
 #include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
 #include <boost/range/adaptors.hpp>
 #include <boost/optional.hpp>
 #include <boost/thread.hpp>
@@ -23,9 +28,32 @@
 #include "./vstsdk2.4/pluginterfaces/vst2.x/aeffectx.h"
 #pragma warning(pop)
 
+#include "./AudioAnalyzer.hpp"
+#include "./AudioThread.hpp"
+#include "./BlockAdapter.hpp"
+#include "./Benchmark.hpp"
+#include "./BufferCalibration.hpp"
+#include "./ControlClient.hpp"
+#include "./ControlServer.hpp"
+#include "./GoldenRender.hpp"
 #include "./HostApplication.hpp"
+#include "./ParameterCache.hpp"
+#include "./PluginSwapper.hpp"
+#include "./PluginWatchdog.hpp"
+#include "./RealtimeChecker.hpp"
+#include "./Recorder.hpp"
+#include "./RenderAhead.hpp"
+#include "./Resampler.hpp"
+#include "./Session.hpp"
+#include "./ShellPlugin.hpp"
+#include "./ThreadRole.hpp"
+#include "./Trace.hpp"
 #include "./VstPlugin.hpp"
+#include "./WaveFile.hpp"
 #include "./WaveOutProcessor.hpp"
+#if defined(HWM_USE_JACK)
+#include "./JackProcessor.hpp"
+#endif
 
 namespace hwm {
 
@@ -36,21 +64,381 @@ namespace gpx = balor::graphics;
 
 //! GUIn萔
 static size_t CLIENT_WIDTH = 800;
-static size_t CLIENT_HEIGHT = 200;
+static size_t CLIENT_HEIGHT = 230;
 
 static size_t const KEY_HEIGHT = 50;
 static size_t const KEY_WIDTH = 15;
 static balor::Rectangle const KEYBOARD_RECT(0, CLIENT_HEIGHT - KEY_HEIGHT, CLIENT_WIDTH, KEY_HEIGHT);
 
 //! I[fBIn萔
-static size_t const SAMPLING_RATE = 44100;
-static size_t const BLOCK_SIZE = 1024;
+//! vOCƃfoCX̃TvO[gقȂꍇ́A
+//! vOC̏o͂foCX̃TvO[gɕϊĂĐB
+static size_t const PLUGIN_SAMPLING_RATE = 44100;
+static size_t const DEVICE_SAMPLING_RATE = 44100;
+static size_t const RESAMPLER_TAPS = 32;
+//! ĐXbhŒ肷CPŨ}XNB0ȂŒ肵ȂB
+static DWORD_PTR const AUDIO_THREAD_AFFINITY_MASK = 0;
+//! vOCxɍt[(effSetBlockSizeŐݒ肷l)ƁA
+//! foCX̃obt@̃t[B
+//! ҂قȂꍇBlockAdapterōzB
+//! vOC̃ubNƁAՂĂ特ς܂ł̒xꂪȂB
+static size_t const PLUGIN_BLOCK_SIZE = 256;
+static size_t const DEVICE_BLOCK_SIZE = 1024;
 static size_t const BUFFER_MULTIPLICITY = 4;
+//! "-calibrate"ŒfoCX̃obt@TCYƑdxۑt@C
+//! Nɂ̃t@C΁ADEVICE_BLOCK_SIZEBUFFER_MULTIPLICITY̑ɂ̐ݒgB
+static char const BUFFER_CONFIG_FILE[] = "buffer_config.xml";
+//! svOC̃ubNB0Ȃss킸AfoCX̃R[obNōB
+//! ssƁA̍xꂽAvO̕ύXprocess_mutexێꂽ肵ĂA
+//! foCXւ̋r؂ɂȂB(RenderAheadSettings::live_blocks(1)傫lA܂2ȏw肷邱)
+static size_t const RENDER_AHEAD_BLOCKS = 0;
+//! vOC̏Ɋ蓖Ă鎞Ԃ́AubN̒ɑ΂銄B
+//! JԂPluginWatchdogvOC~[gA΂炭Ă珙XɍĊJB0ȂĎȂB
+static double const WATCHDOG_BUDGET_SHARE = 0.8;
+//! ^p̃Oobt@̒(b)Bt@Cւ݂̏̎Ԉȏ~܂ƁA^f[^B
+static size_t const RECORDER_RING_SECONDS = 4;
+//! ĐɃvOCւƂ̃NXtF[h̒(t[)
+static size_t const SWAP_FADE_FRAMES = 2048;
+//! ZbVǂݍރ[J[Xbh̐B0ȂCPŨRAgB
+static size_t const SESSION_LOAD_WORKERS = 0;
+//! ĐɎgfoCX
+//! HWM_USE_JACK`ărhƁAWindowsWaveI[fBIfoCX̑JACKōĐB
+//! JACKł̓vZXR[obN̒ŒPLUGIN_BLOCK_SIZE̂ŁATvABlockAdapterAs͎g킸A
+//! DEVICE_SAMPLING_RATEADEVICE_BLOCK_SIZEABUFFER_MULTIPLICITYABUFFER_CONFIG_FILEARENDER_AHEAD_BLOCKS͖B
+//! JACKT[o[̃TvO[ǵAPLUGIN_SAMPLING_RATEɍ킹ċNĂƁB
+#if defined(HWM_USE_JACK)
+typedef JackProcessor		AudioDevice;
+static bool const USE_JACK = true;
+#else
+typedef WaveOutProcessor	AudioDevice;
+static bool const USE_JACK = false;
+#endif
+//! vO̕ύXASẴvOCŃvOςVCX^Xւ̍ւōsB
+//! VCX^X̓ǂݍ݂ɎԂ͂邪AĐ̃CX^Xɑ΂effSetProgramĂ΂Ȃ̂ŁA
+//! vO̕ύXdvOCłĐr؂ȂBւ̓rŕύXꍇ͒effSetProgramĂԁB
+//! 傫ȃTvǂݍމȂǂł͍ւ̂قd̂ŁAʏeffSetProgramŕύXA
+//! r؂邱ƂĂvOCAZbṼGgswap_on_program_changeōւgB
+static bool const SWAP_ON_PROGRAM_CHANGE = false;
+//! ÕvOm[gp[^󂯎Rg[\Pbg(ControlServer)JB
+//! \PbgGetDefaultControlSocketPath()̈ʒuɍ쐬B
+static bool const USE_CONTROL_SERVER = true;
+//! Rg[\PbgŎMāAI[fBIXbhɓn܂ŗ߂ĂR}h̐
+static size_t const CONTROL_QUEUE_CAPACITY = 16384;
 
-int main_impl()
+//! GtFNgvOCŁAWAVt@C̐擪疖܂łB
+//! ǂݍ񂾃f[^̓vOC̓̓obt@ɒڏ܂A
+//! vOC̏o͔͂񓯊ɏoB
+//! t[ubNƂprogress֏݁AcanceltrueɂȂ_ŏł؂B
+//! t[ԂB
+//! hostapp̓ItC[hɂĂAubNƂɃt@C̐擪̃Tvʒuݒ肷B
+boost::uint64_t process_wave_file(
+	VstPlugin &vsti, HostApplication &hostapp, MappedWaveFileReader &reader, AsyncWaveFileWriter &writer,
+	boost::atomic<boost::uint64_t> &progress, boost::atomic<bool> const &cancel)
+{
+	boost::uint64_t processed = 0;
+
+	for( ; ; ) {
+		if(cancel.load()) { return processed; }
+		size_t const frames = reader.Read(vsti.GetInputBuffers(), vsti.GetNumInputs(), PLUGIN_BLOCK_SIZE);
+		if(frames == 0) { break; }
+
+		vsti.ProcessEvents();
+		hostapp.SetSamplePosition(static_cast<double>(processed));
+		float **output = vsti.ProcessAudio(frames);
+		writer.Write(output, vsti.GetNumOutputs(), frames);
+		processed += frames;
+		progress.store(processed);
+	}
+
+	//! o[uȂǂ̗]Co߁AvOC񍐂e[̒͂B
+	//! (0͕sA1̓e[Ȃ\Bꍇ10bőł؂)
+	size_t const tail_size = static_cast<size_t>(vsti.dispatcher(effGetTailSize, 0, 0, 0, 0));
+	if(tail_size > 1) {
+		size_t tail_left = std::min<size_t>(tail_size, reader.GetSamplingRate() * 10);
+		for(size_t ch = 0; ch < vsti.GetNumInputs(); ++ch) {
+			std::fill(vsti.GetInputBuffers()[ch], vsti.GetInputBuffers()[ch] + PLUGIN_BLOCK_SIZE, 0.0f);
+		}
+		while(tail_left > 0 && !cancel.load()) {
+			size_t const frames = std::min<size_t>(tail_left, PLUGIN_BLOCK_SIZE);
+			vsti.ProcessEvents();
+			hostapp.SetSamplePosition(static_cast<double>(processed));
+			float **output = vsti.ProcessAudio(frames);
+			writer.Write(output, vsti.GetNumOutputs(), frames);
+			processed += frames;
+			tail_left -= frames;
+			progress.store(processed);
+		}
+	}
+
+	return processed;
+}
+
+//! GtFNgvOC[hꂽꍇ̏
+//! WAVt@CƏoWAVt@CIāAGtFNgt@CoB
+//! t@CłEBhEł܂Ȃ悤ɁAϊ̓[J[XbhōsA
+//! ̊Ԃ͐i݋\EBhEoBEBhE邩Cancelƕϊł؂B
+int run_effect(gui::Frame &frame, VstPlugin &vsti, HostApplication &hostapp)
+{
+	//! o͂̂ȂvOCł́AôȂ(WaveFormatȂ)B
+	if(vsti.GetNumOutputs() == 0) {
+		gui::MessageBox::show(frame.handle(), _T("this plugin has no audio outputs."));
+		return -1;
+	}
+
+	gui::OpenFileDialog input_dialog;
+	input_dialog.pathMustExist(true);
+	input_dialog.filter(_T("Wave File(*.wav)\n*.wav\nAll Files(*.*)\n*.*\n\n"));
+	input_dialog.title(_T("Select an input wave file"));
+	if(!input_dialog.show(frame)) { return 0; }
+
+	gui::SaveFileDialog output_dialog;
+	output_dialog.filter(_T("Wave File(*.wav)\n*.wav\n\n"));
+	output_dialog.title(_T("Select an output wave file"));
+	if(!output_dialog.show(frame)) { return 0; }
+
+	MappedWaveFileReader reader(input_dialog.filePath().c_str());
+
+	//! vOC̃TvO[g̓t@Cɍ킹
+	hostapp.SetSamplingRate(reader.GetSamplingRate());
+	vsti.SetSamplingRate(reader.GetSamplingRate());
+
+	//! o͂32bit floatŏôŁAvOC̏o͂Nbv邱Ƃ͂ȂB
+	WaveFormat const output_format(vsti.GetNumOutputs(), reader.GetSamplingRate(), WaveFormat::FLOAT32);
+	AsyncWaveFileWriter writer(output_dialog.filePath().c_str(), output_format);
+
+	boost::atomic<boost::uint64_t> progress(0);
+	boost::atomic<bool> cancel(false);
+	boost::atomic<bool> finished(false);
+	boost::uint64_t processed = 0;
+	std::string error;
+
+	auto const start = boost::chrono::steady_clock::now();
+	boost::thread worker([&] {
+		//! processReplacingĂяoXbhȂ̂ŁAFTZDAZݒ肷
+		DenormalScope denormal;
+		//! t@C̕ϊ͎ԂɔȂ̂ŁAS[f_[ƓItCƂď
+		//! (audioMasterGetCurrentProcessLevelkVstProcessLevelOfflineAaudioMasterGetTime̓t@C̈ʒuɂȂ)
+		ThreadRoleScope const offline_role(ThreadRole::OFFLINE);
+		hostapp.SetOffline(true);
+		try {
+			processed = process_wave_file(vsti, hostapp, reader, writer, progress, cancel);
+			writer.Close();
+		} catch(std::exception &e) {
+			error = e.what();
+		}
+		hostapp.SetOffline(false);
+		finished.store(true);
+	});
+
+	gui::Frame dialog(L"Processing", 400, 90, gui::Frame::Style::singleLine);
+	dialog.owner(&frame);
+	dialog.maximizeButton(false);
+
+	gpx::Font font_small(L"CI", 12, gpx::Font::Style::regular, gpx::Font::Quality::antialiased);
+	gui::Panel status(dialog, 10, 10, 380, 20);
+	status.onPaint() = [&] (gui::Panel::Paint &e) {
+		e.graphics().font(font_small);
+		e.graphics().backTransparent(true);
+
+		//! e[̏́A̓t@C̒𒴂
+		boost::uint64_t const total = std::max<boost::uint64_t>(reader.GetNumFrames(), 1);
+		std::ostringstream ss;
+		ss	<< progress.load() << " / " << reader.GetNumFrames() << " frames ("
+			<< std::min<boost::uint64_t>(progress.load() * 100 / total, 100) << "%)";
+		e.graphics().drawText(balor::locale::Charset(932, true).decode(ss.str()), balor::Rectangle(0, 0, 380, 20));
+	};
+
+	gui::Button cancel_button(dialog, 320, 35, 70, 22, _T("Cancel"));
+	cancel_button.onClick() = [&] (gui::Button::Click &) {
+		dialog.close();
+	};
+
+	gui::Timer timer(dialog, 100);
+	timer.onRun() = [&] (gui::Timer::Run &) {
+		status.invalidate();
+		if(finished.load()) {
+			dialog.close();
+		}
+	};
+	timer.start();
+	dialog.runMessageLoop();
+	timer.stop();
+
+	cancel.store(!finished.load());
+	worker.join();
+	double const elapsed = boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+
+	if(!error.empty()) {
+		gui::MessageBox::show(frame.handle(), _T("processing failed : ") + balor::locale::Charset(932, true).decode(error));
+		return -1;
+	}
+
+	double const length = static_cast<double>(processed) / reader.GetSamplingRate();
+	gui::MessageBox::show(
+		frame.handle(),
+		(cancel.load() ? _T("Canceled. Processed ") : _T("Processed ")) +
+		std::to_wstring(static_cast<unsigned long long>(processed)) + _T(" frames (") +
+		std::to_wstring(static_cast<long double>(length)) + _T(" sec) in ") +
+		std::to_wstring(static_cast<long double>(elapsed)) + _T(" sec.")
+		);
+
+	return 0;
+}
+
+//! VFvOCɊ܂܂vOCAǂݍނ̂I
+//! IvOCIDԂBLZꂽꍇboost::noneԂB
+boost::optional<VstInt32> select_shell_plugin(gui::Frame &owner, std::vector<ShellPluginEntry> const &entries)
+{
+	if(entries.empty()) {
+		gui::MessageBox::show(owner.handle(), _T("no plugins found in the shell plugin."));
+		return boost::none;
+	}
+
+	std::vector<std::wstring> names;
+	for(auto const &entry: entries) {
+		names.push_back(balor::locale::Charset(932, true).decode(entry.name));
+	}
+
+	gui::Frame dialog(L"Select a plugin in the shell", 320, 80, gui::Frame::Style::singleLine);
+	dialog.owner(&owner);
+	dialog.maximizeButton(false);
+
+	gui::ComboBox list(dialog, 10, 10, 300, 20, names, gui::ComboBox::Style::dropDownList);
+	list.selectedIndex(0);
+
+	boost::optional<VstInt32> selected;
+	gui::Button ok_button(dialog, 240, 40, 70, 22, _T("OK"));
+	ok_button.onClick() = [&] (gui::Button::Click &) {
+		int const index = list.selectedIndex();
+		if(index != -1) {
+			selected = entries[index].id;
+		}
+		dialog.close();
+	};
+
+	dialog.runMessageLoop();
+	return selected;
+}
+
+//! ZbṼGg̃vOC쐬
+//! SessionLoader̃[J[XbhĂяoBԂ̕SessionLoadersB
+std::unique_ptr<VstPlugin> create_session_plugin(SessionEntry const &entry, HostApplication &hostapp)
+{
+	return std::unique_ptr<VstPlugin>(
+		new VstPlugin(
+			balor::String(entry.path.c_str(), balor::locale::Charset(932, true)),
+			PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, &hostapp, entry.shell_plugin_id
+			)
+		);
+}
+
+//! ZbṼvOCɓǂݍ
+//! ǂݍ݂̓ro߂GgƂɕ\EBhEoASēǂݍݏIƕB
+//! EBhErŕƁA܂n߂ĂȂGg̓ǂݍ݂߂B
+//! ǂݍ߂ȂGgnullptrɂȂB
+std::vector<std::unique_ptr<VstPlugin>> load_session(gui::Frame &owner, std::vector<SessionEntry> const &entries, HostApplication &hostapp)
+{
+	size_t const num_workers =
+		std::min<size_t>(
+			SESSION_LOAD_WORKERS ? SESSION_LOAD_WORKERS : std::max<size_t>(boost::thread::hardware_concurrency(), 1),
+			entries.size()
+			);
+	SessionLoader loader(
+		entries,
+		[&hostapp] (SessionEntry const &entry) { return create_session_plugin(entry, hostapp); },
+		num_workers
+		);
+
+	size_t const LINE_HEIGHT = 16;
+	size_t const visible_lines = std::min<size_t>(entries.size(), 20);
+
+	gui::Frame dialog(L"Loading session", 400, 40 + LINE_HEIGHT * (visible_lines + 1), gui::Frame::Style::singleLine);
+	dialog.owner(&owner);
+	dialog.maximizeButton(false);
+
+	gpx::Font font_small(L"CI", 12, gpx::Font::Style::regular, gpx::Font::Quality::antialiased);
+	gui::Panel progress(dialog, 10, 10, 380, LINE_HEIGHT * (visible_lines + 1));
+	progress.onPaint() = [&] (gui::Panel::Paint &e) {
+		static char const * const status_names[] = { "waiting", "loading", "loaded", "failed" };
+		e.graphics().font(font_small);
+		e.graphics().backTransparent(true);
+
+		std::ostringstream ss;
+		ss << loader.GetNumFinished() << " / " << loader.GetNumEntries() << " finished";
+		e.graphics().drawText(balor::locale::Charset(932, true).decode(ss.str()), balor::Rectangle(0, 0, 380, LINE_HEIGHT));
+
+		for(size_t i = 0; i < visible_lines; ++i) {
+			SessionEntry const &entry = loader.GetEntry(i);
+			std::string const line = (entry.name.empty() ? entry.path : entry.name) + " : " + status_names[loader.GetStatus(i)];
+			e.graphics().drawText(balor::locale::Charset(932, true).decode(line), balor::Rectangle(0, LINE_HEIGHT * (i + 1), 380, LINE_HEIGHT));
+		}
+	};
+
+	//! GUIXbhō쐬GǵA^C}[1ǂݍŁÅԂ\XVł悤ɂB
+	gui::Timer timer(dialog, 33);
+	timer.onRun() = [&] (gui::Timer::Run &) {
+		loader.RunMainThreadTask();
+		progress.invalidate();
+		if(loader.IsFinished()) {
+			dialog.close();
+		}
+	};
+	timer.start();
+	dialog.runMessageLoop();
+	timer.stop();
+
+	if(!loader.IsFinished()) {
+		loader.Cancel();
+	}
+	loader.Wait();
+
+	std::vector<std::unique_ptr<VstPlugin>> plugins;
+	std::string errors;
+	for(size_t i = 0; i < loader.GetNumEntries(); ++i) {
+		plugins.push_back(loader.TakePlugin(i));
+		if(loader.GetStatus(i) == SessionLoader::FAILED) {
+			errors += loader.GetEntry(i).path + " : " + loader.GetError(i) + "\n";
+		}
+	}
+	if(!errors.empty()) {
+		gui::MessageBox::show(owner.handle(), _T("some plugins failed to load :\n") + balor::locale::Charset(932, true).decode(errors));
+	}
+	return plugins;
+}
+
+//! foCX̃obt@̐ݒ
+//! BUFFER_CONFIG_FILEǂݍ߂āATvO[gŒ̂ł΂̐ݒA
+//! łȂDEVICE_BLOCK_SIZEBUFFER_MULTIPLICITYԂB
+BufferConfig load_buffer_config()
+{
+	BufferConfig config(DEVICE_BLOCK_SIZE, BUFFER_MULTIPLICITY);
+	config.sampling_rate = DEVICE_SAMPLING_RATE;
+
+	std::ifstream file(BUFFER_CONFIG_FILE);
+	if(!file) { return config; }
+	try {
+		BufferConfig const loaded = BufferConfig::Load(file);
+		if(loaded.sampling_rate == DEVICE_SAMPLING_RATE) { config = loaded; }
+	} catch(std::exception &) {}
+	return config;
+}
+
+int main_impl(boost::optional<std::string> const &session_path)
 {
 	boost::mutex process_mutex;
-	auto get_process_lock = [&] () -> boost::unique_lock<boost::mutex> { return boost::make_unique_lock(process_mutex); };
+	auto get_process_lock = [&] () -> boost::unique_lock<boost::mutex> {
+		HWM_REALTIME_CHECK_LOCK("process_mutex");
+		HWM_TRACE_SCOPE("wait process_mutex");
+		return boost::make_unique_lock(process_mutex);
+	};
+
+	HWM_TRACE_THREAD("GUI");
+
+#if defined(HWM_REALTIME_CHECK)
+	//! foCX̃R[obNōsꂽmۂ⃍bNoB
+	//! ʂ͏Irealtime_violations.txtɏoB
+	RealtimeChecker::GetInstance().Install();
+#endif
 
 	gpx::Font font(L"CI", 18, gpx::Font::Style::regular, gpx::Font::Quality::antialiased);
 	gpx::Font font_small(L"CI", 12, gpx::Font::Style::regular, gpx::Font::Quality::antialiased);
@@ -62,82 +450,353 @@ int main_impl()
 	frame.icon(gpx::Icon::windowsLogo());
 	frame.maximizeButton(false);
 
-	//! [hVSTiI
-	gui::OpenFileDialog  file_dialog;
-	file_dialog.pathMustExist(true);
-	file_dialog.filter(_T("VSTi DLL(*.dll)\n*.dll\nAll Files(*.*)\n*.*\n\n"));
-	file_dialog.title(_T("Select a VSTi DLL"));
-	bool selected = file_dialog.show(frame);
-	if(!selected) { return 0; }
-
 	//! VSTvOCƁA[hĂVSTzXg̊ԂŃf[^Ƃ肷NX
-	HostApplication		hostapp(SAMPLING_RATE, BLOCK_SIZE);
+	HostApplication		hostapp(PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE);
 
-	//! VstPluginNX
-	//! VSTvOCCC^[tF[XłAEffectێāAbvĂ
-	VstPlugin			vsti(file_dialog.filePath(), SAMPLING_RATE, BLOCK_SIZE, &hostapp);
+	//! ZbV
+	//! Đ̃vOC܂߂āAZbṼGgƂɃvOC̃pXƏԂB
+	//! session_pluginśAZbVǂݍ񂾂܂܁A܂ĐɎgĂȂCX^XB
+	std::vector<SessionEntry> session_entries;
+	std::vector<std::unique_ptr<VstPlugin>> session_plugins;
+	size_t session_active = 0;
 
-	if(!vsti.IsSynth()) {
-		gui::MessageBox::show(
-			frame.handle(),
-			_T("This plugin [") + 
-			io::File(file_dialog.filePath()).name() +
-			_T("] is an Audio Effect. VST Instrument is expected.")
-			);
-		return 0;
+	std::unique_ptr<VstPlugin>	vsti;
+	if(session_path) {
+		//! ZbṼvOCɓǂݍ݁Âŏ̃VZTCU[Đ
+		std::ifstream session_file(session_path->c_str());
+		if(!session_file) { throw std::runtime_error("failed to open session file"); }
+		session_entries = Session::Load(session_file).entries;
+		session_plugins = load_session(frame, session_entries, hostapp);
+
+		for(size_t i = 0; i < session_plugins.size() && !vsti; ++i) {
+			if(session_plugins[i] && session_plugins[i]->IsSynth()) {
+				vsti = std::move(session_plugins[i]);
+				session_active = i;
+			}
+		}
+		if(!vsti) { throw std::runtime_error("no synth plugin loaded from the session"); }
+	} else {
+		//! [hVSTiI
+		gui::OpenFileDialog  file_dialog;
+		file_dialog.pathMustExist(true);
+		file_dialog.filter(_T("VSTi DLL(*.dll)\n*.dll\nAll Files(*.*)\n*.*\n\n"));
+		file_dialog.title(_T("Select a VSTi DLL"));
+		bool selected = file_dialog.show(frame);
+		if(!selected) { return 0; }
+
+		//! VstPluginNX
+		//! VSTvOCCC^[tF[XłAEffectێāAbvĂ
+		//! VFvOC̏ꍇ́A܂܂ĂvOC(2ڈȍ~̓LbVǂݍ)āA
+		//! Iꂽ̂IDw肵č쐬B
+		std::vector<ShellPluginEntry> shell_entries;
+		if(!ShellPluginCache::Load(file_dialog.filePath(), shell_entries)) {
+			vsti.reset(new VstPlugin(file_dialog.filePath(), PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, &hostapp));
+			if(vsti->IsShell()) {
+				shell_entries = ShellPluginCache::Enumerate(*vsti);
+				vsti.reset();
+			}
+		}
+		if(!vsti) {
+			boost::optional<VstInt32> const shell_plugin_id = select_shell_plugin(frame, shell_entries);
+			if(!shell_plugin_id) { return 0; }
+			vsti.reset(new VstPlugin(file_dialog.filePath(), PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, &hostapp, shell_plugin_id.get()));
+		}
 	}
 
-	//! Waveo̓NX
+#if defined(HWM_REALTIME_CHECK)
+	//! vOCDLLWin32 APIĂяoĎ
+	RealtimeChecker::GetInstance().HookModuleContaining(reinterpret_cast<void const *>(vsti->GetEffect()->dispatcher));
+#endif
+
+	//! GtFNgvOC̏ꍇ́AA^CĐł͂ȂWAVt@C̕ϊsB
+	if(!vsti->IsSynth()) {
+		return run_effect(frame, *vsti, hostapp);
+	}
+
+	//! ZbVǂݍ܂Ȃꍇ́ÃvOC̃ZbVƂ
+	if(session_entries.empty()) {
+		session_entries.push_back(SessionEntry::Capture(*vsti));
+		session_plugins.resize(1);
+	}
+
+	//! Đ`l
+	//! Đɕʂ̃vOCɍւĂAȍ~̒ĩ`l͍ŏɓǂݍ񂾃vOĈ̂ςȂB
+	size_t const num_outputs = vsti->GetNumOutputs();
+
+	//! Waveo̓NX(HWM_USE_JACK`ꍇJACK̃NCAg)
 	//! WindowsWaveI[fBIfoCXI[vāAI[fBI̍ĐsB
-	WaveOutProcessor	wave_out_;
+	AudioDevice		audio_device;
+
+	//! ĐTvO[g
+	size_t const output_sampling_rate = USE_JACK ? PLUGIN_SAMPLING_RATE : DEVICE_SAMPLING_RATE;
+
+	//! foCX̃obt@TCYƑdx
+	//! -calibrateŒݒ肪ۑĂ΂gAȂDEVICE_BLOCK_SIZEBUFFER_MULTIPLICITYgB
+	BufferConfig const buffer_config = load_buffer_config();
+	size_t const device_block_size = buffer_config.block_size;
+
+	//! vOC̏o͂foCX̗vɍ킹i
+	//! TvO[gقȂꍇResamplingStageŕϊA
+	//! ubNTCYقȂꍇBlockAdapterŋ؂蒼B
+	//! ǂȂvOC̏o͂̂܂܎gB
+	std::unique_ptr<ResamplingStage> resampling_stage;
+	std::unique_ptr<BlockAdapter> block_adapter;
+	std::vector<std::vector<float>> device_buffers;
+	std::vector<float *> device_heads;
+	if(USE_JACK) {
+		//! JACK̃vZXR[obNŒڍ
+	} else if(PLUGIN_SAMPLING_RATE != DEVICE_SAMPLING_RATE && num_outputs > 0) {
+		resampling_stage.reset(
+			new ResamplingStage(num_outputs, PLUGIN_SAMPLING_RATE, DEVICE_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, device_block_size, RESAMPLER_TAPS)
+			);
+	} else if(PLUGIN_BLOCK_SIZE != device_block_size && num_outputs > 0 && RENDER_AHEAD_BLOCKS == 0) {
+		block_adapter.reset(new BlockAdapter(num_outputs, PLUGIN_BLOCK_SIZE, device_block_size));
+	}
 
+	//! s
+	//! [J[XbhPLUGIN_BLOCK_SIZEP(Tvꍇ͕ϊ̃t[)ōi߂ĂA
+	//! foCX̃R[obNł͂oɂB
+	std::unique_ptr<RenderAhead> render_ahead;
+	std::vector<std::vector<float>> ahead_buffers;
+	std::vector<float *> ahead_heads;
+	if(RENDER_AHEAD_BLOCKS > 0 && num_outputs > 0 && !USE_JACK) {
+		RenderAheadSettings settings;
+		settings.ahead_blocks = RENDER_AHEAD_BLOCKS;
+		render_ahead.reset(new RenderAhead(num_outputs, PLUGIN_BLOCK_SIZE, device_block_size, settings));
+		if(resampling_stage) {
+			ahead_buffers.resize(num_outputs, std::vector<float>(PLUGIN_BLOCK_SIZE));
+			for(auto &buffer: ahead_buffers) {
+				ahead_heads.push_back(buffer.data());
+			}
+		}
+	}
+
+	//! Ղ̑Ȃǂsɒm点B
+	//! sčς݂̃f[^̂ACxgfĂȂB
+	auto notify_live_event = [&] {
+		if(render_ahead) {
+			render_ahead->NotifyLiveEvent();
+		}
+	};
+
+	if(resampling_stage || block_adapter || render_ahead) {
+		device_buffers.resize(num_outputs, std::vector<float>(device_block_size));
+		for(auto &buffer: device_buffers) {
+			device_heads.push_back(buffer.data());
+		}
+	}
+
+	//! vOC̍ւ
+	//! ǂݍ񂾃CX^XPluginSwapperێAȍ~swapper.GetActive()oRĎgB
+	//! Đswapper.ProcesssAւ̍ۂ͐ṼCX^XNXtF[hB
+	PluginSwapper swapper(std::move(vsti), num_outputs, std::max<size_t>(PLUGIN_BLOCK_SIZE, device_block_size), SWAP_FADE_FRAMES);
+
+	//! vOC̏Ԃ̊Ď
+	//! VZTCU[Ȃ̂ŃoCpX̏o͖͂ɂȂB
+	//! ~[gĂԂɓ͂Cxg̓ubNƂɎ̂ĂāAɃI[m[gIt(CC#123)uĂB
+	//! ĊJɂ́A~[g̑OĂm[g~߂ĂǍ̃CxgvOC֓nB
+	//! (~[g̑OɉāA~[gɗꂽՂ̉葱Ȃ悤ɂ)
+	WatchdogSettings watchdog_settings;
+	watchdog_settings.budget_share = WATCHDOG_BUDGET_SHARE;
+	watchdog_settings.mode = WatchdogSettings::MUTE;
+	PluginWatchdog watchdog(
+		swapper.GetActive().GetEffectName(), PLUGIN_SAMPLING_RATE, num_outputs,
+		std::max<size_t>(PLUGIN_BLOCK_SIZE, device_block_size), watchdog_settings
+		);
+
+	//! Rg[\Pbg
+	//! MR}h́AXbhubNƂDispatchŃvOCƃzXgɓKpB
+	ControlServer control_server(CONTROL_QUEUE_CAPACITY);
+
+	//! frames̍
+	//! VstPluginɒǉm[gCxgAubNƂɃvOC֓nĂ獇B
+	//! Rg[\Pbg̃R}h́A~[gL[ɗ܂葱Ȃ悤ɁAĎ̊OŎoB
+	auto render = [&] (size_t frames) -> float ** {
+		control_server.Dispatch(swapper.GetActive(), hostapp);
+		auto process = [&] {
+			swapper.Process(frames);
+		};
+		if(WATCHDOG_BUDGET_SHARE == 0) {
+			process();
+		} else if(!watchdog.Run(swapper.GetOutputBuffers(), frames, process, [] (float * const *, size_t) {})) {
+			swapper.GetActive().DiscardEvents();
+		}
+		hostapp.AdvanceTransport(frames);
+		return swapper.GetOutputBuffers();
+	};
+
+	//! vOC̃ubN̍
+	auto render_block = [&] () -> float ** {
+		return render(PLUGIN_BLOCK_SIZE);
+	};
+
+	//! Đf[^̉
+	//! ĐXbhŋ߂xg`AXyNgA
+	//! process_mutexg킸Ƀgvobt@oRGUIXbhɓnB
+	AudioAnalyzer analyzer(num_outputs, output_sampling_rate);
+
+	//! ^
+	//! ĐXbhł͍f[^Oobt@ɃRs[邾ŁA
+	//! t@Cւ݂̏Recordeȑ݃XbhsB
+	Recorder recorder(std::max<size_t>(num_outputs, 1), output_sampling_rate, output_sampling_rate * RECORDER_RING_SECONDS);
+
+	//! ĐXbh̐ݒ
+	//! MMCSSɓo^ėDxグAKvȂCPUŒ肷B
+	//! JACK̃vZXXbhJACKXPW[OǗ̂ŁAFTZDAZݒ肷B
+	AudioThreadSettings thread_settings;
+	thread_settings.affinity_mask = AUDIO_THREAD_AFFINITY_MASK;
+	audio_device.SetThreadSettings(thread_settings);
+
+	//! ĐɃANZXobt@A炩߃y[WCăbNĂB
+	swapper.GetActive().VisitBufferMemory([&] (void *data, size_t bytes) { audio_device.LockMemory(data, bytes); });
+	swapper.VisitMemory([&] (void *data, size_t bytes) { audio_device.LockMemory(data, bytes); });
+	for(auto &buffer: device_buffers) {
+		audio_device.LockMemory(buffer.data(), buffer.size() * sizeof(float));
+	}
+	if(block_adapter) {
+		block_adapter->VisitMemory([&] (void *data, size_t bytes) { audio_device.LockMemory(data, bytes); });
+	}
+	if(render_ahead) {
+		render_ahead->VisitMemory([&] (void *data, size_t bytes) { audio_device.LockMemory(data, bytes); });
+	}
+	analyzer.VisitMemory([&] (void *data, size_t bytes) { audio_device.LockMemory(data, bytes); });
+	recorder.VisitMemory([&] (void *data, size_t bytes) { audio_device.LockMemory(data, bytes); });
+	watchdog.VisitMemory([&] (void *data, size_t bytes) { audio_device.LockMemory(data, bytes); });
+	control_server.VisitMemory([&] (void *data, size_t bytes) { audio_device.LockMemory(data, bytes); });
+
+	//! s̃[J[XbhJn
+	//! process_mutex̓[J[Xbh̊Ԃ̂ŁAfoCX̃R[obN̓bN҂ȂB
+	//! [J[Xbh̗Dx́AĐXbhiႭĂB
+	if(render_ahead) {
+		AudioThreadSettings worker_settings = thread_settings;
+		worker_settings.priority = THREAD_PRIORITY_HIGHEST;
+		render_ahead->Start(
+			[&] () -> float const * const * {
+				auto lock = get_process_lock();
+				if(resampling_stage) {
+					resampling_stage->Pull(ahead_heads.data(), PLUGIN_BLOCK_SIZE, render_block);
+					return ahead_heads.data();
+				}
+				return render_block();
+			},
+			worker_settings
+			);
+	}
+
+#if defined(HWM_USE_JACK)
+	//! JACKT[o[ɐڑ
+	//! vZXR[obN̒ŁAJACK1PLUGIN_BLOCK_SIZEāA|[g̃obt@֒ڏށB
+	//! ԂɃXbhobt@܂Ȃ̂ŁAǉ郌CeVJACK1ɂȂB
+	bool const open_device =
+		audio_device.OpenDevice(
+			"VstHostDemo",
+			PLUGIN_SAMPLING_RATE,
+			2,	//2ch
+			[&] (float **data, size_t device_channel, size_t frames) {
+
+				HWM_REALTIME_SCOPE();
+
+				//! JACK̃vZXR[obN̓bN҂ĂȂ̂ŁA
+				//! GUIXbhvO̕ύXȂǂprocess_mutexĂԂ́A̎𖳉ɂB
+				boost::unique_lock<boost::mutex> lock(process_mutex, boost::try_to_lock);
+				if(!lock.owns_lock()) {
+					HWM_TRACE_INSTANT("process_mutex busy");
+					for(size_t ch = 0; ch < device_channel; ++ch) {
+						std::fill(data[ch], data[ch] + frames, 0.0f);
+					}
+					return;
+				}
+
+				for(size_t done = 0; done < frames; ) {
+					size_t const n = std::min<size_t>(frames - done, PLUGIN_BLOCK_SIZE);
+					float **syntheized = render(n);
+
+					analyzer.Process(syntheized, num_outputs, n);
+					recorder.Push(syntheized, num_outputs, n);
+
+					for(size_t ch = 0; ch < device_channel; ++ch) {
+						if(ch < num_outputs) {
+							std::copy(syntheized[ch], syntheized[ch] + n, data[ch] + done);
+						} else {
+							std::fill(data[ch] + done, data[ch] + done + n, 0.0f);
+						}
+					}
+					done += n;
+				}
+			}
+		);
+#else
 	//! foCXI[v
 	bool const open_device =
-		wave_out_.OpenDevice(
-			SAMPLING_RATE, 
+		audio_device.OpenDevice(
+			DEVICE_SAMPLING_RATE, 
 			2,	//2ch
-			BLOCK_SIZE,				// obt@TCYBĐr؂鎞͂̒l𑝂₷BCeV͑傫ȂB
-			BUFFER_MULTIPLICITY,	// obt@dxBĐr؂鎞͂̒l𑝂₷BCeV͑傫ȂB
+			device_block_size,		// obt@TCYBĐr؂鎞-calibrateŒ(l𑝂₷ƃCeV͑傫Ȃ)B
+			buffer_config.multiplicity,	// obt@dxBB
 
 			//! foCXobt@ɋ󂫂ƂɌĂ΂R[obN֐B
 			//! ̃AvP[Vł́AVstPluginɑ΂čsAI[fBIf[^WaveOutProcessor̍Đobt@֏łB
 			[&] (short *data, size_t device_channel, size_t sample) {
 
-				auto lock = get_process_lock();
+				HWM_REALTIME_SCOPE();
 
-				//! VstPluginɒǉm[gCxg
-				//! Đpf[^ƂĎۂ̃vOCɓn
-				vsti.ProcessEvents();
-				
-				//! sample̎Ԃ̃I[fBIf[^
-				float **syntheized = vsti.ProcessAudio(sample);
+				float **syntheized = nullptr;
 
-				size_t const channels_to_be_played = 
-					std::min<size_t>(device_channel, vsti.GetEffect()->numOutputs);
+				//! ssĂꍇAprocess_mutex̓[J[XbhB
+				boost::unique_lock<boost::mutex> lock;
+				if(!render_ahead) {
+					lock = get_process_lock();
+				}
+
+				if(render_ahead) {
+					//! [J[XbhĂf[^AsampleoB
+					render_ahead->Pull(device_heads.data(), sample);
+					syntheized = device_heads.data();
+				} else if(resampling_stage) {
+					//! vOCPLUGIN_BLOCK_SIZEPʂōA
+					//! foCX̃TvO[gɕϊf[^sampleoB
+					resampling_stage->Pull(device_heads.data(), sample, render_block);
+					syntheized = device_heads.data();
+				} else if(block_adapter) {
+					//! vOCPLUGIN_BLOCK_SIZEPʂōA
+					//! ̃f[^sampleoB
+					block_adapter->Pull(device_heads.data(), sample, render_block);
+					syntheized = device_heads.data();
+				} else {
+					//! VstPluginɒǉm[gCxg
+					//! Đpf[^ƂĎۂ̃vOCɓnĂA
+					//! sample̎Ԃ̃I[fBIf[^
+					//! ɗ̂̓ubNTCYꍇAo͂̂ȂvOCŒiȂꍇB
+					//! ҂łsamplePLUGIN_BLOCK_SIZE𒴂邱Ƃ̂ŁAPLUGIN_BLOCK_SIZEɕčB
+					//! (o͂Ȃ΁AŌ̃ubN̏o͂ԂĂȂ)
+					for(size_t done = 0; done < sample; ) {
+						size_t const n = std::min<size_t>(sample - done, PLUGIN_BLOCK_SIZE);
+						syntheized = render(n);
+						done += n;
+					}
+				}
+
+				analyzer.Process(syntheized, num_outputs, sample);
+				recorder.Push(syntheized, num_outputs, sample);
 
 				//! f[^I[fBIfoCX̃`lȓ̃f[^̈ɏoB
 				//! foCX̃Tv^Cv16bitŊJĂ̂ŁA
 				//! VST-1.0 .. 1.0̃I[fBIf[^-32768 .. 32767ɕϊĂB
 				//! ܂AVSTōf[^̓`lƂɗ񂪕Ă̂ŁA
 				//! WaveformI[fBIfoCXɗOɃC^[[uB
-				for(size_t ch = 0; ch < channels_to_be_played; ++ch) {
-					for(size_t fr = 0; fr < sample; ++fr) {
-						double const sample = syntheized[ch][fr] * 32768.0;
-						data[fr * device_channel + ch] =
-							static_cast<short>(
-								std::max<double>(-32768.0, std::min<double>(sample, 32767.0))
-								);
-					}
-				}
+				//! (S[f_[̌؂łϊg)
+				InterleaveToShort(syntheized, num_outputs, data, device_channel, sample);
 			}
 		);
+#endif
 
 	if(open_device == false) {
 		return -1;
 	}
 
 	//! VST́AȂǂchar *ňAbalorłUnicodeňB
-	balor::String eff_name(vsti.GetEffectName(), balor::locale::Charset(932, true));
+	//! vOCւƂ́AVvOC̖OɕςB
+	balor::String eff_name(swapper.GetActive().GetEffectName(), balor::locale::Charset(932, true));
 
 	//! frame̕`Cxgnh
 	//! Ղ`悷B
@@ -178,6 +837,7 @@ int main_impl()
 	};
 
 	frame.onMouseDown() = [&] (gui::Frame::MouseDown &e) {
+		HWM_TRACE_SCOPE("onMouseDown");
 		BOOST_ASSERT(!sent_note);
 
 		if(!e.lButton() || e.ctrl() || e.shift()) {
@@ -192,11 +852,13 @@ int main_impl()
 		e.sender().captured(true);
 
         //! vOCɃm[gIݒ
-		vsti.AddNoteOn(note_number.get());
+		swapper.GetActive().AddNoteOn(note_number.get());
+		notify_live_event();
 		sent_note = note_number;
 	};
 
 	frame.onMouseMove() = [&] (gui::Frame::MouseEvent &e) {
+		HWM_TRACE_SCOPE("onMouseMove");
 		if(!sent_note) {
 			return;
 		}
@@ -210,12 +872,14 @@ int main_impl()
 			return;
 		}
 
-		vsti.AddNoteOff(sent_note.get());
-		vsti.AddNoteOn(note_number.get());
+		swapper.GetActive().AddNoteOff(sent_note.get());
+		swapper.GetActive().AddNoteOn(note_number.get());
+		notify_live_event();
 		sent_note = note_number;
 	};
 
 	frame.onMouseUp() = [&] (gui::Frame::MouseUp &e) {
+		HWM_TRACE_SCOPE("onMouseUp");
 		if(!sent_note) {
 			return;
 		}
@@ -224,25 +888,139 @@ int main_impl()
 			e.sender().captured(false);
 		}
 
-		vsti.AddNoteOff(sent_note.get());
+		swapper.GetActive().AddNoteOff(sent_note.get());
+		notify_live_event();
 		sent_note = boost::none;
 	};
 
 	frame.onDeactivate() = [&] (gui::Frame::Deactivate &/*e*/) {
 		if(sent_note) {
-			vsti.AddNoteOff(sent_note.get());
+			swapper.GetActive().AddNoteOff(sent_note.get());
+			notify_live_event();
 			sent_note = boost::none;
 		}
 	};
 
 	//! vOC̕`
 	gui::Panel plugin_name(frame, 10, 10, 125, 27);
-	plugin_name.onPaint() = [&font, eff_name] (gui::Panel::Paint &e) {
+	plugin_name.onPaint() = [&font, &eff_name] (gui::Panel::Paint &e) {
 		e.graphics().font(font);
 		e.graphics().backTransparent(true);
 		e.graphics().drawText(eff_name, e.sender().clientRectangle());
 	};
 
+	//! ĐXbh̐ݒ茋ʂ̕\
+	//! ݒ͍ĐXbh(JACKł̓vZXXbh)̊JnɍŝŁAfoCXJA`̂тɓǂށB
+	gui::Panel audio_thread_status_label(frame, 10, 45, 500, 18);
+	audio_thread_status_label.onPaint() = [&font_small, &audio_device, &buffer_config] (gui::Panel::Paint &e) {
+		std::wstring const audio_thread_status =
+			balor::locale::Charset(932, true).decode(
+				audio_device.GetThreadSetupResult().ToString() + ", " + audio_device.GetMemoryLocker().ToString() +
+				(USE_JACK ? "" : ", buffer: " + buffer_config.ToString())
+				);
+		e.graphics().font(font_small);
+		e.graphics().backTransparent(true);
+		e.graphics().drawText(audio_thread_status, e.sender().clientRectangle());
+	};
+
+	//! x[^[Ag`AXyNg̕`
+	//! ĐXbhJŐV̉͌ʂA^C}[ŒIɓǂݏoĕ`悷B
+	//! ǂݏo̓gvobt@̌Ȃ̂ŁAĐXbh҂邱Ƃ͂ȂB
+	gui::Panel meter_panel(frame, 230, 70, 560, 75);
+	meter_panel.onPaint() = [&analyzer] (gui::Panel::Paint &e) {
+		HWM_TRACE_SCOPE("meter paint");
+		MeterSnapshot const &snapshot = analyzer.GetFeed().Front();
+		balor::Rectangle const rect = e.sender().clientRectangle();
+		int const height = rect.height;
+
+		e.graphics().pen(gpx::Color(40, 40, 40));
+		e.graphics().brush(gpx::Color(20, 20, 20));
+		e.graphics().drawRectangle(0, 0, rect.width, height);
+
+		auto level_to_y = [height] (float db) -> int {
+			float const range = 60.0f;
+			return static_cast<int>(height * std::min<float>(-db / range, 1.0f));
+		};
+
+		//! x[^[ : `lƂɁARMS_ŁAs[Nŕ\(-60dB .. 0dB)
+		size_t const meter_channels = std::min<size_t>(snapshot.num_channels, 2);
+		for(size_t ch = 0; ch < meter_channels; ++ch) {
+			int const x = 5 + static_cast<int>(ch) * 14;
+			int const rms_y = level_to_y(AudioAnalyzer::ToDecibel(snapshot.rms[ch]));
+			int const peak_y = level_to_y(AudioAnalyzer::ToDecibel(snapshot.peak[ch]));
+
+			e.graphics().pen(gpx::Color(60, 200, 80));
+			e.graphics().brush(gpx::Color(60, 200, 80));
+			if(rms_y < height) {
+				e.graphics().drawRectangle(x, rms_y, 10, height - rms_y);
+			}
+			e.graphics().pen(snapshot.peak[ch] >= 1.0f ? gpx::Color(250, 60, 60) : gpx::Color(240, 240, 120));
+			e.graphics().drawLine(x, peak_y, x + 10, peak_y);
+		}
+
+		//! g` : ԈԂƂ̍ŏlől܂łcŕ`
+		int const wave_left = 40;
+		int const wave_width = 250;
+		int const wave_center = height / 2;
+		e.graphics().pen(gpx::Color(120, 180, 250));
+		for(int x = 0; x < wave_width; ++x) {
+			size_t const point = x * MeterSnapshot::WAVEFORM_POINTS / wave_width;
+			float mn = 0;
+			float mx = 0;
+			for(size_t ch = 0; ch < meter_channels; ++ch) {
+				mn = std::min<float>(mn, snapshot.waveform_min[ch][point]);
+				mx = std::max<float>(mx, snapshot.waveform_max[ch][point]);
+			}
+			int const top = wave_center - static_cast<int>(std::min<float>(mx, 1.0f) * (height / 2));
+			int const bottom = wave_center - static_cast<int>(std::max<float>(mn, -1.0f) * (height / 2));
+			e.graphics().drawLine(wave_left + x, top, wave_left + x, bottom + 1);
+		}
+
+		//! XyNg : 20Hz .. 20kHz̑ΐAc-100dB .. 0dB
+		int const spectrum_left = 300;
+		int const spectrum_width = rect.width - spectrum_left - 5;
+		double const bin_hz = snapshot.sampling_rate / static_cast<double>(MeterSnapshot::FFT_SIZE);
+		e.graphics().pen(gpx::Color(250, 170, 60));
+		for(int x = 0; x < spectrum_width; ++x) {
+			double const f0 = 20.0 * pow(1000.0, x / static_cast<double>(spectrum_width));
+			double const f1 = 20.0 * pow(1000.0, (x + 1) / static_cast<double>(spectrum_width));
+			size_t const bin0 = std::min<size_t>(static_cast<size_t>(f0 / bin_hz), MeterSnapshot::SPECTRUM_BINS - 1);
+			size_t const bin1 = std::min<size_t>(std::max<size_t>(static_cast<size_t>(f1 / bin_hz), bin0 + 1), MeterSnapshot::SPECTRUM_BINS);
+			float db = MIN_DB;
+			for(size_t bin = bin0; bin < bin1; ++bin) {
+				db = std::max<float>(db, snapshot.spectrum_db[bin]);
+			}
+			int const y = static_cast<int>(height * std::min<float>(-db / 100.0f, 1.0f));
+			if(y < height) {
+				e.graphics().drawLine(spectrum_left + x, y, spectrum_left + x, height);
+			}
+		}
+	};
+
+	//! 30fpsŉ͌ʂmFAVʂ΍ĕ`悷
+	gui::Timer meter_timer(frame, 33);
+	meter_timer.onRun() = [&] (gui::Timer::Run &) {
+		HWM_TRACE_SCOPE("meter timer");
+		if(analyzer.GetFeed().Update()) {
+			meter_panel.invalidate();
+		}
+	};
+
+	//! s̓v̕\
+	//! sg؂(drains)ƁA܂ĂubN̍ŏl(min fill)A
+	//! słǂꂾĐ̓r؂hĂ邩̖ڈɂȂB
+	gui::Panel render_ahead_label(frame, 230, 20, 560, 18);
+	render_ahead_label.onPaint() = [&] (gui::Panel::Paint &e) {
+		if(!render_ahead) { return; }
+		e.graphics().font(font_small);
+		e.graphics().backTransparent(true);
+		e.graphics().drawText(
+			balor::locale::Charset(932, true).decode(render_ahead->GetStats().ToString()),
+			e.sender().clientRectangle()
+			);
+	};
+	meter_timer.start();
+
 	//! vOXg̐ݒu
 	gui::Panel program_list_label(frame, 10, 80, 75, 18);
 	program_list_label.onPaint() = [&font_small] (gui::Panel::Paint &e) {
@@ -251,26 +1029,316 @@ int main_impl()
 		e.graphics().drawText(_T("Program List"), e.sender().clientRectangle());
 	};
 
-	std::vector<std::wstring> program_names(vsti.GetNumPrograms());
-	for(size_t i = 0; i < vsti.GetNumPrograms(); ++i) {
-		program_names[i] = balor::locale::Charset(932, true).decode(vsti.GetProgramName(i));
-	}
+	auto get_program_names = [] (VstPlugin &plugin) -> std::vector<std::wstring> {
+		std::vector<std::wstring> program_names(plugin.GetNumPrograms());
+		for(size_t i = 0; i < plugin.GetNumPrograms(); ++i) {
+			program_names[i] = balor::locale::Charset(932, true).decode(plugin.GetProgramName(i));
+		}
+		return program_names;
+	};
 
-	gui::ComboBox program_list(frame, 10, 100, 200, 20, program_names, gui::ComboBox::Style::dropDownList);
+	//! path̃vOC(VFvOC̏ꍇ͂̂shell_plugin_id̂)ǂݍ݁A
+	//! stateΕāAĐɎg悤ɂ֐
+	//! ֐́APluginSwapper̓ǂݍݗp̃XbhŌĂяoB
+	//! needs_main_threadtrueȂAZbV̓ǂݍ݂ƓSessionLoaderRunMainThreadTaskg
+	//! ̏(GUIXbh)ō쐬ƏԂ̕܂ōς܂ĂAǂݍݗp̃Xbhł͂󂯎邾ɂB
+	HostApplication *host = &hostapp;
+	AudioDevice *device = &audio_device;
+	auto make_loader = [host, device] (balor::String path, VstInt32 shell_plugin_id, boost::optional<PluginState> state, bool needs_main_thread) -> PluginSwapper::loader_function_t {
+		//! std::function̓Rs[łKv̂ŁA쐬CX^Xshared_ptrɕœn
+		auto preloaded = std::make_shared<std::unique_ptr<VstPlugin>>();
+		std::string error;
+		if(needs_main_thread) {
+			SessionEntry main_thread_entry;
+			main_thread_entry.path = balor::locale::Charset(932, true).encode(path);
+			main_thread_entry.shell_plugin_id = shell_plugin_id;
+			main_thread_entry.needs_main_thread = true;
+			if(state) { main_thread_entry.state = *state; }
+			SessionLoader loader(
+				std::vector<SessionEntry>(1, main_thread_entry),
+				[host] (SessionEntry const &entry) { return create_session_plugin(entry, *host); },
+				0
+				);
+			loader.Wait();
+			*preloaded = loader.TakePlugin(0);
+			if(!*preloaded) { error = loader.GetError(0); }
+		}
+		return [host, device, path, shell_plugin_id, state, needs_main_thread, preloaded, error] () -> std::unique_ptr<VstPlugin> {
+			std::unique_ptr<VstPlugin> plugin;
+			if(needs_main_thread) {
+				if(!*preloaded) { throw std::runtime_error(error); }
+				plugin = std::move(*preloaded);
+			} else {
+				plugin.reset(new VstPlugin(path, PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, host, shell_plugin_id));
+			}
+			if(plugin->IsShell()) {
+				//! ߂ēǂݍ񂾃VFvOĆAŗ񋓂ăLbVĂB
+				//! Load{^œt@CI񂾂ƂɁA܂܂ĂvOCIłB
+				ShellPluginCache::Enumerate(*plugin);
+				throw std::runtime_error("shell plugin enumerated. select it again to choose a plugin in the shell");
+			}
+			if(!plugin->IsSynth()) { throw std::runtime_error("not a synth plugin"); }
+			if(state && !needs_main_thread) {
+				state->Restore(*plugin);
+			}
+			plugin->VisitBufferMemory([device] (void *data, size_t bytes) { device->LockMemory(data, bytes); });
+			return plugin;
+		};
+	};
+
+	gui::ComboBox program_list(frame, 10, 100, 200, 20, get_program_names(swapper.GetActive()), gui::ComboBox::Style::dropDownList);
 	program_list.list().font(font_small);
 	program_list.onSelect() = [&] (gui::ComboBox::Select &e) {
+		HWM_TRACE_SCOPE("onSelect program");
 		int const selected = e.sender().selectedIndex();
 		if(selected != -1) {
-			auto lock = get_process_lock();
-			vsti.SetProgram(selected);
+			VstPlugin &active = swapper.GetActive();
+			bool const swap = SWAP_ON_PROGRAM_CHANGE || session_entries[session_active].swap_on_program_change;
+			if(swap && !swapper.IsBusy()) {
+				//! ݂̏ԂpVCX^XŃvOύXĂ獷ւB
+				PluginState state = PluginState::Capture(active);
+				state.program = selected;
+				swapper.RequestSwap(make_loader(active.GetModulePath(), active.GetShellPluginId(), state, session_entries[session_active].needs_main_thread));
+				return;
+			}
+			{
+				auto lock = get_process_lock();
+				HWM_TRACE_SCOPE("SetProgram");
+				active.SetProgram(selected);
+			}
+			active.GetParameters().Reload();
+			notify_live_event();
+		}
+	};
+
+	//! vOC̍ւ
+	//! Load{^ŕʂ̃vOCAReload{^ō̃vOCԂpœǂݍݒA
+	//! Đ~߂ɃNXtF[hōւB
+	gui::Button load_button(frame, 90, 77, 60, 20, _T("Load"));
+	load_button.font(font_small);
+	load_button.onClick() = [&] (gui::Button::Click &) {
+		if(swapper.IsBusy()) { return; }
+
+		gui::OpenFileDialog load_dialog;
+		load_dialog.pathMustExist(true);
+		load_dialog.filter(_T("VSTi DLL(*.dll)\n*.dll\nAll Files(*.*)\n*.*\n\n"));
+		load_dialog.title(_T("Select a VSTi DLL"));
+		if(!load_dialog.show(frame)) { return; }
+
+		VstInt32 shell_plugin_id = 0;
+		std::vector<ShellPluginEntry> entries;
+		if(ShellPluginCache::Load(load_dialog.filePath(), entries)) {
+			boost::optional<VstInt32> const selected = select_shell_plugin(frame, entries);
+			if(!selected) { return; }
+			shell_plugin_id = selected.get();
+		}
+
+		swapper.RequestSwap(make_loader(load_dialog.filePath(), shell_plugin_id, boost::none, false));
+		load_button.text(_T("Loading"));
+	};
+
+	gui::Button reload_button(frame, 155, 77, 60, 20, _T("Reload"));
+	reload_button.font(font_small);
+	reload_button.onClick() = [&] (gui::Button::Click &) {
+		if(swapper.IsBusy()) { return; }
+
+		VstPlugin &active = swapper.GetActive();
+		swapper.RequestSwap(
+			make_loader(active.GetModulePath(), active.GetShellPluginId(), PluginState::Capture(active), session_entries[session_active].needs_main_thread)
+			);
+		load_button.text(_T("Loading"));
+	};
+
+	//! ZbV̕ۑƐ؂ւ
+	//! Save{^ŁAĐ̃vOCƃZbV̑̃vOC̏Ԃt@CɏoB
+	//! (Load{^œǂݍ񂾃vOĆAI𒆂̃Gg̃vOCƂĕۑ)
+	//! XgŃGgIԂƁÃvOCɍւB
+	//! ZbVǂݍ񂾃CX^X͈x̂܂܎gAȍ~͕ۑĂԂ蒼B
+	std::vector<std::wstring> session_names;
+	for(auto const &entry: session_entries) {
+		session_names.push_back(balor::locale::Charset(932, true).decode(entry.name.empty() ? entry.path : entry.name));
+	}
+	gui::ComboBox session_list(frame, 85, 152, 300, 20, session_names, gui::ComboBox::Style::dropDownList);
+	session_list.list().font(font_small);
+	session_list.selectedIndex(session_active);
+	session_list.onSelect() = [&] (gui::ComboBox::Select &e) {
+		int const selected = e.sender().selectedIndex();
+		if(selected == -1 || static_cast<size_t>(selected) == session_active) { return; }
+		if(swapper.IsBusy() || (session_plugins[selected] && !session_plugins[selected]->IsSynth())) {
+			e.sender().selectedIndex(session_active);
+			return;
 		}
+
+		SessionEntry &current = session_entries[session_active];
+		current.Update(swapper.GetActive());
+
+		if(session_plugins[selected]) {
+			//! std::function̓Rs[łKv̂ŁAshared_ptrɕœǂݍݗp̃Xbhɓn
+			auto preloaded = std::make_shared<std::unique_ptr<VstPlugin>>(std::move(session_plugins[selected]));
+			swapper.RequestSwap([preloaded, device] () -> std::unique_ptr<VstPlugin> {
+				std::unique_ptr<VstPlugin> plugin = std::move(*preloaded);
+				plugin->VisitBufferMemory([device] (void *data, size_t bytes) { device->LockMemory(data, bytes); });
+				return plugin;
+			});
+		} else {
+			SessionEntry const &entry = session_entries[selected];
+			swapper.RequestSwap(
+				make_loader(balor::String(entry.path.c_str(), balor::locale::Charset(932, true)), entry.shell_plugin_id, entry.state, entry.needs_main_thread)
+				);
+		}
+		session_active = selected;
+		load_button.text(_T("Loading"));
+	};
+
+	gui::Button session_save_button(frame, 10, 150, 70, 22, _T("Save"));
+	session_save_button.font(font_small);
+	session_save_button.onClick() = [&] (gui::Button::Click &) {
+		gui::SaveFileDialog save_dialog;
+		save_dialog.filter(_T("Session File(*.xml)\n*.xml\n\n"));
+		save_dialog.title(_T("Save the session"));
+		if(!save_dialog.show(frame)) { return; }
+
+		SessionEntry &current = session_entries[session_active];
+		current.Update(swapper.GetActive());
+		session_names[session_active] = balor::locale::Charset(932, true).decode(current.name);
+		session_list.items(session_names);
+		session_list.selectedIndex(session_active);
+
+		Session session;
+		session.sampling_rate = PLUGIN_SAMPLING_RATE;
+		session.block_size = PLUGIN_BLOCK_SIZE;
+		session.entries = session_entries;
+		try {
+			std::ofstream os(save_dialog.filePath().c_str());
+			session.Save(os);
+		} catch(std::exception &e) {
+			gui::MessageBox::show(frame.handle(), _T("failed to save the session : ") + balor::locale::Charset(932, true).decode(e.what()));
+		}
+	};
+
+	//! ^{^Ƙ^Ԃ̕\
+	//! gq.rawȂwb_Ȃ32bit floatt@CAȊO32bit floatWAVt@CƂďoB
+	gui::Panel record_status_label(frame, 85, 127, 140, 18);
+	record_status_label.onPaint() = [&] (gui::Panel::Paint &e) {
+		e.graphics().font(font_small);
+		e.graphics().backTransparent(true);
+		e.graphics().drawText(
+			balor::locale::Charset(932, true).decode(recorder.ToString()),
+			e.sender().clientRectangle()
+			);
+	};
+
+	gui::Button record_button(frame, 10, 124, 70, 22, _T("Record"));
+	record_button.font(font_small);
+	record_button.onClick() = [&] (gui::Button::Click &) {
+		if(recorder.IsRecording()) {
+			record_button.text(_T("Record"));
+			try {
+				recorder.Stop();
+			} catch(std::exception &e) {
+				gui::MessageBox::show(frame.handle(), _T("recording failed : ") + balor::locale::Charset(932, true).decode(e.what()));
+			}
+			if(recorder.GetNumOverruns() > 0) {
+				gui::MessageBox::show(
+					frame.handle(),
+					std::to_wstring(static_cast<unsigned long long>(recorder.GetNumOverruns())) + _T(" overruns (") +
+					std::to_wstring(static_cast<unsigned long long>(recorder.GetNumDroppedFrames())) + _T(" frames dropped) while recording.")
+					);
+			}
+			record_status_label.invalidate();
+			return;
+		}
+
+		gui::SaveFileDialog record_dialog;
+		record_dialog.filter(_T("Wave File(*.wav)\n*.wav\nRaw Float File(*.raw)\n*.raw\n\n"));
+		record_dialog.title(_T("Select a file to record"));
+		if(!record_dialog.show(frame)) { return; }
+
+		std::wstring const path = record_dialog.filePath().c_str();
+		bool const is_raw = path.size() >= 4 && _wcsicmp(path.c_str() + path.size() - 4, L".raw") == 0;
+		try {
+			recorder.Start(path.c_str(), WaveFormat::FLOAT32, !is_raw);
+		} catch(std::exception &e) {
+			gui::MessageBox::show(frame.handle(), _T("recording failed : ") + balor::locale::Charset(932, true).decode(e.what()));
+			return;
+		}
+		record_button.text(_T("Stop"));
+	};
+
+	//! g[X̊Jnƒ~
+	//! ~ƁAL^^CCtrace.jsonɏoB(Perfettochrome://tracingŊJ)
+	gui::Button trace_button(frame, 140, 12, 80, 22, _T("Trace"));
+	trace_button.font(font_small);
+	trace_button.onClick() = [&] (gui::Button::Click &) {
+		Tracer &tracer = Tracer::GetInstance();
+		if(!tracer.IsEnabled()) {
+			tracer.Clear();
+			tracer.SetEnabled(true);
+			trace_button.text(_T("Stop Trace"));
+			return;
+		}
+
+		tracer.SetEnabled(false);
+		trace_button.text(_T("Trace"));
+
+		std::ofstream os("trace.json");
+		size_t const num_events = tracer.WriteChromeTrace(os);
+		gui::MessageBox::show(
+			frame.handle(),
+			std::to_wstring(static_cast<unsigned long long>(num_events)) + _T(" events written to trace.json")
+			);
+	};
+
+	//! PluginWatchdog̏ԂƁAŌɍs̕\
+	//! sׂ͂plugin_watchdog.txtɂoB
+	std::string last_watchdog_action;
+	std::ofstream watchdog_log;
+	gui::Panel watchdog_label(frame, 230, 2, 560, 18);
+	watchdog_label.onPaint() = [&] (gui::Panel::Paint &e) {
+		if(WATCHDOG_BUDGET_SHARE == 0) { return; }
+		e.graphics().font(font_small);
+		e.graphics().backTransparent(true);
+		e.graphics().drawText(
+			balor::locale::Charset(932, true).decode(
+				watchdog.ToString() + (last_watchdog_action.empty() ? "" : " / " + last_watchdog_action)
+				),
+			e.sender().clientRectangle()
+			);
+	};
+
+	//! Rg[\Pbg̏Ԃ̕\
+	gui::Panel control_label(frame, 395, 154, 395, 18);
+	control_label.onPaint() = [&] (gui::Panel::Paint &e) {
+		if(!USE_CONTROL_SERVER) { return; }
+		e.graphics().font(font_small);
+		e.graphics().backTransparent(true);
+		e.graphics().drawText(
+			balor::locale::Charset(932, true).decode(control_server.ToString()),
+			e.sender().clientRectangle()
+			);
+	};
+
+	//! ŌɕύXꂽp[^̕\
+	//! l\pParameterCacheǂݏôŁA`̂߂ɃvOCĂяoƂ͂ȂB
+	std::string last_parameter;
+	gui::Panel parameter_label(frame, 520, 45, 270, 18);
+	parameter_label.onPaint() = [&] (gui::Panel::Paint &e) {
+		e.graphics().font(font_small);
+		e.graphics().backTransparent(true);
+		e.graphics().drawText(balor::locale::Charset(932, true).decode(last_parameter), e.sender().clientRectangle());
 	};
 
 	//! GfB^EBhE
+	//! vOCւƂ́AVvOC̃GfB^𓯂EBhEŊJB
 	gui::Frame editor;
-	{
+	bool editor_created = false;
+	auto open_editor = [&] (VstPlugin &plugin) {
 		//! [hĂVSTvOCgGfB^EBhEĂꍇ̂݁B
-		if(vsti.HasEditor()) {
+		if(!plugin.HasEditor()) {
+			if(editor_created) { editor.visible(false); }
+			return;
+		}
+		if(!editor_created) {
 			editor = gui::Frame(eff_name, 400, 300, gui::Frame::Style::singleLine);
 			editor.icon(gpx::Icon::windowsLogo());
 
@@ -283,27 +1351,603 @@ int main_impl()
 				e.cancel(true);
 				e.sender().minimized(true);
 			};
-			vsti.OpenEditor(editor);
+			editor_created = true;
 		}
+		editor.text(eff_name);
+		plugin.OpenEditor(editor);
+	};
+
+	//! s̓vAPluginWatchdog̏ԁA^ԁAp[^̕\IɍXVA
+	//! vOC̍ւi߂B
+	gui::Timer status_timer(frame, 500);
+	status_timer.onRun() = [&] (gui::Timer::Run &) {
+		if(render_ahead) {
+			render_ahead_label.invalidate();
+		}
+		WatchdogAction action;
+		while(watchdog.PopAction(action)) {
+			last_watchdog_action = action.ToString();
+			if(!watchdog_log.is_open()) {
+				watchdog_log.open("plugin_watchdog.txt", std::ios::app);
+			}
+			watchdog_log << watchdog.GetName() << " " << last_watchdog_action << std::endl;
+		}
+		if(WATCHDOG_BUDGET_SHARE != 0) {
+			watchdog_label.invalidate();
+		}
+		if(recorder.IsRecording()) {
+			record_status_label.invalidate();
+		}
+		if(USE_CONTROL_SERVER) {
+			control_label.invalidate();
+		}
+
+        //! ւAOCX^X̃obt@̃bNāA
+        //! OAvOXgAGfB^VCX^X̂̂ɐ؂ւB
+		try {
+			bool plugin_changed = false;
+			bool const swapped = swapper.Update([&] (VstPlugin &retired) {
+				retired.VisitBufferMemory([&] (void *data, size_t bytes) { audio_device.UnlockMemory(data, bytes); });
+				plugin_changed = retired.GetEffect()->uniqueID != swapper.GetActive().GetEffect()->uniqueID;
+			});
+			if(swapped) {
+				VstPlugin &active = swapper.GetActive();
+				eff_name = balor::String(active.GetEffectName(), balor::locale::Charset(932, true));
+				plugin_name.invalidate();
+				if(plugin_changed) {
+					program_list.items(get_program_names(active));
+				}
+				open_editor(active);
+				load_button.text(_T("Load"));
+			}
+		} catch(std::exception &e) {
+			load_button.text(_T("Load"));
+			gui::MessageBox::show(frame.handle(), _T("plugin swap failed : ") + balor::locale::Charset(932, true).decode(e.what()));
+		}
+
+        //! \ṕAlςp[^̕vOC擾
+		ParameterCache &parameters = swapper.GetActive().GetParameters();
+		parameters.RefreshDisplays();
+		size_t last_index = parameters.GetNumParameters();
+		parameters.ConsumeChanges([&] (size_t index, float) { last_index = index; });
+		if(last_index != parameters.GetNumParameters()) {
+			last_parameter = parameters.GetName(last_index) + " = " + parameters.GetDisplay(last_index);
+			parameter_label.invalidate();
+		}
+	};
+	status_timer.start();
+
+	if(USE_CONTROL_SERVER) {
+		control_server.Start(GetDefaultControlSocketPath());
 	}
 
+	open_editor(swapper.GetActive());
+
 	//! bZ[W[v
 	//! frameƔ
 	frame.runMessageLoop();
 
 	//! I
-	vsti.CloseEditor();
-	wave_out_.CloseDevice();
+	meter_timer.stop();
+	status_timer.stop();
+	control_server.Stop();
+	swapper.GetActive().CloseEditor();
+	audio_device.CloseDevice();
+	try {
+		recorder.Stop();
+	} catch(std::exception &) {}
+	if(render_ahead) {
+		render_ahead->Stop();
+	}
+
+#if defined(HWM_REALTIME_CHECK)
+	{
+		std::ofstream os("realtime_violations.txt");
+		RealtimeChecker::GetInstance().WriteReport(os);
+	}
+	if(RealtimeChecker::GetInstance().GetTotalCount() > 0) {
+		gui::MessageBox::show(
+			std::to_wstring(static_cast<unsigned long long>(RealtimeChecker::GetInstance().GetTotalCount())) +
+			_T(" realtime violations detected. see realtime_violations.txt")
+			);
+	}
+#endif
 
 	return 0;
 }
 
 }	//::hwm
 
-int APIENTRY WinMain(HINSTANCE , HINSTANCE , LPSTR , int ) {
+namespace hwm {
+
+//! x`}[N[h
+//! "-bench <name>"ŋNƁAGUI\Ƀx`}[NsA
+//! ʂbenchmark_result.txtɏoB
+int run_benchmark(std::string const &command_line)
+{
+	std::istringstream args(command_line);
+	std::string option, name;
+	args >> option >> name;
+
+	std::ofstream os("benchmark_result.txt", std::ios::app);
+
+	bool known = false;
+	if(name == "resampler" || name == "all") {
+		bench::RunResamplerBenchmark(os);
+		known = true;
+	}
+	if(name == "routing" || name == "all") {
+		bench::RunRoutingBenchmark(os);
+		known = true;
+	}
+	if(name == "blocksize" || name == "all") {
+		bench::RunBlockSizeBenchmark(os);
+		known = true;
+	}
+	if(name == "params" || name == "all") {
+		bench::RunParameterBenchmark(os);
+		known = true;
+	}
+	if(name == "midirouter" || name == "all") {
+		bench::RunMidiRouterBenchmark(os);
+		known = true;
+	}
+	//! ۂ̃vOC̓ǂݍݎԂv̂ŁA"-bench startup <ZbVt@C>"ŌʂɎs
+	if(name == "startup") {
+		std::string session_path;
+		args >> session_path;
+		std::ifstream session_file(session_path.c_str());
+		if(!session_file) { throw std::runtime_error("usage : -bench startup <session file>"); }
+		std::vector<SessionEntry> const entries = Session::Load(session_file).entries;
+
+		HostApplication hostapp(PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE);
+		bench::RunSessionStartupBenchmark(
+			os, entries,
+			[&hostapp] (SessionEntry const &entry) { return create_session_plugin(entry, hostapp); }
+			);
+		known = true;
+	}
+	//! CX^X̕׎Ԃ̂ŁA"-bench capacity <VSTi DLL> [1Xebv̕b]"ŌʂɎs
+	if(name == "capacity") {
+		std::string plugin_path;
+		args >> plugin_path;
+		if(plugin_path.empty()) { throw std::runtime_error("usage : -bench capacity <plugin> [seconds per step]"); }
+		double trial_seconds = 1.0;
+		double value;
+		if(args >> value) { trial_seconds = value; }
+
+		HostApplication hostapp(PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE);
+		balor::String const module_path(plugin_path.c_str(), balor::locale::Charset(932, true));
+		bench::RunCapacityBenchmark(
+			os, plugin_path,
+			[&] (size_t block_size) {
+				return std::unique_ptr<VstPlugin>(new VstPlugin(module_path, PLUGIN_SAMPLING_RATE, block_size, &hostapp));
+			},
+			PLUGIN_SAMPLING_RATE, trial_seconds
+			);
+		known = true;
+	}
+
+	//! 񐳋K̐ff͎ۂ̃vOCĝŁA"-bench denormal <VSTi DLL> [<VSTi DLL> ...]"ŌʂɎs
+	if(name == "denormal") {
+		HostApplication hostapp(PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE);
+		std::string plugin_path;
+		while(args >> plugin_path) {
+			balor::String const module_path(plugin_path.c_str(), balor::locale::Charset(932, true));
+			bench::RunDenormalBenchmark(
+				os, plugin_path,
+				[&] {
+					return std::unique_ptr<VstPlugin>(new VstPlugin(module_path, PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, &hostapp));
+				},
+				PLUGIN_BLOCK_SIZE, PLUGIN_SAMPLING_RATE
+				);
+			known = true;
+		}
+		if(!known) { throw std::runtime_error("usage : -bench denormal <plugin> [<plugin> ...]"); }
+	}
+
+	if(!known) {
+		gui::MessageBox::show(_T("unknown benchmark : ") + balor::locale::Charset(932, true).decode(name));
+		return -1;
+	}
+
+	gui::MessageBox::show(_T("benchmark finished. see benchmark_result.txt"));
+	return 0;
+}
+
+//! S[f_[[h
+//! "-golden record <VSTi DLL> <CxgXNvg> <S[ft@C>"ŋNƁA
+//! GUI\ɃCxgXNvg̓eŃItCA
+//! <S[ft@C>.hash.txtɃubNƂ̃nbVA<S[ft@C>.wavɏo͂oB
+//! "-golden verify <VSTi DLL> <CxgXNvg> <S[ft@C> [e덷]"ŋNƁA
+//! 悤ɍāAe덷w肵Ȃ΃nbVƁAw肷WAVt@CƔrB
+//! ʂgolden_result.txtɏoAvȂ1ԂB
+//! (ȒP̂߁ApXɂ͋󔒂܂߂Ȃ)
+int run_golden(std::string const &command_line)
+{
+	std::istringstream args(command_line);
+	std::string option, mode, plugin_path, script_path, golden_path;
+	args >> option >> mode >> plugin_path >> script_path >> golden_path;
+	boost::optional<double> tolerance;
+	double value;
+	if(args >> value) { tolerance = value; }
+
+	if((mode != "record" && mode != "verify") || golden_path.empty()) {
+		gui::MessageBox::show(_T("usage : -golden record|verify <plugin> <script> <golden> [tolerance]"));
+		return -1;
+	}
+
+	std::ifstream script_file(script_path.c_str());
+	if(!script_file) { throw std::runtime_error("failed to open event script"); }
+	EventScript const script = EventScript::Parse(script_file);
+
+	HostApplication hostapp(PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE);
+	VstPlugin plugin(
+		balor::String(plugin_path.c_str(), balor::locale::Charset(932, true)),
+		PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, &hostapp);
+
+	std::wstring const golden_base = balor::locale::Charset(932, true).decode(golden_path);
+	std::wstring const hash_path = golden_base + L".hash.txt";
+	std::wstring const wav_path = golden_base + L".wav";
+
+	std::ofstream os("golden_result.txt", std::ios::app);
+	os << "golden " << mode << " : " << plugin_path << ", " << script_path << ", " << golden_path << std::endl;
+
+	if(mode == "record") {
+		std::ofstream hashes(hash_path.c_str());
+		size_t const num_blocks = GoldenRender::Record(plugin, hostapp, script, PLUGIN_BLOCK_SIZE, PLUGIN_SAMPLING_RATE, hashes, wav_path.c_str());
+		os << "recorded " << num_blocks << " blocks" << std::endl;
+		gui::MessageBox::show(_T("golden render recorded. see golden_result.txt"));
+		return 0;
+	}
+
+	GoldenResult result;
+	if(tolerance) {
+		result = GoldenRender::VerifyWithTolerance(plugin, hostapp, script, PLUGIN_BLOCK_SIZE, wav_path.c_str(), *tolerance);
+	} else {
+		std::ifstream hashes(hash_path.c_str());
+		if(!hashes) { throw std::runtime_error("failed to open golden hash file"); }
+		result = GoldenRender::VerifyHashes(plugin, hostapp, script, PLUGIN_BLOCK_SIZE, hashes);
+	}
+	os << result.ToString() << std::endl;
+
+	gui::MessageBox::show(balor::locale::Charset(932, true).decode(result.ToString()));
+	return result.matched ? 0 : 1;
+}
+
+}	//::hwm
+
+namespace hwm {
+
+//! obt@̎[h
+//! "-calibrate <VSTi DLL> [1ɋer؂̉] [1Xebv̕b]"ŋNƁA
+//! GUI\ɁAvOCɕ׎ƓCxgp^[𑗂Ė炵ȂA
+//! WaveI[fBIfoCX̃obt@TCYƑdx̑gݍ킹CeV̏ɎA
+//! Đ̓r؂ꂪelȓɎ܂łCeV̏ݒBUFFER_CONFIG_FILEɕۑB
+//! Đ̌oH͒ʏ̍ĐƓAKvɉResamplingStageBlockAdapterʂA
+//! process_mutexɓ郍bNAPluginWatchdogɂĎAAudioAnalyzerɂ́ARecorderւ̎󂯓nsB
+//! PluginSwapperARg[\PbgAs͎g킸AGUIXbhƂ̃bN̋NȂ̂ŁA
+//! ʏ̍Đ菭yB́̕A̗pݒ̑dxɗ]T̃obt@(BufferCalibrationSettings::margin_buffers)ĕ₤B
+//! ݒ育Ƃ̌ʂcalibration_result.txtɏoB
+int run_calibrate(std::string const &command_line)
+{
+	if(USE_JACK) {
+		gui::MessageBox::show(_T("calibration is for the Wave audio device. set the buffer size of the JACK server instead."));
+		return -1;
+	}
+
+	std::istringstream args(command_line);
+	std::string option, plugin_path;
+	args >> option >> plugin_path;
+	if(plugin_path.empty()) {
+		gui::MessageBox::show(_T("usage : -calibrate <plugin> [max underruns per minute] [seconds per step]"));
+		return -1;
+	}
+	BufferCalibrationSettings settings;
+	double value;
+	if(args >> value) { settings.max_underruns_per_minute = value; }
+	if(args >> value) { settings.trial_seconds = value; }
+
+	HostApplication hostapp(PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE);
+	VstPlugin plugin(
+		balor::String(plugin_path.c_str(), balor::locale::Charset(932, true)),
+		PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, &hostapp);
+	size_t const num_outputs = plugin.GetNumOutputs();
+
+	AudioThreadSettings thread_settings;
+	thread_settings.affinity_mask = AUDIO_THREAD_AFFINITY_MASK;
+
+	//! ʏ̍ĐƓ悤ɁA̎ōs
+	boost::mutex process_mutex;
+	WatchdogSettings watchdog_settings;
+	watchdog_settings.budget_share = WATCHDOG_BUDGET_SHARE;
+	watchdog_settings.mode = WatchdogSettings::MUTE;
+	PluginWatchdog watchdog(plugin.GetEffectName(), PLUGIN_SAMPLING_RATE, num_outputs, PLUGIN_BLOCK_SIZE, watchdog_settings);
+	AudioAnalyzer analyzer(num_outputs, DEVICE_SAMPLING_RATE);
+	Recorder recorder(std::max<size_t>(num_outputs, 1), DEVICE_SAMPLING_RATE, DEVICE_SAMPLING_RATE * RECORDER_RING_SECONDS);
+
+	auto trial = [&] (BufferConfig const &config, double seconds, size_t max_underruns) -> BufferTrialResult {
+		std::unique_ptr<ResamplingStage> resampling_stage;
+		std::unique_ptr<BlockAdapter> block_adapter;
+		if(PLUGIN_SAMPLING_RATE != DEVICE_SAMPLING_RATE && num_outputs > 0) {
+			resampling_stage.reset(
+				new ResamplingStage(num_outputs, PLUGIN_SAMPLING_RATE, DEVICE_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, config.block_size, RESAMPLER_TAPS)
+				);
+		} else if(PLUGIN_BLOCK_SIZE != config.block_size && num_outputs > 0) {
+			block_adapter.reset(new BlockAdapter(num_outputs, PLUGIN_BLOCK_SIZE, config.block_size));
+		}
+		std::vector<std::vector<float>> device_buffers(num_outputs, std::vector<float>(config.block_size));
+		std::vector<float *> device_heads;
+		for(auto &buffer: device_buffers) {
+			device_heads.push_back(buffer.data());
+		}
+
+		bench::CapacityEventPattern pattern(PLUGIN_SAMPLING_RATE);
+		MidiEventBatch batch;
+		auto render_block = [&] () -> float ** {
+			pattern.Next(PLUGIN_BLOCK_SIZE, batch);
+			plugin.AddEvents(batch);
+			auto process = [&] {
+				plugin.ProcessEvents();
+				plugin.ProcessAudio(PLUGIN_BLOCK_SIZE);
+			};
+			if(WATCHDOG_BUDGET_SHARE == 0) {
+				process();
+			} else if(!watchdog.Run(plugin.GetOutputBuffers(), PLUGIN_BLOCK_SIZE, process, [] (float * const *, size_t) {})) {
+				plugin.DiscardEvents();
+			}
+			return plugin.GetOutputBuffers();
+		};
+
+		WaveOutProcessor device;
+		device.SetThreadSettings(thread_settings);
+		plugin.VisitBufferMemory([&] (void *data, size_t bytes) { device.LockMemory(data, bytes); });
+		for(auto &buffer: device_buffers) {
+			device.LockMemory(buffer.data(), buffer.size() * sizeof(float));
+		}
+		if(block_adapter) {
+			block_adapter->VisitMemory([&] (void *data, size_t bytes) { device.LockMemory(data, bytes); });
+		}
+		watchdog.VisitMemory([&] (void *data, size_t bytes) { device.LockMemory(data, bytes); });
+		analyzer.VisitMemory([&] (void *data, size_t bytes) { device.LockMemory(data, bytes); });
+		recorder.VisitMemory([&] (void *data, size_t bytes) { device.LockMemory(data, bytes); });
+
+		BufferTrialResult result;
+		result.opened = device.OpenDevice(
+			DEVICE_SAMPLING_RATE, 2, config.block_size, config.multiplicity,
+			[&] (short *data, size_t device_channel, size_t sample) {
+				boost::unique_lock<boost::mutex> lock(process_mutex);
+				float **syntheized = nullptr;
+				if(resampling_stage) {
+					resampling_stage->Pull(device_heads.data(), sample, render_block);
+					syntheized = device_heads.data();
+				} else if(block_adapter) {
+					block_adapter->Pull(device_heads.data(), sample, render_block);
+					syntheized = device_heads.data();
+				} else {
+					//! o͂̂ȂvOCł́AfoCX̃ubNPLUGIN_BLOCK_SIZE
+					for(size_t done = 0; done < sample; done += PLUGIN_BLOCK_SIZE) {
+						syntheized = render_block();
+					}
+				}
+				analyzer.Process(syntheized, num_outputs, sample);
+				recorder.Push(syntheized, num_outputs, sample);
+				InterleaveToShort(syntheized, num_outputs, data, device_channel, sample);
+			});
+		if(!result.opened) { return result; }
+
+		bench::Stopwatch sw;
+		while(sw.Elapsed() < seconds && device.GetNumUnderruns() <= max_underruns) {
+			Sleep(100);
+		}
+		result.seconds = sw.Elapsed();
+		device.CloseDevice();
+
+		result.num_callbacks = device.GetNumCallbacks();
+		result.num_underruns = device.GetNumUnderruns();
+		result.average_callback_sec = device.GetAverageCallbackSec();
+		result.max_callback_sec = device.GetMaxCallbackSec();
+
+		//! 葱Ăm[g~߂āA̐ݒ𓯂Ԃn߂
+		VstMidiEvent const all_notes_off = MakeControlChange(0, 123, 0);
+		plugin.AddEvents(&all_notes_off, &all_notes_off + 1);
+		return result;
+	};
+
+	std::stringstream ss;
+	ss << "[calibrate] " << plugin_path << std::endl;
+	boost::optional<BufferConfig> config = RunBufferCalibration(ss, settings, DEVICE_SAMPLING_RATE, trial);
+	if(config) {
+		config->plugin = plugin_path;
+		std::ofstream file(BUFFER_CONFIG_FILE);
+		config->Save(file);
+		ss << "selected " << config->ToString() << ", saved to " << BUFFER_CONFIG_FILE << std::endl;
+	} else {
+		ss << "no configuration met the target. " << BUFFER_CONFIG_FILE << " was not changed." << std::endl;
+	}
+
+	std::ofstream os("calibration_result.txt", std::ios::app);
+	os << ss.str() << std::endl;
+
+	gui::MessageBox::show(balor::locale::Charset(932, true).decode(ss.str()));
+	return config ? 0 : 1;
+}
+
+//! Rg[\Pbg̕׎[h
+//! "-control-load <events/sec> <b> [1t[̃R}h] [\Pbg̃pX]"ŋNƁA
+//! GUI\ɁAN̕ʂVstHostDemõRg[\PbgփR}h𑗂葱A
+//! ʂcontrol_load_result.txtɏoBpXȗƊ̃pXɑB
+int run_control_load(std::string const &command_line)
+{
+	std::istringstream args(command_line);
+	std::string option, path;
+	double events_per_sec = 0;
+	double seconds = 0;
+	size_t commands_per_frame = 64;
+	args >> option >> events_per_sec >> seconds;
+	if(events_per_sec <= 0 || seconds <= 0) {
+		gui::MessageBox::show(_T("usage : -control-load <events/sec> <seconds> [commands per frame] [socket path]"));
+		return -1;
+	}
+	args >> commands_per_frame >> path;
+	if(path.empty()) { path = GetDefaultControlSocketPath(); }
+
+	std::stringstream ss;
+	bool const succeeded = RunControlLoadGenerator(ss, path, events_per_sec, seconds, commands_per_frame);
+
+	std::ofstream os("control_load_result.txt", std::ios::app);
+	os << ss.str() << std::endl;
+
+	gui::MessageBox::show(balor::locale::Charset(932, true).decode(ss.str()));
+	return succeeded ? 0 : 1;
+}
+
+//! JACK̓mF[h
+//! "-jack-smoke <VSTi DLL> [̐]"ŋNƁAGUI\ɋNJACKT[o[֐ڑA
+//! ׎ƓCxgp^[ŃvOC炵ȂAw肵̐(ł1000)ĐB
+//! xrunNAłȂo͂0AłȂ(̌AvOC̓ǂݍ݂̎sA
+//! JACKT[o[ւ̐ڑ̎s܂߂)1ԂB
+//! wbhX̊"jackd -d dummy"ŋNT[o[ɑ΂ăXNvgsł悤ɁA
+//! bZ[W{bNX͕\Aʂjack_smoke_result.txtɏoB
+int run_jack_smoke(std::string const &command_line)
+{
+	std::ofstream os("jack_smoke_result.txt", std::ios::app);
+
+#if !defined(HWM_USE_JACK)
+	(void)command_line;
+	os << "-jack-smoke needs a build with HWM_USE_JACK defined." << std::endl << "FAILED" << std::endl;
+	return 1;
+#else
+	std::istringstream args(command_line);
+	std::string option, plugin_path;
+	size_t num_periods = 1000;
+	args >> option >> plugin_path;
+	args >> num_periods;
+
+	if(plugin_path.empty() || num_periods == 0) {
+		os << "usage : -jack-smoke <plugin> [periods]" << std::endl << "FAILED" << std::endl;
+		return 1;
+	}
+	os << "[jack-smoke] " << plugin_path << ", " << num_periods << " periods" << std::endl;
+
+	//! ǂݍ݂ɎsꍇAWinMainŃbZ[W{bNX\ɏIR[hŒm点
+	HostApplication hostapp(PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE);
+	std::unique_ptr<VstPlugin> loaded;
+	try {
+		loaded.reset(new VstPlugin(
+			balor::String(plugin_path.c_str(), balor::locale::Charset(932, true)),
+			PLUGIN_SAMPLING_RATE, PLUGIN_BLOCK_SIZE, &hostapp));
+	} catch(std::exception &e) {
+		os << "failed to load the plugin : " << e.what() << std::endl << "FAILED" << std::endl;
+		return 1;
+	}
+	VstPlugin &plugin = *loaded;
+	size_t const num_outputs = plugin.GetNumOutputs();
+
+	bench::CapacityEventPattern pattern(PLUGIN_SAMPLING_RATE);
+	MidiEventBatch batch;
+
+	//! o͂̍őĺAvZXR[obN̒łACloseDevicěœǂ
+	boost::atomic<size_t> periods(0);
+	float peak = 0;
+
+	JackProcessor device;
+	plugin.VisitBufferMemory([&] (void *data, size_t bytes) { device.LockMemory(data, bytes); });
+
+	bool const opened = device.OpenDevice(
+		"VstHostDemoSmoke", PLUGIN_SAMPLING_RATE, 2,
+		[&] (float **data, size_t device_channel, size_t frames) {
+			HWM_REALTIME_SCOPE();
+			for(size_t done = 0; done < frames; ) {
+				size_t const n = std::min<size_t>(frames - done, PLUGIN_BLOCK_SIZE);
+				pattern.Next(n, batch);
+				plugin.AddEvents(batch);
+				plugin.ProcessEvents();
+				float **syntheized = plugin.ProcessAudio(n);
+				for(size_t ch = 0; ch < device_channel; ++ch) {
+					if(ch < num_outputs) {
+						std::copy(syntheized[ch], syntheized[ch] + n, data[ch] + done);
+						for(size_t i = 0; i < n; ++i) {
+							peak = std::max<float>(peak, std::abs(syntheized[ch][i]));
+						}
+					} else {
+						std::fill(data[ch] + done, data[ch] + done + n, 0.0f);
+					}
+				}
+				done += n;
+			}
+			periods.fetch_add(1, boost::memory_order_relaxed);
+		});
+	if(!opened) {
+		os << "failed to connect to the JACK server (or its sampling rate is not " << PLUGIN_SAMPLING_RATE << ")" << std::endl
+		   << "FAILED" << std::endl;
+		return 1;
+	}
+
+	//! OpenDevice̓vZXXbh̐ݒ҂Ă߂̂ŁAœǂ
+	AudioThreadSetupResult const thread_setup = device.GetThreadSetupResult();
+
+	//! T[o[~܂ĂꍇɔāA\̍ĐԂ4{5b߂ł؂
+	double const expected_sec = static_cast<double>(num_periods) * device.GetBlockSize() / PLUGIN_SAMPLING_RATE;
+	bench::Stopwatch sw;
+	while(periods.load(boost::memory_order_relaxed) < num_periods && !device.IsShutdown() && sw.Elapsed() < expected_sec * 4 + 5) {
+		Sleep(10);
+	}
+	size_t const block_size = device.GetBlockSize();
+	size_t const num_xruns = device.GetNumXruns();
+	bool const shutdown = device.IsShutdown();
+	device.CloseDevice();
+
+	//! vZXXbhFTZDAZݒ肳Ă邱ƂmF
+	size_t const processed = periods.load(boost::memory_order_relaxed);
+	bool const passed =
+		processed >= num_periods && num_xruns == 0 && !shutdown && peak > 0 &&
+		thread_setup.denormals == AudioThreadSetupResult::SUCCEEDED;
+	os	<< "block: " << block_size << ", periods: " << processed << ", xruns: " << num_xruns
+		<< ", peak: " << peak << (shutdown ? ", shutdown" : "") << std::endl
+		<< thread_setup.ToString() << std::endl
+		<< (passed ? "passed" : "FAILED") << std::endl;
+	return passed ? 0 : 1;
+#endif
+}
+
+}	//::hwm
+
+int APIENTRY WinMain(HINSTANCE , HINSTANCE , LPSTR command_line, int ) {
+
+	//! CXbhGUIXbhƂĈ(x`}[NS[f_[̃[hł)
+	hwm::ThreadRole::SetCurrent(hwm::ThreadRole::GUI);
+	//! GtFNg̏S[f_[Ax`}[Nł́ACXbhłprocessReplacingĂяôŁA
+	//! I[fBIXbhƓ悤FTZDAZݒ肵ĂB
+	hwm::Denormal::SetFlush(true);
 
 	try {
-		hwm::main_impl();
+		if(std::string(command_line).compare(0, 6, "-bench") == 0) {
+			return hwm::run_benchmark(command_line);
+		}
+		if(std::string(command_line).compare(0, 7, "-golden") == 0) {
+			return hwm::run_golden(command_line);
+		}
+		if(std::string(command_line).compare(0, 13, "-control-load") == 0) {
+			return hwm::run_control_load(command_line);
+		}
+		if(std::string(command_line).compare(0, 10, "-calibrate") == 0) {
+			return hwm::run_calibrate(command_line);
+		}
+		if(std::string(command_line).compare(0, 11, "-jack-smoke") == 0) {
+			return hwm::run_jack_smoke(command_line);
+		}
+
+		//! "-session <ZbVt@C>"ŋNƁAt@CIԑɃZbṼvOCǂݍ
+		boost::optional<std::string> session_path;
+		if(std::string(command_line).compare(0, 8, "-session") == 0) {
+			std::istringstream args(command_line);
+			std::string option, path;
+			args >> option >> path;
+			session_path = path;
+		}
+
+		hwm::main_impl(session_path);
 	} catch(std::exception &e) {
 		balor::gui::MessageBox::show(
 			balor::String(
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/atomic.hpp>
+
+namespace hwm {
+
+//! ̏݃Xbh̓ǂݍ݃XbhցAlɎ󂯓nŒeʂ̃L[
+//!
+//! ͍̈\zɊmۂAPush/Popł̓mۂbNsȂ(wait-free)B
+//! ݑƓǂݍݑ́Aꂼꎩ̃CfbNXA
+//! ̃CfbNXacquireœǂނƂŁAl݂̏ƌJ̏ۏ؂B
+//! L[t̏ꍇAPush͒l̂ĂfalseԂB
+template<class T>
+struct SpscQueue
+{
+	//! capacity܂Œl𗭂߂L[
+	explicit SpscQueue(size_t capacity)
+		:	slots_(capacity + 1)
+		,	write_index_(0)
+		,	read_index_(0)
+	{
+		BOOST_ASSERT(capacity > 0);
+	}
+
+	size_t	capacity() const { return slots_.size() - 1; }
+
+	//! ݑ : lǉBL[tȂfalseԂB
+	bool	Push(T const &value)
+	{
+		size_t const write = write_index_.load(boost::memory_order_relaxed);
+		size_t const next = advance(write);
+		if(next == read_index_.load(boost::memory_order_acquire)) { return false; }
+
+		slots_[write] = value;
+		write_index_.store(next, boost::memory_order_release);
+		return true;
+	}
+
+	//! ǂݍݑ : 擪̒loBL[ȂfalseԂB
+	bool	Pop(T &value)
+	{
+		size_t const read = read_index_.load(boost::memory_order_relaxed);
+		if(read == write_index_.load(boost::memory_order_acquire)) { return false; }
+
+		value = slots_[read];
+		read_index_.store(advance(read), boost::memory_order_release);
+		return true;
+	}
+
+	//! ܂Ăl̐(ǂ̃XbhĂł悢A悻̒lɂȂ)
+	size_t	size() const
+	{
+		size_t const write = write_index_.load(boost::memory_order_acquire);
+		size_t const read = read_index_.load(boost::memory_order_acquire);
+		return (write >= read) ? write - read : write + slots_.size() - read;
+	}
+
+	bool	empty() const { return size() == 0; }
+
+	//! mۍς݂̗̈visit(void *data, size_t bytes)ŗ񋓂
+	template<class Visitor>
+	void	VisitMemory(Visitor visit)
+	{
+		visit(static_cast<void *>(slots_.data()), slots_.size() * sizeof(T));
+	}
+
+private:
+	size_t	advance(size_t index) const { return (index + 1 == slots_.size()) ? 0 : index + 1; }
+
+private:
+	std::vector<T>			slots_;
+	boost::atomic<size_t>	write_index_;
+	boost::atomic<size_t>	read_index_;
+
+	SpscQueue(SpscQueue const &);
+	SpscQueue & operator=(SpscQueue const &);
+};
+
+}	//::hwm
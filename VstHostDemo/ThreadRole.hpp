@@ -0,0 +1,92 @@
+#pragma once
+
+#pragma warning(push)
+#pragma warning(disable: 4996)
+#include "./vstsdk2.4/pluginterfaces/vst2.x/aeffectx.h"
+#pragma warning(pop)
+
+namespace hwm {
+
+//! zXg쐬Xbh̖
+//!
+//! eXbh̊JnSetCurrentŐݒ肵ĂƁA
+//! vOCaudioMasterGetCurrentProcessLevelŖ₢킹ꂽɁAĂяõXbh̖ɉlԂB
+//! (vOC͂̒lāAA^Cp̌yƃItCp̍iȏ؂ւ肷)
+//! g[X̃Xbh⃊A^C̃`FbŇʂɂA\B
+//! l̓XbhƂɕێ̂ŁAݒɃbN͗vȂB
+struct ThreadRole
+{
+	enum Role {
+		UNKNOWN,	//! ݒ肵ĂȂXbh(vOCō쐬XbhȂ)
+		GUI,		//! GUI⃁bZ[W[ṽXbh
+		REALTIME,	//! I[fBIfoCX̎ɍ킹čXbh
+		PREFETCH,	//! ĐɐsčXbh(s̃[J[Xbh)
+		WORKER,		//! vOC̓ǂݍ݂jA^̏oȂǂsXbh
+		OFFLINE		//! ԂɔꂸɍXbh(S[f_[Ȃ)
+	};
+
+	//! ݂̃Xbh̖
+	static
+	Role	GetCurrent() { return current(); }
+
+	//! ݂̃Xbh̖ݒ肷
+	//! g[X̃Xbhɖ\邽߁AHWM_TRACE_THREADOɌĂяoB
+	static
+	void	SetCurrent(Role role) { current() = role; }
+
+	//! audioMasterGetCurrentProcessLevelŕԂl
+	static
+	VstInt32	ToProcessLevel(Role role)
+	{
+		switch(role) {
+			case GUI:		return kVstProcessLevelUser;
+			case REALTIME:	return kVstProcessLevelRealtime;
+			case PREFETCH:	return kVstProcessLevelPrefetch;
+			case WORKER:	return kVstProcessLevelUser;
+			case OFFLINE:	return kVstProcessLevelOffline;
+			default:		return kVstProcessLevelUnknown;
+		}
+	}
+
+	static
+	char const *	GetName(Role role)
+	{
+		switch(role) {
+			case GUI:		return "gui";
+			case REALTIME:	return "realtime";
+			case PREFETCH:	return "prefetch";
+			case WORKER:	return "worker";
+			case OFFLINE:	return "offline";
+			default:		return "unknown";
+		}
+	}
+
+private:
+	static
+	Role &	current()
+	{
+		static __declspec(thread) Role role = UNKNOWN;
+		return role;
+	}
+};
+
+//! ̃IuWFNgĂԁÃ݂Xbh̖ύX
+//! GUIXbhňꎞIɃItCsꍇȂǂɎgB
+struct ThreadRoleScope
+{
+	explicit ThreadRoleScope(ThreadRole::Role role)
+		:	previous_(ThreadRole::GetCurrent())
+	{
+		ThreadRole::SetCurrent(role);
+	}
+
+	~ThreadRoleScope() { ThreadRole::SetCurrent(previous_); }
+
+private:
+	ThreadRole::Role	previous_;
+
+	ThreadRoleScope(ThreadRoleScope const &);
+	ThreadRoleScope & operator=(ThreadRoleScope const &);
+};
+
+}	//::hwm
@@ -0,0 +1,517 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/preprocessor/cat.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <windows.h>
+
+#include "./ThreadRole.hpp"
+
+//! zXg̓^CCƂċL^g[X@\
+//!
+//! ĐXbhAfoCX̃R[obNAProcessEventsAprocessReplacingAGUĨCxgnhȂǂ
+//! JnƏI(Xp)AJE^̒l̕ωQueryPerformanceCounter̎ƂƂɋL^A
+//! Chromẽg[X`(JSON)ŏoBot@CPerfetto(ui.perfetto.dev)
+//! chrome://tracingŊJB
+//!
+//! Cxg̓XbhƂ̃Oobt@ɋL^B
+//! ނ̂͂̃XbhgȂ̂ŁAL^ɃbNAg~bNȓǂݏȊO͍̓sȂB
+//! obt@tɂȂꍇ͌ÂCxg㏑B
+//! Oobt@̃͋L^LȊԂmۂAIXbh̃obt@͎ɓo^ꂽXbhŎg񂷁B
+//! L^̗L/͎sSetEnabledŐ؂ւAȊԂ̋L^̓tO̊mFŏIB
+//!
+//! Xbhɂ́AXbh̖(ThreadRole)tďoAA^C̃Xbh珇ɕׂB
+//!
+//! HWM_DISABLE_TRACE`ƁAHWM_TRACE_*}Nׂ͂ĉȂȂB
+
+namespace hwm {
+
+//! g[X̃Cxg
+struct TraceEvent
+{
+	enum Type { BEGIN, END, COUNTER, INSTANT };
+
+	char const *	name;
+	LONGLONG		timestamp;
+	double			value;
+	Type			type;
+};
+
+//! XbhƂ̃Cxgobt@
+struct TraceThreadBuffer
+{
+	enum {
+		CAPACITY = 64 * 1024,	//! L^łCxg̐
+		MAX_NAME = 32
+	};
+
+	TraceThreadBuffer()
+		:	allocated_(false)
+		,	written_(0)
+		,	cleared_(0)
+		,	thread_id_(0)
+		,	role_(ThreadRole::UNKNOWN)
+	{
+		SetName("");
+	}
+
+	//! VXbh̃obt@ƂĎgn߂
+	//! ÕXbhL^Cxg͏ȏΏۂOBmۍς݂̃͂̂܂܎gB
+	void Reset(DWORD thread_id, ThreadRole::Role role)
+	{
+		Clear();
+		thread_id_ = thread_id;
+		role_ = role;
+		SetName("");
+	}
+
+	//! Oobt@̃mۂ
+	//! mۂ܂Push͉ȂBxmۂ͉ȂB
+	void Allocate()
+	{
+		if(IsAllocated()) { return; }
+		events_.resize(CAPACITY);
+		allocated_.store(true, boost::memory_order_release);
+	}
+
+	bool	IsAllocated() const { return allocated_.load(boost::memory_order_acquire); }
+
+	//! ȏΏۂɂȂĂCxgȂtrue
+	bool	IsEmpty() const
+	{
+		return written_.load(boost::memory_order_acquire) == cleared_.load(boost::memory_order_relaxed);
+	}
+
+	//! CxgL^
+	//! obt@LXbhĂяoB
+	void Push(TraceEvent::Type type, char const *name, double value)
+	{
+		if(!IsAllocated()) { return; }
+
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+
+		size_t const n = written_.load(boost::memory_order_relaxed);
+		TraceEvent &e = events_[n % CAPACITY];
+		e.name = name;
+		e.timestamp = now.QuadPart;
+		e.value = value;
+		e.type = type;
+		written_.store(n + 1, boost::memory_order_release);
+	}
+
+	void SetName(char const *name)
+	{
+		strncpy_s(name_, name, _TRUNCATE);
+	}
+
+	void SetRole(ThreadRole::Role role) { role_ = role; }
+
+	//! ܂łɋL^CxgAȏΏۂO
+	void Clear()
+	{
+		cleared_.store(written_.load(boost::memory_order_acquire), boost::memory_order_relaxed);
+	}
+
+	//! ȏΏۂɂȂĂCxgdestɒǉ
+	//! L^ɌĂяoĂ悢BRs[ɏ㏑ꂽ\̂Cxg͊܂߂ȂB
+	//! ㏑ŎꂽCxg̐ԂB
+	size_t Collect(std::vector<TraceEvent> &dest) const
+	{
+		if(!IsAllocated()) { return 0; }
+
+		size_t const end = written_.load(boost::memory_order_acquire);
+		size_t const cleared = cleared_.load(boost::memory_order_relaxed);
+		size_t const oldest = (end > CAPACITY) ? end - CAPACITY : 0;
+		size_t const begin = std::max<size_t>(cleared, oldest);
+
+		size_t const first = dest.size();
+		for(size_t i = begin; i < end; ++i) {
+			dest.push_back(events_[i % CAPACITY]);
+		}
+
+		//! Rs[ĂԂɏ㏑ꂽ菜
+		size_t const end_after = written_.load(boost::memory_order_acquire);
+		size_t const valid_from = (end_after > CAPACITY) ? end_after - CAPACITY : 0;
+		if(valid_from > begin) {
+			size_t const invalid = std::min<size_t>(valid_from - begin, end - begin);
+			dest.erase(dest.begin() + first, dest.begin() + first + invalid);
+		}
+
+		return (valid_from > cleared) ? valid_from - cleared : 0;
+	}
+
+	DWORD			GetThreadId() const { return thread_id_; }
+	char const *	GetName() const { return name_; }
+	ThreadRole::Role	GetRole() const { return role_; }
+
+private:
+	std::vector<TraceEvent>	events_;
+	boost::atomic<bool>		allocated_;
+	boost::atomic<size_t>	written_;
+	boost::atomic<size_t>	cleared_;
+	DWORD					thread_id_;
+	char					name_[MAX_NAME];
+	ThreadRole::Role		role_;
+
+	TraceThreadBuffer(TraceThreadBuffer const &);
+	TraceThreadBuffer & operator=(TraceThreadBuffer const &);
+};
+
+struct Tracer
+{
+	enum { MAX_THREADS = 64 };
+
+	static
+	Tracer & GetInstance()
+	{
+		static Tracer instance;
+		return instance;
+	}
+
+	//! L^Lɂ鎞́Ao^ς݂̃Xbh̃obt@̃̃XbhŊmۂĂLɂB
+	void	SetEnabled(bool enabled)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if(enabled) {
+			for(size_t i = 0; i < MAX_THREADS; ++i) {
+				if(states_[i] == ACTIVE) { buffers_[i].Allocate(); }
+			}
+		}
+		enabled_.store(enabled, boost::memory_order_relaxed);
+	}
+
+	bool	IsEnabled() const { return enabled_.load(boost::memory_order_relaxed); }
+
+	//! ݂̃XbhɃobt@蓖ĂāA^CCɕ\閼Ot
+	//! obt@̃́AL^Lł΂ŁAł΋L^LɂɊmۂB
+	//! o^ĂȂXbhł͍ŏɃCxgL^Ɋ蓖ĂƊmۂŝŁA
+	//! ĐXbhȂǂŃmۂ邽߁AXbh̊JnɌĂяoĂB
+	//! Xbh̖́A̎_ThreadRoleɐݒ肳Ă̂L^B
+	//! ʏTraceThreadScope(HWM_TRACE_THREAD)gAXbh̏IUnregisterThreadĂяoB
+	void RegisterThread(char const *name)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		TraceThreadBuffer *buffer = get_or_assign_buffer();
+		if(buffer) {
+			buffer->SetName(name);
+			buffer->SetRole(ThreadRole::GetCurrent());
+		}
+	}
+
+	//! ݂̃XbhɊ蓖Ăobt@ԋp
+	//! L^CxǵAʂ̃Xbh̃obt@gn߂܂ŏȏΏۂɎcB
+	void UnregisterThread()
+	{
+		TraceThreadBuffer *&current = current_buffer();
+		if(!current) { return; }
+
+		boost::mutex::scoped_lock lock(mutex_);
+		release(current - buffers_);
+		current = nullptr;
+	}
+
+	//! thread_id̃XbhɊ蓖Ăobt@Aʂ̃Xbhԋp
+	//! JACK̃vZXXbĥ悤ɁAIŒm邱Ƃ̂łȂXbhɎgB
+	//! ̃XbhIACxgL^ȂȂĂĂяoB
+	void ReleaseThread(DWORD thread_id)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		for(size_t i = 0; i < MAX_THREADS; ++i) {
+			if(states_[i] == ACTIVE && buffers_[i].GetThreadId() == thread_id) {
+				release(i);
+			}
+		}
+	}
+
+	//! Xp̊JnƏI
+	//! nameɂ͕񃊃eȂǁA؂ȂnB(o܂ŎQƂ)
+	void Begin(char const *name)						{ push(TraceEvent::BEGIN, name, 0); }
+	void End(char const *name)							{ push(TraceEvent::END, name, 0); }
+	//! JE^̒l
+	void Counter(char const *name, double value)		{ push(TraceEvent::COUNTER, name, value); }
+	//! ԕȂCxg
+	void Instant(char const *name)						{ push(TraceEvent::INSTANT, name, 0); }
+
+	//! ܂łɋL^Cxgj
+	void Clear()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		for(size_t i = 0; i < MAX_THREADS; ++i) {
+			if(states_[i] != FREE) { buffers_[i].Clear(); }
+		}
+	}
+
+	//! L^CxgChromẽg[X`(JSON)ŏo
+	//! o(㏑ŎĂȂ)Cxg̑ԂB
+	size_t WriteChromeTrace(std::ostream &os) const
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+
+		std::vector<std::vector<TraceEvent>> collected;
+		std::vector<TraceThreadBuffer const *> owners;
+		size_t num_lost = 0;
+		LONGLONG base = 0;
+		bool has_base = false;
+
+		//! oI܂ŁAobt@ʂ̃XbhɊ蓖ĒȂ
+		boost::mutex::scoped_lock lock(mutex_);
+
+		for(size_t i = 0; i < MAX_THREADS; ++i) {
+			TraceThreadBuffer const *buffer = &buffers_[i];
+			if(states_[i] == FREE || !buffer->IsAllocated()) { continue; }
+
+			collected.push_back(std::vector<TraceEvent>());
+			owners.push_back(buffer);
+			num_lost += buffer->Collect(collected.back());
+			if(!collected.back().empty()) {
+				LONGLONG const t = collected.back().front().timestamp;
+				base = has_base ? std::min<LONGLONG>(base, t) : t;
+				has_base = true;
+			}
+		}
+
+		os << "{\"traceEvents\":[\n";
+		os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"VstHostDemo\"}}";
+
+		size_t num_written = 0;
+		for(size_t i = 0; i < collected.size(); ++i) {
+			DWORD const tid = owners[i]->GetThreadId();
+
+			ThreadRole::Role const role = owners[i]->GetRole();
+			std::string const name = std::string(owners[i]->GetName()) + " (" + ThreadRole::GetName(role) + ")";
+			os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+			write_string(os, name.c_str());
+			os << "}}";
+			os << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+			   << ",\"args\":{\"sort_index\":" << sort_index(role) << "}}";
+
+			//! ㏑ŊJnꂽXp̏I͏oȂ
+			int depth = 0;
+			for(auto const &e: collected[i]) {
+				if(e.type == TraceEvent::END) {
+					if(depth == 0) { continue; }
+					--depth;
+				} else if(e.type == TraceEvent::BEGIN) {
+					++depth;
+				}
+
+				double const ts = static_cast<double>(e.timestamp - base) * 1000000.0 / frequency.QuadPart;
+				os << ",\n{\"name\":";
+				write_string(os, e.name);
+				os << ",\"ph\":\"" << phase(e.type) << "\",\"ts\":" << std::fixed << ts << ",\"pid\":1,\"tid\":" << tid;
+				if(e.type == TraceEvent::COUNTER) {
+					os << ",\"args\":{\"value\":" << e.value << "}";
+				} else if(e.type == TraceEvent::INSTANT) {
+					os << ",\"s\":\"t\"";
+				}
+				os << "}";
+				++num_written;
+			}
+		}
+
+		os << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"lost_events\":" << num_lost << "}}\n";
+		return num_written;
+	}
+
+private:
+	//! obt@̊蓖ď
+	//! FREE : x蓖ĂĂȂ
+	//! ACTIVE : XbhɊ蓖ĂĂ
+	//! RELEASED : XbhԋpBL^Cxg͏ȏΏۂɎcĂB
+	enum SlotState { FREE, ACTIVE, RELEASED };
+
+	Tracer()
+		:	enabled_(false)
+		,	num_releases_(0)
+	{
+		for(size_t i = 0; i < MAX_THREADS; ++i) {
+			states_[i] = FREE;
+			released_at_[i] = 0;
+		}
+	}
+
+	//! mutex_擾ԂŌĂяo
+	void release(size_t index)
+	{
+		states_[index] = RELEASED;
+		released_at_[index] = ++num_releases_;
+	}
+
+	void push(TraceEvent::Type type, char const *name, double value)
+	{
+		if(!enabled_.load(boost::memory_order_relaxed)) { return; }
+
+		TraceThreadBuffer *buffer = current_buffer();
+		if(!buffer) {
+			boost::mutex::scoped_lock lock(mutex_);
+			buffer = get_or_assign_buffer();
+		}
+		if(buffer) { buffer->Push(type, name, value); }
+	}
+
+	static
+	TraceThreadBuffer *& current_buffer()
+	{
+		static __declspec(thread) TraceThreadBuffer *current = nullptr;
+		return current;
+	}
+
+	//! ݂̃Xbh̃obt@ԂB܂ȂΊ蓖ĂB
+	//! xgĂȂobt@Aԋpꂽobt@̂oĂȂCxgȂ́A
+	//! ԋpꂽobt@̂łOɕԋpꂽ́ȀɑIŎg񂷁B
+	//! 蓖Ăobt@Ȃ(MAX_THREADS̃Xbhgp)ꍇnullptrԂB
+	//! mutex_擾ԂŌĂяoB
+	TraceThreadBuffer * get_or_assign_buffer()
+	{
+		//! ReleaseThreadŕԋpĂΊ蓖Ē
+		TraceThreadBuffer *&current = current_buffer();
+		if(current && states_[current - buffers_] == ACTIVE && current->GetThreadId() == GetCurrentThreadId()) {
+			return current;
+		}
+		current = nullptr;
+
+		size_t index = MAX_THREADS;
+		for(size_t i = 0; i < MAX_THREADS && index == MAX_THREADS; ++i) {
+			if(states_[i] == FREE) { index = i; }
+		}
+		for(size_t i = 0; i < MAX_THREADS && index == MAX_THREADS; ++i) {
+			if(states_[i] == RELEASED && buffers_[i].IsEmpty()) { index = i; }
+		}
+		for(size_t i = 0; i < MAX_THREADS; ++i) {
+			if(states_[i] != RELEASED) { continue; }
+			if(index == MAX_THREADS || (states_[index] == RELEASED && !buffers_[index].IsEmpty() && released_at_[i] < released_at_[index])) {
+				index = i;
+			}
+		}
+		if(index == MAX_THREADS) { return nullptr; }
+
+		TraceThreadBuffer &buffer = buffers_[index];
+		buffer.Reset(GetCurrentThreadId(), ThreadRole::GetCurrent());
+		if(enabled_.load(boost::memory_order_relaxed)) {
+			buffer.Allocate();
+		}
+		states_[index] = ACTIVE;
+		current = &buffer;
+		return current;
+	}
+
+	//! ^CCŁAsXbhقǏɕׂ
+	static
+	int sort_index(ThreadRole::Role role)
+	{
+		switch(role) {
+			case ThreadRole::REALTIME:	return 0;
+			case ThreadRole::PREFETCH:	return 1;
+			case ThreadRole::OFFLINE:	return 2;
+			case ThreadRole::GUI:		return 3;
+			case ThreadRole::WORKER:	return 4;
+			default:					return 5;
+		}
+	}
+
+	static
+	char const * phase(TraceEvent::Type type)
+	{
+		switch(type) {
+			case TraceEvent::BEGIN:		return "B";
+			case TraceEvent::END:		return "E";
+			case TraceEvent::COUNTER:	return "C";
+			default:					return "i";
+		}
+	}
+
+	static
+	void write_string(std::ostream &os, char const *s)
+	{
+		os << '"';
+		for( ; *s; ++s) {
+			if(*s == '"' || *s == '\\') {
+				os << '\\' << *s;
+			} else if(static_cast<unsigned char>(*s) < 0x20) {
+				os << ' ';
+			} else {
+				os << *s;
+			}
+		}
+		os << '"';
+	}
+
+private:
+	boost::atomic<bool>	enabled_;
+	mutable boost::mutex	mutex_;	//! obt@̊蓖ĂƏo̔r
+	SlotState			states_[MAX_THREADS];
+	size_t				released_at_[MAX_THREADS];	//! ԋp
+	size_t				num_releases_;
+	TraceThreadBuffer	buffers_[MAX_THREADS];
+};
+
+//! ̃IuWFNgĂԁÃ݂XbhɃg[X̃obt@蓖Ă
+//! Xbh֐̐擪ɒuAXbh̏IɃobt@ԋpB
+struct TraceThreadScope
+{
+	explicit
+	TraceThreadScope(char const *name)	{ Tracer::GetInstance().RegisterThread(name); }
+	~TraceThreadScope()					{ Tracer::GetInstance().UnregisterThread(); }
+
+private:
+	TraceThreadScope(TraceThreadScope const &);
+	TraceThreadScope & operator=(TraceThreadScope const &);
+};
+
+//! ̃IuWFNgĂԂXpƂċL^
+//! JnɋL^ꍇ́ArŗLɂȂĂIL^ȂB
+struct TraceScope
+{
+	explicit
+	TraceScope(char const *name)
+		:	name_(name)
+		,	active_(Tracer::GetInstance().IsEnabled())
+	{
+		if(active_) { Tracer::GetInstance().Begin(name_); }
+	}
+
+	~TraceScope()
+	{
+		if(active_) { Tracer::GetInstance().End(name_); }
+	}
+
+private:
+	char const *	name_;
+	bool			active_;
+
+	TraceScope(TraceScope const &);
+	TraceScope & operator=(TraceScope const &);
+};
+
+}	//::hwm
+
+#if !defined(HWM_DISABLE_TRACE)
+	//! ̃XR[v͈̔͂XpƂċL^
+	#define HWM_TRACE_SCOPE(name) ::hwm::TraceScope const BOOST_PP_CAT(hwm_trace_scope_, __LINE__)(name)
+	//! JE^̒lL^
+	#define HWM_TRACE_COUNTER(name, value) ::hwm::Tracer::GetInstance().Counter(name, static_cast<double>(value))
+	//! ԕȂCxgL^
+	#define HWM_TRACE_INSTANT(name) ::hwm::Tracer::GetInstance().Instant(name)
+	//! ݂̃XbhɖOtB̃XR[v𔲂ƃobt@ԋpB
+	#define HWM_TRACE_THREAD(name) ::hwm::TraceThreadScope const hwm_trace_thread_(name)
+	//! ݂̃XbhɖOtBԋpHWM_TRACE_RELEASE_THREADōsB(JACK̃vZXXbhȂ)
+	#define HWM_TRACE_REGISTER_THREAD(name) ::hwm::Tracer::GetInstance().RegisterThread(name)
+	//! HWM_TRACE_REGISTER_THREADŖOtXbh̃obt@Aʂ̃Xbhԋp
+	#define HWM_TRACE_RELEASE_THREAD(thread_id) ::hwm::Tracer::GetInstance().ReleaseThread(thread_id)
+#else
+	#define HWM_TRACE_SCOPE(name) ((void)0)
+	#define HWM_TRACE_COUNTER(name, value) ((void)0)
+	#define HWM_TRACE_INSTANT(name) ((void)0)
+	#define HWM_TRACE_THREAD(name) ((void)0)
+	#define HWM_TRACE_REGISTER_THREAD(name) ((void)0)
+	#define HWM_TRACE_RELEASE_THREAD(thread_id) ((void)0)
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+#include <boost/atomic.hpp>
+
+namespace hwm {
+
+//! ̏݃Xbh̓ǂݍ݃XbhցAŐV̒l󂯓ngvobt@
+//!
+//! ݑBack()œXbgɒlłPublish()A
+//! ǂݍݑUpdate()ōŐṼXbg󂯎ĂFront()ŎQƂB
+//! ǂ̑Ag~bNȌŊA҂ƂȂ(wait-free)B
+//! ǂݍݑԂɍȂl͏㏑AɍŐV̒lǂ܂B
+//!
+//! Publish()Back()ԂXbg̓e͌ÂlȂ̂ŁAݑ͖񂷂ׂĂƁB
+template<class T>
+struct TripleBuffer
+{
+	TripleBuffer()
+		:	slots_(3)
+		,	back_(0)
+		,	shared_(1)
+		,	front_(2)
+	{}
+
+	//! ݑ : PublishXbg
+	T &			Back()			{ return slots_[back_]; }
+
+	//! ݑ : Back()ɏ񂾒lJ
+	void Publish()
+	{
+		back_ = shared_.exchange(back_ | FRESH, boost::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	//! ǂݍݑ : VJꂽl΁AFront()ɂ
+	//! VlꍇtrueԂB
+	bool Update()
+	{
+		if((shared_.load(boost::memory_order_relaxed) & FRESH) == 0) { return false; }
+		front_ = shared_.exchange(front_, boost::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	//! ǂݍݑ : ŌUpdate()Ŏ󂯎l
+	T const &	Front() const	{ return slots_[front_]; }
+
+	//! ݂n߂OɁAׂẴXbg𓯂lŏ
+	void Reset(T const &value)
+	{
+		for(size_t i = 0; i < slots_.size(); ++i) { slots_[i] = value; }
+	}
+
+	template<class Visitor>
+	void VisitMemory(Visitor visit)
+	{
+		visit(static_cast<void *>(slots_.data()), slots_.size() * sizeof(T));
+	}
+
+private:
+	enum { INDEX_MASK = 3, FRESH = 4 };
+
+	std::vector<T>			slots_;
+	unsigned int			back_;
+	boost::atomic<unsigned int>	shared_;
+	unsigned int			front_;
+
+	TripleBuffer(TripleBuffer const &);
+	TripleBuffer & operator=(TripleBuffer const &);
+};
+
+}	//::hwm
@@ -4,6 +4,7 @@
 #include <vector>
 #include <stdexcept>
 #include <array>
+#include <memory>
 
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_factories.hpp>
@@ -22,6 +23,10 @@
 #include <balor/io/File.hpp>
 
 #include "./HostApplication.hpp"
+#include "./MidiEvent.hpp"
+#include "./ParameterCache.hpp"
+#include "./RealtimeChecker.hpp"
+#include "./Trace.hpp"
 
 
 namespace hwm {
@@ -35,15 +40,28 @@ struct VstPlugin
     //! CC^[tF[X̃IuWFNgԂB
 	typedef AEffect * (VstPluginEntryProc)(audioMasterCallback callback);
 
+	//! xProcessEventsőMłCxg̍ő吔ƁA
+	//! SysExf[^pɊmۂĂv[̃oCg
+	enum {
+		EVENT_CAPACITY = 2048,
+		SYSEX_POOL_SIZE = 64 * 1024
+	};
+
+	//! shell_plugin_id0ȊOw肷ƁAVFvOC(kPlugCategShell)̃W[A
+	//! ID̃TuvOC쐬B
 	VstPlugin(
 		balor::String module_path,
 		size_t sampling_rate,
 		size_t block_size,
-		HostApplication *hostapp )
+		HostApplication *hostapp,
+		VstInt32 shell_plugin_id = 0 )
 		:	module_(module_path.c_str())
+		,	module_path_(module_path)
+		,	shell_plugin_id_(shell_plugin_id)
 		,	hostapp_(hostapp)
 		,	is_editor_opened_(false)
 		,	events_(0)
+		,	num_dropped_events_(0)
 	{
 		if(!module_) { throw std::runtime_error("module not found"); }
 		initialize(sampling_rate, block_size);
@@ -61,6 +79,50 @@ public:
 
 	bool	IsSynth() const { return (effect_->flags & effFlagsIsSynth) != 0; }
 	bool	HasEditor() const { return (effect_->flags & effFlagsHasEditor) != 0; }
+	//! ̃vOC܂ރVFvOĈ̂łtrue
+	//! ̏ꍇ̓TuvOC񋓂AIDw肵č쐬B(ShellPlugin.hppQ)
+	bool	IsShell() const { return dispatcher(effGetPlugCategory, 0, 0, 0, 0) == kPlugCategShell; }
+	//! VFvOC쐬TuvOCł΁A쐬Ɏw肵IDBȊO0
+	VstInt32 GetShellPluginId() const { return shell_plugin_id_; }
+	size_t	GetNumInputs() const { return effect_->numInputs; }
+	size_t	GetNumOutputs() const { return effect_->numOutputs; }
+
+    //! GtFNgvOCɓn̓obt@
+    //! ProcessAudiȏOɁAփ`lƂblock_size܂ł̃f[^łB
+	float ** GetInputBuffers() { return input_buffer_heads_.data(); }
+
+    //! ProcessAudio(size_t)ʂޏo̓obt@
+	float ** GetOutputBuffers() { return output_buffer_heads_.data(); }
+
+    //! I[fBIɎgpobt@visit(void *data, size_t bytes)ŗ񋓂
+    //! I[fBIXbhŃy[WtHgNȂ悤ɁA
+    //! ̗̈vtHgăbNĂ߂ɎgB
+	template<class Visitor>
+	void VisitBufferMemory(Visitor visit)
+	{
+		for(auto &buffer: input_buffers_) {
+			visit(static_cast<void *>(buffer.data()), buffer.size() * sizeof(float));
+		}
+		for(auto &buffer: output_buffers_) {
+			visit(static_cast<void *>(buffer.data()), buffer.size() * sizeof(float));
+		}
+		pending_events_.VisitMemory(visit);
+		processing_events_.VisitMemory(visit);
+		visit(static_cast<void *>(events_storage_.data()), events_storage_.size());
+		parameters_->VisitMemory(visit);
+	}
+
+    //! TvO[g̕ύX
+    //! vOC͏~߂ԂłȂƃTvO[g̕ύX󂯕tȂ̂ŁA
+    //! xdItɂĂݒ肵B
+	void	SetSamplingRate(size_t sampling_rate)
+	{
+		dispatcher(effStopProcess, 0, 0, 0, 0);
+		dispatcher(effMainsChanged, 0, false, 0, 0);
+		dispatcher(effSetSampleRate, 0, 0, 0, static_cast<float>(sampling_rate));
+		dispatcher(effMainsChanged, 0, true, 0, 0);
+		dispatcher(effStartProcess, 0, 0, 0, 0);
+	}
 
 	void	OpenEditor(balor::gui::Control &parent)
 	{
@@ -112,12 +174,29 @@ public:
 	HostApplication const & GetHost() const { return *hostapp_; }
 	std::string	GetEffectName() const { return effect_name_; }
 	char const * GetDirectory() const { return directory_.c_str(); }
+	balor::String const & GetModulePath() const { return module_path_; }
 
-	size_t GetProgram() const { dispatcher(effGetProgram, 0, 0, 0, 0); }
+	size_t GetProgram() const { return dispatcher(effGetProgram, 0, 0, 0, 0); }
 	void SetProgram(size_t index) { dispatcher(effSetProgram, 0, index, 0, 0); }
 	size_t GetNumPrograms() const { return effect_->numPrograms; }
 	std::string GetProgramName(size_t index) { return program_names_[index]; }
 
+    //! p[^̃LbV
+    //! GUIȂǂ̃p[^̓ǂݏ́AvOC𒼐ڌĂяoɂoRčsB
+    //! ݂͎ProcessEvents̐擪ŃvOCɓKpB
+	ParameterCache & GetParameters() { return *parameters_; }
+	ParameterCache const & GetParameters() const { return *parameters_; }
+
+    //! audioMasterAutomate󂯎ۂ
+    //! HostApplicationNX̃nhɂĂ̊֐Ă΂
+    //! (LbV̍쐬O)̒ʒḿALbV̍쐬ɂ܂Ƃ߂ēǂݍ܂̂ŖB
+	void	OnParameterAutomated(size_t index, float value)
+	{
+		if(parameters_) {
+			parameters_->OnAutomate(index, value);
+		}
+	}
+
     //! m[gI󂯎
     //! ۂ̃A^CyAvP[Vł́A
     //! Ńm[g񂾂͂Ȃ܂܂MIDI
@@ -126,49 +205,85 @@ public:
     //! m[g𐏎ReiɒǉA
     //! ̍̃^C~OœVSTvOC
     //! Ƀf[^邱Ƃ҂ɂȂĂB
-	void AddNoteOn(size_t note_number)
+	void AddNoteOn(size_t note_number, size_t velocity = 0x64, size_t channel = 0)
 	{
-		VstMidiEvent event;
-		event.type = kVstMidiType;
-		event.byteSize = sizeof(VstMidiEvent);
-		event.flags = kVstMidiEventIsRealtime;
-		event.midiData[0] = static_cast<char>(0x90u);		// note on for 1st channel
-		event.midiData[1] = static_cast<char>(note_number);	// note number
-		event.midiData[2] = static_cast<char>(0x64u);		// velocity
-		event.midiData[3] = 0;				// unused
-		event.noteLength = 0;
-		event.noteOffset = 0;
-		event.detune = 0;
-		event.deltaFrames = 0;
-		event.noteOffVelocity = 100;
-		event.reserved1 = 0;
-		event.reserved2 = 0;
+		AddEvent(MakeNoteOn(channel, note_number, velocity));
+	}
 
+    //! m[gIƓB
+	void AddNoteOff(size_t note_number, size_t velocity = 0x64, size_t channel = 0)
+	{
+		AddEvent(MakeNoteOff(channel, note_number, velocity));
+	}
+
+	//! CӂMIDIbZ[W󂯎
+	//! MakeControlChangeMakePitchBendȂǂō쐬CxgnB
+	void AddEvent(VstMidiEvent const &event)
+	{
 		auto lock = get_event_buffer_lock();
-		midi_events_.push_back(event);
+		if(!pending_events_.Push(event)) {
+			++num_dropped_events_;
+		}
 	}
 
-    //! m[gIƓB
-	void AddNoteOff(size_t note_number)
+	//! ܂ĂCxgׂĎ̂ĂāAS`l̃I[m[gIt(CC#123)ɒu
+	//! vOC̏~߂Ă(PluginWatchdog̃~[gȂ)ɁAProcessEvents̑ɃubNƂɌĂяoB
+	//! nȂCxg܂葱AĊJɌÂCxg܂Ƃ߂ē͂肹A
+	//! ĊJɂ͎~߂OĂm[g~܂ĂǍ̃Cxg͂B
+	void DiscardEvents()
 	{
-		VstMidiEvent event;
-		event.type = kVstMidiType;
-		event.byteSize = sizeof(VstMidiEvent);
-		event.flags = kVstMidiEventIsRealtime;
-		event.midiData[0] = static_cast<char>(0x80u);		// note on for 1st channel
-		event.midiData[1] = static_cast<char>(note_number);	// note number
-		event.midiData[2] = static_cast<char>(0x64u);		// velocity
-		event.midiData[3] = 0;				// unused
-		event.noteLength = 0;
-		event.noteOffset = 0;
-		event.detune = 0;
-		event.deltaFrames = 0;
-		event.noteOffVelocity = 100;
-		event.reserved1 = 0;
-		event.reserved2 = 0;
+		auto lock = get_event_buffer_lock();
+		pending_events_.Clear();
+		for(size_t ch = 0; ch < 16; ++ch) {
+			pending_events_.Push(MakeControlChange(ch, 123, 0));
+		}
+	}
 
+	//! SysExbZ[W󂯎
+	//! dataF0F7܂ł܂߂bZ[WŚB
+	//! f[^͂炩ߊmۂv[ɃRs[̂ŁAĂяodatajĂ悢B
+	//! 0SysEx͒ǉA肱ڂƂĐB
+	void AddSysEx(char const *data, size_t length, VstInt32 delta_frames = 0)
+	{
+		auto lock = get_event_buffer_lock();
+		if(!pending_events_.PushSysEx(data, length, delta_frames)) {
+			++num_dropped_events_;
+		}
+	}
+
+	//! VstMidiEvent̗܂Ƃ߂Ď󂯎
+	//! Rg[`FWʂɑ悤ȏꍇłA
+	//! bN͈̂xōςށB
+	template<class Iterator>
+	void AddEvents(Iterator first, Iterator last)
+	{
 		auto lock = get_event_buffer_lock();
-		midi_events_.push_back(event);
+		for( ; first != last; ++first) {
+			if(!pending_events_.Push(*first)) {
+				++num_dropped_events_;
+			}
+		}
+	}
+
+	//! SysEx܂ރCxg܂Ƃ߂Ď󂯎
+	void AddEvents(MidiEventBatch const &batch)
+	{
+		auto lock = get_event_buffer_lock();
+		num_dropped_events_ += batch.CopyTo(pending_events_);
+	}
+
+	//! MidiRouterŐU蕪Cxg܂Ƃ߂Ď󂯎
+	void AddEvents(VstEventBuffer const &events)
+	{
+		auto lock = get_event_buffer_lock();
+		num_dropped_events_ += pending_events_.Append(events);
+	}
+
+	//! L[tŎ̂ĂꂽCxg̐
+	size_t GetNumDroppedEvents() const
+	{
+		auto lock = get_event_buffer_lock();
+		return num_dropped_events_;
 	}
 
     //! I[fBI̍ɐ旧A
@@ -178,29 +293,27 @@ public:
     //! ProcessAudio̒OɈx̊֐Ă΂悤ɂB
 	void ProcessEvents()
 	{
+		HWM_TRACE_SCOPE("ProcessEvents");
+        //! GUIȂǂ珑܂ꂽp[^AubN̐擪ł܂Ƃ߂ēKpB
+		parameters_->ApplyPendingWrites();
 		{
 			auto lock = get_event_buffer_lock();
             //! Mpf[^VstPlugiñobt@ɈڂւB
-			std::swap(tmp_, midi_events_);
+			swap(processing_events_, pending_events_);
 		}
 
         //! Mf[^ȂɂΕԂB
-		if(tmp_.empty()) { return; }
+		if(processing_events_.empty()) { return; }
 
         //! VstEvents^́A̔zϒzƂĈ̂ŁA
-        //! MMIDICxg̐ɍ킹ăm
-        //! VstEvents^ɁAƂVstEvent̃|C^̗̈悪܂܂Ă̂ŁA
-        //! ۂɊmۂ郁ʂ͑MCxg̂ŌvZĂB
-        //!
-		//! Ŋmۂ
-        //! processReplacingĂяoꂽŉB
-		size_t const bytes = sizeof(VstEvents) + sizeof(VstEvent *) * std::max<size_t>(tmp_.size(), 2) - 2;
-		events_ = (VstEvents *)malloc(bytes);
-		for(size_t i = 0; i < tmp_.size(); ++i) {
-			events_->events[i] = reinterpret_cast<VstEvent *>(&tmp_[i]);
+        //! Cxgobt@̗eʕ̃|C^̈ɊmۂĂB
+        //! ł̓mۂ͍sȂB
+		for(size_t i = 0; i < processing_events_.size(); ++i) {
+			events_->events[i] = &processing_events_[i].event;
 		}
-		events_->numEvents = tmp_.size();
+		events_->numEvents = processing_events_.size();
 		events_->reserved = 0;
+		HWM_TRACE_COUNTER("events", processing_events_.size());
 
         //! Cxg𑗐MB
 		dispatcher(effProcessEvents, 0, 0, events_, 0);
@@ -210,6 +323,8 @@ public:
 	float ** ProcessAudio(size_t frame)
 	{
 		BOOST_ASSERT(frame <= output_buffers_[0].size());
+		HWM_TRACE_SCOPE("processReplacing");
+		HWM_REALTIME_CHECK_DENORMALS("processReplacing");
 
         //! ̓obt@Ao̓obt@AׂTvԂn
         //! processReplacingĂяoB
@@ -220,14 +335,25 @@ public:
 		effect_->processReplacing(effect_, input_buffer_heads_.data(), output_buffer_heads_.data(), frame);
 
         //! IȂ̂
-        //! effProcessEventsőMf[^B
-		tmp_.clear();
-		free(events_);
-		events_ = nullptr;
+        //! effProcessEventsőMf[^jB
+        //! (obt@̗͎̈ȍ~g)
+		processing_events_.Clear();
 
 		return output_buffer_heads_.data();
 	}
 
+    //! Ăяopӂobt@ŃI[fBIs
+    //! RoutingGrapĥ悤ɁÃvOC̊ԂŃobt@LꍇɎgB
+    //! inputs, outputsɂ͂ꂼGetNumInputs(), GetNumOutputs()̃`lnB
+    //! `lԍł΁A͂Əo͂ɓobt@nĂ悢B
+	void ProcessAudio(float **inputs, float **outputs, size_t frame)
+	{
+		HWM_TRACE_SCOPE("processReplacing");
+		HWM_REALTIME_CHECK_DENORMALS("processReplacing");
+		effect_->processReplacing(effect_, inputs, outputs, frame);
+		processing_events_.Clear();
+	}
+
 private:
     //! vOC̏
 	void initialize(size_t sampling_rate, size_t block_size)
@@ -241,7 +367,11 @@ private:
 			if(!proc) { throw std::runtime_error("entry point not found"); }
 		}
 
+        //! VFvOĆAGg|Cg̒audioMasterCurrentId₢킹āA
+        //! ԂꂽID̃TuvOC쐬B
+		SetLoadingShellPluginId(shell_plugin_id_);
 		AEffect *test = proc(&hwm::VstHostCallback);
+		SetLoadingShellPluginId(0);
 		if(!test || test->magic != kEffectMagic) { throw std::runtime_error("not a vst plugin"); }
 
 		effect_ = test;
@@ -277,6 +407,14 @@ private:
 			output_buffer_heads_[i] = output_buffers_[i].data();
 		}
 
+        //! Cxgobt@̊m
+        //! VstEvents^ɁAƂVstEvent̃|C^̗̈悪܂܂Ă̂ŁA
+        //! ۂɊmۂ郁ʂ̓Cxg̂ŌvZĂB
+		pending_events_.Allocate(EVENT_CAPACITY, SYSEX_POOL_SIZE);
+		processing_events_.Allocate(EVENT_CAPACITY, SYSEX_POOL_SIZE);
+		events_storage_.resize(sizeof(VstEvents) + sizeof(VstEvent *) * (EVENT_CAPACITY - 2));
+		events_ = reinterpret_cast<VstEvents *>(events_storage_.data());
+
         //! vOC̎擾
 		std::array<char, kVstMaxEffectNameLen+1> namebuf = {};
 		dispatcher(effGetEffectName, 0, 0, namebuf.data(), 0);
@@ -296,6 +434,9 @@ private:
 				program_names_[i] = "unknown";
 			}
 		}
+
+        //! p[^̃LbV쐬
+		parameters_.reset(new ParameterCache(effect_));
 	}
 
     //! I
@@ -313,6 +454,8 @@ private:
 private:
 	HostApplication *hostapp_;
 	balor::system::Module module_;
+	balor::String module_path_;
+	VstInt32 shell_plugin_id_;
 	balor::gui::Control *parent_;
 	AEffect *effect_;
 
@@ -321,16 +464,23 @@ private:
 	std::vector<float *>			output_buffer_heads_;
 	std::vector<float *>			input_buffer_heads_;
 	boost::mutex mutable			event_buffer_mutex_;
-	std::vector<VstMidiEvent>		midi_events_;
+	VstEventBuffer					pending_events_;
 	bool							is_editor_opened_;
 	std::string						effect_name_;
 	std::string						directory_;
 	std::vector<std::string>		program_names_;
-	std::vector<VstMidiEvent> tmp_;
-	VstEvents *events_;
+	VstEventBuffer					processing_events_;
+	std::vector<char>				events_storage_;
+	VstEvents *						events_;
+	size_t							num_dropped_events_;
+	std::unique_ptr<ParameterCache>	parameters_;
 
 	boost::unique_lock<boost::mutex>
-			get_event_buffer_lock() const { return boost::make_unique_lock(event_buffer_mutex_); }
+			get_event_buffer_lock() const
+	{
+		HWM_REALTIME_CHECK_LOCK("VstPlugin::event_buffer_mutex_");
+		return boost::make_unique_lock(event_buffer_mutex_);
+	}
 };
 
 }
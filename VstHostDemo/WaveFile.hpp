@@ -0,0 +1,611 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <windows.h>
+
+#include "./SampleConversion.hpp"
+
+namespace hwm {
+
+//! WAVt@C̃tH[}bg
+struct WaveFormat
+{
+	enum SampleType { PCM16, PCM24, PCM32, FLOAT32 };
+
+	WaveFormat()
+		:	channels(0)
+		,	sampling_rate(0)
+		,	sample_type(PCM16)
+	{}
+
+	WaveFormat(size_t channels, size_t sampling_rate, SampleType sample_type)
+		:	channels(channels)
+		,	sampling_rate(sampling_rate)
+		,	sample_type(sample_type)
+	{}
+
+	size_t		channels;
+	size_t		sampling_rate;
+	SampleType	sample_type;
+
+	size_t	GetBytesPerSample() const
+	{
+		switch(sample_type) {
+			case PCM16:		return 2;
+			case PCM24:		return 3;
+			default:		return 4;
+		}
+	}
+
+	size_t	GetBlockAlign() const { return GetBytesPerSample() * channels; }
+	bool	IsFloat() const { return sample_type == FLOAT32; }
+};
+
+namespace wave_file_detail {
+
+	enum {
+		WAVE_FORMAT_PCM_TAG			= 0x0001,
+		WAVE_FORMAT_IEEE_FLOAT_TAG	= 0x0003,
+		WAVE_FORMAT_EXTENSIBLE_TAG	= 0xFFFE
+	};
+
+	inline boost::uint16_t ReadU16(unsigned char const *p) { return static_cast<boost::uint16_t>(p[0] | (p[1] << 8)); }
+	inline boost::uint32_t ReadU32(unsigned char const *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<boost::uint32_t>(p[3]) << 24); }
+
+	//! C^[[uꂽ1Tv-1.0 .. 1.0floatɕϊ
+	inline float DecodeSample(unsigned char const *p, WaveFormat::SampleType type)
+	{
+		switch(type) {
+			case WaveFormat::PCM16:
+				return static_cast<boost::int16_t>(ReadU16(p)) / 32768.0f;
+			case WaveFormat::PCM24:
+				return static_cast<boost::int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<boost::uint32_t>(p[2]) << 24)) / 2147483648.0f;
+			case WaveFormat::PCM32:
+				return static_cast<boost::int32_t>(ReadU32(p)) / 2147483648.0f;
+			default:
+				{
+					float f;
+					std::memcpy(&f, p, sizeof(f));
+					return f;
+				}
+		}
+	}
+
+	//! -1.0 .. 1.0floatt@C̃Tv`ɕϊď
+	inline void EncodeSample(float sample, unsigned char *p, WaveFormat::SampleType type)
+	{
+		switch(type) {
+			case WaveFormat::FLOAT32:
+				std::memcpy(p, &sample, sizeof(sample));
+				break;
+			case WaveFormat::PCM16:
+				{
+					boost::int16_t const v = FloatToShort(sample);
+					std::memcpy(p, &v, sizeof(v));
+				}
+				break;
+			case WaveFormat::PCM24:
+				{
+					double const s = std::max<double>(-8388608.0, std::min<double>(sample * 8388608.0, 8388607.0));
+					boost::int32_t const v = static_cast<boost::int32_t>(s);
+					p[0] = static_cast<unsigned char>(v & 0xFF);
+					p[1] = static_cast<unsigned char>((v >> 8) & 0xFF);
+					p[2] = static_cast<unsigned char>((v >> 16) & 0xFF);
+				}
+				break;
+			case WaveFormat::PCM32:
+				{
+					double const s = std::max<double>(-2147483648.0, std::min<double>(sample * 2147483648.0, 2147483647.0));
+					boost::int32_t const v = static_cast<boost::int32_t>(s);
+					std::memcpy(p, &v, sizeof(v));
+				}
+				break;
+		}
+	}
+
+}	//::wave_file_detail
+
+//! }bvgt@CWAVt@CǂݍރNX
+//! t@CŜł͂ȂAVIEW_SIZEoCg̑}bvďɓǂݐi߂̂ŁA
+//! GB̃t@CłgpAhXԂ͈B
+//! ǂݍ񂾃f[^̓C^[[uȂA
+//! Ăяow肵obt@(VstPlugin̓̓obt@Ȃ)ɒڏށB
+struct MappedWaveFileReader
+{
+	enum { VIEW_SIZE = 32 * 1024 * 1024 };
+
+	explicit
+	MappedWaveFileReader(wchar_t const *path)
+		:	file_(INVALID_HANDLE_VALUE)
+		,	mapping_(NULL)
+		,	view_(nullptr)
+		,	view_offset_(0)
+		,	view_length_(0)
+		,	data_offset_(0)
+		,	data_length_(0)
+		,	position_(0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		granularity_ = info.dwAllocationGranularity;
+
+		//! V[PVɓǂݐi߂邱ƂOSɓ`āAǂ݂
+		file_ = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if(file_ == INVALID_HANDLE_VALUE) { throw std::runtime_error("failed to open wave file"); }
+
+		LARGE_INTEGER size;
+		GetFileSizeEx(file_, &size);
+		file_size_ = size.QuadPart;
+
+		mapping_ = CreateFileMappingW(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(!mapping_) {
+			CloseHandle(file_);
+			throw std::runtime_error("failed to map wave file");
+		}
+
+		try {
+			parse_header();
+		} catch(...) {
+			close();
+			throw;
+		}
+	}
+
+	~MappedWaveFileReader()
+	{
+		close();
+	}
+
+	WaveFormat const &	GetFormat() const { return format_; }
+	size_t	GetNumChannels() const { return format_.channels; }
+	size_t	GetSamplingRate() const { return format_.sampling_rate; }
+	boost::uint64_t	GetNumFrames() const { return data_length_ / format_.GetBlockAlign(); }
+	boost::uint64_t	GetPosition() const { return position_ / format_.GetBlockAlign(); }
+
+	//! őframes̃f[^ǂݍ݁Adest[0 .. num_dest_channels)Ƀ`lƂɏށB
+	//! t@C̃`lȂꍇAmt@CȂS`lɓf[^A
+	//! łȂΎc̃`lɖށB
+	//! ۂɓǂݍ񂾃t[ԂBt@CI[ł0ԂB
+	size_t Read(float * const *dest, size_t num_dest_channels, size_t frames)
+	{
+		size_t const block_align = format_.GetBlockAlign();
+		size_t const bytes_per_sample = format_.GetBytesPerSample();
+		size_t const file_channels = format_.channels;
+
+		boost::uint64_t const frames_left = (data_length_ - position_) / block_align;
+		frames = static_cast<size_t>(std::min<boost::uint64_t>(frames, frames_left));
+
+		size_t done = 0;
+		while(done < frames) {
+			boost::uint64_t const byte_pos = data_offset_ + position_;
+			if(byte_pos < view_offset_ || byte_pos + block_align > view_offset_ + view_length_) {
+				map_view(byte_pos);
+			}
+
+			//! ݂̑Ɏ܂Ăt[
+			size_t const in_view = static_cast<size_t>((view_offset_ + view_length_ - byte_pos) / block_align);
+			size_t const n = std::min<size_t>(frames - done, in_view);
+			unsigned char const *src = view_ + (byte_pos - view_offset_);
+
+			for(size_t ch = 0; ch < num_dest_channels; ++ch) {
+				float *dst = dest[ch] + done;
+				if(ch < file_channels || file_channels == 1) {
+					size_t const src_ch = (ch < file_channels) ? ch : 0;
+					unsigned char const *p = src + src_ch * bytes_per_sample;
+					for(size_t fr = 0; fr < n; ++fr, p += block_align) {
+						dst[fr] = wave_file_detail::DecodeSample(p, format_.sample_type);
+					}
+				} else {
+					std::fill(dst, dst + n, 0.0f);
+				}
+			}
+
+			done += n;
+			position_ += n * block_align;
+		}
+
+		return frames;
+	}
+
+private:
+	void map_view(boost::uint64_t byte_pos)
+	{
+		if(view_) {
+			UnmapViewOfFile(view_);
+			view_ = nullptr;
+		}
+
+		//! }bv̊Jnʒu̓AP[Vx̔{łȂ΂ȂȂ
+		boost::uint64_t const offset = byte_pos - (byte_pos % granularity_);
+		boost::uint64_t const length = std::min<boost::uint64_t>(VIEW_SIZE, file_size_ - offset);
+
+		view_ = static_cast<unsigned char const *>(
+			MapViewOfFile(mapping_, FILE_MAP_READ, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset & 0xFFFFFFFF), static_cast<SIZE_T>(length))
+			);
+		if(!view_) { throw std::runtime_error("failed to map view of wave file"); }
+
+		view_offset_ = offset;
+		view_length_ = length;
+	}
+
+	void parse_header()
+	{
+		using namespace wave_file_detail;
+
+		if(file_size_ < 12) { throw std::runtime_error("not a wave file"); }
+
+		map_view(0);
+		if(std::memcmp(view_, "RIFF", 4) != 0 || std::memcmp(view_ + 8, "WAVE", 4) != 0) {
+			throw std::runtime_error("not a wave file");
+		}
+
+		bool found_format = false;
+		boost::uint64_t pos = 12;
+		while(pos + 8 <= file_size_) {
+			if(pos + 8 > view_offset_ + view_length_ || pos < view_offset_) { map_view(pos); }
+			unsigned char const *chunk = view_ + (pos - view_offset_);
+			boost::uint32_t const chunk_size = ReadU32(chunk + 4);
+
+			if(std::memcmp(chunk, "fmt ", 4) == 0) {
+				//! ǂރtB[h`N̒ɂA`NŜt@Cƃ}bv͈͂̒ɂ邱Ƃm߂Ăǂ
+				if(chunk_size < 16) { throw std::runtime_error("broken fmt chunk"); }
+				if(pos + 8 + chunk_size > file_size_) { throw std::runtime_error("broken fmt chunk"); }
+				if(pos + 8 + chunk_size > view_offset_ + view_length_) { map_view(pos); chunk = view_ + (pos - view_offset_); }
+				if(pos + 8 + chunk_size > view_offset_ + view_length_) { throw std::runtime_error("broken fmt chunk"); }
+
+				boost::uint16_t tag = ReadU16(chunk + 8);
+				format_.channels = ReadU16(chunk + 10);
+				format_.sampling_rate = ReadU32(chunk + 12);
+				size_t const bits = ReadU16(chunk + 22);
+
+				//! WAVE_FORMAT_EXTENSIBLȄꍇ́ASubFormatGUID̐擪2oCgۂ̃tH[}bg
+				if(tag == WAVE_FORMAT_EXTENSIBLE_TAG) {
+					if(chunk_size < 40) { throw std::runtime_error("broken fmt chunk"); }
+					tag = ReadU16(chunk + 8 + 24);
+				}
+
+				if(tag == WAVE_FORMAT_PCM_TAG && bits == 16) {
+					format_.sample_type = WaveFormat::PCM16;
+				} else if(tag == WAVE_FORMAT_PCM_TAG && bits == 24) {
+					format_.sample_type = WaveFormat::PCM24;
+				} else if(tag == WAVE_FORMAT_PCM_TAG && bits == 32) {
+					format_.sample_type = WaveFormat::PCM32;
+				} else if(tag == WAVE_FORMAT_IEEE_FLOAT_TAG && bits == 32) {
+					format_.sample_type = WaveFormat::FLOAT32;
+				} else {
+					throw std::runtime_error("unsupported wave format");
+				}
+
+				if(format_.channels == 0) { throw std::runtime_error("broken fmt chunk"); }
+				found_format = true;
+			} else if(std::memcmp(chunk, "data", 4) == 0) {
+				if(!found_format) { throw std::runtime_error("fmt chunk not found"); }
+
+				data_offset_ = pos + 8;
+				//! 4GB𒴂t@Cł̓TCYȂƂ̂ŁAt@CTCYŐ
+				data_length_ = std::min<boost::uint64_t>(chunk_size, file_size_ - data_offset_);
+				if(chunk_size == 0xFFFFFFFF || chunk_size == 0) {
+					data_length_ = file_size_ - data_offset_;
+				}
+				data_length_ -= data_length_ % format_.GetBlockAlign();
+				return;
+			}
+
+			//! `N2oCgEɑĂ
+			pos += 8 + chunk_size + (chunk_size & 1);
+		}
+
+		throw std::runtime_error("data chunk not found");
+	}
+
+	void close()
+	{
+		if(view_) { UnmapViewOfFile(view_); view_ = nullptr; }
+		if(mapping_) { CloseHandle(mapping_); mapping_ = NULL; }
+		if(file_ != INVALID_HANDLE_VALUE) { CloseHandle(file_); file_ = INVALID_HANDLE_VALUE; }
+	}
+
+private:
+	HANDLE					file_;
+	HANDLE					mapping_;
+	unsigned char const *	view_;
+	boost::uint64_t			view_offset_;
+	boost::uint64_t			view_length_;
+	boost::uint64_t			file_size_;
+	boost::uint64_t			data_offset_;
+	boost::uint64_t			data_length_;
+	boost::uint64_t			position_;
+	DWORD					granularity_;
+	WaveFormat				format_;
+
+	MappedWaveFileReader(MappedWaveFileReader const &);
+	MappedWaveFileReader & operator=(MappedWaveFileReader const &);
+};
+
+//! WAVt@CoNX
+//! WriteRawɓnoCĝ܂܃t@Cɏ݁A
+//! Close̎_RIFFwb_̃TCYm肳B
+//! with_headerfalsew肷ƁAwb_Ȃrawt@CƂďoB
+struct WaveFileWriter
+{
+	WaveFileWriter(wchar_t const *path, WaveFormat const &format, bool with_header = true)
+		:	file_(INVALID_HANDLE_VALUE)
+		,	format_(format)
+		,	with_header_(with_header)
+		,	data_length_(0)
+	{
+		BOOST_ASSERT(format.channels > 0);
+
+		file_ = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if(file_ == INVALID_HANDLE_VALUE) { throw std::runtime_error("failed to create wave file"); }
+
+		if(with_header_) {
+			//! TCY͉̒lŏĂACloseŏ
+			write_header();
+		}
+	}
+
+	~WaveFileWriter()
+	{
+		Close();
+	}
+
+	WaveFormat const & GetFormat() const { return format_; }
+	boost::uint64_t GetNumFrames() const { return data_length_ / format_.GetBlockAlign(); }
+
+	//! C^[[uς݂̃f[^
+	void WriteRaw(void const *data, size_t bytes)
+	{
+		BOOST_ASSERT(file_ != INVALID_HANDLE_VALUE);
+
+		char const *p = static_cast<char const *>(data);
+		while(bytes > 0) {
+			DWORD written = 0;
+			DWORD const to_write = static_cast<DWORD>(std::min<size_t>(bytes, 0x40000000));
+			if(!WriteFile(file_, p, to_write, &written, NULL) || written == 0) {
+				throw std::runtime_error("failed to write wave file");
+			}
+			p += written;
+			bytes -= written;
+			data_length_ += written;
+		}
+	}
+
+	//! `lƂɕꂽf[^C^[[uȂ
+	//! t@C̃Tv`ɕϊdestɏށB
+	//! destɂframes * GetBlockAlign()oCgȏ̗̈悪KvB
+	//! src̃`lt@C菭ȂꍇAȂ`l͖ɂȂB
+	static
+	void Interleave(float const * const *src, size_t num_src_channels, size_t frames, WaveFormat const &format, unsigned char *dest)
+	{
+		size_t const block_align = format.GetBlockAlign();
+		size_t const bytes_per_sample = format.GetBytesPerSample();
+
+		for(size_t ch = 0; ch < format.channels; ++ch) {
+			unsigned char *p = dest + ch * bytes_per_sample;
+			if(ch < num_src_channels) {
+				float const *s = src[ch];
+				for(size_t fr = 0; fr < frames; ++fr, p += block_align) {
+					wave_file_detail::EncodeSample(s[fr], p, format.sample_type);
+				}
+			} else {
+				for(size_t fr = 0; fr < frames; ++fr, p += block_align) {
+					wave_file_detail::EncodeSample(0.0f, p, format.sample_type);
+				}
+			}
+		}
+	}
+
+	void Close()
+	{
+		if(file_ == INVALID_HANDLE_VALUE) { return; }
+
+		if(with_header_) {
+			LARGE_INTEGER zero;
+			zero.QuadPart = 0;
+			SetFilePointerEx(file_, zero, NULL, FILE_BEGIN);
+			write_header();
+		}
+
+		CloseHandle(file_);
+		file_ = INVALID_HANDLE_VALUE;
+	}
+
+private:
+	void write_header()
+	{
+		bool const is_float = format_.IsFloat();
+		size_t const fmt_size = is_float ? 18 : 16;
+
+		//! RIFF̃TCY32bitȂ̂ŁA4GB𒴂ꍇ͏lĂ
+		boost::uint64_t const riff_size = 4 + (8 + fmt_size) + 8 + data_length_ + (data_length_ & 1);
+		boost::uint32_t const riff_size32 = static_cast<boost::uint32_t>(std::min<boost::uint64_t>(riff_size, 0xFFFFFFFF));
+		boost::uint32_t const data_size32 = static_cast<boost::uint32_t>(std::min<boost::uint64_t>(data_length_, 0xFFFFFFFF));
+
+		std::vector<unsigned char> header;
+		header.reserve(64);
+		put(header, "RIFF", 4);
+		put_u32(header, riff_size32);
+		put(header, "WAVE", 4);
+		put(header, "fmt ", 4);
+		put_u32(header, static_cast<boost::uint32_t>(fmt_size));
+		put_u16(header, is_float ? wave_file_detail::WAVE_FORMAT_IEEE_FLOAT_TAG : wave_file_detail::WAVE_FORMAT_PCM_TAG);
+		put_u16(header, static_cast<boost::uint16_t>(format_.channels));
+		put_u32(header, static_cast<boost::uint32_t>(format_.sampling_rate));
+		put_u32(header, static_cast<boost::uint32_t>(format_.sampling_rate * format_.GetBlockAlign()));
+		put_u16(header, static_cast<boost::uint16_t>(format_.GetBlockAlign()));
+		put_u16(header, static_cast<boost::uint16_t>(format_.GetBytesPerSample() * 8));
+		if(is_float) { put_u16(header, 0); }
+		put(header, "data", 4);
+		put_u32(header, data_size32);
+
+		DWORD written = 0;
+		if(!WriteFile(file_, header.data(), static_cast<DWORD>(header.size()), &written, NULL)) {
+			throw std::runtime_error("failed to write wave header");
+		}
+	}
+
+	static void put(std::vector<unsigned char> &v, char const *s, size_t n) { v.insert(v.end(), s, s + n); }
+	static void put_u16(std::vector<unsigned char> &v, boost::uint16_t x) { v.push_back(x & 0xFF); v.push_back((x >> 8) & 0xFF); }
+	static void put_u32(std::vector<unsigned char> &v, boost::uint32_t x) { put_u16(v, x & 0xFFFF); put_u16(v, (x >> 16) & 0xFFFF); }
+
+private:
+	HANDLE			file_;
+	WaveFormat		format_;
+	bool			with_header_;
+	boost::uint64_t	data_length_;
+
+	WaveFileWriter(WaveFileWriter const &);
+	WaveFileWriter & operator=(WaveFileWriter const &);
+};
+
+//! _uobt@OWAVt@C񓯊ɏoNX
+//! Writeł̓C^[[uƕϊsĕ\̃obt@ɒ߂邾ŁA
+//! obt@tɂȂ痠̃obt@ƓւāA݃XbhɃt@Cւ݂̏CB
+//! ݃XbhÕobt@IĂȂꍇ̂݁AWrite҂B
+struct AsyncWaveFileWriter
+{
+	enum { DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024 };
+
+	AsyncWaveFileWriter(wchar_t const *path, WaveFormat const &format, size_t buffer_size = DEFAULT_BUFFER_SIZE)
+		:	writer_(path, format)
+		,	front_used_(0)
+		,	back_used_(0)
+		,	terminated_(false)
+	{
+		//! obt@TCY̓t[̋Eɑ
+		size_t const block_align = format.GetBlockAlign();
+		size_t const size = std::max<size_t>(buffer_size - buffer_size % block_align, block_align);
+		front_.resize(size);
+		back_.resize(size);
+
+		write_thread_ = boost::thread([this] { WriteThread(); });
+	}
+
+	~AsyncWaveFileWriter()
+	{
+		try {
+			Close();
+		} catch(...) {}
+	}
+
+	boost::uint64_t GetNumFrames() const { return writer_.GetNumFrames(); }
+
+	void Write(float const * const *src, size_t num_src_channels, size_t frames)
+	{
+		size_t const block_align = writer_.GetFormat().GetBlockAlign();
+		float const *heads[64];
+		BOOST_ASSERT(num_src_channels <= 64);
+
+		size_t done = 0;
+		while(done < frames) {
+			size_t const room = (front_.size() - front_used_) / block_align;
+			size_t const n = std::min<size_t>(frames - done, room);
+
+			for(size_t ch = 0; ch < num_src_channels; ++ch) {
+				heads[ch] = src[ch] + done;
+			}
+			WaveFileWriter::Interleave(heads, num_src_channels, n, writer_.GetFormat(), front_.data() + front_used_);
+
+			front_used_ += n * block_align;
+			done += n;
+
+			if(front_used_ == front_.size()) {
+				submit();
+			}
+		}
+	}
+
+	//! c̃f[^oăt@CB
+	void Close()
+	{
+		if(!write_thread_.joinable()) { return; }
+
+		{
+			boost::unique_lock<boost::mutex> lock(mutex_);
+			while(back_used_ != 0) {
+				cond_.wait(lock);
+			}
+			if(!error_ && front_used_ != 0) {
+				front_.swap(back_);
+				back_used_ = front_used_;
+				front_used_ = 0;
+			}
+			terminated_ = true;
+		}
+		cond_.notify_all();
+		write_thread_.join();
+
+		writer_.Close();
+		if(error_) { throw std::runtime_error(*error_); }
+	}
+
+private:
+	//! \̃obt@݃Xbhɓn
+	void submit()
+	{
+		boost::unique_lock<boost::mutex> lock(mutex_);
+		while(back_used_ != 0) {
+			cond_.wait(lock);
+		}
+		if(error_) { throw std::runtime_error(*error_); }
+
+		front_.swap(back_);
+		back_used_ = front_used_;
+		front_used_ = 0;
+		cond_.notify_all();
+	}
+
+	void WriteThread()
+	{
+		for( ; ; ) {
+			boost::unique_lock<boost::mutex> lock(mutex_);
+			while(back_used_ == 0 && !terminated_) {
+				cond_.wait(lock);
+			}
+			if(back_used_ == 0 && terminated_) { break; }
+
+			size_t const bytes = back_used_;
+			lock.unlock();
+
+			try {
+				writer_.WriteRaw(back_.data(), bytes);
+			} catch(std::exception &e) {
+				lock.lock();
+				error_ = std::string(e.what());
+				back_used_ = 0;
+				cond_.notify_all();
+				break;
+			}
+
+			lock.lock();
+			back_used_ = 0;
+			cond_.notify_all();
+		}
+	}
+
+private:
+	WaveFileWriter				writer_;
+	std::vector<unsigned char>	front_;
+	std::vector<unsigned char>	back_;
+	size_t						front_used_;
+	size_t						back_used_;
+	bool						terminated_;
+	boost::optional<std::string>	error_;
+	boost::mutex				mutex_;
+	boost::condition_variable	cond_;
+	boost::thread				write_thread_;
+};
+
+}	//::hwm
@@ -6,14 +6,20 @@
 
 #include <boost/assert.hpp>
 #include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/range/adaptors.hpp>
 #include <boost/thread.hpp>
+#include <boost/thread/future.hpp>
 
 #include <windows.h>
 #include <mmsystem.h>
 
 #pragma comment(lib, "winmm.lib")
 
+#include "./AudioThread.hpp"
+#include "./ThreadRole.hpp"
+#include "./Trace.hpp"
+
 namespace hwm {
 
 //! WAVEHDR̃bpNX
@@ -74,8 +80,16 @@ struct WaveOutProcessor
 		,	block_size_	(0)
 		,	channel_	(0)
 		,	multiplicity_(0)
+		,	num_underruns_(0)
+		,	num_callbacks_(0)
+		,	total_callback_ticks_(0)
+		,	max_callback_ticks_(0)
 	{
 		InitializeCriticalSection(&cs_);
+
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		ticks_per_sec_ = static_cast<double>(frequency.QuadPart);
 	}
 
 	~WaveOutProcessor() {
@@ -103,6 +117,46 @@ struct WaveOutProcessor
 	callback_function_t				callback_;
 	boost::mutex					initial_lock_mutex_;
 
+	AudioThreadSettings				thread_settings_;
+	AudioThreadSetupResult			thread_setup_result_;
+	MemoryLocker					memory_locker_;
+
+    //! Đ̓vBĐXbhށB
+	boost::atomic<size_t>			num_underruns_;
+	boost::atomic<size_t>			num_callbacks_;
+	boost::atomic<boost::uint64_t>	total_callback_ticks_;
+	boost::atomic<boost::uint64_t>	max_callback_ticks_;
+	double							ticks_per_sec_;
+
+    //! ĐXbh̗DxCPŮ蓖Ă̐ݒ
+    //! OpenDevicȇOɌĂяoB
+	void SetThreadSettings(AudioThreadSettings const &settings) { thread_settings_ = settings; }
+
+    //! ĐXbh̐ݒ茋
+    //! OpenDeviceŗLɂȂB
+	AudioThreadSetupResult const & GetThreadSetupResult() const { return thread_setup_result_; }
+
+    //! ĐɃANZX郁̈vtHgăbNB
+    //! vOC̃obt@ȂǁAfoCX̃obt@ȊÖ̗OpenDevicȇOɂœo^ĂB
+    //! bNCloseDeviceŉB
+    //! ĐɍւvOC̗̈́AĐɃbNAjOUnlockMemoryŉB
+	bool LockMemory(void *data, size_t bytes) { return memory_locker_.Lock(data, bytes); }
+	bool UnlockMemory(void *data, size_t bytes) { return memory_locker_.Unlock(data, bytes); }
+	MemoryLocker const & GetMemoryLocker() const { return memory_locker_; }
+
+    //! foCXɓnĂobt@ׂčĐIĂ(Đr؂ꂽ)
+    //! obt@nOɁAɍĐ̃obt@cĂ邩Ŕ肷BOpenDevice0ɖ߂B
+	size_t GetNumUnderruns() const { return num_underruns_.load(boost::memory_order_relaxed); }
+
+    //! R[obN֐Ăяo񐔂ƁA1񂠂̏(b)̕ςƍő
+	size_t GetNumCallbacks() const { return num_callbacks_.load(boost::memory_order_relaxed); }
+	double GetAverageCallbackSec() const
+	{
+		size_t const n = GetNumCallbacks();
+		return n ? total_callback_ticks_.load(boost::memory_order_relaxed) / ticks_per_sec_ / n : 0;
+	}
+	double GetMaxCallbackSec() const { return max_callback_ticks_.load(boost::memory_order_relaxed) / ticks_per_sec_; }
+
     //! foCXJ
     //! JfoCX̎ẃAWAVE_MAPPERŒB
     //! ȒP̂ߗOSȂǂ͂܂lĂȂ_ɒӁB
@@ -123,7 +177,20 @@ struct WaveOutProcessor
 		boost::unique_lock<boost::mutex> lock(initial_lock_mutex_);
 
 		terminated_ = false;
-		process_thread_ = boost::thread([this] { ProcessThread(); });
+		num_underruns_.store(0);
+		num_callbacks_.store(0);
+		total_callback_ticks_.store(0);
+		max_callback_ticks_.store(0);
+
+        //! Xbh̗DxȂǂ̐ݒ̓XbhgōsKv̂ŁA
+        //! ĐXbh̐擪ŐݒsǍʂ󂯎܂ő҂B
+		boost::promise<AudioThreadSetupResult> setup_promise;
+		boost::unique_future<AudioThreadSetupResult> setup_result = setup_promise.get_future();
+		process_thread_ = boost::thread([this, &setup_promise] {
+			setup_promise.set_value(SetupAudioThread(thread_settings_));
+			ProcessThread();
+		});
+		thread_setup_result_ = setup_result.get();
 
 		WAVEFORMATEX wf;
 		wf.wFormatTag = WAVE_FORMAT_PCM;
@@ -137,6 +204,7 @@ struct WaveOutProcessor
 		headers_.resize(multiplicity_);
 		for(auto &header: headers_) {
 			header.reset(new WaveHeader(block_size * channel * sizeof(short)));
+			LockMemory(header->get()->lpData, header->get()->dwBufferLength);
 		}
 
         //! WAVEHDRgpςݒʒm󂯎Ƃ
@@ -158,6 +226,7 @@ struct WaveOutProcessor
 			process_thread_.join();
 			terminated_ = false;
             hwo_ = NULL;
+			memory_locker_.UnlockAll();
 
 			return false;
 		}
@@ -192,25 +261,45 @@ struct WaveOutProcessor
 			Sleep(10);
 		}
 		hwo_ = NULL;
+
+		memory_locker_.UnlockAll();
 	}
 
     //! foCXI[vɎw肵R[obN֐ĂяoāA
     //! foCXɏo͂I[fBIf[^B
 	void PrepareData(WAVEHDR *header)
 	{
+		HWM_TRACE_SCOPE("device callback");
+
+		LARGE_INTEGER begin, end;
+		QueryPerformanceCounter(&begin);
 		callback_(reinterpret_cast<short *>(header->lpData), channel_, block_size_);
+		QueryPerformanceCounter(&end);
+
+		boost::uint64_t const ticks = static_cast<boost::uint64_t>(end.QuadPart - begin.QuadPart);
+		num_callbacks_.store(num_callbacks_.load(boost::memory_order_relaxed) + 1, boost::memory_order_relaxed);
+		total_callback_ticks_.store(total_callback_ticks_.load(boost::memory_order_relaxed) + ticks, boost::memory_order_relaxed);
+		if(ticks > max_callback_ticks_.load(boost::memory_order_relaxed)) {
+			max_callback_ticks_.store(ticks, boost::memory_order_relaxed);
+		}
 	}
 
     //! Đpf[^̏
     //! WAVEHDR̓ւXƍs[J[Xbh
 	void ProcessThread()
 	{
+		ThreadRole::SetCurrent(ThreadRole::REALTIME);
+		HWM_TRACE_THREAD("ProcessThread");
 		{
 			boost::unique_lock<boost::mutex> lock(initial_lock_mutex_);
 		}
+		size_t last_queued = 0;
+		bool started = false;
 		for( ; ; ) {
 			if(terminated_.load()) { break; }
 
+			size_t num_queued = 0;
+
             //! gpςWAVEHDR̊mF
 			for(auto &header: headers_ | boost::adaptors::indirected) {
 				DWORD_PTR status = NULL;
@@ -243,15 +332,47 @@ struct WaveOutProcessor
 
                     //! WAVEHDRPrepare
 					waveOutPrepareHeader(hwo_, header.get(), sizeof(WAVEHDR));
+
+					//! ŏɃobt@nŁAnOɍĐ̃obt@ȂȂĂAĐr؂ĂB
+					//! (mF̌PrepareDatåԂɓr؂邱Ƃ̂ŁAobt@nтɊmF)
+					if(started && !is_other_header_playing(header.get())) {
+						num_underruns_.store(num_underruns_.load(boost::memory_order_relaxed) + 1, boost::memory_order_relaxed);
+						HWM_TRACE_INSTANT("underrun");
+					}
+					started = true;
                     //! foCX֏o(悤ɓo^)
 					waveOutWrite(hwo_, header.get(), sizeof(WAVEHDR));
 				}
+				if(header.get()->dwUser == WaveHeader::USING) {
+					++num_queued;
+				}
+			}
+
+            //! foCXɓnĂobt@̐B0ɋ߂ÂقǍĐr؂₷B
+			if(num_queued != last_queued) {
+				HWM_TRACE_COUNTER("queued buffers", num_queued);
+				last_queued = num_queued;
 			}
 
 			Sleep(1);
 		}
 	}
 
+    //! headerȊOɁAfoCXɓnĂ܂gpς݂̒ʒmĂȂWAVEHDRtrue
+	bool is_other_header_playing(WAVEHDR const *header)
+	{
+		bool playing = false;
+		EnterCriticalSection(&cs_);
+		for(auto &other: headers_ | boost::adaptors::indirected) {
+			if(other.get() != header && other.get()->dwUser == WaveHeader::USING) {
+				playing = true;
+				break;
+			}
+		}
+		LeaveCriticalSection(&cs_);
+		return playing;
+	}
+
     //! foCX̒ʒm󂯎֐
 	static
 	void CALLBACK waveOutProc(HWAVEOUT hwo, UINT msg, DWORD_PTR instance, DWORD_PTR p1, DWORD_PTR /*p2*/)